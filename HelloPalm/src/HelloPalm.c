@@ -1,6 +1,7 @@
 #include <PalmOS.h>
 #include "HelloPalm.h"
 #include "LogDB.h"
+#include "LogEvt.h"
 
 // Define version 4.0 as the minimum OS version
 #define MinOSVersion sysMakeROMVersion(4, 0, 0, sysROMStageRelease, 0)
@@ -10,6 +11,9 @@ static void AppEventLoop(void);
 static Err AppStart(void);
 static void AppStop(void);
 
+/* Per-event dispatch times, logged on exit */
+static LogEvt_Loop sLoop;
+
 static Err RomVersionCompatible(UInt32 requiredVersion)
 {
   UInt32 romVersion;
@@ -214,30 +218,20 @@ static Err AppStart(void)
 {
   Err e;
   e = LogDB_Init("HelloPalm");
+  LogEvt_Init(&sLoop, 0);
+  LogDB_SetMemInterval(SysTicksPerSecond() * 60UL);
   return e;
 }
 
 static void AppStop(void)
 {
+  LogEvt_Report(&sLoop);
   LogDB_Close();
 }
 
 static void AppEventLoop(void)
 {
-  EventType event;
-  UInt16 err;
-
   /* Open the main form the usual way */
   FrmGotoForm(MainForm);
-
-  do
-  {
-    EvtGetEvent(&event, evtWaitForever);
-
-    if (!SysHandleEvent(&event))
-      if (!MenuHandleEvent(0, &event, &err))
-        if (!AppHandleEvent(&event))
-          FrmDispatchEvent(&event);
-
-  } while (event.eType != appStopEvent);
+  LogEvt_Run(&sLoop, AppHandleEvent);
 }
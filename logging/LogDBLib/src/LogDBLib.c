@@ -0,0 +1,520 @@
+/*
+    LogDBLib shared library: install entry point, dispatch table and traps.
+
+    Built with -DLOGDB_SYSLIB -DBUILDING_LOGDBLIB together with
+    ../common/src/LogDB.c. A SysLib has no A5 globals, so the LogDB state
+    lives in the library's globals block (SysLibTblEntry()->globalsP),
+    allocated on first open and owned by the system so it outlives the app
+    that opened the library.
+*/
+
+#include <PalmOS.h>
+#include "LogDBLib.h"
+#include "LogDBPriv.h"
+
+typedef struct LogDBLib_GlobalsTag
+{
+    UInt16 openCount;
+    LogDB_Globals db;
+} LogDBLib_Globals;
+
+extern MemPtr *LogDBLib_DispatchTable(void);
+
+/* Must be the first function in the code resource. */
+Err start(UInt16 refNum, SysLibTblEntryType *entryP)
+{
+    entryP->dispatchTblP = LogDBLib_DispatchTable();
+    entryP->globalsP = NULL;
+    return errNone;
+}
+
+/*
+    Dispatch table: offset of the library name, one offset per entry
+    point (in trap order), a JMP per entry point, then the name itself.
+*/
+__asm__(
+    "    .text\n"
+    "    .even\n"
+    "    .globl LogDBLib_DispatchTable\n"
+    "LogDBLib_DispatchTable:\n"
+    "    lea     LogDBLib_Table(%pc),%a0\n"
+    "    move.l  %a0,%d0\n"
+    "    rts\n"
+    "LogDBLib_Table:\n"
+    "    .word   LogDBLib_Name-LogDBLib_Table\n"
+    "    .word   LogDBLib_JOpen-LogDBLib_Table\n"
+    "    .word   LogDBLib_JClose-LogDBLib_Table\n"
+    "    .word   LogDBLib_JSleep-LogDBLib_Table\n"
+    "    .word   LogDBLib_JWake-LogDBLib_Table\n"
+    "    .word   LogDBLib_JInit-LogDBLib_Table\n"
+    "    .word   LogDBLib_JLog-LogDBLib_Table\n"
+    "    .word   LogDBLib_JClearAll-LogDBLib_Table\n"
+    "    .word   LogDBLib_JIterBegin-LogDBLib_Table\n"
+    "    .word   LogDBLib_JIterNext-LogDBLib_Table\n"
+    "    .word   LogDBLib_JIterUnlock-LogDBLib_Table\n"
+    "    .word   LogDBLib_JIterEnd-LogDBLib_Table\n"
+    "    .word   LogDBLib_JSetRollPolicy-LogDBLib_Table\n"
+    "    .word   LogDBLib_JPurgeBefore-LogDBLib_Table\n"
+    "    .word   LogDBLib_JIterBeginRange-LogDBLib_Table\n"
+    "    .word   LogDBLib_JInitSinks-LogDBLib_Table\n"
+    "    .word   LogDBLib_JFlush-LogDBLib_Table\n"
+    "    .word   LogDBLib_JIterBeginSink-LogDBLib_Table\n"
+    "    .word   LogDBLib_JLogFields-LogDBLib_Table\n"
+    "    .word   LogDBLib_JIterNextEntry-LogDBLib_Table\n"
+    "    .word   LogDBLib_JFieldNext-LogDBLib_Table\n"
+    "    .word   LogDBLib_JFieldFind-LogDBLib_Table\n"
+    "    .word   LogDBLib_JLogSampled-LogDBLib_Table\n"
+    "    .word   LogDBLib_JMigrate-LogDBLib_Table\n"
+    "    .word   LogDBLib_JCompact-LogDBLib_Table\n"
+    "    .word   LogDBLib_JIterSetApp-LogDBLib_Table\n"
+    "    .word   LogDBLib_JIterTell-LogDBLib_Table\n"
+    "    .word   LogDBLib_JIterSeekEntry-LogDBLib_Table\n"
+    "    .word   LogDBLib_JSetMemInterval-LogDBLib_Table\n"
+    "    .word   LogDBLib_JMemSample-LogDBLib_Table\n"
+    "    .word   LogDBLib_JMemReport-LogDBLib_Table\n"
+    "    .word   LogDBLib_JClearApp-LogDBLib_Table\n"
+    "    .word   LogDBLib_JIdle-LogDBLib_Table\n"
+    "    .word   LogDBLib_JIdleGetStats-LogDBLib_Table\n"
+    "    .word   LogDBLib_JIdleReport-LogDBLib_Table\n"
+    "    .word   LogDBLib_JIterSetText-LogDBLib_Table\n"
+    "    .word   LogDBLib_JCtxInit-LogDBLib_Table\n"
+    "    .word   LogDBLib_JCtxLog-LogDBLib_Table\n"
+    "    .word   LogDBLib_JCtxClose-LogDBLib_Table\n"
+    "    .word   LogDBLib_JSetPressurePolicy-LogDBLib_Table\n"
+    "    .word   LogDBLib_JGetStats-LogDBLib_Table\n"
+    "    .word   LogDBLib_JArchiveTrim-LogDBLib_Table\n"
+    "    .word   LogDBLib_JStatsReport-LogDBLib_Table\n"
+    "    .word   LogDBLib_JSetAppName-LogDBLib_Table\n"
+    "LogDBLib_JOpen:              jmp LogDBLibOpen(%pc)\n"
+    "LogDBLib_JClose:             jmp LogDBLibClose(%pc)\n"
+    "LogDBLib_JSleep:             jmp LogDBLibSleep(%pc)\n"
+    "LogDBLib_JWake:              jmp LogDBLibWake(%pc)\n"
+    "LogDBLib_JInit:              jmp LogDBLibInit(%pc)\n"
+    "LogDBLib_JLog:               jmp LogDBLibLog(%pc)\n"
+    "LogDBLib_JClearAll:          jmp LogDBLibClearAll(%pc)\n"
+    "LogDBLib_JIterBegin:         jmp LogDBLibIterBegin(%pc)\n"
+    "LogDBLib_JIterNext:          jmp LogDBLibIterNext(%pc)\n"
+    "LogDBLib_JIterUnlock:        jmp LogDBLibIterUnlock(%pc)\n"
+    "LogDBLib_JIterEnd:           jmp LogDBLibIterEnd(%pc)\n"
+    "LogDBLib_JSetRollPolicy:     jmp LogDBLibSetRollPolicy(%pc)\n"
+    "LogDBLib_JPurgeBefore:       jmp LogDBLibPurgeBefore(%pc)\n"
+    "LogDBLib_JIterBeginRange:    jmp LogDBLibIterBeginRange(%pc)\n"
+    "LogDBLib_JInitSinks:         jmp LogDBLibInitSinks(%pc)\n"
+    "LogDBLib_JFlush:             jmp LogDBLibFlush(%pc)\n"
+    "LogDBLib_JIterBeginSink:     jmp LogDBLibIterBeginSink(%pc)\n"
+    "LogDBLib_JLogFields:         jmp LogDBLibLogFields(%pc)\n"
+    "LogDBLib_JIterNextEntry:     jmp LogDBLibIterNextEntry(%pc)\n"
+    "LogDBLib_JFieldNext:         jmp LogDBLibFieldNext(%pc)\n"
+    "LogDBLib_JFieldFind:         jmp LogDBLibFieldFind(%pc)\n"
+    "LogDBLib_JLogSampled:        jmp LogDBLibLogSampled(%pc)\n"
+    "LogDBLib_JMigrate:           jmp LogDBLibMigrate(%pc)\n"
+    "LogDBLib_JCompact:           jmp LogDBLibCompact(%pc)\n"
+    "LogDBLib_JIterSetApp:        jmp LogDBLibIterSetApp(%pc)\n"
+    "LogDBLib_JIterTell:          jmp LogDBLibIterTell(%pc)\n"
+    "LogDBLib_JIterSeekEntry:     jmp LogDBLibIterSeekEntry(%pc)\n"
+    "LogDBLib_JSetMemInterval:    jmp LogDBLibSetMemInterval(%pc)\n"
+    "LogDBLib_JMemSample:         jmp LogDBLibMemSample(%pc)\n"
+    "LogDBLib_JMemReport:         jmp LogDBLibMemReport(%pc)\n"
+    "LogDBLib_JClearApp:          jmp LogDBLibClearApp(%pc)\n"
+    "LogDBLib_JIdle:              jmp LogDBLibIdle(%pc)\n"
+    "LogDBLib_JIdleGetStats:      jmp LogDBLibIdleGetStats(%pc)\n"
+    "LogDBLib_JIdleReport:        jmp LogDBLibIdleReport(%pc)\n"
+    "LogDBLib_JIterSetText:       jmp LogDBLibIterSetText(%pc)\n"
+    "LogDBLib_JCtxInit:           jmp LogDBLibCtxInit(%pc)\n"
+    "LogDBLib_JCtxLog:            jmp LogDBLibCtxLog(%pc)\n"
+    "LogDBLib_JCtxClose:          jmp LogDBLibCtxClose(%pc)\n"
+    "LogDBLib_JSetPressurePolicy: jmp LogDBLibSetPressurePolicy(%pc)\n"
+    "LogDBLib_JGetStats:          jmp LogDBLibGetStats(%pc)\n"
+    "LogDBLib_JArchiveTrim:       jmp LogDBLibArchiveTrim(%pc)\n"
+    "LogDBLib_JStatsReport:       jmp LogDBLibStatsReport(%pc)\n"
+    "LogDBLib_JSetAppName:        jmp LogDBLibSetAppName(%pc)\n"
+    "LogDBLib_Name:\n"
+    "    .asciz  \"" LOGDBLIB_NAME "\"\n"
+    "    .even\n");
+
+static LogDBLib_Globals *LogDBLib_Globals_Get(UInt16 refNum)
+{
+    SysLibTblEntryType *entryP;
+
+    entryP = SysLibTblEntry(refNum);
+    return (entryP != NULL) ? (LogDBLib_Globals *)entryP->globalsP : NULL;
+}
+
+/* --- Standard entry points --- */
+
+Err LogDBLibOpen(UInt16 refNum)
+{
+    SysLibTblEntryType *entryP;
+    LogDBLib_Globals *lg;
+
+    entryP = SysLibTblEntry(refNum);
+    if (entryP == NULL)
+        return sysErrParamErr;
+
+    lg = (LogDBLib_Globals *)entryP->globalsP;
+    if (lg == NULL)
+    {
+        lg = (LogDBLib_Globals *)MemPtrNew(sizeof(LogDBLib_Globals));
+        if (lg == NULL)
+            return memErrNotEnoughSpace;
+        MemSet(lg, sizeof(LogDBLib_Globals), 0);
+        /* System-owned: not freed when the opening app exits */
+        MemPtrSetOwner(lg, 0);
+        entryP->globalsP = lg;
+    }
+    lg->openCount++;
+    return errNone;
+}
+
+Err LogDBLibClose(UInt16 refNum, UInt16 *useCountP)
+{
+    LogDBLib_Globals *lg;
+
+    lg = LogDBLib_Globals_Get(refNum);
+    if (lg == NULL)
+        return sysErrParamErr;
+
+    /* The DB stays open with use count 0; that is the point of the library */
+    if (lg->openCount > 0)
+        lg->openCount--;
+    if (useCountP != NULL)
+        *useCountP = lg->openCount;
+    return errNone;
+}
+
+Err LogDBLibSleep(UInt16 refNum)
+{
+    return errNone;
+}
+
+Err LogDBLibWake(UInt16 refNum)
+{
+    return errNone;
+}
+
+/* --- LogDB traps --- */
+
+Err LogDBLibInit(UInt16 refNum, const Char *appName)
+{
+    LogDBLib_Globals *lg;
+
+    lg = LogDBLib_Globals_Get(refNum);
+    if (lg == NULL)
+        return sysErrParamErr;
+    return LogDB_InitG(&lg->db, appName);
+}
+
+Err LogDBLibLog(UInt16 refNum, const Char *message)
+{
+    LogDBLib_Globals *lg;
+
+    lg = LogDBLib_Globals_Get(refNum);
+    if (lg == NULL)
+        return sysErrParamErr;
+    return LogDB_LogG(&lg->db, message);
+}
+
+Err LogDBLibClearAll(UInt16 refNum)
+{
+    LogDBLib_Globals *lg;
+
+    lg = LogDBLib_Globals_Get(refNum);
+    if (lg == NULL)
+        return sysErrParamErr;
+    return LogDB_ClearAllG(&lg->db);
+}
+
+Err LogDBLibIterBegin(UInt16 refNum, LogDB_Iter *it)
+{
+    return LogDB_IterBegin(it);
+}
+
+MemHandle LogDBLibIterNext(UInt16 refNum, LogDB_Iter *it, UInt32 *seconds, Char **appPtr,
+                           Char **msgPtr)
+{
+    return LogDB_IterNext(it, seconds, appPtr, msgPtr);
+}
+
+void LogDBLibIterUnlock(UInt16 refNum, MemHandle h)
+{
+    LogDB_IterUnlock(h);
+}
+
+void LogDBLibIterEnd(UInt16 refNum, LogDB_Iter *it)
+{
+    LogDBLib_Globals *lg;
+
+    lg = LogDBLib_Globals_Get(refNum);
+    if (lg != NULL)
+        LogDB_IterEndG(&lg->db, it);
+}
+
+void LogDBLibSetRollPolicy(UInt16 refNum, const LogDB_RollPolicy *policy)
+{
+    LogDBLib_Globals *lg;
+
+    lg = LogDBLib_Globals_Get(refNum);
+    if (lg != NULL)
+        LogDB_SetRollPolicyG(&lg->db, policy);
+}
+
+Err LogDBLibPurgeBefore(UInt16 refNum, UInt32 secs, UInt16 *purgedP)
+{
+    LogDBLib_Globals *lg;
+
+    lg = LogDBLib_Globals_Get(refNum);
+    if (lg == NULL)
+        return sysErrParamErr;
+    return LogDB_PurgeBeforeG(&lg->db, secs, purgedP);
+}
+
+Err LogDBLibIterBeginRange(UInt16 refNum, LogDB_Iter *it, UInt32 fromSecs, UInt32 toSecs)
+{
+    return LogDB_IterBeginRange(it, fromSecs, toSecs);
+}
+
+Err LogDBLibInitSinks(UInt16 refNum, const Char *appName, UInt16 sinks)
+{
+    LogDBLib_Globals *lg;
+
+    lg = LogDBLib_Globals_Get(refNum);
+    if (lg == NULL)
+        return sysErrParamErr;
+    return LogDB_InitSinksG(&lg->db, appName, sinks);
+}
+
+Err LogDBLibFlush(UInt16 refNum)
+{
+    LogDBLib_Globals *lg;
+
+    lg = LogDBLib_Globals_Get(refNum);
+    if (lg == NULL)
+        return sysErrParamErr;
+    return LogDB_FlushG(&lg->db);
+}
+
+Err LogDBLibIterBeginSink(UInt16 refNum, LogDB_Iter *it, UInt16 sink, UInt32 fromSecs,
+                          UInt32 toSecs)
+{
+    LogDBLib_Globals *lg;
+
+    lg = LogDBLib_Globals_Get(refNum);
+    if (lg == NULL)
+        return sysErrParamErr;
+    return LogDB_IterBeginSinkG(&lg->db, it, sink, fromSecs, toSecs);
+}
+
+Err LogDBLibLogFields(UInt16 refNum, const Char *message, const LogDB_Field *fields,
+                      UInt16 numFields)
+{
+    LogDBLib_Globals *lg;
+
+    lg = LogDBLib_Globals_Get(refNum);
+    if (lg == NULL)
+        return sysErrParamErr;
+    return LogDB_LogFieldsG(&lg->db, message, fields, numFields);
+}
+
+MemHandle LogDBLibIterNextEntry(UInt16 refNum, LogDB_Iter *it, LogDB_Entry *entry)
+{
+    return LogDB_IterNextEntry(it, entry);
+}
+
+Boolean LogDBLibFieldNext(UInt16 refNum, const LogDB_Entry *entry, UInt16 *posP,
+                          LogDB_Field *field)
+{
+    return LogDB_FieldNext(entry, posP, field);
+}
+
+Boolean LogDBLibFieldFind(UInt16 refNum, const LogDB_Entry *entry, const Char *key,
+                          LogDB_Field *field)
+{
+    return LogDB_FieldFind(entry, key, field);
+}
+
+Err LogDBLibLogSampled(UInt16 refNum, UInt16 rate, const Char *message,
+                       const LogDB_Field *fields, UInt16 numFields)
+{
+    LogDBLib_Globals *lg;
+
+    lg = LogDBLib_Globals_Get(refNum);
+    if (lg == NULL)
+        return sysErrParamErr;
+    return LogDB_LogSampledG(&lg->db, rate, message, fields, numFields);
+}
+
+Err LogDBLibMigrate(UInt16 refNum, UInt16 *migratedP)
+{
+    LogDBLib_Globals *lg;
+
+    lg = LogDBLib_Globals_Get(refNum);
+    if (lg == NULL)
+        return sysErrParamErr;
+    return LogDB_MigrateG(&lg->db, migratedP);
+}
+
+Err LogDBLibCompact(UInt16 refNum, UInt32 *packedP)
+{
+    LogDBLib_Globals *lg;
+
+    lg = LogDBLib_Globals_Get(refNum);
+    if (lg == NULL)
+        return sysErrParamErr;
+    return LogDB_CompactG(&lg->db, packedP);
+}
+
+void LogDBLibIterSetApp(UInt16 refNum, LogDB_Iter *it, const Char *app)
+{
+    LogDB_IterSetApp(it, app);
+}
+
+void LogDBLibIterSetText(UInt16 refNum, LogDB_Iter *it, const Char *text)
+{
+    LogDB_IterSetText(it, text);
+}
+
+UInt32 LogDBLibIterTell(UInt16 refNum, const LogDB_Iter *it)
+{
+    return LogDB_IterTell(it);
+}
+
+MemHandle LogDBLibIterSeekEntry(UInt16 refNum, LogDB_Iter *it, UInt32 pos, LogDB_Entry *entry)
+{
+    return LogDB_IterSeekEntry(it, pos, entry);
+}
+
+void LogDBLibSetMemInterval(UInt16 refNum, UInt32 intervalTicks)
+{
+    LogDBLib_Globals *lg;
+
+    lg = LogDBLib_Globals_Get(refNum);
+    if (lg != NULL)
+        LogDB_SetMemIntervalG(&lg->db, intervalTicks);
+}
+
+Err LogDBLibMemSample(UInt16 refNum, Boolean force)
+{
+    LogDBLib_Globals *lg;
+
+    lg = LogDBLib_Globals_Get(refNum);
+    if (lg == NULL)
+        return sysErrParamErr;
+    return LogDB_MemSampleG(&lg->db, force);
+}
+
+Err LogDBLibMemReport(UInt16 refNum)
+{
+    LogDBLib_Globals *lg;
+
+    lg = LogDBLib_Globals_Get(refNum);
+    if (lg == NULL)
+        return sysErrParamErr;
+    return LogDB_MemReportG(&lg->db);
+}
+
+Err LogDBLibClearApp(UInt16 refNum, const Char *app)
+{
+    LogDBLib_Globals *lg;
+
+    lg = LogDBLib_Globals_Get(refNum);
+    if (lg == NULL)
+        return sysErrParamErr;
+    return LogDB_ClearAppG(&lg->db, app);
+}
+
+Boolean LogDBLibIdle(UInt16 refNum, UInt16 tickBudget)
+{
+    LogDBLib_Globals *lg;
+
+    lg = LogDBLib_Globals_Get(refNum);
+    if (lg == NULL)
+        return false;
+    return LogDB_IdleG(&lg->db, tickBudget);
+}
+
+void LogDBLibIdleGetStats(UInt16 refNum, LogDB_IdleStats *stats)
+{
+    LogDBLib_Globals *lg;
+
+    lg = LogDBLib_Globals_Get(refNum);
+    if (lg != NULL)
+        LogDB_IdleGetStatsG(&lg->db, stats);
+    else
+        MemSet(stats, sizeof(LogDB_IdleStats), 0);
+}
+
+Err LogDBLibIdleReport(UInt16 refNum)
+{
+    LogDBLib_Globals *lg;
+
+    lg = LogDBLib_Globals_Get(refNum);
+    if (lg == NULL)
+        return sysErrParamErr;
+    return LogDB_IdleReportG(&lg->db);
+}
+
+/* The context carries everything, so these need no globals either */
+Err LogDBLibCtxInit(UInt16 refNum, LogDB_Ctx *ctx, const Char *appName)
+{
+    return LogDB_CtxInit(ctx, appName);
+}
+
+Err LogDBLibCtxLog(UInt16 refNum, LogDB_Ctx *ctx, const Char *message)
+{
+    return LogDB_CtxLog(ctx, message);
+}
+
+void LogDBLibCtxClose(UInt16 refNum, LogDB_Ctx *ctx)
+{
+    LogDB_CtxClose(ctx);
+}
+
+void LogDBLibSetPressurePolicy(UInt16 refNum, const LogDB_PressurePolicy *policy)
+{
+    LogDBLib_Globals *lg;
+
+    lg = LogDBLib_Globals_Get(refNum);
+    if (lg != NULL)
+        LogDB_SetPressurePolicyG(&lg->db, policy);
+}
+
+void LogDBLibGetStats(UInt16 refNum, LogDB_Stats *stats)
+{
+    LogDBLib_Globals *lg;
+
+    lg = LogDBLib_Globals_Get(refNum);
+    if (lg != NULL)
+        LogDB_GetStatsG(&lg->db, stats);
+    else
+        MemSet(stats, sizeof(LogDB_Stats), 0);
+}
+
+Err LogDBLibArchiveTrim(UInt16 refNum, UInt32 *droppedP)
+{
+    LogDBLib_Globals *lg;
+
+    lg = LogDBLib_Globals_Get(refNum);
+    if (lg == NULL)
+        return sysErrParamErr;
+    return LogDB_ArchiveTrimG(&lg->db, droppedP);
+}
+
+Err LogDBLibStatsReport(UInt16 refNum)
+{
+    LogDBLib_Globals *lg;
+
+    lg = LogDBLib_Globals_Get(refNum);
+    if (lg == NULL)
+        return sysErrParamErr;
+    return LogDB_StatsReportG(&lg->db);
+}
+
+Err LogDBLibSetAppName(UInt16 refNum, const Char *appName)
+{
+    LogDBLib_Globals *lg;
+
+    lg = LogDBLib_Globals_Get(refNum);
+    if (lg == NULL)
+        return sysErrParamErr;
+    return LogDB_SetAppNameG(&lg->db, appName);
+}
@@ -0,0 +1,401 @@
+#include <PalmOS.h>
+#include "LogTest.h"
+#include "LogStress.h"
+#include "LogDB.h"
+
+/*
+    Stress form: one repeatable load through LogDB_Log.
+
+    A run writes count lines of size bytes, spread round-robin over apps
+    app names ("Stress0", "Stress1", ...), either as fast as the device
+    goes (burst) or at rate lines a second (steady). Every LogDB_Log call
+    is timed on its own; a switch of app name is not part of its time.
+    The run is stepped from the event loop, so the form stays live and
+    Done stops it.
+
+    At the end the form shows, and the DebugLog gets as a "stressCfg" and
+    a "stress" record: lines a second, call latency percentiles in ticks
+    (0 = under a tick, which is most calls) and how far the storage heap's
+    free space fell, in all and per line.
+*/
+
+#define STRESS_MAX_COUNT 60000UL
+#define STRESS_MIN_SIZE 16  /* room for the sequence number */
+#define STRESS_MAX_SIZE 255
+#define STRESS_MAX_APPS 32
+#define STRESS_LAT_SLOTS 32 /* one per tick; the last is 32 and up */
+#define STRESS_STEP_TICKS 5
+#define STRESS_REDRAW_TICKS 50
+
+typedef struct
+{
+    /* Settings, kept between openings of the form */
+    UInt32 count;
+    UInt16 size;
+    UInt16 apps;
+    UInt16 mode; /* STRESS_* */
+    UInt16 rate; /* lines a second, steady */
+
+    /* The run */
+    Boolean busy;
+    Boolean done; /* results to show */
+    UInt32 sent;
+    UInt32 startTicks;
+    UInt32 endTicks;
+    UInt32 lastDraw;
+    UInt32 freeBefore;
+    Int32 grew; /* bytes of storage heap used by the run */
+    UInt16 errs;
+    UInt16 maxTicks;
+    UInt16 curApp;
+    UInt32 lat[STRESS_LAT_SLOTS + 1];
+    Char msg[STRESS_MAX_SIZE + 1];
+} StressState;
+
+static StressState sStress = {1000, 64, 1, STRESS_Burst, 100};
+
+static UInt32 Stress_StorageFree(void)
+{
+    UInt32 freeBytes;
+    UInt32 maxChunk;
+
+    if (MemHeapFreeBytes(MemHeapID(0, 1), &freeBytes, &maxChunk) != errNone)
+        return 0;
+    return freeBytes;
+}
+
+Boolean Stress_Busy(void)
+{
+    return sStress.busy;
+}
+
+Int32 Stress_Timeout(void)
+{
+    if (!sStress.busy)
+        return evtWaitForever;
+    return (sStress.mode == STRESS_Steady) ? 1 : 0;
+}
+
+/* Smallest latency, in ticks, at or under which pct percent of calls
+   came in. */
+static UInt16 Stress_Percentile(UInt16 pct)
+{
+    UInt32 want;
+    UInt32 seen;
+    UInt16 i;
+
+    if (sStress.sent == 0)
+        return 0;
+    want = (sStress.sent * pct + 99) / 100;
+    seen = 0;
+    for (i = 0; i < STRESS_LAT_SLOTS; i++)
+    {
+        seen += sStress.lat[i];
+        if (seen >= want)
+            return i;
+    }
+    return sStress.maxTicks;
+}
+
+static UInt32 Stress_LinesPerSec(void)
+{
+    UInt32 ticks;
+
+    ticks = sStress.endTicks - sStress.startTicks;
+    if (ticks == 0)
+        ticks = 1;
+    if (sStress.sent > 0xFFFFFFFFUL / SysTicksPerSecond())
+        return sStress.sent / ticks * SysTicksPerSecond();
+    return sStress.sent * SysTicksPerSecond() / ticks;
+}
+
+/* --- Drawing --- */
+
+static void Stress_DrawResults(void)
+{
+    FormType *frm;
+    RectangleType r;
+    Char line[48];
+    Coord y;
+    Int16 h;
+
+    frm = FrmGetActiveForm();
+    FrmGetObjectBounds(frm, FrmGetObjectIndex(frm, LogStressResultGadID), &r);
+    WinEraseRectangle(&r, 0);
+    if (!sStress.busy && !sStress.done)
+        return;
+    h = FntLineHeight();
+    y = r.topLeft.y;
+
+    StrPrintF(line, "%lu lines in %lu ticks%s", sStress.sent,
+              sStress.endTicks - sStress.startTicks, sStress.busy ? " ..." : "");
+    WinDrawChars(line, StrLen(line), r.topLeft.x, y);
+    y += h;
+    StrPrintF(line, "%lu lines/sec, %u errors", Stress_LinesPerSec(), sStress.errs);
+    WinDrawChars(line, StrLen(line), r.topLeft.x, y);
+    y += h;
+    StrPrintF(line, "Ticks p50 %u p90 %u p99 %u max %u", Stress_Percentile(50),
+              Stress_Percentile(90), Stress_Percentile(99), sStress.maxTicks);
+    WinDrawChars(line, StrLen(line), r.topLeft.x, y);
+    y += h;
+    if (sStress.done)
+    {
+        StrPrintF(line, "Storage %ld bytes, %ld/line", sStress.grew,
+                  (sStress.sent > 0) ? sStress.grew / (Int32)sStress.sent : 0L);
+        WinDrawChars(line, StrLen(line), r.topLeft.x, y);
+    }
+}
+
+/* --- The run --- */
+
+static void Stress_Report(void)
+{
+    LogDB_Field f[8];
+
+    LogDB_FieldUInt32(&f[0], "n", sStress.count);
+    LogDB_FieldUInt32(&f[1], "size", sStress.size);
+    LogDB_FieldUInt32(&f[2], "apps", sStress.apps);
+    LogDB_FieldUInt32(&f[3], "mode", sStress.mode);
+    LogDB_FieldUInt32(&f[4], "rate", sStress.rate);
+    LogDB_LogFields("stressCfg", f, 5);
+
+    LogDB_FieldUInt32(&f[0], "lines", sStress.sent);
+    LogDB_FieldUInt32(&f[1], "ticks", sStress.endTicks - sStress.startTicks);
+    LogDB_FieldUInt32(&f[2], "lps", Stress_LinesPerSec());
+    LogDB_FieldUInt32(&f[3], "p50", Stress_Percentile(50));
+    LogDB_FieldUInt32(&f[4], "p90", Stress_Percentile(90));
+    LogDB_FieldUInt32(&f[5], "p99", Stress_Percentile(99));
+    LogDB_FieldUInt32(&f[6], "max", sStress.maxTicks);
+    LogDB_FieldInt32(&f[7], "grew", sStress.grew);
+    LogDB_LogFields("stress", f, 8);
+    if (sStress.errs > 0)
+    {
+        LogDB_FieldUInt32(&f[0], "errs", sStress.errs);
+        LogDB_LogFields("stress errors", f, 1);
+    }
+}
+
+static void Stress_Finish(void)
+{
+    sStress.endTicks = TimGetTicks();
+    sStress.grew = (Int32)(sStress.freeBefore - Stress_StorageFree());
+    sStress.busy = false;
+    sStress.done = true;
+
+    /* Back to our own name */
+    if (sStress.apps > 1)
+        LogDB_SetAppName(LOGTEST_APP_NAME);
+    Stress_Report();
+}
+
+void Stress_Cancel(void)
+{
+    if (sStress.busy)
+        Stress_Finish();
+}
+
+static void Stress_Begin(void)
+{
+    sStress.busy = true;
+    sStress.done = false;
+    sStress.sent = 0;
+    sStress.errs = 0;
+    sStress.maxTicks = 0;
+    sStress.curApp = 0;
+    MemSet(sStress.lat, sizeof(sStress.lat), 0);
+
+    /* Sequence number, then filler to size */
+    MemSet(sStress.msg, sizeof(sStress.msg), 0);
+    MemSet(sStress.msg, sStress.size, 'x');
+
+    /* The first name switch happens here, so it is not in the first
+       line's time */
+    if (sStress.apps > 1)
+        LogDB_SetAppName("Stress0");
+    sStress.freeBefore = Stress_StorageFree();
+    sStress.startTicks = TimGetTicks();
+    sStress.endTicks = sStress.startTicks;
+    sStress.lastDraw = sStress.startTicks;
+}
+
+void Stress_Step(void)
+{
+    Char name[12];
+    Char seq[12];
+    UInt32 stepStart;
+    UInt32 due;
+    UInt32 t0;
+    UInt32 ticks;
+    UInt16 len;
+
+    if (!sStress.busy)
+        return;
+    stepStart = TimGetTicks();
+    for (;;)
+    {
+        if (sStress.sent >= sStress.count)
+        {
+            Stress_Finish();
+            Stress_DrawResults();
+            return;
+        }
+
+        /* Steady: only the lines whose time has come */
+        if (sStress.mode == STRESS_Steady)
+        {
+            due = (TimGetTicks() - sStress.startTicks) * sStress.rate / SysTicksPerSecond() + 1;
+            if (sStress.sent >= due)
+                break;
+        }
+
+        if (sStress.apps > 1)
+        {
+            sStress.curApp = (UInt16)(sStress.sent % sStress.apps);
+            if (sStress.sent > 0)
+            {
+                StrPrintF(name, "Stress%u", sStress.curApp);
+                LogDB_SetAppName(name);
+            }
+        }
+        len = (UInt16)StrPrintF(seq, "%06lu ", sStress.sent);
+        MemMove(sStress.msg, seq, len);
+
+        t0 = TimGetTicks();
+        if (LogDB_Log(sStress.msg) != errNone)
+            sStress.errs++;
+        ticks = TimGetTicks() - t0;
+
+        sStress.sent++;
+        if (ticks > sStress.maxTicks)
+            sStress.maxTicks = (ticks > 0xFFFF) ? 0xFFFF : (UInt16)ticks;
+        sStress.lat[(ticks < STRESS_LAT_SLOTS) ? ticks : STRESS_LAT_SLOTS]++;
+
+        if (TimGetTicks() - stepStart >= STRESS_STEP_TICKS)
+            break;
+    }
+
+    sStress.endTicks = TimGetTicks();
+    if (sStress.endTicks - sStress.lastDraw >= STRESS_REDRAW_TICKS)
+    {
+        sStress.lastDraw = sStress.endTicks;
+        Stress_DrawResults();
+    }
+}
+
+/* --- Form --- */
+
+static FieldType *Stress_Field(UInt16 id)
+{
+    FormType *frm;
+
+    frm = FrmGetActiveForm();
+    return (FieldType *)FrmGetObjectPtr(frm, FrmGetObjectIndex(frm, id));
+}
+
+static void Stress_SetNumber(UInt16 id, UInt32 value)
+{
+    FieldType *fld;
+    Char num[12];
+
+    fld = Stress_Field(id);
+    StrPrintF(num, "%lu", value);
+    FldDelete(fld, 0, FldGetTextLength(fld));
+    FldInsert(fld, num, StrLen(num));
+}
+
+/* Field as a number, clamped to lo..hi (lo when empty). */
+static UInt32 Stress_GetNumber(UInt16 id, UInt32 lo, UInt32 hi)
+{
+    Char *text;
+    UInt32 value;
+
+    text = FldGetTextPtr(Stress_Field(id));
+    value = (text != NULL) ? (UInt32)StrAToI(text) : 0;
+    if (value < lo)
+        value = lo;
+    if (value > hi)
+        value = hi;
+    return value;
+}
+
+/* Settings from the form, clamped, and shown as they will be used. */
+static void Stress_ReadSettings(void)
+{
+    sStress.count = Stress_GetNumber(LogStressCountFldID, 1, STRESS_MAX_COUNT);
+    sStress.size = (UInt16)Stress_GetNumber(LogStressSizeFldID, STRESS_MIN_SIZE, STRESS_MAX_SIZE);
+    sStress.apps = (UInt16)Stress_GetNumber(LogStressAppsFldID, 1, STRESS_MAX_APPS);
+    sStress.rate = (UInt16)Stress_GetNumber(LogStressRateFldID, 1, 1000);
+    Stress_SetNumber(LogStressCountFldID, sStress.count);
+    Stress_SetNumber(LogStressSizeFldID, sStress.size);
+    Stress_SetNumber(LogStressAppsFldID, sStress.apps);
+    Stress_SetNumber(LogStressRateFldID, sStress.rate);
+}
+
+static void Stress_ShowSettings(void)
+{
+    FormType *frm;
+    ListType *lst;
+    ControlType *trg;
+
+    Stress_SetNumber(LogStressCountFldID, sStress.count);
+    Stress_SetNumber(LogStressSizeFldID, sStress.size);
+    Stress_SetNumber(LogStressAppsFldID, sStress.apps);
+    Stress_SetNumber(LogStressRateFldID, sStress.rate);
+
+    frm = FrmGetActiveForm();
+    lst = (ListType *)FrmGetObjectPtr(frm, FrmGetObjectIndex(frm, LogStressModeListID));
+    trg = (ControlType *)FrmGetObjectPtr(frm, FrmGetObjectIndex(frm, LogStressModeTrigID));
+    LstSetSelection(lst, sStress.mode);
+    CtlSetLabel(trg, LstGetSelectionText(lst, sStress.mode));
+}
+
+Boolean StressFormHandleEvent(EventType *eventP)
+{
+    FormType *frm;
+    Boolean handled;
+
+    handled = false;
+    switch (eventP->eType)
+    {
+    case frmOpenEvent:
+        frm = FrmGetActiveForm();
+        Stress_ShowSettings();
+        FrmDrawForm(frm);
+        Stress_DrawResults();
+        handled = true;
+        break;
+
+    case popSelectEvent:
+        /* The trigger label is left to the form */
+        if (eventP->data.popSelect.listID == LogStressModeListID)
+            sStress.mode = (UInt16)eventP->data.popSelect.selection;
+        break;
+
+    case ctlSelectEvent:
+        if (eventP->data.ctlSelect.controlID == LogStressBtnStartID)
+        {
+            if (!sStress.busy)
+            {
+                Stress_ReadSettings();
+                Stress_Begin();
+                Stress_DrawResults();
+            }
+            handled = true;
+        }
+        else if (eventP->data.ctlSelect.controlID == LogStressBtnDoneID)
+        {
+            Stress_Cancel();
+            FrmReturnToForm(LogTestFormID);
+            handled = true;
+        }
+        break;
+
+    case frmCloseEvent:
+        Stress_Cancel();
+        break;
+
+    default:
+        break;
+    }
+    return handled;
+}
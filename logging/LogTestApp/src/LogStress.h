@@ -0,0 +1,15 @@
+#ifndef LOGSTRESS_H
+#define LOGSTRESS_H
+
+/* Stress form: a configurable load through LogDB_Log, timed. */
+
+/* The run is written a step at a time from the event loop; Stress_Timeout
+   is what to pass EvtGetEvent (evtWaitForever when idle) */
+Boolean Stress_Busy(void);
+Int32 Stress_Timeout(void);
+void Stress_Step(void);
+void Stress_Cancel(void);
+
+Boolean StressFormHandleEvent(EventType *eventP);
+
+#endif /* LOGSTRESS_H */
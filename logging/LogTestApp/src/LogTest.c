@@ -1,6 +1,9 @@
 #include <PalmOS.h>
 #include "LogTest.h"
 #include "LogDB.h"
+#include "LogEvt.h"
+#include "LogRing.h"
+#include "LogStress.h"
 
 /* Forward decls */
 static Boolean AppHandleEvent(EventType *eventP);
@@ -9,6 +12,23 @@ static void AppEventLoop(void);
 static Err AppStart(void);
 static void AppStop(void);
 
+/* Per-event dispatch times, logged on exit */
+static LogEvt_Loop sLoop;
+
+/* Pen drags fire many events a second: keep one in 16 */
+static LogDB_Site sPenSite = LOGDB_SITE_EVERY(16);
+
+/* Lines from the wakeup notification handler, drained by the loop */
+static LogRing_Buffer sRing;
+
+/* Called by the Notification Manager, not the event loop: no LogDB_Log
+   here, only the ring it was registered with. */
+static Err WakeupNotify(SysNotifyParamType *notifyParamsP)
+{
+    LogRing_Put((LogRing_Buffer *)notifyParamsP->userDataP, "Late wakeup");
+    return errNone;
+}
+
 UInt32 PilotMain(UInt16 cmd, MemPtr cmdPBP, UInt16 launchFlags)
 {
     Err err;
@@ -21,18 +41,53 @@ UInt32 PilotMain(UInt16 cmd, MemPtr cmdPBP, UInt16 launchFlags)
         AppEventLoop();
         AppStop();
     }
+    else if (cmd == sysAppLaunchCmdSystemReset || cmd == sysAppLaunchCmdTimeChange)
+    {
+        /* Sent to every app, without globals: a line through a context */
+        LogDB_Ctx ctx;
+
+        if (LogDB_CtxInit(&ctx, LOGTEST_APP_NAME) == errNone)
+        {
+            LogDB_CtxLog(&ctx, (cmd == sysAppLaunchCmdSystemReset) ? "System reset"
+                                                                     : "Clock changed");
+            LogDB_CtxClose(&ctx);
+        }
+    }
     return errNone;
 }
 
 static Err AppStart(void)
 {
     Err e;
-    e = LogDB_Init("LogTestApp");
+    UInt16 cardNo;
+    LocalID dbID;
+
+    e = LogDB_Init(LOGTEST_APP_NAME);
+
+    /* What the last HotSync backed up need not go again */
+    if (e == errNone)
+        LogDB_ArchiveTrim(NULL);
+    LogEvt_Init(&sLoop, 0);
+    LogDB_SetMemInterval(SysTicksPerSecond() * (UInt32)LOGTEST_MEM_SECS);
+
+    LogRing_Init(&sRing);
+    LogEvt_SetRing(&sLoop, &sRing);
+    if (SysCurAppDatabase(&cardNo, &dbID) == errNone)
+        SysNotifyRegister(cardNo, dbID, sysNotifyLateWakeupEvent, WakeupNotify,
+                          sysNotifyNormalPriority, &sRing);
     return e;
 }
 
 static void AppStop(void)
 {
+    UInt16 cardNo;
+    LocalID dbID;
+
+    if (SysCurAppDatabase(&cardNo, &dbID) == errNone)
+        SysNotifyUnregister(cardNo, dbID, sysNotifyLateWakeupEvent, sysNotifyNormalPriority);
+    Stress_Cancel();
+    LogRing_Drain(&sRing);
+    LogEvt_Report(&sLoop);
     LogDB_Close();
 }
 
@@ -47,20 +102,31 @@ static void OpenMainForm(void)
 static void AppEventLoop(void)
 {
     EventType event;
-    UInt16 err;
+    Int32 timeout;
 
     /* Open the main form the usual way */
     FrmGotoForm(LogTestFormID);
 
+    /* LogEvt_Run, but a stress run is written on nil events, and LogDB's
+       upkeep runs on them when there is no run */
     do
     {
-        EvtGetEvent(&event, evtWaitForever);
-
-        if (!SysHandleEvent(&event))
-            if (!MenuHandleEvent(0, &event, &err))
-                if (!AppHandleEvent(&event))
-                    FrmDispatchEvent(&event);
-
+        timeout = Stress_Timeout();
+        if (timeout == evtWaitForever && LogDB_Idle(0))
+            timeout = LOGTEST_IDLE_TICKS;
+        EvtGetEvent(&event, timeout);
+        LogEvt_Dispatch(&sLoop, &event, AppHandleEvent);
+        if (event.eType != nilEvent)
+            continue;
+        if (Stress_Busy())
+        {
+            if (FrmGetActiveFormID() == LogStressFormID)
+                Stress_Step();
+        }
+        else
+        {
+            LogDB_Idle(LOGTEST_IDLE_BUDGET);
+        }
     } while (event.eType != appStopEvent);
 }
 
@@ -79,6 +145,13 @@ static Boolean AppHandleEvent(EventType *eventP)
             FrmSetEventHandler(frmP, MainFormHandleEvent);
             return true;
         }
+        if (formId == LogStressFormID)
+        {
+            frmP = FrmInitForm(formId);
+            FrmSetActiveForm(frmP);
+            FrmSetEventHandler(frmP, StressFormHandleEvent);
+            return true;
+        }
     }
     return false;
 }
@@ -92,13 +165,36 @@ static Boolean MainFormHandleEvent(EventType *eventP)
     case ctlSelectEvent:
         if (eventP->data.ctlSelect.controlID == LogTestBtnHelloID)
         {
-            /* Write a log line */
-            LogDB_Log("Button Clicked");
+            LogDB_Field fields[2];
+
+            /* Write a log line, tagged so the viewer can filter on form=1000 */
+            LogDB_FieldUInt32(&fields[0], "form", LogTestFormID);
+            LogDB_FieldUInt32(&fields[1], "ctl", LogTestBtnHelloID);
+            LogDB_LogFields("Button Clicked", fields, 2);
             SndPlaySystemSound(sndClick);
             handled = true;
         }
         break;
 
+    case menuEvent:
+        if (eventP->data.menu.itemID == LogTestMenuStressID)
+        {
+            FrmPopupForm(LogStressFormID);
+            handled = true;
+        }
+        break;
+
+    case penMoveEvent:
+        if (LogDB_Sample(&sPenSite))
+        {
+            LogDB_Field fields[2];
+
+            LogDB_FieldInt32(&fields[0], "x", eventP->screenX);
+            LogDB_FieldInt32(&fields[1], "y", eventP->screenY);
+            LogDB_LogSampled(sPenSite.rate, "penMove", fields, 2);
+        }
+        break;
+
     case frmOpenEvent:
         FrmDrawForm(FrmGetActiveForm());
         handled = true;
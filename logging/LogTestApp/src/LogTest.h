@@ -5,9 +5,38 @@
 #define LOGTEST_CREATOR 'LTst'
 #define LOGTEST_TYPE 'appl'
 
+/* Name the app logs under, and its memory sample interval (LogStress.c
+   switches names during a run and puts both back after) */
+#define LOGTEST_APP_NAME "LogTestApp"
+#define LOGTEST_MEM_SECS 60
+
+/* Ticks without events before LogDB's upkeep runs, and its share then */
+#define LOGTEST_IDLE_TICKS 10
+#define LOGTEST_IDLE_BUDGET 5
+
 /* Form and controls */
 #define LogTestFormID 1000
 #define LogTestBtnHelloID 1001
 #define LogTestStrVerID 2000
 
+/* Menu */
+#define LogTestMenuID 1020
+#define LogTestMenuStressID 1021
+
+/* Stress form (LogStress.c) */
+#define LogStressFormID 1100
+#define LogStressCountFldID 1101
+#define LogStressSizeFldID 1102
+#define LogStressAppsFldID 1103
+#define LogStressModeTrigID 1104
+#define LogStressModeListID 1105
+#define LogStressRateFldID 1106
+#define LogStressResultGadID 1107
+#define LogStressBtnStartID 1108
+#define LogStressBtnDoneID 1109
+
+/* Stress mode (list indices) */
+#define STRESS_Burst 0
+#define STRESS_Steady 1
+
 #endif /* LOGTEST_H */
@@ -0,0 +1,359 @@
+#include <PalmOS.h>
+#include "LogRows.h"
+
+/*
+    Row view for the main form's log.
+
+    The text is laid out into rows (word-wrapped at the gadget's width)
+    once, when it arrives: a row is the offset where it starts, and it
+    ends where the next one does. The viewer's load writes its lines
+    straight onto the end (Rows_Extend), so the page is held once, and
+    only the new lines are laid out.
+
+    The visible rows live in an offscreen window the size of the gadget.
+    Scrolling moves that window's bits with WinScrollRectangle, draws the
+    rows scrolled into view and copies the result to the screen in one
+    blit, so a scroll step costs the rows it exposes rather than a redraw
+    of the whole page. A repaint (the form coming back from the stats
+    form) is the blit alone. Without memory for the offscreen window the
+    same steps run on the screen itself.
+*/
+
+#define ROWS_FIRST_CAP 256
+
+typedef struct
+{
+    UInt16 formID;
+    UInt16 scbID;
+    RectangleType bounds; /* the gadget, in form coordinates */
+    WinHandle backW;      /* offscreen copy of the gadget, or NULL */
+    Int16 lineH;
+    UInt16 visible;       /* whole rows that fit */
+
+    Char *text;
+    UInt32 textLen;
+    UInt32 textCap;
+
+    UInt32 *rows; /* where each row starts in text */
+    UInt16 numRows;
+    UInt16 rowCap;
+    UInt16 top;   /* first row shown */
+} RowsState;
+
+static RowsState sRows;
+
+const Char *Rows_Text(UInt32 *lenP)
+{
+    if (lenP != NULL)
+        *lenP = sRows.textLen;
+    return (sRows.text != NULL) ? sRows.text : "";
+}
+
+/* --- Layout --- */
+
+static Boolean Rows_Add(UInt32 start)
+{
+    UInt32 *tmp;
+    UInt16 ncap;
+
+    if (sRows.numRows == sRows.rowCap)
+    {
+        if (sRows.rowCap >= 0x8000)
+            return false;
+        ncap = (sRows.rowCap == 0) ? ROWS_FIRST_CAP : (UInt16)(sRows.rowCap * 2);
+        tmp = (UInt32 *)MemPtrNew((UInt32)ncap * sizeof(UInt32));
+        if (tmp == NULL)
+            return false;
+        if (sRows.rows != NULL)
+        {
+            MemMove(tmp, sRows.rows, (UInt32)sRows.numRows * sizeof(UInt32));
+            MemPtrFree(sRows.rows);
+        }
+        sRows.rows = tmp;
+        sRows.rowCap = ncap;
+    }
+    sRows.rows[sRows.numRows++] = start;
+    return true;
+}
+
+/* Rows for text from pos on; pos starts a row. Stops early, showing
+   less, when the row table cannot grow. */
+static void Rows_Layout(UInt32 pos)
+{
+    UInt16 n;
+
+    while (pos < sRows.textLen)
+    {
+        if (!Rows_Add(pos))
+            return;
+        /* Counts the line end it stops at; always make progress */
+        n = FntWordWrap(sRows.text + pos, (UInt16)sRows.bounds.extent.x);
+        pos += (n > 0) ? n : 1;
+    }
+}
+
+/* Start and length of row, without its line end. */
+static UInt16 Rows_Span(UInt16 row, UInt32 *startP)
+{
+    UInt32 end;
+
+    *startP = sRows.rows[row];
+    end = (row + 1 < sRows.numRows) ? sRows.rows[row + 1] : sRows.textLen;
+    if (end > *startP && sRows.text[end - 1] == '\n')
+        end--;
+    return (UInt16)(end - *startP);
+}
+
+/* --- Drawing --- */
+
+static Boolean Rows_OnScreen(void)
+{
+    return FrmGetActiveFormID() == sRows.formID;
+}
+
+/* Draw visible rows first..last-1 (0 = the top one shown) into the back
+   buffer, or the screen if there is none. */
+static void Rows_Paint(UInt16 first, UInt16 last)
+{
+    WinHandle oldW;
+    RectangleType r;
+    Coord x;
+    Coord y;
+    UInt32 start;
+    UInt16 len;
+    UInt16 i;
+
+    if (sRows.backW == NULL && !Rows_OnScreen())
+        return;
+    oldW = NULL;
+    if (sRows.backW != NULL)
+    {
+        oldW = WinSetDrawWindow(sRows.backW);
+        x = 0;
+        y = 0;
+    }
+    else
+    {
+        x = sRows.bounds.topLeft.x;
+        y = sRows.bounds.topLeft.y;
+    }
+
+    /* The last band runs to the bottom, past the last whole row */
+    r.topLeft.x = x;
+    r.topLeft.y = (Coord)(y + first * sRows.lineH);
+    r.extent.x = sRows.bounds.extent.x;
+    r.extent.y = (Coord)((last >= sRows.visible) ? sRows.bounds.extent.y - first * sRows.lineH
+                                                 : (last - first) * sRows.lineH);
+    WinEraseRectangle(&r, 0);
+    for (i = first; i < last && sRows.top + i < sRows.numRows; i++)
+    {
+        len = Rows_Span((UInt16)(sRows.top + i), &start);
+        WinDrawChars(sRows.text + start, len, x, (Coord)(y + i * sRows.lineH));
+    }
+
+    if (oldW != NULL)
+        WinSetDrawWindow(oldW);
+}
+
+/* Back buffer to the screen */
+static void Rows_Blit(void)
+{
+    RectangleType r;
+
+    if (sRows.backW == NULL || !Rows_OnScreen())
+        return;
+    r.topLeft.x = 0;
+    r.topLeft.y = 0;
+    r.extent = sRows.bounds.extent;
+    WinCopyRectangle(sRows.backW, NULL, &r, sRows.bounds.topLeft.x, sRows.bounds.topLeft.y,
+                     winPaint);
+}
+
+static void Rows_UpdateScrollBar(void)
+{
+    FormType *frm;
+    ScrollBarType *scb;
+    UInt16 maxTop;
+
+    if (!Rows_OnScreen())
+        return;
+    frm = FrmGetActiveForm();
+    scb = (ScrollBarType *)FrmGetObjectPtr(frm, FrmGetObjectIndex(frm, sRows.scbID));
+    maxTop = (sRows.numRows > sRows.visible) ? (UInt16)(sRows.numRows - sRows.visible) : 0;
+    SclSetScrollBar(scb, (Int16)sRows.top, 0, (Int16)maxTop,
+                    (Int16)((sRows.visible > 1) ? sRows.visible - 1 : 1));
+}
+
+void Rows_Draw(void)
+{
+    if (sRows.backW != NULL)
+        Rows_Blit();
+    else
+        Rows_Paint(0, sRows.visible);
+    Rows_UpdateScrollBar();
+}
+
+void Rows_ScrollTo(Int16 top)
+{
+    WinHandle oldW;
+    RectangleType r;
+    RectangleType vacated;
+    UInt16 maxTop;
+    UInt16 dist;
+    Boolean down;
+
+    maxTop = (sRows.numRows > sRows.visible) ? (UInt16)(sRows.numRows - sRows.visible) : 0;
+    if (top < 0)
+        top = 0;
+    if ((UInt16)top > maxTop)
+        top = (Int16)maxTop;
+    if ((UInt16)top == sRows.top)
+        return;
+
+    down = ((UInt16)top > sRows.top); /* text moves up, rows come in below */
+    dist = down ? (UInt16)(top - sRows.top) : (UInt16)(sRows.top - top);
+    sRows.top = (UInt16)top;
+
+    if (dist >= sRows.visible)
+    {
+        Rows_Paint(0, sRows.visible);
+    }
+    else
+    {
+        /* Move what is still in view, then draw what came into it */
+        oldW = NULL;
+        r = sRows.bounds;
+        if (sRows.backW != NULL)
+        {
+            oldW = WinSetDrawWindow(sRows.backW);
+            r.topLeft.x = 0;
+            r.topLeft.y = 0;
+        }
+        if (sRows.backW != NULL || Rows_OnScreen())
+        {
+            r.extent.y = (Coord)(sRows.visible * sRows.lineH);
+            WinScrollRectangle(&r, down ? winUp : winDown, (Coord)(dist * sRows.lineH),
+                               &vacated);
+        }
+        if (oldW != NULL)
+            WinSetDrawWindow(oldW);
+
+        if (down)
+            Rows_Paint((UInt16)(sRows.visible - dist), sRows.visible);
+        else
+            Rows_Paint(0, dist);
+    }
+    Rows_Blit();
+    Rows_UpdateScrollBar();
+}
+
+/* --- Text --- */
+
+Char *Rows_Extend(UInt32 len)
+{
+    Char *tmp;
+    Char *p;
+    UInt32 ncap;
+
+    if (sRows.textLen + len + 1 > sRows.textCap)
+    {
+        ncap = (sRows.textCap == 0) ? 2048 : sRows.textCap;
+        while (ncap < sRows.textLen + len + 1)
+            ncap *= 2;
+        tmp = (Char *)MemPtrNew(ncap);
+        if (tmp == NULL)
+            return NULL;
+        if (sRows.text != NULL)
+        {
+            MemMove(tmp, sRows.text, sRows.textLen + 1);
+            MemPtrFree(sRows.text);
+        }
+        sRows.text = tmp;
+        sRows.textCap = ncap;
+    }
+    p = sRows.text + sRows.textLen;
+    sRows.textLen += len;
+    sRows.text[sRows.textLen] = 0;
+    return p;
+}
+
+void Rows_SetText(const Char *text)
+{
+    UInt32 oldLen;
+    UInt32 len;
+    Char *p;
+
+    if (text == NULL)
+        text = "";
+    len = StrLen(text);
+
+    oldLen = sRows.textLen;
+    sRows.textLen = 0;
+    p = Rows_Extend(len);
+    if (p == NULL)
+    {
+        /* Keep what is shown rather than show nothing */
+        sRows.textLen = oldLen;
+        Rows_Draw();
+        return;
+    }
+    MemMove(p, text, len);
+    sRows.numRows = 0;
+    sRows.top = 0;
+    Rows_ShowAdded();
+}
+
+void Rows_ShowAdded(void)
+{
+    UInt16 oldRows;
+
+    /* Keep the rows, less the last (it may have been cut) */
+    oldRows = (sRows.numRows > 0) ? (UInt16)(sRows.numRows - 1) : 0;
+    sRows.numRows = oldRows;
+    Rows_Layout((oldRows > 0) ? sRows.rows[oldRows] : 0);
+    if (sRows.top > 0 && sRows.top + sRows.visible > sRows.numRows)
+        sRows.top = (sRows.numRows > sRows.visible) ? (UInt16)(sRows.numRows - sRows.visible) : 0;
+
+    /* The rows on screen only change if the text did under them */
+    if (oldRows == 0 || sRows.top + sRows.visible > oldRows)
+    {
+        Rows_Paint(0, sRows.visible);
+        Rows_Blit();
+    }
+    Rows_UpdateScrollBar();
+}
+
+/* --- Setup --- */
+
+void Rows_Open(UInt16 gadgetID, UInt16 scrollBarID)
+{
+    FormType *frm;
+    UInt16 err;
+
+    Rows_Close();
+    frm = FrmGetActiveForm();
+    sRows.formID = FrmGetActiveFormID();
+    sRows.scbID = scrollBarID;
+    FrmGetObjectBounds(frm, FrmGetObjectIndex(frm, gadgetID), &sRows.bounds);
+    sRows.lineH = FntLineHeight();
+    sRows.visible = (UInt16)(sRows.bounds.extent.y / sRows.lineH);
+
+    sRows.backW = WinCreateOffscreenWindow(sRows.bounds.extent.x, sRows.bounds.extent.y,
+                                           screenFormat, &err);
+    if (err != errNone)
+        sRows.backW = NULL;
+    Rows_Paint(0, sRows.visible);
+    Rows_Blit();
+    Rows_UpdateScrollBar();
+}
+
+void Rows_Close(void)
+{
+    if (sRows.backW != NULL)
+        WinDeleteWindow(sRows.backW, false);
+    if (sRows.text != NULL)
+        MemPtrFree(sRows.text);
+    if (sRows.rows != NULL)
+        MemPtrFree(sRows.rows);
+    MemSet(&sRows, sizeof(sRows), 0);
+}
@@ -0,0 +1,29 @@
+#ifndef LOGROWS_H
+#define LOGROWS_H
+
+/* The main form's log: rows of text drawn into a gadget, with a
+   scroll bar. */
+
+/* After the form is drawn; ties the view to the gadget and scroll bar. */
+void Rows_Open(UInt16 gadgetID, UInt16 scrollBarID);
+void Rows_Close(void);
+
+/* Show text ('\n' between lines), from the top. */
+void Rows_SetText(const Char *text);
+
+/* Grow the text by len bytes for the caller to fill, returning where they
+   start (NULL, and nothing added, if it cannot grow). Rows_ShowAdded
+   then lays out only what was added, and the view stays put. */
+Char *Rows_Extend(UInt32 len);
+void Rows_ShowAdded(void);
+
+/* What is shown (never NULL) and its length */
+const Char *Rows_Text(UInt32 *lenP);
+
+/* Repaint from the back buffer (frmUpdateEvent) */
+void Rows_Draw(void);
+
+/* Put row top at the top (sclRepeatEvent) */
+void Rows_ScrollTo(Int16 top);
+
+#endif /* LOGROWS_H */
@@ -0,0 +1,364 @@
+#include <PalmOS.h>
+#include "LogViewer.h"
+#include "LogStats.h"
+#include "LogDB.h"
+
+/*
+    App stats form: which app is logging how much, and since when.
+
+    One pass over the window through LogDB_IterNextEntry adds up, per app,
+    records, the calls they stand for (sampled records count for their
+    rate), bytes of app, message and fields, the first and last time seen
+    and a record count per time bucket. Only lengths and timestamps are
+    read: no message is copied. Packed segments filter by time on their
+    block headers, so old history costs little.
+
+    The pass is stepped from the event loop like the main form's refresh;
+    the list and histogram are redrawn as it goes.
+*/
+
+#define STATS_MAX_APPS 32
+#define STATS_BUCKETS 38 /* 4 pixels each across the gadget */
+#define STATS_STEP_ENTRIES 256
+#define STATS_STEP_TICKS 5
+#define STATS_REDRAW_STEPS 8
+
+typedef struct
+{
+    Char name[32];
+    UInt32 records;
+    UInt32 calls;
+    UInt32 bytes;
+    UInt32 firstSecs;
+    UInt32 lastSecs;
+    UInt16 buckets[STATS_BUCKETS];
+} StatsRow;
+
+typedef struct
+{
+    Boolean busy;
+    Boolean iterOpen;
+    LogDB_Iter it;
+    UInt16 steps;
+
+    UInt16 sink;
+    UInt32 fromSecs; /* as asked for */
+    UInt32 toSecs;
+    UInt32 lo;       /* what the buckets and the rate cover */
+    UInt32 hi;
+    UInt32 bucketSecs;
+
+    StatsRow *rows; /* [0] is every app together */
+    UInt16 numRows;
+    UInt16 lastRow; /* records come in runs from one app */
+    Int16 selected;
+} StatsState;
+
+static StatsState sStats;
+
+void Stats_SetWindow(UInt16 sink, UInt32 fromSecs, UInt32 toSecs)
+{
+    sStats.sink = sink;
+    sStats.fromSecs = fromSecs;
+    sStats.toSecs = toSecs;
+}
+
+Boolean Stats_Busy(void)
+{
+    return sStats.busy;
+}
+
+void Stats_Cancel(void)
+{
+    if (sStats.iterOpen)
+        LogDB_IterEnd(&sStats.it);
+    sStats.iterOpen = false;
+    sStats.busy = false;
+}
+
+static void Stats_Free(void)
+{
+    Stats_Cancel();
+    if (sStats.rows != NULL)
+        MemPtrFree(sStats.rows);
+    sStats.rows = NULL;
+    sStats.numRows = 0;
+}
+
+static void Stats_Add(StatsRow *row, const LogDB_Entry *entry, UInt16 bucket)
+{
+    if (row->records == 0 || entry->seconds < row->firstSecs)
+        row->firstSecs = entry->seconds;
+    if (entry->seconds > row->lastSecs)
+        row->lastSecs = entry->seconds;
+    row->records++;
+    row->calls += entry->rate;
+    row->bytes += (UInt32)entry->appLen + 1 + entry->msgLen + 1 + entry->fieldsLen;
+    if (row->buckets[bucket] < 0xFFFF)
+        row->buckets[bucket]++;
+}
+
+/* Row for the entry's app, added on first sight; 0 (all apps only) once
+   the table is full. */
+static UInt16 Stats_Row(const LogDB_Entry *entry)
+{
+    StatsRow *row;
+    UInt16 i;
+
+    row = &sStats.rows[sStats.lastRow];
+    if (sStats.lastRow > 0 && StrCompare(row->name, entry->app) == 0)
+        return sStats.lastRow;
+
+    for (i = 1; i < sStats.numRows; i++)
+    {
+        if (StrCompare(sStats.rows[i].name, entry->app) == 0)
+        {
+            sStats.lastRow = i;
+            return i;
+        }
+    }
+    if (sStats.numRows > STATS_MAX_APPS || entry->appLen >= sizeof(row->name))
+        return 0;
+
+    i = sStats.numRows++;
+    MemMove(sStats.rows[i].name, entry->app, entry->appLen + 1);
+    sStats.lastRow = i;
+    return i;
+}
+
+/* --- Drawing --- */
+
+/* Right-align text so it ends at x. */
+static void Stats_DrawRight(const Char *text, Coord x, Coord y)
+{
+    UInt16 len;
+
+    len = (UInt16)StrLen(text);
+    WinDrawChars(text, len, x - FntCharsWidth(text, len), y);
+}
+
+static void Stats_DrawRow(Int16 itemNum, RectangleType *bounds, Char **itemsText)
+{
+    StatsRow *row;
+    Char num[16];
+    UInt32 span;
+
+    if (sStats.rows == NULL || itemNum < 0 || itemNum >= (Int16)sStats.numRows)
+        return;
+    row = &sStats.rows[itemNum];
+
+    if (itemNum == 0)
+        WinDrawChars("All apps", 8, bounds->topLeft.x + 2, bounds->topLeft.y);
+    else
+        WinDrawTruncChars(row->name, StrLen(row->name), bounds->topLeft.x + 2,
+                          bounds->topLeft.y, 56);
+
+    StrPrintF(num, "%lu", row->records);
+    Stats_DrawRight(num, bounds->topLeft.x + 90, bounds->topLeft.y);
+    StrPrintF(num, "%lu", (row->bytes + 1023) / 1024);
+    Stats_DrawRight(num, bounds->topLeft.x + 120, bounds->topLeft.y);
+
+    /* Calls per hour over the window, so sampled sites are not undercounted */
+    span = sStats.hi - sStats.lo + 1;
+    if (span < 60)
+        span = 60;
+    if (row->calls > 0xFFFFFFFFUL / 3600UL)
+        StrPrintF(num, "%lu", row->calls / (span / 3600UL + 1));
+    else
+        StrPrintF(num, "%lu", row->calls * 3600UL / span);
+    Stats_DrawRight(num, bounds->topLeft.x + 158, bounds->topLeft.y);
+}
+
+/* Bars for the selected row, and when that app started logging. */
+static void Stats_DrawHistogram(void)
+{
+    FormType *frm;
+    RectangleType r;
+    RectangleType bar;
+    StatsRow *row;
+    DateTimeType dt;
+    Char line[40];
+    UInt16 peak;
+    UInt16 barsH;
+    UInt16 i;
+
+    frm = FrmGetActiveForm();
+    FrmGetObjectBounds(frm, FrmGetObjectIndex(frm, LogStatsHistGadID), &r);
+    WinEraseRectangle(&r, 0);
+    if (sStats.rows == NULL || sStats.selected < 0 || sStats.selected >= (Int16)sStats.numRows)
+        return;
+    row = &sStats.rows[sStats.selected];
+
+    barsH = (UInt16)(r.extent.y - FntLineHeight() - 1);
+    peak = 0;
+    for (i = 0; i < STATS_BUCKETS; i++)
+    {
+        if (row->buckets[i] > peak)
+            peak = row->buckets[i];
+    }
+    for (i = 0; i < STATS_BUCKETS && peak > 0; i++)
+    {
+        bar.extent.y = (Coord)(((UInt32)row->buckets[i] * barsH + peak - 1) / peak);
+        bar.extent.x = 3;
+        bar.topLeft.x = (Coord)(r.topLeft.x + i * 4);
+        bar.topLeft.y = (Coord)(r.topLeft.y + barsH - bar.extent.y);
+        WinDrawRectangle(&bar, 0);
+    }
+    WinDrawLine(r.topLeft.x, r.topLeft.y + barsH, r.topLeft.x + r.extent.x - 1,
+                r.topLeft.y + barsH);
+
+    if (row->records == 0)
+        StrCopy(line, "No records");
+    else
+    {
+        TimSecondsToDateTime(row->firstSecs, &dt);
+        StrPrintF(line, "Since %02d-%02d %02d:%02d, peak %u", (Int16)dt.month, (Int16)dt.day,
+                  (Int16)dt.hour, (Int16)dt.minute, peak);
+    }
+    WinDrawChars(line, StrLen(line), r.topLeft.x, r.topLeft.y + barsH + 1);
+}
+
+static void Stats_Redraw(void)
+{
+    FormType *frm;
+    ListType *lst;
+
+    frm = FrmGetActiveForm();
+    lst = (ListType *)FrmGetObjectPtr(frm, FrmGetObjectIndex(frm, LogStatsListID));
+    LstSetListChoices(lst, NULL, sStats.numRows);
+    LstSetSelection(lst, sStats.selected);
+    LstDrawList(lst);
+    Stats_DrawHistogram();
+}
+
+/* --- The pass --- */
+
+static void Stats_Begin(void)
+{
+    LogDB_Entry entry;
+    MemHandle h;
+    UInt32 nowSecs;
+
+    Stats_Free();
+    sStats.rows = (StatsRow *)MemPtrNew((STATS_MAX_APPS + 1) * sizeof(StatsRow));
+    if (sStats.rows == NULL)
+        return;
+    MemSet(sStats.rows, (STATS_MAX_APPS + 1) * sizeof(StatsRow), 0);
+    sStats.numRows = 1;
+    sStats.lastRow = 0;
+    sStats.selected = 0;
+    sStats.steps = 0;
+
+    /* Buckets span the window, up to now; an open start begins at the
+       oldest record, which is the first one the iterator returns */
+    nowSecs = TimGetSeconds();
+    sStats.lo = sStats.fromSecs;
+    sStats.hi = (sStats.toSecs < nowSecs) ? sStats.toSecs : nowSecs;
+    if (LogDB_IterBeginSink(&sStats.it, sStats.sink, sStats.fromSecs, sStats.toSecs) != errNone)
+        return;
+    h = LogDB_IterNextEntry(&sStats.it, &entry);
+    if (h != NULL)
+    {
+        if (entry.seconds > sStats.lo)
+            sStats.lo = entry.seconds;
+        LogDB_IterUnlock(h);
+    }
+    LogDB_IterEnd(&sStats.it);
+    if (sStats.hi < sStats.lo)
+        sStats.hi = sStats.lo;
+    sStats.bucketSecs = (sStats.hi - sStats.lo) / STATS_BUCKETS + 1;
+
+    if (LogDB_IterBeginSink(&sStats.it, sStats.sink, sStats.fromSecs, sStats.toSecs) != errNone)
+        return;
+    sStats.iterOpen = true;
+    sStats.busy = true;
+}
+
+void Stats_Step(void)
+{
+    LogDB_Entry entry;
+    MemHandle h;
+    UInt32 start;
+    UInt32 b;
+    UInt16 bucket;
+    UInt16 done;
+
+    start = TimGetTicks();
+    for (done = 0; done < STATS_STEP_ENTRIES; done++)
+    {
+        h = LogDB_IterNextEntry(&sStats.it, &entry);
+        if (h == NULL)
+        {
+            Stats_Cancel();
+            FrmSetTitle(FrmGetActiveForm(), "App Stats");
+            Stats_Redraw();
+            return;
+        }
+
+        /* Past the end (future clocks) lands in the last bucket */
+        b = (entry.seconds > sStats.lo) ? (entry.seconds - sStats.lo) / sStats.bucketSecs : 0;
+        bucket = (UInt16)((b < STATS_BUCKETS) ? b : STATS_BUCKETS - 1);
+        Stats_Add(&sStats.rows[0], &entry, bucket);
+        if (Stats_Row(&entry) > 0)
+            Stats_Add(&sStats.rows[sStats.lastRow], &entry, bucket);
+        LogDB_IterUnlock(h);
+
+        if (TimGetTicks() - start >= STATS_STEP_TICKS)
+            break;
+    }
+
+    if (++sStats.steps % STATS_REDRAW_STEPS == 0)
+        Stats_Redraw();
+}
+
+/* --- Form --- */
+
+Boolean StatsFormHandleEvent(EventType *eventP)
+{
+    FormType *frm;
+    ListType *lst;
+    Boolean handled;
+
+    handled = false;
+    switch (eventP->eType)
+    {
+    case frmOpenEvent:
+        frm = FrmGetActiveForm();
+        lst = (ListType *)FrmGetObjectPtr(frm, FrmGetObjectIndex(frm, LogStatsListID));
+        LstSetDrawFunction(lst, Stats_DrawRow);
+        LstSetListChoices(lst, NULL, 0);
+        FrmDrawForm(frm);
+        Stats_Begin();
+        if (sStats.busy)
+            FrmSetTitle(frm, "App Stats ...");
+        Stats_Redraw();
+        handled = true;
+        break;
+
+    case lstSelectEvent:
+        if (eventP->data.lstSelect.listID == LogStatsListID)
+        {
+            sStats.selected = eventP->data.lstSelect.selection;
+            Stats_DrawHistogram();
+            handled = true;
+        }
+        break;
+
+    case ctlSelectEvent:
+        if (eventP->data.ctlSelect.controlID == LogStatsBtnDoneID)
+        {
+            Stats_Free();
+            FrmReturnToForm(LogViewerFormID);
+            handled = true;
+        }
+        break;
+
+    case frmCloseEvent:
+        Stats_Free();
+        break;
+
+    default:
+        break;
+    }
+    return handled;
+}
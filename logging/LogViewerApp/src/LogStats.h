@@ -0,0 +1,16 @@
+#ifndef LOGSTATS_H
+#define LOGSTATS_H
+
+/* App stats form: counts, bytes and rate per app over one window. */
+
+/* Window (and source, LOGDB_SINK_*) for the next time the form opens */
+void Stats_SetWindow(UInt16 sink, UInt32 fromSecs, UInt32 toSecs);
+
+/* The aggregation pass runs a step at a time from the event loop */
+Boolean Stats_Busy(void);
+void Stats_Step(void);
+void Stats_Cancel(void);
+
+Boolean StatsFormHandleEvent(EventType *eventP);
+
+#endif /* LOGSTATS_H */
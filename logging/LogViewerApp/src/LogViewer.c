@@ -1,6 +1,9 @@
 #include <PalmOS.h>
 #include "LogViewer.h"
+#include "LogStats.h"
 #include "LogDB.h"
+#include "LogEvt.h"
+#include "LogRows.h"
 
 /* --- Model for the on-screen text buffer --- */
 
@@ -9,6 +12,8 @@ typedef struct
     UInt32 seconds;
     Char *app; /* owned copies */
     Char *msg; /* owned copies */
+    UInt16 appLen;
+    UInt16 msgLen;
 } Item;
 
 typedef struct
@@ -17,17 +22,42 @@ typedef struct
     UInt16 count;
 } ItemList;
 
-static MemHandle sTextH = NULL;   /* Field text handle */
 static Char **sAppChoices = NULL; /* dynamic app names array for list */
 static UInt16 sAppChoiceCount = 0;
 static UInt16 sSelectedApp = 0; /* index in sAppChoices (0 == "All") */
 static UInt16 sSelectedTime = TF_All;
+static UInt16 sSelectedSrc = SRC_Device;
+static Boolean sAppsStale = false; /* app list waits for a full scan */
+
+/* "key=value" filter on record fields, or words to find in the message,
+   parsed once per refresh */
+typedef struct
+{
+    Boolean active;
+    Boolean words;   /* no '=': str is a LogDB_IterSetText search */
+    Boolean numeric; /* value was a number: match int32/uint32/ticks fields */
+    Int32 num;
+    Char key[LOGDB_FIELD_KEY_MAX + 1];
+    Char str[32];
+} FieldFilter;
+
+static FieldFilter sWhere;
+
+/* LogDB's upkeep (packing closed segments, mostly) gets BUDGET ticks
+   after each IDLE_TICKS without events, while it has any queued */
+#define LOGVIEWER_IDLE_TICKS 10
+#define LOGVIEWER_IDLE_BUDGET 5
+
+/* Per-event dispatch times, logged on exit */
+static LogEvt_Loop sLoop;
+
+/* Form title; FrmSetTitle keeps the pointer, so it must outlive the form */
+static Char sTitle[24];
 
 static void Viewer_BuildAppChoices(void);
 static void Viewer_FreeAppChoices(void);
 static void Viewer_Refresh(void);
-static void Viewer_SetFieldText(const Char *text);
-static void Viewer_UpdateScrollBar(Boolean redraw);
+static void Viewer_JobCancel(void);
 
 static Boolean AppHandleEvent(EventType *eventP);
 static Boolean MainFormHandleEvent(EventType *eventP);
@@ -50,49 +80,196 @@ static void FormatDateTime(Char *dst, UInt32 secs)
     StrPrintF(dst, "%04d-%02d-%02d %02d:%02d", (Int16)y, (Int16)mo, (Int16)d, (Int16)h, (Int16)mi);
 }
 
-static Boolean TimeFilter_Passes(UInt32 nowSecs, UInt32 recSecs)
+/* Time window for the selected filter; the iterator skips whole segments
+   outside it and filters the remaining records. */
+static void TimeFilter_Range(UInt32 nowSecs, UInt32 *fromP, UInt32 *toP)
 {
-    UInt32 delta;
     DateTimeType now;
-    DateTimeType rec;
+    UInt32 span;
+
+    *fromP = 0;
+    *toP = nowSecs;
 
     switch (sSelectedTime)
     {
+    case TF_LastHour:
+        span = 60UL * 60UL;
+        break;
+
+    case TF_Last24h:
+        span = 24UL * 60UL * 60UL;
+        break;
+
+    case TF_Last7d:
+        span = 7UL * 24UL * 60UL * 60UL;
+        break;
+
+    case TF_Today:
+        TimSecondsToDateTime(nowSecs, &now);
+        now.hour = 0;
+        now.minute = 0;
+        now.second = 0;
+        *fromP = TimDateTimeToSeconds(&now);
+        *toP = *fromP + 24UL * 60UL * 60UL - 1;
+        return;
+
     case TF_All:
+    default:
+        *toP = 0xFFFFFFFFUL;
+        return;
+    }
+
+    *fromP = (nowSecs > span) ? nowSecs - span : 0;
+}
+
+/* The LOGDB_SINK_* behind the selected source */
+static UInt16 Viewer_Sink(void)
+{
+    switch (sSelectedSrc)
+    {
+    case SRC_Card:
+        return LOGDB_SINK_VFS;
+    case SRC_Apps:
+        return LOGDB_SINK_APPDB;
+    default:
+        return LOGDB_SINK_DB;
+    }
+}
+
+/* Begin iterating the selected backend: the DebugLog DBs, the card file
+   or the per-app DBs */
+static Err Viewer_IterBegin(LogDB_Iter *it, UInt32 fromSecs, UInt32 toSecs)
+{
+    return LogDB_IterBeginSink(it, Viewer_Sink(), fromSecs, toSecs);
+}
+
+/* --- Field filter --- */
+
+/* Parse "key=value", or words; an empty text clears the filter. */
+static Boolean FieldFilter_Parse(const Char *text, FieldFilter *ff)
+{
+    const Char *eq;
+    const Char *v;
+    UInt16 keyLen;
+    Boolean neg;
+
+    MemSet(ff, sizeof(FieldFilter), 0);
+    if (text == NULL || *text == 0)
         return true;
 
-    case TF_LastHour:
-        if (nowSecs >= recSecs)
-        {
-            delta = nowSecs - recSecs;
-            return (delta <= 60UL * 60UL);
-        }
+    eq = StrChr(text, '=');
+    if (eq == NULL)
+    {
+        if (StrLen(text) >= sizeof(ff->str))
+            return false;
+        StrCopy(ff->str, text);
+        ff->words = true;
+        ff->active = true;
+        return true;
+    }
+    if (eq == text)
+        return false;
+    keyLen = (UInt16)(eq - text);
+    if (keyLen > LOGDB_FIELD_KEY_MAX || StrLen(eq + 1) >= sizeof(ff->str))
         return false;
 
-    case TF_Last24h:
-        if (nowSecs >= recSecs)
+    MemMove(ff->key, text, keyLen);
+    ff->key[keyLen] = 0;
+    StrCopy(ff->str, eq + 1);
+
+    /* Digits (optionally signed) compare as a number */
+    v = ff->str;
+    neg = (*v == '-');
+    if (neg)
+        v++;
+    ff->numeric = (*v != 0);
+    for (; *v != 0; v++)
+    {
+        if (*v < '0' || *v > '9')
         {
-            delta = nowSecs - recSecs;
-            return (delta <= 24UL * 60UL * 60UL);
+            ff->numeric = false;
+            break;
         }
+    }
+    if (ff->numeric)
+        ff->num = StrAToI(ff->str);
+
+    ff->active = true;
+    return true;
+}
+
+/* The words to search for, or NULL */
+static const Char *Viewer_Words(void)
+{
+    return (sWhere.active && sWhere.words) ? sWhere.str : NULL;
+}
+
+static Boolean FieldFilter_Passes(const FieldFilter *ff, const LogDB_Entry *entry)
+{
+    LogDB_Field f;
+
+    /* Words are matched by the iterator */
+    if (!ff->active || ff->words)
+        return true;
+    if (!LogDB_FieldFind(entry, ff->key, &f))
         return false;
 
-    case TF_Last7d:
-        if (nowSecs >= recSecs)
-        {
-            delta = nowSecs - recSecs;
-            return (delta <= 7UL * 24UL * 60UL * 60UL);
-        }
+    switch (f.type)
+    {
+    case LOGDB_FIELD_INT32:
+        return ff->numeric && f.v.i32 == ff->num;
+    case LOGDB_FIELD_UINT32:
+    case LOGDB_FIELD_TICKS:
+        return ff->numeric && f.v.u32 == (UInt32)ff->num;
+    case LOGDB_FIELD_STR:
+        return f.strLen == StrLen(ff->str) && MemCmp(f.v.str, ff->str, f.strLen) == 0;
+    default:
         return false;
+    }
+}
 
-    case TF_Today:
-        TimSecondsToDateTime(nowSecs, &now);
-        TimSecondsToDateTime(recSecs, &rec);
-        return (now.year == rec.year && now.month == rec.month && now.day == rec.day);
+/* Append the entry's fields as " {key=value ...}"; returns the length
+   written (dst holds cap bytes including the terminator). */
+static UInt16 Viewer_FormatFields(const LogDB_Entry *entry, Char *dst, UInt16 cap)
+{
+    LogDB_Field f;
+    Char num[16];
+    UInt16 pos;
+    UInt16 len;
+    UInt16 sep;
+    UInt16 n;
 
-    default:
-        return true;
+    len = 0;
+    pos = 0;
+    dst[0] = 0;
+    while (LogDB_FieldNext(entry, &pos, &f))
+    {
+        if (f.type == LOGDB_FIELD_INT32)
+            StrPrintF(num, "%ld", f.v.i32);
+        else if (f.type == LOGDB_FIELD_STR)
+            num[0] = 0;
+        else
+            StrPrintF(num, "%lu", f.v.u32);
+
+        /* " {" before the first field, " " between; keep room for "}\0" */
+        n = (f.type == LOGDB_FIELD_STR) ? f.strLen : (UInt16)StrLen(num);
+        sep = (len == 0) ? 2 : 1;
+        if (len + sep + f.keyLen + 1 + n + 2 > cap)
+            break;
+
+        dst[len++] = ' ';
+        if (sep == 2)
+            dst[len++] = '{';
+        MemMove(dst + len, f.key, f.keyLen);
+        len += f.keyLen;
+        dst[len++] = '=';
+        MemMove(dst + len, (f.type == LOGDB_FIELD_STR) ? f.v.str : num, n);
+        len += n;
     }
+    if (len > 0)
+        dst[len++] = '}';
+    dst[len] = 0;
+    return len;
 }
 
 /* --- Sorting newest-first with simple insertion sort --- */
@@ -110,88 +287,71 @@ static int CmpItemsDesc(const void *a, const void *b)
 
 /* --- App choices --- */
 
-static void Viewer_BuildAppChoices(void)
+#define MAX_APPS 32
+
+/* Hook names[0..count) (owned by the list from now on) into the app list,
+   after "All". */
+static void Viewer_InstallAppChoices(Char **names, UInt16 count)
 {
-    LogDB_Iter it;
-    Err e;
+    FormType *frm;
+    ListType *lst;
+    ControlType *trg;
     UInt16 i;
-    MemHandle h;
-    UInt32 secs;
-    Char *app;
-    Char *msg;
 
     Viewer_FreeAppChoices();
-
-    /* First pass: collect distinct app names (cap to avoid big allocations). */
+    sAppChoices = (Char **)MemPtrNew((count + 1) * sizeof(Char *));
+    if (sAppChoices == NULL)
     {
-#define MAX_APPS 32
-        Char *names[MAX_APPS];
-        UInt16 counts;
+        for (i = 0; i < count; i++)
+            MemPtrFree(names[i]);
+        return;
+    }
+    sAppChoices[0] = "All";
+    for (i = 0; i < count; i++)
+    {
+        sAppChoices[i + 1] = names[i];
+    }
+    sAppChoiceCount = count + 1;
 
-        for (i = 0; i < MAX_APPS; i++)
-            names[i] = NULL;
-        counts = 0;
+    frm = FrmGetActiveForm();
+    lst = (ListType *)FrmGetObjectPtr(frm, FrmGetObjectIndex(frm, LogViewerAppListID));
+    trg = (ControlType *)FrmGetObjectPtr(frm, FrmGetObjectIndex(frm, LogViewerAppTrigID));
+    LstSetListChoices(lst, sAppChoices, sAppChoiceCount);
+    LstSetSelection(lst, 0);
+    CtlSetLabel(trg, sAppChoices[0]);
+    sSelectedApp = 0;
+}
 
-        e = LogDB_IterBegin(&it);
-        if (e == errNone)
-        {
-            while ((h = LogDB_IterNext(&it, &secs, &app, &msg)) != NULL)
-            {
-                Boolean found;
-                found = false;
-                for (i = 0; i < counts; i++)
-                {
-                    if (StrCompare(names[i], app) == 0)
-                    {
-                        found = true;
-                        break;
-                    }
-                }
-                if (!found && counts < MAX_APPS)
-                {
-                    UInt16 len;
-                    Char *copy;
-                    len = (UInt16)StrLen(app);
-                    copy = (Char *)MemPtrNew(len + 1);
-                    if (copy != NULL)
-                    {
-                        MemMove(copy, app, len + 1);
-                        names[counts++] = copy;
-                    }
-                }
-                LogDB_IterUnlock(h);
-            }
-            LogDB_IterEnd(&it);
-        }
+/* Select the app called name, if the list has it. */
+static void Viewer_SelectApp(const Char *name)
+{
+    FormType *frm;
+    ListType *lst;
+    ControlType *trg;
+    UInt16 i;
 
-        sAppChoices = (Char **)MemPtrNew((counts + 1) * sizeof(Char *));
-        if (sAppChoices == NULL)
+    for (i = 1; i < sAppChoiceCount; i++)
+    {
+        if (StrCompare(sAppChoices[i], name) == 0)
         {
-            sAppChoiceCount = 0;
+            frm = FrmGetActiveForm();
+            lst = (ListType *)FrmGetObjectPtr(frm, FrmGetObjectIndex(frm, LogViewerAppListID));
+            trg = (ControlType *)FrmGetObjectPtr(frm, FrmGetObjectIndex(frm, LogViewerAppTrigID));
+            LstSetSelection(lst, i);
+            CtlSetLabel(trg, sAppChoices[i]);
+            sSelectedApp = i;
             return;
         }
-        sAppChoices[0] = "All";
-        for (i = 0; i < counts; i++)
-        {
-            sAppChoices[i + 1] = names[i];
-        }
-        sAppChoiceCount = counts + 1;
     }
+}
 
-    /* Hook into the list control */
-    {
-        FormType *frm;
-        ListType *lst;
-        ControlType *trg;
-
-        frm = FrmGetActiveForm();
-        lst = (ListType *)FrmGetObjectPtr(frm, FrmGetObjectIndex(frm, LogViewerAppListID));
-        trg = (ControlType *)FrmGetObjectPtr(frm, FrmGetObjectIndex(frm, LogViewerAppTrigID));
-        LstSetListChoices(lst, sAppChoices, sAppChoiceCount);
-        LstSetSelection(lst, 0);
-        CtlSetLabel(trg, sAppChoices[0]);
-        sSelectedApp = 0;
-    }
+/* Only "All" until the next refresh has scanned the log for app names,
+   which it does after showing the records. */
+static void Viewer_BuildAppChoices(void)
+{
+    Viewer_JobCancel(); /* its app filter points into the old list */
+    Viewer_InstallAppChoices(NULL, 0);
+    sAppsStale = true;
 }
 
 static void Viewer_FreeAppChoices(void)
@@ -213,338 +373,1201 @@ static void Viewer_FreeAppChoices(void)
     sSelectedApp = 0;
 }
 
-/* --- Render / Refresh --- */
+/* --- Snapshot ---
 
-static void Viewer_Refresh(void)
+   Where every device entry lives (LogDB_IterTell), with its time and app,
+   so a filter change re-runs the predicates over three arrays and only
+   reads back the records it shows. It stays good while every DebugLog DB
+   has the modNum it had when the snapshot was taken and no DB has come
+   or gone (a roll, a purge or packing all change the set); when only the
+   newest DBs were logged to, it is extended instead. Logs bigger
+   than LOGVIEWER_SNAP_MAX entries are read window by window instead. */
+
+#define LOGVIEWER_SNAP_MAX 6000
+#define SNAP_OTHER_APP 0xFF /* past MAX_APPS: never filtered on */
+
+typedef struct
 {
-    LogDB_Iter it;
-    Err e;
-    MemHandle h;
-    UInt32 nowSecs;
-    UInt32 secs;
-    Char *app;
-    Char *msg;
-    Item *arr;
-    UInt16 n;
+    Boolean complete;
+    Boolean tooBig; /* the signature holds, but there are no arrays */
+
+    UInt16 numDBs;
+    LocalID dbIDs[LOGDB_MAX_SEGMENTS + 1];
+    UInt32 modNums[LOGDB_MAX_SEGMENTS + 1];
+
+    UInt16 count;
     UInt16 cap;
+    UInt32 *secs;
+    UInt32 *pos;
+    UInt8 *app; /* index into names */
 
-    Char *outBuf;
-    UInt32 outCap;
-    UInt32 outLen;
+    Char *names[MAX_APPS];
+    UInt16 numNames;
+    UInt16 lastApp;
+} Snapshot;
 
-    Char timeBuf[24];
-    const Char *appFilter;
+static Snapshot sSnap;
 
-    arr = NULL;
-    n = 0;
-    cap = 0;
-    outBuf = NULL;
-    outCap = 0;
-    outLen = 0;
-    appFilter = NULL;
+static void Snap_FreeArrays(void)
+{
+    if (sSnap.secs != NULL)
+        MemPtrFree(sSnap.secs);
+    if (sSnap.pos != NULL)
+        MemPtrFree(sSnap.pos);
+    if (sSnap.app != NULL)
+        MemPtrFree(sSnap.app);
+    sSnap.secs = NULL;
+    sSnap.pos = NULL;
+    sSnap.app = NULL;
+    sSnap.count = 0;
+    sSnap.cap = 0;
+}
 
-    if (sSelectedApp > 0 && sAppChoices != NULL && sSelectedApp < sAppChoiceCount)
+static void Snap_Free(void)
+{
+    UInt16 i;
+
+    Snap_FreeArrays();
+    for (i = 0; i < sSnap.numNames; i++)
+        MemPtrFree(sSnap.names[i]);
+    MemSet(&sSnap, sizeof(sSnap), 0);
+}
+
+/* Take the signature of the DBs it (a fresh full-range iterator) covers. */
+static void Snap_Sign(const LogDB_Iter *it)
+{
+    UInt16 i;
+
+    sSnap.numDBs = it->numDBs;
+    for (i = 0; i < it->numDBs; i++)
     {
-        appFilter = sAppChoices[sSelectedApp];
+        sSnap.dbIDs[i] = it->dbIDs[i];
+        sSnap.modNums[i] = 0;
+        DmDatabaseInfo(0, it->dbIDs[i], NULL, NULL, NULL, NULL, NULL, NULL, &sSnap.modNums[i],
+                       NULL, NULL, NULL, NULL);
     }
+}
 
-    nowSecs = TimGetSeconds();
+#define SnapStale 0
+#define SnapCurrent 1
+#define SnapGrew 2 /* only appended to; it is positioned after the last entry */
 
-    /* Collect items (COPY strings while record is locked) */
-    e = LogDB_IterBegin(&it);
-    if (e == errNone)
+/* Compare the snapshot with the DBs it (a fresh full-range iterator)
+   covers. A changed newest DB, or new ones after it, may only have been
+   logged to: if the last entry is still where it was, everything after
+   it is new. */
+static UInt16 Snap_Check(LogDB_Iter *it)
+{
+    LogDB_Entry entry;
+    MemHandle h;
+    UInt32 modNum;
+    UInt16 last;
+    UInt16 i;
+    Boolean same;
+
+    if (!sSnap.complete || sSnap.numDBs == 0 || it->numDBs < sSnap.numDBs)
+        return SnapStale;
+    same = (it->numDBs == sSnap.numDBs);
+    for (i = 0; i < sSnap.numDBs; i++)
     {
-        while ((h = LogDB_IterNext(&it, &secs, &app, &msg)) != NULL)
+        if (it->dbIDs[i] != sSnap.dbIDs[i])
+            return SnapStale;
+        modNum = 0;
+        DmDatabaseInfo(0, it->dbIDs[i], NULL, NULL, NULL, NULL, NULL, NULL, &modNum, NULL, NULL,
+                       NULL, NULL);
+        if (modNum != sSnap.modNums[i])
         {
-            Boolean ok;
-            ok = true;
+            if (i + 1 < sSnap.numDBs)
+                return SnapStale;
+            same = false;
+        }
+    }
+    if (same)
+        return SnapCurrent;
+    if (sSnap.tooBig || sSnap.count == 0)
+        return SnapStale;
+
+    last = sSnap.count - 1;
+    h = LogDB_IterSeekEntry(it, sSnap.pos[last], &entry);
+    if (h == NULL)
+        return SnapStale;
+    same = (entry.seconds == sSnap.secs[last] &&
+            (sSnap.app[last] == SNAP_OTHER_APP ||
+             StrCompare(entry.app, sSnap.names[sSnap.app[last]]) == 0));
+    LogDB_IterUnlock(h);
+    return same ? SnapGrew : SnapStale;
+}
 
-            if (appFilter != NULL)
-            {
-                if (StrCompare(appFilter, app) != 0)
-                    ok = false;
-            }
-            if (ok)
-                ok = TimeFilter_Passes(nowSecs, secs);
+static UInt8 Snap_AppIndex(const LogDB_Entry *entry)
+{
+    UInt16 i;
+    Char *copy;
 
-            if (ok)
-            {
-                if (n == cap)
-                {
-                    UInt16 ncap;
-                    Item *tmp;
-                    ncap = (cap == 0) ? 32 : (UInt16)(cap * 2);
-                    tmp = (Item *)MemPtrNew(ncap * sizeof(Item));
-                    if (tmp == NULL)
-                    {
-                        LogDB_IterUnlock(h);
-                        break;
-                    }
-                    if (arr != NULL)
-                    {
-                        MemMove(tmp, arr, n * sizeof(Item));
-                        MemPtrFree(arr);
-                    }
-                    arr = tmp;
-                    cap = ncap;
-                }
-                /* Copy app + msg strings now */
-                {
-                    UInt16 alen;
-                    UInt16 mlen;
-                    Char *ac;
-                    Char *mc;
-
-                    alen = (UInt16)StrLen(app);
-                    mlen = (UInt16)StrLen(msg);
-                    ac = (Char *)MemPtrNew(alen + 1);
-                    mc = (Char *)MemPtrNew(mlen + 1);
-                    if (ac == NULL || mc == NULL)
-                    {
-                        if (ac != NULL)
-                            MemPtrFree(ac);
-                        if (mc != NULL)
-                            MemPtrFree(mc);
-                        LogDB_IterUnlock(h);
-                        break;
-                    }
-                    MemMove(ac, app, alen + 1);
-                    MemMove(mc, msg, mlen + 1);
-
-                    arr[n].seconds = secs;
-                    arr[n].app = ac;
-                    arr[n].msg = mc;
-                }
-                n++;
-            }
+    if (sSnap.lastApp < sSnap.numNames && StrCompare(sSnap.names[sSnap.lastApp], entry->app) == 0)
+        return (UInt8)sSnap.lastApp;
+    for (i = 0; i < sSnap.numNames; i++)
+    {
+        if (StrCompare(sSnap.names[i], entry->app) == 0)
+        {
+            sSnap.lastApp = i;
+            return (UInt8)i;
+        }
+    }
+    if (sSnap.numNames == MAX_APPS)
+        return SNAP_OTHER_APP;
+    copy = (Char *)MemPtrNew(entry->appLen + 1);
+    if (copy == NULL)
+        return SNAP_OTHER_APP;
+    MemMove(copy, entry->app, entry->appLen + 1);
+    sSnap.lastApp = sSnap.numNames;
+    sSnap.names[sSnap.numNames++] = copy;
+    return (UInt8)sSnap.lastApp;
+}
 
-            LogDB_IterUnlock(h);
+/* Append one entry; false once the log is too big to keep. */
+static Boolean Snap_Add(const LogDB_Entry *entry, UInt32 pos)
+{
+    UInt16 ncap;
+    UInt32 *nsecs;
+    UInt32 *npos;
+    UInt8 *napp;
+
+    if (sSnap.count == sSnap.cap)
+    {
+        if (sSnap.cap == LOGVIEWER_SNAP_MAX)
+            return false;
+        ncap = (sSnap.cap == 0) ? 256 : (UInt16)(sSnap.cap * 2);
+        if (ncap > LOGVIEWER_SNAP_MAX)
+            ncap = LOGVIEWER_SNAP_MAX;
+        nsecs = (UInt32 *)MemPtrNew(ncap * sizeof(UInt32));
+        npos = (UInt32 *)MemPtrNew(ncap * sizeof(UInt32));
+        napp = (UInt8 *)MemPtrNew(ncap);
+        if (nsecs == NULL || npos == NULL || napp == NULL)
+        {
+            if (nsecs != NULL)
+                MemPtrFree(nsecs);
+            if (npos != NULL)
+                MemPtrFree(npos);
+            if (napp != NULL)
+                MemPtrFree(napp);
+            return false;
+        }
+        if (sSnap.count > 0)
+        {
+            MemMove(nsecs, sSnap.secs, sSnap.count * sizeof(UInt32));
+            MemMove(npos, sSnap.pos, sSnap.count * sizeof(UInt32));
+            MemMove(napp, sSnap.app, sSnap.count);
         }
-        LogDB_IterEnd(&it);
+        Snap_FreeArrays();
+        sSnap.secs = nsecs;
+        sSnap.pos = npos;
+        sSnap.app = napp;
+        sSnap.cap = ncap;
     }
+    sSnap.count++;
+    sSnap.secs[sSnap.count - 1] = entry->seconds;
+    sSnap.pos[sSnap.count - 1] = pos;
+    sSnap.app[sSnap.count - 1] = Snap_AppIndex(entry);
+    return true;
+}
+
+/* --- Refresh job ---
+
+   Loading runs as a job the event loop steps on nil events, at most
+   LOGVIEWER_JOB_ENTRIES entries or LOGVIEWER_JOB_TICKS per step, so pens,
+   scrolling and filter changes get through while a big log loads. The
+   time range is read back to front in windows that double in length,
+   starting with the newest LOGVIEWER_FIRST_WINDOW seconds; each finished
+   window is appended to the field, so the newest page shows first. A new
+   refresh replaces the running one; tapping the title stops it.
+
+   On the device log the first refresh takes a snapshot instead, and this
+   and every later refresh until the log changes walks the snapshot back
+   to front, reading only the records that match. */
+
+#define LOGVIEWER_JOB_ENTRIES 64
+#define LOGVIEWER_JOB_TICKS 5
+#define LOGVIEWER_FIRST_WINDOW (60UL * 60UL)
+
+#define JobIdle 0
+#define JobWindow 1 /* collecting the entries of lo..hi */
+#define JobApps 2   /* collecting app names for the list */
+#define JobSnap 3   /* taking the snapshot */
+#define JobShow 4   /* walking the snapshot */
+
+#define LOGVIEWER_SHOW_EXAMINE 512 /* snapshot entries looked at per step */
+#define SNAP_ANY_APP 0xFFFF
+#define SNAP_NO_APP 0xFFFE
+
+typedef struct
+{
+    UInt16 stage;
+    Boolean iterOpen;
+    LogDB_Iter it;
+    const Char *appFilter;
+    UInt32 fromSecs; /* as asked for */
+    UInt32 toSecs;
+
+    UInt32 floor; /* oldest time worth a window */
+    UInt32 lo;    /* current window, inclusive */
+    UInt32 hi;
+    UInt32 span;
+
+    UInt16 next;   /* snapshot entries left to look at */
+    UInt16 appIdx; /* snapshot app to match, or SNAP_ANY_APP */
+
+    Item *items; /* current window, in iteration order */
+    UInt16 count;
+    UInt16 cap;
 
-    /* Sort newest-first (insertion sort) */
-    if (arr != NULL && n > 1)
+    UInt32 shown; /* lines on the page (Rows holds the text) */
+    UInt32 estimate;
+
+    Char *names[MAX_APPS];
+    UInt16 numNames;
+} RefreshJob;
+
+static RefreshJob sJob;
+
+static void Viewer_JobFreeItems(void)
+{
+    UInt16 i;
+
+    for (i = 0; i < sJob.count; i++)
     {
-        UInt16 i;
-        for (i = 1; i < n; i++)
+        if (sJob.items[i].app != NULL)
+            MemPtrFree(sJob.items[i].app);
+        if (sJob.items[i].msg != NULL)
+            MemPtrFree(sJob.items[i].msg);
+    }
+    if (sJob.items != NULL)
+        MemPtrFree(sJob.items);
+    sJob.items = NULL;
+    sJob.count = 0;
+    sJob.cap = 0;
+}
+
+/* Stop the job; what is on screen stays. */
+static void Viewer_JobCancel(void)
+{
+    UInt16 i;
+
+    if (sJob.iterOpen)
+        LogDB_IterEnd(&sJob.it);
+    Viewer_JobFreeItems();
+    for (i = 0; i < sJob.numNames; i++)
+        MemPtrFree(sJob.names[i]);
+    MemSet(&sJob, sizeof(sJob), 0);
+}
+
+static Boolean Viewer_JobBusy(void)
+{
+    return sJob.stage != JobIdle;
+}
+
+/* Copy app + msg (with its fields as text) while the record is locked */
+static Boolean Viewer_JobAddItem(const LogDB_Entry *entry)
+{
+    Char fieldText[64];
+    UInt16 fieldLen;
+    UInt16 alen;
+    UInt16 mlen;
+    Char *ac;
+    Char *mc;
+    Item *item;
+
+    if (sJob.count == sJob.cap)
+    {
+        UInt16 ncap;
+        Item *tmp;
+        ncap = (sJob.cap == 0) ? 32 : (UInt16)(sJob.cap * 2);
+        tmp = (Item *)MemPtrNew(ncap * sizeof(Item));
+        if (tmp == NULL)
+            return false;
+        if (sJob.items != NULL)
         {
-            Item key;
-            UInt16 j;
+            MemMove(tmp, sJob.items, sJob.count * sizeof(Item));
+            MemPtrFree(sJob.items);
+        }
+        sJob.items = tmp;
+        sJob.cap = ncap;
+    }
 
-            key = arr[i];
-            j = i;
-            while (j > 0 && CmpItemsDesc(&arr[j - 1], &key) > 0)
-            {
-                arr[j] = arr[j - 1];
-                j--;
-            }
-            arr[j] = key;
+    fieldLen = Viewer_FormatFields(entry, fieldText, sizeof(fieldText));
+    alen = entry->appLen;
+    mlen = entry->msgLen;
+    ac = (Char *)MemPtrNew(alen + 1);
+    mc = (Char *)MemPtrNew(mlen + fieldLen + 1);
+    if (ac == NULL || mc == NULL)
+    {
+        if (ac != NULL)
+            MemPtrFree(ac);
+        if (mc != NULL)
+            MemPtrFree(mc);
+        return false;
+    }
+    MemMove(ac, entry->app, alen + 1);
+    MemMove(mc, entry->msg, mlen);
+    MemMove(mc + mlen, fieldText, fieldLen + 1);
+
+    item = &sJob.items[sJob.count++];
+    item->seconds = entry->seconds;
+    item->app = ac;
+    item->msg = mc;
+    item->appLen = alen;
+    item->msgLen = (UInt16)(mlen + fieldLen);
+
+    /* A sampled record stands for rate calls */
+    sJob.estimate += entry->rate;
+    return true;
+}
+
+static void Viewer_JobAddApp(const LogDB_Entry *entry)
+{
+    UInt16 i;
+    Char *copy;
+
+    for (i = 0; i < sJob.numNames; i++)
+    {
+        if (StrCompare(sJob.names[i], entry->app) == 0)
+            return;
+    }
+    if (sJob.numNames == MAX_APPS)
+        return;
+    copy = (Char *)MemPtrNew(entry->appLen + 1);
+    if (copy != NULL)
+    {
+        MemMove(copy, entry->app, entry->appLen + 1);
+        sJob.names[sJob.numNames++] = copy;
+    }
+}
+
+/* Sort the window newest-first and append it to the page; sorted: the
+   items are in that order already. False once the page cannot grow, so
+   there is no point reading more. */
+static Boolean Viewer_JobShowWindow(Boolean sorted)
+{
+    Char timeBuf[24];
+    Item *arr;
+    UInt16 n;
+    UInt16 i;
+    Boolean grew;
+
+    arr = sJob.items;
+    n = sJob.count;
+
+    /* Entries arrive oldest first; reversed, the insertion sort has next
+       to nothing left to do */
+    for (i = 0; i < n / 2 && !sorted; i++)
+    {
+        Item t;
+        t = arr[i];
+        arr[i] = arr[n - 1 - i];
+        arr[n - 1 - i] = t;
+    }
+    for (i = 1; i < n && !sorted; i++)
+    {
+        Item key;
+        UInt16 j;
+
+        key = arr[i];
+        j = i;
+        while (j > 0 && CmpItemsDesc(&arr[j - 1], &key) > 0)
+        {
+            arr[j] = arr[j - 1];
+            j--;
         }
+        arr[j] = key;
     }
 
-    /* Render into one big buffer */
+    /* The first lines replace a page kept from the cache */
+    if (sJob.shown == 0 && n > 0)
+        Rows_SetText("");
+
+    grew = true;
+    for (i = 0; i < n; i++)
     {
-        UInt16 i;
-        for (i = 0; i < n; i++)
+        UInt16 need;
+        UInt16 timeLen;
+        Char *out;
+
+        FormatDateTime(timeBuf, arr[i].seconds);
+        timeLen = (UInt16)StrLen(timeBuf);
+        need = (UInt16)(timeLen + 3 + arr[i].appLen + 3 + arr[i].msgLen + 1);
+        out = Rows_Extend(need);
+        if (out == NULL)
         {
-            UInt16 need;
-            UInt16 appLen;
-            UInt16 msgLen;
-            Char *dst;
+            grew = false;
+            break;
+        }
 
-            FormatDateTime(timeBuf, arr[i].seconds);
-            appLen = (UInt16)StrLen(arr[i].app);
-            msgLen = (UInt16)StrLen(arr[i].msg);
-            need = (UInt16)(StrLen(timeBuf) + 3 + appLen + 3 + msgLen + 1);
+        /* Append line: "YYYY-MM-DD hh:mm - App - Message\n" */
+        MemMove(out, timeBuf, timeLen);
+        out += timeLen;
+        MemMove(out, " - ", 3);
+        out += 3;
+        MemMove(out, arr[i].app, arr[i].appLen);
+        out += arr[i].appLen;
+        MemMove(out, " - ", 3);
+        out += 3;
+        MemMove(out, arr[i].msg, arr[i].msgLen);
+        out += arr[i].msgLen;
+        *out = '\n';
+    }
+    sJob.shown += i;
+    Viewer_JobFreeItems();
 
-            if (outLen + need + 1 > outCap)
-            {
-                UInt32 ncap;
-                Char *tmp;
-                ncap = (outCap == 0) ? 2048 : (outCap * 2);
-                tmp = (Char *)MemPtrNew(ncap);
-                if (tmp == NULL)
-                {
-                    break;
-                }
-                if (outBuf != NULL)
-                {
-                    MemMove(tmp, outBuf, outLen);
-                    MemPtrFree(outBuf);
-                }
-                outBuf = tmp;
-                outCap = ncap;
-            }
+    if (i > 0)
+        Rows_ShowAdded();
+    return grew;
+}
 
-            /* Append line: "YYYY-MM-DD hh:mm - App - Message\n" */
-            dst = outBuf + outLen;
-            StrCopy(dst, timeBuf);
-            outLen += (UInt16)StrLen(timeBuf);
+static Boolean Viewer_JobOpen(UInt32 fromSecs, UInt32 toSecs, const Char *app,
+                              const Char *words)
+{
+    if (Viewer_IterBegin(&sJob.it, fromSecs, toSecs) != errNone)
+        return false;
+    LogDB_IterSetApp(&sJob.it, app);
+    LogDB_IterSetText(&sJob.it, words);
+    sJob.iterOpen = true;
+    return true;
+}
 
-            StrCopy(outBuf + outLen, " - ");
-            outLen += 3;
+static void Viewer_JobFinish(void)
+{
+    /* A page kept from the cache that no result replaced */
+    if (sJob.shown == 0)
+        Rows_SetText("");
 
-            StrCopy(outBuf + outLen, arr[i].app);
-            outLen += appLen;
+    /* Scaled-up count in the title when any shown record was sampled */
+    if (sJob.estimate != sJob.shown)
+        StrPrintF(sTitle, "LogViewer ~%lu", sJob.estimate);
+    else
+        StrCopy(sTitle, "LogViewer");
+    FrmSetTitle(FrmGetActiveForm(), sTitle);
+    Viewer_JobCancel();
+}
 
-            StrCopy(outBuf + outLen, " - ");
-            outLen += 3;
+static void Viewer_JobWindows(void);
 
-            StrCopy(outBuf + outLen, arr[i].msg);
-            outLen += msgLen;
+/* Snapshot apps as the job's own copies, for Viewer_InstallAppChoices. */
+static void Viewer_JobCopySnapApps(void)
+{
+    UInt16 i;
+    Char *copy;
 
-            outBuf[outLen++] = '\n';
-            outBuf[outLen] = 0;
-        }
+    for (i = 0; i < sSnap.numNames; i++)
+    {
+        copy = (Char *)MemPtrNew(StrLen(sSnap.names[i]) + 1);
+        if (copy == NULL)
+            break;
+        StrCopy(copy, sSnap.names[i]);
+        sJob.names[sJob.numNames++] = copy;
     }
+}
 
-    Viewer_SetFieldText((outBuf != NULL) ? outBuf : "");
+/* Put the snapshot's apps in the list (some may be new since it was made),
+   keeping the selected one. */
+static void Viewer_JobSnapApps(void)
+{
+    Char *keep;
 
-    /* Cleanup */
-    if (arr != NULL)
+    keep = NULL;
+    if (sJob.appFilter != NULL)
     {
-        UInt16 i2;
-        for (i2 = 0; i2 < n; i2++)
+        keep = (Char *)MemPtrNew(StrLen(sJob.appFilter) + 1);
+        if (keep != NULL)
+            StrCopy(keep, sJob.appFilter);
+    }
+    Viewer_JobCopySnapApps();
+    Viewer_InstallAppChoices(sJob.names, sJob.numNames);
+    sJob.numNames = 0; /* the list owns them now */
+    sAppsStale = false;
+
+    /* The old filter pointed into the list just freed */
+    sJob.appFilter = NULL;
+    if (keep != NULL)
+    {
+        Viewer_SelectApp(keep);
+        if (sSelectedApp > 0)
+            sJob.appFilter = sAppChoices[sSelectedApp];
+        MemPtrFree(keep);
+    }
+}
+
+/* Walk the snapshot for the current filters, from its newest entry. */
+static void Viewer_JobShowBegin(void)
+{
+    UInt16 i;
+
+    sJob.appIdx = SNAP_ANY_APP;
+    if (sJob.appFilter != NULL)
+    {
+        /* An app the snapshot never saw matches nothing */
+        sJob.appIdx = SNAP_NO_APP;
+        for (i = 0; i < sSnap.numNames; i++)
+        {
+            if (StrCompare(sSnap.names[i], sJob.appFilter) == 0)
+                sJob.appIdx = i;
+        }
+    }
+    if (!sJob.iterOpen)
+    {
+        if (LogDB_IterBeginRange(&sJob.it, 0, 0xFFFFFFFFUL) != errNone)
         {
-            if (arr[i2].app != NULL)
-                MemPtrFree(arr[i2].app);
-            if (arr[i2].msg != NULL)
-                MemPtrFree(arr[i2].msg);
+            Viewer_JobFinish();
+            return;
         }
-        MemPtrFree(arr);
+        sJob.iterOpen = true;
     }
-    if (outBuf != NULL)
-        MemPtrFree(outBuf);
+    sJob.next = sSnap.count;
+    sJob.stage = JobShow;
 }
 
-static void Viewer_SetFieldText(const Char *text)
+/* Look at up to LOGVIEWER_SHOW_EXAMINE snapshot entries; read back and
+   show the ones the time and app filters pass. */
+static void Viewer_JobShowStep(void)
 {
-    FormType *frm;
-    FieldType *fld;
-    UInt32 len;
-    Char *p;
+    LogDB_Entry entry;
+    MemHandle h;
+    UInt32 start;
+    UInt16 looked;
+    UInt16 i;
+    Boolean ok;
 
-    frm = FrmGetActiveForm();
-    fld = (FieldType *)FrmGetObjectPtr(frm, FrmGetObjectIndex(frm, LogViewerFldID));
-    len = (text != NULL) ? StrLen(text) : 0;
+    start = TimGetTicks();
+    ok = true;
+    for (looked = 0; looked < LOGVIEWER_SHOW_EXAMINE && sJob.next > 0; looked++)
+    {
+        i = --sJob.next;
+        if (sSnap.secs[i] < sJob.fromSecs || sSnap.secs[i] > sJob.toSecs)
+            continue;
+        if (sJob.appIdx != SNAP_ANY_APP && sSnap.app[i] != sJob.appIdx)
+            continue;
+
+        h = LogDB_IterSeekEntry(&sJob.it, sSnap.pos[i], &entry);
+        if (h == NULL)
+            continue;
+        if (FieldFilter_Passes(&sWhere, &entry))
+            ok = Viewer_JobAddItem(&entry);
+        LogDB_IterUnlock(h);
+
+        if (!ok || sJob.count >= LOGVIEWER_JOB_ENTRIES ||
+            TimGetTicks() - start >= LOGVIEWER_JOB_TICKS)
+            break;
+    }
+
+    /* The snapshot is in log order, so walking it backwards gives the
+       newest first; a clock set back is the only exception, and a rare
+       one, so it is not sorted for */
+    if (!Viewer_JobShowWindow(true) || !ok || sJob.next == 0)
+        Viewer_JobFinish();
+}
 
-    /* Detach any existing handle from the field BEFORE freeing it */
-    if (sTextH != NULL)
+/* The current pass ran out: show it, then go on to the next window, the
+   app scan, or the end. */
+static void Viewer_JobAdvance(void)
+{
+    if (sJob.stage == JobSnap)
     {
-        FldSetTextHandle(fld, NULL);
-        MemHandleFree(sTextH);
-        sTextH = NULL;
+        /* The iterator stays open: showing seeks on it */
+        sSnap.complete = true;
+        if (sAppsStale || sSnap.numNames + 1 != sAppChoiceCount)
+            Viewer_JobSnapApps();
+        Viewer_JobShowBegin();
+        return;
     }
 
-    sTextH = MemHandleNew(len + 1);
-    if (sTextH == NULL)
+    if (sJob.iterOpen)
+        LogDB_IterEnd(&sJob.it);
+    sJob.iterOpen = false;
+
+    if (sJob.stage == JobWindow)
     {
-        FldSetTextHandle(fld, NULL);
-        FldDrawField(fld);
-        Viewer_UpdateScrollBar(true);
+        if (!Viewer_JobShowWindow(false))
+        {
+            Viewer_JobFinish();
+            return;
+        }
+        if (sJob.lo > sJob.floor)
+        {
+            sJob.hi = sJob.lo - 1;
+            if (sJob.span < 0x80000000UL)
+                sJob.span *= 2;
+            sJob.lo = (sJob.hi - sJob.floor >= sJob.span) ? sJob.hi - sJob.span + 1 : sJob.floor;
+            if (Viewer_JobOpen(sJob.lo, sJob.hi, sJob.appFilter, Viewer_Words()))
+                return;
+        }
+        if (sAppsStale && Viewer_JobOpen(0, 0xFFFFFFFFUL, NULL, NULL))
+        {
+            sJob.stage = JobApps;
+            return;
+        }
+    }
+    else if (sJob.stage == JobApps)
+    {
+        Viewer_InstallAppChoices(sJob.names, sJob.numNames);
+        sJob.numNames = 0; /* the list owns them now */
+        sAppsStale = false;
+    }
+    Viewer_JobFinish();
+}
+
+static void Viewer_JobStep(void)
+{
+    LogDB_Entry entry;
+    MemHandle h;
+    UInt32 start;
+    UInt16 done;
+    Boolean ok;
+
+    if (sJob.stage == JobShow)
+    {
+        Viewer_JobShowStep();
         return;
     }
 
-    p = (Char *)MemHandleLock(sTextH);
-    if (p != NULL)
+    start = TimGetTicks();
+    for (done = 0; done < LOGVIEWER_JOB_ENTRIES; done++)
     {
-        if (len > 0)
+        h = LogDB_IterNextEntry(&sJob.it, &entry);
+        if (h == NULL)
         {
-            MemMove(p, text, len);
+            /* Painting the window is this step's work */
+            Viewer_JobAdvance();
+            return;
         }
-        p[len] = 0;
-        MemHandleUnlock(sTextH);
+
+        ok = true;
+        if (sJob.stage == JobSnap)
+            ok = Snap_Add(&entry, LogDB_IterTell(&sJob.it));
+        else if (sJob.stage == JobApps)
+            Viewer_JobAddApp(&entry);
+        else if (FieldFilter_Passes(&sWhere, &entry))
+            ok = Viewer_JobAddItem(&entry);
+        LogDB_IterUnlock(h);
+
+        if (!ok && sJob.stage == JobSnap)
+        {
+            /* Too big to keep: remember that, and load by windows */
+            Snap_FreeArrays();
+            sSnap.tooBig = true;
+            sSnap.complete = true;
+            Viewer_JobWindows();
+            return;
+        }
+        if (!ok)
+        {
+            /* Out of memory: keep what fits */
+            Viewer_JobShowWindow(false);
+            Viewer_JobFinish();
+            return;
+        }
+        if (TimGetTicks() - start >= LOGVIEWER_JOB_TICKS)
+            break;
+    }
+}
+
+/* Read sJob.fromSecs..toSecs window by window, newest first. */
+static void Viewer_JobWindows(void)
+{
+    LogDB_Entry entry;
+    MemHandle h;
+    UInt32 nowSecs;
+    UInt32 fromSecs;
+    UInt32 toSecs;
+    UInt32 base;
+
+    if (sJob.iterOpen)
+        LogDB_IterEnd(&sJob.it);
+    sJob.iterOpen = false;
+    nowSecs = TimGetSeconds();
+    fromSecs = sJob.fromSecs;
+    toSecs = sJob.toSecs;
+
+    /* Windows stop at the oldest record in range: the first one the
+       iterator returns without filters, found in one record read */
+    sJob.floor = fromSecs;
+    if (Viewer_IterBegin(&sJob.it, fromSecs, toSecs) == errNone)
+    {
+        h = LogDB_IterNextEntry(&sJob.it, &entry);
+        if (h != NULL)
+        {
+            if (entry.seconds > sJob.floor)
+                sJob.floor = entry.seconds;
+            LogDB_IterUnlock(h);
+        }
+        LogDB_IterEnd(&sJob.it);
+    }
+
+    /* The card file and the per-app DBs have no time index to skip by,
+       so they are one window */
+    base = (toSecs < nowSecs) ? toSecs : nowSecs;
+    sJob.span = LOGVIEWER_FIRST_WINDOW;
+    sJob.hi = toSecs;
+    if (sSelectedSrc != SRC_Device || base < sJob.floor || base - sJob.floor <= sJob.span)
+        sJob.lo = sJob.floor;
+    else
+        sJob.lo = base - sJob.span;
+
+    sJob.stage = JobWindow;
+    if (!Viewer_JobOpen(sJob.lo, sJob.hi, sJob.appFilter, Viewer_Words()))
+    {
+        /* Nothing to read: straight on to the app scan or the end */
+        sJob.lo = sJob.floor;
+        Viewer_JobAdvance();
+    }
+}
+
+/* Start loading for the current filters; the event loop does the rest.
+   keepPage: leave what is shown (painted from the cache) until the first
+   results replace it. */
+static void Viewer_RefreshPage(Boolean keepPage)
+{
+    UInt16 state;
+
+    Viewer_JobCancel();
+    if (!keepPage)
+        Rows_SetText("");
+    StrCopy(sTitle, "LogViewer ...");
+    FrmSetTitle(FrmGetActiveForm(), sTitle);
+
+    if (sSelectedApp > 0 && sAppChoices != NULL && sSelectedApp < sAppChoiceCount)
+    {
+        sJob.appFilter = sAppChoices[sSelectedApp];
+    }
+    TimeFilter_Range(TimGetSeconds(), &sJob.fromSecs, &sJob.toSecs);
+
+    /* A word search reads through the iterator, whose filters pass over
+       whole runs of records, rather than seek each snapshot entry */
+    if (sSelectedSrc == SRC_Device && Viewer_Words() == NULL &&
+        LogDB_IterBeginRange(&sJob.it, 0, 0xFFFFFFFFUL) == errNone)
+    {
+        sJob.iterOpen = true;
+        state = Snap_Check(&sJob.it);
+        if (state == SnapCurrent && !sSnap.tooBig)
+        {
+            Viewer_JobShowBegin();
+            return;
+        }
+        if (state == SnapStale)
+        {
+            /* Start over, from a fresh iterator */
+            Snap_Free();
+            LogDB_IterEnd(&sJob.it);
+            sJob.iterOpen = (LogDB_IterBeginRange(&sJob.it, 0, 0xFFFFFFFFUL) == errNone);
+        }
+        if (state != SnapCurrent && sJob.iterOpen)
+        {
+            Snap_Sign(&sJob.it);
+            sSnap.complete = false;
+            sJob.stage = JobSnap;
+            return;
+        }
+    }
+    Viewer_JobWindows();
+}
+
+static void Viewer_Refresh(void)
+{
+    Viewer_RefreshPage(false);
+}
+
+/* --- Cache DB ---
+
+   On exit the filters, the app list, the snapshot with its signature and
+   the top of the page go to a small DB. The next launch paints from it
+   straight away, and its refresh checks the snapshot as any other does:
+   usually only what was logged since is read. One record each, in the
+   CacheRec order below; a cache that does not fit is not used. */
+
+#define LOGVIEWER_CACHE_VERSION 1
+#define LOGVIEWER_CACHE_PAGE 1024
+
+#define CacheRecHeader 0
+#define CacheRecApps 1     /* the list, NUL-separated */
+#define CacheRecSnapApps 2 /* sSnap.names, the same way */
+#define CacheRecSecs 3
+#define CacheRecPos 4
+#define CacheRecApp 5
+#define CacheRecPage 6
+#define CacheNumRecs 7
+
+typedef struct
+{
+    UInt16 version;
+    UInt16 time;
+    UInt16 src;
+    Char app[32]; /* selected; "" for All */
+    Char where[32];
+    UInt16 numApps;
+    Boolean hasSnap;
+    UInt16 numDBs;
+    LocalID dbIDs[LOGDB_MAX_SEGMENTS + 1];
+    UInt32 modNums[LOGDB_MAX_SEGMENTS + 1];
+    UInt16 count;
+    UInt16 numNames;
+} CacheHeader;
+
+static Err Cache_Put(DmOpenRef dbR, const void *src, UInt32 size)
+{
+    UInt16 index;
+    MemHandle h;
+    void *p;
+
+    index = dmMaxRecordIndex;
+    h = DmNewRecord(dbR, &index, (size > 0) ? size : 1);
+    if (h == NULL)
+        return DmGetLastErr();
+    p = MemHandleLock(h);
+    if (size > 0)
+        DmWrite(p, 0, src, size);
+    MemHandleUnlock(h);
+    DmReleaseRecord(dbR, index, true);
+    return errNone;
+}
+
+static Err Cache_PutNames(DmOpenRef dbR, Char **names, UInt16 count)
+{
+    UInt32 size;
+    UInt32 len;
+    Char *buf;
+    Err err;
+    UInt16 i;
+
+    size = 0;
+    for (i = 0; i < count; i++)
+        size += StrLen(names[i]) + 1;
+    buf = (Char *)MemPtrNew((size > 0) ? size : 1);
+    if (buf == NULL)
+        return memErrNotEnoughSpace;
+    size = 0;
+    for (i = 0; i < count; i++)
+    {
+        len = StrLen(names[i]) + 1;
+        MemMove(buf + size, names[i], len);
+        size += len;
     }
+    err = Cache_Put(dbR, buf, size);
+    MemPtrFree(buf);
+    return err;
+}
 
-    FldSetTextHandle(fld, sTextH);
-    FldRecalculateField(fld, true);
-    FldDrawField(fld);
-    Viewer_UpdateScrollBar(true);
+/* Copy count names out of a CacheRecApps-style record into names. */
+static UInt16 Cache_GetNames(DmOpenRef dbR, UInt16 index, Char **names, UInt16 count)
+{
+    MemHandle h;
+    const Char *p;
+    const Char *end;
+    UInt32 len;
+    UInt16 n;
+
+    h = DmQueryRecord(dbR, index);
+    if (h == NULL)
+        return 0;
+    p = (const Char *)MemHandleLock(h);
+    end = p + MemHandleSize(h);
+    for (n = 0; n < count && n < MAX_APPS && p < end; n++)
+    {
+        len = StrLen(p) + 1;
+        names[n] = (Char *)MemPtrNew(len);
+        if (names[n] == NULL)
+            break;
+        MemMove(names[n], p, len);
+        p += len;
+    }
+    MemHandleUnlock(h);
+    return n;
 }
 
-static void Viewer_UpdateScrollBar(Boolean redraw)
+/* Save the current view; any failure just leaves no cache behind. */
+static void Viewer_CacheSave(void)
 {
+    CacheHeader hdr;
     FormType *frm;
     FieldType *fld;
-    ScrollBarType *scb;
-    UInt16 scrollPos;
-    UInt16 textHeight;
-    UInt16 fieldHeight;
-    UInt16 maxValue;
+    DmOpenRef dbR;
+    LocalID dbID;
+    const Char *text;
+    UInt32 pageLen;
+    Boolean hasSnap;
+    Err err;
 
     frm = FrmGetActiveForm();
-    fld = (FieldType *)FrmGetObjectPtr(frm, FrmGetObjectIndex(frm, LogViewerFldID));
-    scb = (ScrollBarType *)FrmGetObjectPtr(frm, FrmGetObjectIndex(frm, LogViewerScbID));
+    if (frm == NULL || FrmGetActiveFormID() != LogViewerFormID)
+        return;
+    dbID = DmFindDatabase(0, LOGVIEWER_CACHE_NAME);
+    if (dbID != 0)
+        DmDeleteDatabase(0, dbID);
+
+    MemSet(&hdr, sizeof(hdr), 0);
+    hdr.version = LOGVIEWER_CACHE_VERSION;
+    hdr.time = sSelectedTime;
+    hdr.src = sSelectedSrc;
+    if (sSelectedApp > 0 && sSelectedApp < sAppChoiceCount)
+        StrNCopy(hdr.app, sAppChoices[sSelectedApp], sizeof(hdr.app) - 1);
+    fld = (FieldType *)FrmGetObjectPtr(frm, FrmGetObjectIndex(frm, LogViewerWhereFldID));
+    text = FldGetTextPtr(fld);
+    if (text != NULL)
+        StrNCopy(hdr.where, text, sizeof(hdr.where) - 1);
+    hdr.numApps = (sAppChoiceCount > 0) ? sAppChoiceCount - 1 : 0;
+
+    /* A snapshot still being taken, or of a log too big, is no use */
+    hasSnap = (sSnap.complete && !sSnap.tooBig);
+    hdr.hasSnap = hasSnap;
+    if (hasSnap)
+    {
+        hdr.numDBs = sSnap.numDBs;
+        MemMove(hdr.dbIDs, sSnap.dbIDs, sizeof(hdr.dbIDs));
+        MemMove(hdr.modNums, sSnap.modNums, sizeof(hdr.modNums));
+        hdr.count = sSnap.count;
+        hdr.numNames = sSnap.numNames;
+    }
+
+    /* The top of the page, cut at a line end */
+    text = Rows_Text(&pageLen);
+    if (pageLen > LOGVIEWER_CACHE_PAGE)
+    {
+        pageLen = LOGVIEWER_CACHE_PAGE;
+        while (pageLen > 0 && text[pageLen - 1] != '\n')
+            pageLen--;
+    }
+
+    if (DmCreateDatabase(0, LOGVIEWER_CACHE_NAME, LOGVIEWER_CREATOR, LOGVIEWER_CACHE_TYPE, false) !=
+        errNone)
+        return;
+    dbID = DmFindDatabase(0, LOGVIEWER_CACHE_NAME);
+    dbR = (dbID != 0) ? DmOpenDatabase(0, dbID, dmModeReadWrite) : NULL;
+    if (dbR == NULL)
+        return;
+    err = Cache_Put(dbR, &hdr, sizeof(hdr));
+    if (err == errNone)
+        err = Cache_PutNames(dbR, sAppChoices + 1, hdr.numApps);
+    if (err == errNone)
+        err = Cache_PutNames(dbR, sSnap.names, hdr.numNames);
+    if (err == errNone)
+        err = Cache_Put(dbR, sSnap.secs, hdr.count * sizeof(UInt32));
+    if (err == errNone)
+        err = Cache_Put(dbR, sSnap.pos, hdr.count * sizeof(UInt32));
+    if (err == errNone)
+        err = Cache_Put(dbR, sSnap.app, hdr.count);
+    if (err == errNone)
+        err = Cache_Put(dbR, text, pageLen);
+    DmCloseDatabase(dbR);
+    if (err != errNone)
+        DmDeleteDatabase(0, dbID);
+}
+
+/* Copy a cached array of size bytes into a new chunk. */
+static void *Cache_GetArray(DmOpenRef dbR, UInt16 index, UInt32 size)
+{
+    MemHandle h;
+    void *p;
 
-    scrollPos = 0;
-    textHeight = 0;
-    fieldHeight = 0;
-    maxValue = 0;
+    h = DmQueryRecord(dbR, index);
+    if (h == NULL || MemHandleSize(h) < size)
+        return NULL;
+    p = MemPtrNew((size > 0) ? size : 1);
+    if (p != NULL)
+        MemMove(p, MemHandleLock(h), size);
+    MemHandleUnlock(h);
+    return p;
+}
 
-    FldGetScrollValues(fld, &scrollPos, &textHeight, &fieldHeight);
-    if (textHeight > fieldHeight)
+/* Restore the snapshot from the cache; false leaves none. */
+static Boolean Cache_GetSnap(DmOpenRef dbR, const CacheHeader *hdr)
+{
+    Snap_Free();
+    if (hdr->count > LOGVIEWER_SNAP_MAX || hdr->numNames > MAX_APPS ||
+        hdr->numDBs > LOGDB_MAX_SEGMENTS + 1)
+        return false;
+    sSnap.numNames = Cache_GetNames(dbR, CacheRecSnapApps, sSnap.names, hdr->numNames);
+    sSnap.secs = (UInt32 *)Cache_GetArray(dbR, CacheRecSecs, hdr->count * sizeof(UInt32));
+    sSnap.pos = (UInt32 *)Cache_GetArray(dbR, CacheRecPos, hdr->count * sizeof(UInt32));
+    sSnap.app = (UInt8 *)Cache_GetArray(dbR, CacheRecApp, hdr->count);
+    if (sSnap.numNames != hdr->numNames || sSnap.secs == NULL || sSnap.pos == NULL ||
+        sSnap.app == NULL)
     {
-        maxValue = textHeight - fieldHeight;
+        Snap_Free();
+        return false;
     }
-    else
+    sSnap.count = hdr->count;
+    sSnap.cap = hdr->count;
+    sSnap.numDBs = hdr->numDBs;
+    MemMove(sSnap.dbIDs, hdr->dbIDs, sizeof(sSnap.dbIDs));
+    MemMove(sSnap.modNums, hdr->modNums, sizeof(sSnap.modNums));
+    sSnap.complete = true;
+    return true;
+}
+
+/* Point a popup trigger and its list at item sel. */
+static void Viewer_SetPopup(UInt16 trigID, UInt16 listID, UInt16 sel)
+{
+    FormType *frm;
+    ListType *lst;
+    ControlType *trg;
+
+    frm = FrmGetActiveForm();
+    lst = (ListType *)FrmGetObjectPtr(frm, FrmGetObjectIndex(frm, listID));
+    trg = (ControlType *)FrmGetObjectPtr(frm, FrmGetObjectIndex(frm, trigID));
+    LstSetSelection(lst, sel);
+    CtlSetLabel(trg, LstGetSelectionText(lst, sel));
+}
+
+/* Put the cached view on screen; false if there is none to use. */
+static Boolean Viewer_CacheLoad(void)
+{
+    CacheHeader hdr;
+    FormType *frm;
+    FieldType *fld;
+    FieldFilter ff;
+    DmOpenRef dbR;
+    LocalID dbID;
+    MemHandle h;
+    Char *names[MAX_APPS];
+    Char *page;
+    UInt16 numApps;
+
+    dbID = DmFindDatabase(0, LOGVIEWER_CACHE_NAME);
+    if (dbID == 0)
+        return false;
+    dbR = DmOpenDatabase(0, dbID, dmModeReadOnly);
+    if (dbR == NULL)
+        return false;
+    h = (DmNumRecords(dbR) == CacheNumRecs) ? DmQueryRecord(dbR, CacheRecHeader) : NULL;
+    if (h == NULL || MemHandleSize(h) != sizeof(hdr))
     {
-        maxValue = 0;
+        DmCloseDatabase(dbR);
+        return false;
+    }
+    MemMove(&hdr, MemHandleLock(h), sizeof(hdr));
+    MemHandleUnlock(h);
+    hdr.app[sizeof(hdr.app) - 1] = 0;
+    hdr.where[sizeof(hdr.where) - 1] = 0;
+    if (hdr.version != LOGVIEWER_CACHE_VERSION || hdr.time > TF_Today || hdr.src > SRC_Apps ||
+        hdr.numApps > MAX_APPS || !FieldFilter_Parse(hdr.where, &ff))
+    {
+        DmCloseDatabase(dbR);
+        return false;
     }
 
-    SclSetScrollBar(scb, scrollPos, 0, maxValue, (fieldHeight > 0) ? (fieldHeight - 1) : 0);
-    if (redraw)
+    /* Filters */
+    sSelectedTime = hdr.time;
+    sSelectedSrc = hdr.src;
+    sWhere = ff;
+    Viewer_SetPopup(LogViewerTimeTrigID, LogViewerTimeListID, sSelectedTime);
+    Viewer_SetPopup(LogViewerSrcTrigID, LogViewerSrcListID, sSelectedSrc);
+    frm = FrmGetActiveForm();
+    fld = (FieldType *)FrmGetObjectPtr(frm, FrmGetObjectIndex(frm, LogViewerWhereFldID));
+    FldDelete(fld, 0, FldGetTextLength(fld));
+    FldInsert(fld, hdr.where, StrLen(hdr.where));
+
+    /* Apps, then the snapshot the refresh will check */
+    numApps = Cache_GetNames(dbR, CacheRecApps, names, hdr.numApps);
+    Viewer_InstallAppChoices(names, numApps);
+    if (hdr.app[0] != 0)
+        Viewer_SelectApp(hdr.app);
+    sAppsStale = false;
+    if (hdr.hasSnap)
+        Cache_GetSnap(dbR, &hdr);
+
+    /* The record has no terminator of its own */
+    h = DmQueryRecord(dbR, CacheRecPage);
+    page = (h != NULL) ? (Char *)MemPtrNew(MemHandleSize(h) + 1) : NULL;
+    if (page != NULL)
     {
-        FldDrawField(fld);
+        MemMove(page, MemHandleLock(h), MemHandleSize(h));
+        MemHandleUnlock(h);
+        page[MemHandleSize(h)] = 0;
+        Rows_SetText(page);
+        MemPtrFree(page);
     }
+    DmCloseDatabase(dbR);
+    return true;
+}
+
+/* What logging has cost this session so far (LogDB_GetStats). */
+static void Viewer_ShowCost(void)
+{
+    LogDB_Stats stats;
+    Char written[48];
+    Char dm[32];
+    Char ticks[48];
+
+    LogDB_GetStats(&stats);
+    StrPrintF(written, "%lu calls, %lu KB, %lu failed", stats.calls, (stats.bytes + 1023) / 1024,
+              stats.failures);
+    StrPrintF(dm, "%lu Data Manager calls", stats.dmCalls);
+    StrPrintF(ticks, "Ticks: log %lu, read %lu, clear %lu", stats.logTicks, stats.iterTicks,
+              stats.clearTicks);
+    FrmCustomAlert(LogCostAlertID, written, dm, ticks);
 }
 
 /* --- Standard app skeleton --- */
 
 static Err AppStart(void)
 {
-    /* Nothing special needed for viewer at start */
+    UInt32 migrated;
+
+    /* Records from older LogDB builds are rewritten as v2 once; the reader
+       takes both, so a failure here only costs speed */
+    if (FtrGet(LOGVIEWER_CREATOR, LogViewerFtrMigrated, &migrated) != errNone)
+    {
+        if (LogDB_Migrate(NULL) == errNone)
+            FtrSet(LOGVIEWER_CREATOR, LogViewerFtrMigrated, 1);
+    }
+
+    /* Only for the event timings and memory samples: the viewer logs
+       nothing else */
+    LogDB_Init("LogViewer");
+    LogEvt_Init(&sLoop, 0);
+    LogDB_SetMemInterval(SysTicksPerSecond() * 60UL);
     return errNone;
 }
 
 static void AppStop(void)
 {
-    if (sTextH != NULL)
-    {
-        /* Ensure field does not hold it before freeing */
-        FormType *frm;
-        FieldType *fld;
-        frm = FrmGetActiveForm();
-        if (frm != NULL)
-        {
-            fld = (FieldType *)FrmGetObjectPtr(frm, FrmGetObjectIndex(frm, LogViewerFldID));
-            if (fld != NULL)
-            {
-                FldSetTextHandle(fld, NULL);
-            }
-        }
-        MemHandleFree(sTextH);
-        sTextH = NULL;
-    }
+    /* While the rows still hold the page */
+    Viewer_CacheSave();
+    Rows_Close();
+    Viewer_JobCancel();
+    Snap_Free();
+    Stats_Cancel();
     Viewer_FreeAppChoices();
+
+    /* Clear opens the DB read/write; also releases the shared library */
+    LogEvt_Report(&sLoop);
+    LogDB_Close();
 }
 
 static void AppEventLoop(void)
 {
     EventType event;
-    UInt16 err;
+    Boolean mainActive;
 
     /* Properly open: generates frmLoadEvent then frmOpenEvent */
     FrmGotoForm(LogViewerFormID);
 
     do
     {
-        EvtGetEvent(&event, evtWaitForever);
-
-        if (!SysHandleEvent(&event))
-            if (!MenuHandleEvent(0, &event, &err))
-                if (!AppHandleEvent(&event))
-                    FrmDispatchEvent(&event);
+        /* A load in progress takes every spare moment, then LogDB's
+           upkeep. The main form's load waits while the stats form is up */
+        mainActive = (FrmGetActiveFormID() == LogViewerFormID);
+        if (Stats_Busy() || (Viewer_JobBusy() && mainActive))
+            EvtGetEvent(&event, 0);
+        else
+            EvtGetEvent(&event, LogDB_Idle(0) ? LOGVIEWER_IDLE_TICKS : evtWaitForever);
+
+        LogEvt_Dispatch(&sLoop, &event, AppHandleEvent);
+
+        if (event.eType != nilEvent)
+            continue;
+        if (Stats_Busy())
+            Stats_Step();
+        else if (Viewer_JobBusy() && FrmGetActiveFormID() == LogViewerFormID)
+            Viewer_JobStep();
+        else if (!Viewer_JobBusy())
+            LogDB_Idle(LOGVIEWER_IDLE_BUDGET);
 
     } while (event.eType != appStopEvent);
 }
@@ -581,6 +1604,13 @@ static Boolean AppHandleEvent(EventType *eventP)
             FrmSetEventHandler(frm, MainFormHandleEvent);
             return true;
         }
+        if (formId == LogStatsFormID)
+        {
+            frm = FrmInitForm(formId);
+            FrmSetActiveForm(frm);
+            FrmSetEventHandler(frm, StatsFormHandleEvent);
+            return true;
+        }
     }
     return false;
 }
@@ -596,19 +1626,20 @@ static Boolean MainFormHandleEvent(EventType *eventP)
     case frmOpenEvent:
     {
         FormType *frm;
-        FieldType *fld;
 
         frm = FrmGetActiveForm();
         FrmDrawForm(frm);
+        Rows_Open(LogViewerRowsGadID, LogViewerScbID);
 
-        /* Make sure the big field is non-editable at runtime too (RCP should already set NONEDITABLE) */
-        // fld = (FieldType *)FrmGetObjectPtr(frm, FrmGetObjectIndex(frm, LogViewerFldID));
-        // if (fld != NULL) {
-        //     FldSetEditable(fld, false);
-        // }
-
-        Viewer_BuildAppChoices();
-        Viewer_Refresh();
+        /* Last exit's view first, if there is one; the refresh then
+           brings it up to date */
+        if (Viewer_CacheLoad())
+            Viewer_RefreshPage(true);
+        else
+        {
+            Viewer_BuildAppChoices();
+            Viewer_Refresh();
+        }
         handled = true;
         break;
     }
@@ -616,42 +1647,79 @@ static Boolean MainFormHandleEvent(EventType *eventP)
     case ctlSelectEvent:
         if (eventP->data.ctlSelect.controlID == LogViewerBtnClearID)
         {
-            /* Clear DB and refresh */
-            LogDB_ClearAll();
+            /* Clear DB (and card file) and refresh; a running load has
+               a DB open. Per-app DBs with an app picked: just that app's */
+            Viewer_JobCancel();
+            if (sSelectedSrc == SRC_Apps && sSelectedApp > 0 && sSelectedApp < sAppChoiceCount)
+                LogDB_ClearApp(sAppChoices[sSelectedApp]);
+            else
+                LogDB_ClearAll();
             Viewer_BuildAppChoices();
             Viewer_Refresh();
             handled = true;
         }
+        else if (eventP->data.ctlSelect.controlID == LogViewerBtnWhereID)
+        {
+            FormType *frm;
+            FieldType *whereFld;
+            FieldFilter ff;
+
+            /* Keep the old filter if the new text does not parse */
+            frm = FrmGetActiveForm();
+            whereFld = (FieldType *)FrmGetObjectPtr(frm, FrmGetObjectIndex(frm, LogViewerWhereFldID));
+            if (FieldFilter_Parse(FldGetTextPtr(whereFld), &ff))
+            {
+                sWhere = ff;
+                Viewer_Refresh();
+            }
+            else
+            {
+                SndPlaySystemSound(sndError);
+            }
+            handled = true;
+        }
         break;
 
     case sclRepeatEvent:
-    {
-        FormType *frm;
-        FieldType *fld;
-        Int16 newValue;
-        Int16 value;
+        Rows_ScrollTo(eventP->data.sclRepeat.newValue);
+        handled = true;
+        break;
 
-        frm = FrmGetActiveForm();
-        fld = (FieldType *)FrmGetObjectPtr(frm, FrmGetObjectIndex(frm, LogViewerFldID));
-        newValue = eventP->data.sclRepeat.newValue;
-        value = eventP->data.sclRepeat.value;
+    case frmUpdateEvent:
+        /* Back from the stats form: the rows come from the back buffer */
+        FrmDrawForm(FrmGetActiveForm());
+        Rows_Draw();
+        handled = true;
+        break;
 
-        if (newValue > value)
+    case menuEvent:
+        if (eventP->data.menu.itemID == LogViewerMenuStatsID)
         {
-            FldScrollField(fld, (UInt16)(newValue - value), winDown);
+            UInt32 fromSecs;
+            UInt32 toSecs;
+
+            /* Same window and source as the list */
+            TimeFilter_Range(TimGetSeconds(), &fromSecs, &toSecs);
+            Stats_SetWindow(Viewer_Sink(), fromSecs, toSecs);
+            FrmPopupForm(LogStatsFormID);
+            handled = true;
         }
-        else if (newValue < value)
+        else if (eventP->data.menu.itemID == LogViewerMenuCostID)
         {
-            FldScrollField(fld, (UInt16)(value - newValue), winUp);
+            Viewer_ShowCost();
+            handled = true;
         }
-        Viewer_UpdateScrollBar(false);
-        handled = true;
         break;
-    }
 
-    case fldChangedEvent:
-        Viewer_UpdateScrollBar(false);
-        handled = true;
+    case frmTitleSelectEvent:
+        /* Tapping the title stops a load, keeping what is shown */
+        if (Viewer_JobBusy())
+        {
+            if (sJob.stage == JobWindow)
+                Viewer_JobShowWindow(false);
+            Viewer_JobFinish();
+            handled = true;
+        }
         break;
 
     case popSelectEvent:
@@ -667,6 +1735,24 @@ static Boolean MainFormHandleEvent(EventType *eventP)
             Viewer_Refresh();
             handled = true;
         }
+        else if (eventP->data.popSelect.listID == LogViewerSrcListID)
+        {
+            FormType *frm;
+            ControlType *trg;
+            ListType *lst;
+
+            /* Handled here, so the trigger label is ours to update */
+            frm = FrmGetActiveForm();
+            lst = (ListType *)FrmGetObjectPtr(frm, FrmGetObjectIndex(frm, LogViewerSrcListID));
+            trg = (ControlType *)FrmGetObjectPtr(frm, FrmGetObjectIndex(frm, LogViewerSrcTrigID));
+            sSelectedSrc = eventP->data.popSelect.selection;
+            CtlSetLabel(trg, LstGetSelectionText(lst, sSelectedSrc));
+
+            /* Different backend, different set of apps */
+            Viewer_BuildAppChoices();
+            Viewer_Refresh();
+            handled = true;
+        }
         break;
 
     default:
@@ -4,9 +4,16 @@
 #define LOGVIEWER_CREATOR 'LVwr'
 #define LOGVIEWER_TYPE 'appl'
 
+/* Last view, for painting at launch (LogViewer.c, "Cache DB") */
+#define LOGVIEWER_CACHE_NAME "LogViewer-Cache"
+#define LOGVIEWER_CACHE_TYPE 'LVca'
+
+/* Feature set once the log has been migrated to v2 records (until reset) */
+#define LogViewerFtrMigrated 0
+
 /* Form & Controls */
 #define LogViewerFormID 3000
-#define LogViewerFldID 3001
+#define LogViewerRowsGadID 3001
 #define LogViewerScbID 3002
 #define LogViewerBtnClearID 3003
 
@@ -16,6 +23,26 @@
 #define LogViewerTimeTrigID 3006
 #define LogViewerTimeListID 3007
 
+#define LogViewerSrcTrigID 3008
+#define LogViewerSrcListID 3009
+
+#define LogViewerWhereFldID 3010
+#define LogViewerBtnWhereID 3011
+
+/* Menu */
+#define LogViewerMenuID 3020
+#define LogViewerMenuStatsID 3021
+#define LogViewerMenuCostID 3022
+
+/* App stats form (LogStats.c) */
+#define LogStatsFormID 3100
+#define LogStatsListID 3101
+#define LogStatsHistGadID 3102
+#define LogStatsBtnDoneID 3103
+
+/* Logging cost alert */
+#define LogCostAlertID 3200
+
 /* Time filter enum (list indices) */
 #define TF_All 0
 #define TF_LastHour 1
@@ -23,4 +50,9 @@
 #define TF_Last7d 3
 #define TF_Today 4
 
+/* Log source (list indices) */
+#define SRC_Device 0
+#define SRC_Card 1
+#define SRC_Apps 2 /* the per-app DBs (LOGDB_SINK_APPDB) */
+
 #endif /* LOGVIEWER_H */
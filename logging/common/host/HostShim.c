@@ -0,0 +1,1485 @@
+/*
+    In-process stand-in for the Data, Memory, String and Time Managers.
+
+    Databases live in a small table of heap-allocated record arrays. Chunks
+    carry a header in front of the payload so DmWrite can bounds-check the
+    locked pointer it is handed, just like the real storage heap does.
+*/
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+
+#include "HostShim.h"
+
+#define HOST_MAX_DBS 256
+#define HOST_MAX_LOCAL_IDS 1024
+#define HOST_LOCAL_ID_BASE 0x80000000UL /* keeps chunk IDs apart from DB IDs */
+#define HOST_CHUNK_MAGIC 0x43484B21UL /* 'CHK!' */
+#define HOST_MAX_FILES 16
+#define HOST_VOL_REF 1
+#define HOST_PDB_HEADER 78 /* then an 8-byte entry per record */
+
+/* 2024-01-01 00:00:00 in Palm seconds */
+#define HOST_DEFAULT_SECONDS 3786912000UL
+
+typedef struct HostChunkTag
+{
+    UInt32 magic;
+    UInt32 size;
+    LocalID localID; /* 0 until MemHandleToLocalID */
+    UInt16 lockCount;
+    Boolean isRecord;
+    UInt8 pad;
+    /* payload follows */
+} HostChunk;
+
+typedef struct
+{
+    MemHandle h;
+    UInt8 attr;
+    Boolean busy;
+} HostRecord;
+
+typedef struct
+{
+    LocalID id;
+    Char name[dmDBNameLength];
+    UInt32 type;
+    UInt32 creator;
+    UInt16 attrs;
+    UInt16 version;
+    UInt32 crDate;
+    UInt32 modDate;
+    UInt32 bckDate;
+    UInt32 modNum;
+    LocalID appInfoID;
+    LocalID sortInfoID;
+    UInt16 openCount;
+
+    /* What HostShim_Backup last saw, to tell what changed since */
+    UInt32 bckModNum;
+    Char bckName[dmDBNameLength];
+
+    HostRecord *recs;
+    UInt32 numRecs;
+    UInt32 capRecs;
+} HostDB;
+
+typedef struct HostOpenDBTag
+{
+    HostDB *db;
+    UInt16 mode;
+} HostOpenDB;
+
+static HostDB *sDBs[HOST_MAX_DBS];
+static HostChunk *sLocalIDs[HOST_MAX_LOCAL_IDS];
+static LocalID sNextID = 1;
+static Err sLastErr = errNone;
+static UInt32 sSeconds = HOST_DEFAULT_SECONDS;
+static HostShim_Stats sStats;
+static UInt32 sStorageBytes = HOST_STORAGE_HEAP_BYTES;
+
+typedef struct
+{
+    FILE *fp;
+    char path[512];
+    UInt16 mode;
+} HostFile;
+
+static char sVolRoot[256];
+static HostFile sFiles[HOST_MAX_FILES];
+
+static const char *sApiNames[hostApiCount] = {
+    "DmCreateDatabase",
+    "DmFindDatabase",
+    "DmDeleteDatabase",
+    "DmGetNextDatabaseByTypeCreator",
+    "DmDatabaseSize",
+    "DmDatabaseInfo",
+    "DmSetDatabaseInfo",
+    "DmOpenDatabase",
+    "DmOpenDatabaseByTypeCreator",
+    "DmCloseDatabase",
+    "DmOpenDatabaseInfo",
+    "DmNumRecords",
+    "DmNewRecord",
+    "DmQueryRecord",
+    "DmGetRecord",
+    "DmReleaseRecord",
+    "DmRemoveRecord",
+    "DmResizeRecord",
+    "DmWrite",
+    "DmNewHandle",
+    "MemPtrNew",
+    "MemPtrFree",
+    "MemHandleNew",
+    "MemHandleFree",
+    "MemHandleLock",
+    "MemHandleUnlock",
+    "MemHeapFreeBytes",
+    "TimGetSeconds",
+    "TimGetTicks",
+    "EvtWakeup",
+    "VFSFileOpen",
+    "VFSFileClose",
+    "VFSFileRead",
+    "VFSFileWrite",
+    "VFSFileSeek",
+};
+
+#define COUNT(api) (sStats.calls[(api)]++)
+
+static void Host_Fatal(const char *what)
+{
+    fprintf(stderr, "HostShim: %s\n", what);
+    abort();
+}
+
+/* --- Chunks --- */
+
+static HostChunk *Chunk_New(UInt32 size, Boolean isRecord)
+{
+    HostChunk *c;
+
+    if (isRecord && (size > sStorageBytes || sStats.storageInUse > sStorageBytes - size))
+        return NULL; /* the storage heap is full */
+    c = (HostChunk *)calloc(1, sizeof(HostChunk) + (size ? size : 1));
+    if (c == NULL)
+        return NULL;
+    c->magic = HOST_CHUNK_MAGIC;
+    c->size = size;
+    c->isRecord = isRecord;
+    if (isRecord)
+    {
+        sStats.recordBytes += size;
+        sStats.storageInUse += size;
+        if (sStats.storageInUse > sStats.storagePeak)
+            sStats.storagePeak = sStats.storageInUse;
+    }
+    else
+        sStats.heapInUse += size;
+    return c;
+}
+
+static void Chunk_Free(HostChunk *c)
+{
+    if (c == NULL)
+        return;
+    if (c->magic != HOST_CHUNK_MAGIC)
+        Host_Fatal("free of a bad chunk");
+    if (c->isRecord)
+        sStats.storageInUse -= c->size;
+    else
+        sStats.heapInUse -= c->size;
+    if (c->localID != 0)
+        sLocalIDs[c->localID - HOST_LOCAL_ID_BASE] = NULL;
+    c->magic = 0;
+    free(c);
+}
+
+static UInt8 *Chunk_Data(HostChunk *c)
+{
+    return (UInt8 *)(c + 1);
+}
+
+static HostChunk *Chunk_FromData(const void *p)
+{
+    HostChunk *c;
+
+    c = ((HostChunk *)p) - 1;
+    if (c->magic != HOST_CHUNK_MAGIC)
+        Host_Fatal("pointer is not the start of a chunk");
+    return c;
+}
+
+/* --- Memory Manager --- */
+
+MemPtr MemPtrNew(UInt32 size)
+{
+    HostChunk *c;
+
+    COUNT(hostApiMemPtrNew);
+    c = Chunk_New(size, false);
+    return (c != NULL) ? Chunk_Data(c) : NULL;
+}
+
+Err MemPtrFree(MemPtr p)
+{
+    COUNT(hostApiMemPtrFree);
+    if (p == NULL)
+        return memErrInvalidParam;
+    Chunk_Free(Chunk_FromData(p));
+    return errNone;
+}
+
+MemHandle MemHandleNew(UInt32 size)
+{
+    COUNT(hostApiMemHandleNew);
+    return Chunk_New(size, false);
+}
+
+Err MemHandleFree(MemHandle h)
+{
+    COUNT(hostApiMemHandleFree);
+    if (h == NULL)
+        return memErrInvalidParam;
+    Chunk_Free(h);
+    return errNone;
+}
+
+MemPtr MemHandleLock(MemHandle h)
+{
+    COUNT(hostApiMemHandleLock);
+    if (h == NULL)
+        return NULL;
+    h->lockCount++;
+    return Chunk_Data(h);
+}
+
+Err MemHandleUnlock(MemHandle h)
+{
+    COUNT(hostApiMemHandleUnlock);
+    if (h == NULL || h->lockCount == 0)
+        return memErrInvalidParam;
+    h->lockCount--;
+    return errNone;
+}
+
+UInt32 MemHandleSize(MemHandle h)
+{
+    return (h != NULL) ? h->size : 0;
+}
+
+UInt16 MemHeapID(UInt16 cardNo, UInt16 heapIndex)
+{
+    (void)cardNo;
+    return heapIndex;
+}
+
+Err MemHeapFreeBytes(UInt16 heapID, UInt32 *freeP, UInt32 *maxP)
+{
+    UInt32 size;
+    UInt32 used;
+
+    COUNT(hostApiMemHeapFreeBytes);
+    size = (heapID == 0) ? HOST_DYNAMIC_HEAP_BYTES : sStorageBytes;
+    used = (heapID == 0) ? sStats.heapInUse : sStats.storageInUse;
+    *freeP = (used < size) ? size - used : 0;
+    *maxP = *freeP;
+    return errNone;
+}
+
+Err MemPtrUnlock(MemPtr p)
+{
+    return MemHandleUnlock(Chunk_FromData(p));
+}
+
+LocalID MemHandleToLocalID(MemHandle h)
+{
+    UInt32 i;
+
+    if (h == NULL)
+        return 0;
+    if (h->localID != 0)
+        return h->localID;
+    for (i = 1; i < HOST_MAX_LOCAL_IDS; i++)
+    {
+        if (sLocalIDs[i] == NULL)
+        {
+            sLocalIDs[i] = h;
+            h->localID = HOST_LOCAL_ID_BASE + i;
+            return h->localID;
+        }
+    }
+    Host_Fatal("out of chunk LocalIDs");
+    return 0;
+}
+
+/* Chunk LocalIDs are all handles here, so this is the MemHandle */
+MemPtr MemLocalIDToGlobal(LocalID local, UInt16 cardNo)
+{
+    UInt32 i;
+
+    (void)cardNo;
+    if (local <= HOST_LOCAL_ID_BASE)
+        return NULL;
+    i = local - HOST_LOCAL_ID_BASE;
+    return (i < HOST_MAX_LOCAL_IDS) ? (MemPtr)sLocalIDs[i] : NULL;
+}
+
+MemPtr MemLocalIDToLockedPtr(LocalID local, UInt16 cardNo)
+{
+    UInt32 i;
+
+    (void)cardNo;
+    if (local <= HOST_LOCAL_ID_BASE)
+        return NULL;
+    i = local - HOST_LOCAL_ID_BASE;
+    if (i >= HOST_MAX_LOCAL_IDS || sLocalIDs[i] == NULL)
+        return NULL;
+    return MemHandleLock(sLocalIDs[i]);
+}
+
+Err MemMove(void *dstP, const void *sP, Int32 numBytes)
+{
+    if (numBytes > 0)
+        memmove(dstP, sP, (size_t)numBytes);
+    return errNone;
+}
+
+Err MemSet(void *dstP, Int32 numBytes, UInt8 value)
+{
+    if (numBytes > 0)
+        memset(dstP, value, (size_t)numBytes);
+    return errNone;
+}
+
+Int16 MemCmp(const void *s1, const void *s2, Int32 numBytes)
+{
+    int r;
+
+    r = memcmp(s1, s2, (size_t)numBytes);
+    return (Int16)((r > 0) - (r < 0));
+}
+
+/* --- Data Manager --- */
+
+static HostDB *DB_ByID(LocalID id)
+{
+    UInt16 i;
+
+    for (i = 0; i < HOST_MAX_DBS; i++)
+    {
+        if (sDBs[i] != NULL && sDBs[i]->id == id)
+            return sDBs[i];
+    }
+    return NULL;
+}
+
+static HostDB *DB_ByName(const Char *name)
+{
+    UInt16 i;
+
+    for (i = 0; i < HOST_MAX_DBS; i++)
+    {
+        if (sDBs[i] != NULL && strcmp(sDBs[i]->name, name) == 0)
+            return sDBs[i];
+    }
+    return NULL;
+}
+
+static void DB_FreeInfoBlock(LocalID id)
+{
+    UInt32 i;
+
+    if (id <= HOST_LOCAL_ID_BASE)
+        return;
+    i = id - HOST_LOCAL_ID_BASE;
+    if (i < HOST_MAX_LOCAL_IDS && sLocalIDs[i] != NULL)
+        Chunk_Free(sLocalIDs[i]);
+}
+
+static void DB_Free(HostDB *db)
+{
+    UInt32 i;
+
+    for (i = 0; i < db->numRecs; i++)
+        Chunk_Free(db->recs[i].h);
+    DB_FreeInfoBlock(db->appInfoID);
+    DB_FreeInfoBlock(db->sortInfoID);
+    free(db->recs);
+    free(db);
+}
+
+static Err SetErr(Err err)
+{
+    sLastErr = err;
+    return err;
+}
+
+Err DmCreateDatabase(UInt16 cardNo, const Char *nameP, UInt32 creator, UInt32 type,
+                     Boolean resDB)
+{
+    HostDB *db;
+    UInt16 i;
+
+    COUNT(hostApiDmCreateDatabase);
+    (void)cardNo;
+    if (nameP == NULL || nameP[0] == 0 || strlen(nameP) >= dmDBNameLength)
+        return SetErr(dmErrInvalidParam);
+    if (DB_ByName(nameP) != NULL)
+        return SetErr(dmErrAlreadyExists);
+
+    for (i = 0; i < HOST_MAX_DBS; i++)
+    {
+        if (sDBs[i] == NULL)
+            break;
+    }
+    if (i == HOST_MAX_DBS)
+        return SetErr(dmErrMemError);
+
+    db = (HostDB *)calloc(1, sizeof(HostDB));
+    if (db == NULL)
+        return SetErr(dmErrMemError);
+    db->id = sNextID++;
+    strcpy(db->name, nameP);
+    db->type = type;
+    db->creator = creator;
+    db->attrs = resDB ? dmHdrAttrResDB : 0;
+    db->crDate = sSeconds;
+    db->modDate = sSeconds;
+    sDBs[i] = db;
+    return SetErr(errNone);
+}
+
+LocalID DmFindDatabase(UInt16 cardNo, const Char *nameP)
+{
+    HostDB *db;
+
+    COUNT(hostApiDmFindDatabase);
+    (void)cardNo;
+    db = (nameP != NULL) ? DB_ByName(nameP) : NULL;
+    if (db == NULL)
+    {
+        SetErr(dmErrCantFind);
+        return 0;
+    }
+    return db->id;
+}
+
+Err DmDeleteDatabase(UInt16 cardNo, LocalID dbID)
+{
+    UInt16 i;
+
+    COUNT(hostApiDmDeleteDatabase);
+    (void)cardNo;
+    for (i = 0; i < HOST_MAX_DBS; i++)
+    {
+        if (sDBs[i] != NULL && sDBs[i]->id == dbID)
+        {
+            if (sDBs[i]->openCount > 0)
+                return SetErr(dmErrDatabaseOpen);
+            DB_Free(sDBs[i]);
+            sDBs[i] = NULL;
+            return SetErr(errNone);
+        }
+    }
+    return SetErr(dmErrCantFind);
+}
+
+Err DmGetLastErr(void)
+{
+    return sLastErr;
+}
+
+Err DmGetNextDatabaseByTypeCreator(Boolean newSearch, DmSearchStatePtr stateInfoP,
+                                   UInt32 type, UInt32 creator, Boolean onlyLatestVers,
+                                   UInt16 *cardNoP, LocalID *dbIDP)
+{
+    UInt32 i;
+
+    COUNT(hostApiDmGetNextDatabaseByTypeCreator);
+    (void)onlyLatestVers;
+    if (stateInfoP == NULL)
+        return SetErr(dmErrInvalidParam);
+    if (newSearch)
+        stateInfoP->info[0] = 0;
+
+    /* 0 acts as a wildcard for type and creator, as on the device */
+    for (i = stateInfoP->info[0]; i < HOST_MAX_DBS; i++)
+    {
+        HostDB *db = sDBs[i];
+        if (db == NULL)
+            continue;
+        if ((type == 0 || db->type == type) && (creator == 0 || db->creator == creator))
+        {
+            stateInfoP->info[0] = i + 1;
+            if (cardNoP != NULL)
+                *cardNoP = 0;
+            if (dbIDP != NULL)
+                *dbIDP = db->id;
+            return errNone;
+        }
+    }
+    stateInfoP->info[0] = HOST_MAX_DBS;
+    return SetErr(dmErrCantFind);
+}
+
+Err DmDatabaseSize(UInt16 cardNo, LocalID dbID, UInt32 *numRecordsP, UInt32 *totalBytesP,
+                   UInt32 *dataBytesP)
+{
+    HostDB *db;
+    UInt32 i;
+    UInt32 data;
+
+    COUNT(hostApiDmDatabaseSize);
+    (void)cardNo;
+    db = DB_ByID(dbID);
+    if (db == NULL)
+        return SetErr(dmErrCantFind);
+
+    data = 0;
+    for (i = 0; i < db->numRecs; i++)
+        data += db->recs[i].h->size;
+    if (numRecordsP != NULL)
+        *numRecordsP = db->numRecs;
+    if (dataBytesP != NULL)
+        *dataBytesP = data;
+    /* Header plus an 8-byte record list entry per record, as in a PDB */
+    if (totalBytesP != NULL)
+        *totalBytesP = data + 78 + 8 * db->numRecs;
+    return errNone;
+}
+
+Err DmDatabaseInfo(UInt16 cardNo, LocalID dbID, Char *nameP, UInt16 *attributesP,
+                   UInt16 *versionP, UInt32 *crDateP, UInt32 *modDateP, UInt32 *bckUpDateP,
+                   UInt32 *modNumP, LocalID *appInfoIDP, LocalID *sortInfoIDP,
+                   UInt32 *typeP, UInt32 *creatorP)
+{
+    HostDB *db;
+
+    COUNT(hostApiDmDatabaseInfo);
+    (void)cardNo;
+    db = DB_ByID(dbID);
+    if (db == NULL)
+        return SetErr(dmErrCantFind);
+
+    if (nameP != NULL)
+        strcpy(nameP, db->name);
+    if (attributesP != NULL)
+        *attributesP = db->attrs | (db->openCount ? dmHdrAttrOpen : 0);
+    if (versionP != NULL)
+        *versionP = db->version;
+    if (crDateP != NULL)
+        *crDateP = db->crDate;
+    if (modDateP != NULL)
+        *modDateP = db->modDate;
+    if (bckUpDateP != NULL)
+        *bckUpDateP = db->bckDate;
+    if (modNumP != NULL)
+        *modNumP = db->modNum;
+    if (appInfoIDP != NULL)
+        *appInfoIDP = db->appInfoID;
+    if (sortInfoIDP != NULL)
+        *sortInfoIDP = db->sortInfoID;
+    if (typeP != NULL)
+        *typeP = db->type;
+    if (creatorP != NULL)
+        *creatorP = db->creator;
+    return errNone;
+}
+
+Err DmSetDatabaseInfo(UInt16 cardNo, LocalID dbID, const Char *nameP, UInt16 *attributesP,
+                      UInt16 *versionP, UInt32 *crDateP, UInt32 *modDateP, UInt32 *bckUpDateP,
+                      UInt32 *modNumP, LocalID *appInfoIDP, LocalID *sortInfoIDP,
+                      UInt32 *typeP, UInt32 *creatorP)
+{
+    HostDB *db;
+
+    COUNT(hostApiDmSetDatabaseInfo);
+    (void)cardNo;
+    db = DB_ByID(dbID);
+    if (db == NULL)
+        return SetErr(dmErrCantFind);
+
+    if (nameP != NULL)
+    {
+        HostDB *other;
+        if (nameP[0] == 0 || strlen(nameP) >= dmDBNameLength)
+            return SetErr(dmErrInvalidParam);
+        other = DB_ByName(nameP);
+        if (other != NULL && other != db)
+            return SetErr(dmErrAlreadyExists);
+        strcpy(db->name, nameP);
+    }
+    if (attributesP != NULL)
+        db->attrs = *attributesP & (UInt16)~dmHdrAttrOpen;
+    if (versionP != NULL)
+        db->version = *versionP;
+    if (crDateP != NULL)
+        db->crDate = *crDateP;
+    if (modDateP != NULL)
+        db->modDate = *modDateP;
+    if (bckUpDateP != NULL)
+        db->bckDate = *bckUpDateP;
+    if (modNumP != NULL)
+        db->modNum = *modNumP;
+    if (appInfoIDP != NULL)
+        db->appInfoID = *appInfoIDP;
+    if (sortInfoIDP != NULL)
+        db->sortInfoID = *sortInfoIDP;
+    if (typeP != NULL)
+        db->type = *typeP;
+    if (creatorP != NULL)
+        db->creator = *creatorP;
+    return errNone;
+}
+
+static DmOpenRef Open_New(HostDB *db, UInt16 mode)
+{
+    HostOpenDB *ref;
+
+    ref = (HostOpenDB *)calloc(1, sizeof(HostOpenDB));
+    if (ref == NULL)
+    {
+        SetErr(dmErrMemError);
+        return NULL;
+    }
+    ref->db = db;
+    ref->mode = mode;
+    db->openCount++;
+    return ref;
+}
+
+DmOpenRef DmOpenDatabase(UInt16 cardNo, LocalID dbID, UInt16 mode)
+{
+    HostDB *db;
+
+    COUNT(hostApiDmOpenDatabase);
+    (void)cardNo;
+    db = DB_ByID(dbID);
+    if (db == NULL)
+    {
+        SetErr(dmErrCantFind);
+        return NULL;
+    }
+    return Open_New(db, mode);
+}
+
+DmOpenRef DmOpenDatabaseByTypeCreator(UInt32 type, UInt32 creator, UInt16 mode)
+{
+    HostDB *best;
+    UInt16 i;
+
+    COUNT(hostApiDmOpenDatabaseByTypeCreator);
+    /* Like the device, the most recently created match wins. */
+    best = NULL;
+    for (i = 0; i < HOST_MAX_DBS; i++)
+    {
+        HostDB *db = sDBs[i];
+        if (db != NULL && db->type == type && db->creator == creator)
+        {
+            if (best == NULL || db->id > best->id)
+                best = db;
+        }
+    }
+    if (best == NULL)
+    {
+        SetErr(dmErrCantFind);
+        return NULL;
+    }
+    return Open_New(best, mode);
+}
+
+Err DmCloseDatabase(DmOpenRef dbP)
+{
+    COUNT(hostApiDmCloseDatabase);
+    if (dbP == NULL)
+        return SetErr(dmErrInvalidParam);
+    if (dbP->db->openCount > 0)
+        dbP->db->openCount--;
+    free(dbP);
+    return errNone;
+}
+
+Err DmOpenDatabaseInfo(DmOpenRef dbP, LocalID *dbIDP, UInt16 *openCountP, UInt16 *modeP,
+                       UInt16 *cardNoP, Boolean *resDBP)
+{
+    COUNT(hostApiDmOpenDatabaseInfo);
+    if (dbP == NULL)
+        return SetErr(dmErrInvalidParam);
+    if (dbIDP != NULL)
+        *dbIDP = dbP->db->id;
+    if (openCountP != NULL)
+        *openCountP = dbP->db->openCount;
+    if (modeP != NULL)
+        *modeP = dbP->mode;
+    if (cardNoP != NULL)
+        *cardNoP = 0;
+    if (resDBP != NULL)
+        *resDBP = (dbP->db->attrs & dmHdrAttrResDB) ? true : false;
+    return errNone;
+}
+
+UInt16 DmNumRecords(DmOpenRef dbP)
+{
+    COUNT(hostApiDmNumRecords);
+    return (dbP != NULL) ? (UInt16)dbP->db->numRecs : 0;
+}
+
+static void DB_Touch(HostDB *db)
+{
+    db->modNum++;
+    db->modDate = sSeconds;
+}
+
+MemHandle DmNewRecord(DmOpenRef dbP, UInt16 *atP, UInt32 size)
+{
+    HostDB *db;
+    HostChunk *c;
+    UInt32 at;
+
+    COUNT(hostApiDmNewRecord);
+    if (dbP == NULL || atP == NULL || !(dbP->mode & dmModeWrite))
+    {
+        SetErr(dmErrReadOnly);
+        return NULL;
+    }
+    db = dbP->db;
+    if (db->numRecs >= dmMaxRecordIndex)
+    {
+        SetErr(dmErrIndexOutOfRange);
+        return NULL;
+    }
+    if (db->numRecs == db->capRecs)
+    {
+        UInt32 ncap;
+        HostRecord *tmp;
+        ncap = (db->capRecs == 0) ? 64 : db->capRecs * 2;
+        tmp = (HostRecord *)realloc(db->recs, ncap * sizeof(HostRecord));
+        if (tmp == NULL)
+        {
+            SetErr(dmErrMemError);
+            return NULL;
+        }
+        db->recs = tmp;
+        db->capRecs = ncap;
+    }
+
+    c = Chunk_New(size, true);
+    if (c == NULL)
+    {
+        SetErr(dmErrMemError);
+        return NULL;
+    }
+
+    /* Out-of-range insert positions append, as on the device. */
+    at = *atP;
+    if (at > db->numRecs)
+        at = db->numRecs;
+    memmove(&db->recs[at + 1], &db->recs[at], (db->numRecs - at) * sizeof(HostRecord));
+    db->recs[at].h = c;
+    db->recs[at].attr = 0;
+    db->recs[at].busy = true;
+    db->numRecs++;
+    *atP = (UInt16)at;
+    DB_Touch(db);
+    return c;
+}
+
+MemHandle DmQueryRecord(DmOpenRef dbP, UInt16 index)
+{
+    COUNT(hostApiDmQueryRecord);
+    if (dbP == NULL || index >= dbP->db->numRecs)
+    {
+        SetErr(dmErrIndexOutOfRange);
+        return NULL;
+    }
+    return dbP->db->recs[index].h;
+}
+
+MemHandle DmGetRecord(DmOpenRef dbP, UInt16 index)
+{
+    HostRecord *r;
+
+    COUNT(hostApiDmGetRecord);
+    if (dbP == NULL || index >= dbP->db->numRecs)
+    {
+        SetErr(dmErrIndexOutOfRange);
+        return NULL;
+    }
+    r = &dbP->db->recs[index];
+    if (r->busy)
+        Host_Fatal("DmGetRecord on a busy record");
+    r->busy = true;
+    return r->h;
+}
+
+Err DmReleaseRecord(DmOpenRef dbP, UInt16 index, Boolean dirty)
+{
+    HostRecord *r;
+
+    COUNT(hostApiDmReleaseRecord);
+    if (dbP == NULL || index >= dbP->db->numRecs)
+        return SetErr(dmErrIndexOutOfRange);
+    r = &dbP->db->recs[index];
+    r->busy = false;
+    if (dirty)
+        DB_Touch(dbP->db);
+    return errNone;
+}
+
+Err DmRemoveRecord(DmOpenRef dbP, UInt16 index)
+{
+    HostDB *db;
+
+    COUNT(hostApiDmRemoveRecord);
+    if (dbP == NULL || index >= dbP->db->numRecs)
+        return SetErr(dmErrIndexOutOfRange);
+    db = dbP->db;
+    Chunk_Free(db->recs[index].h);
+    memmove(&db->recs[index], &db->recs[index + 1],
+            (db->numRecs - index - 1) * sizeof(HostRecord));
+    db->numRecs--;
+    DB_Touch(db);
+    return errNone;
+}
+
+/* Always moves the record, as the device may when it grows */
+MemHandle DmResizeRecord(DmOpenRef dbP, UInt16 index, UInt32 newSize)
+{
+    HostRecord *r;
+    HostChunk *c;
+
+    COUNT(hostApiDmResizeRecord);
+    if (dbP == NULL || index >= dbP->db->numRecs)
+    {
+        SetErr(dmErrIndexOutOfRange);
+        return NULL;
+    }
+    if (!(dbP->mode & dmModeWrite))
+    {
+        SetErr(dmErrReadOnly);
+        return NULL;
+    }
+    r = &dbP->db->recs[index];
+    if (r->h->lockCount != 0)
+        Host_Fatal("DmResizeRecord on a locked record");
+
+    c = Chunk_New(newSize, true);
+    if (c == NULL)
+    {
+        SetErr(dmErrMemError);
+        return NULL;
+    }
+    memcpy(Chunk_Data(c), Chunk_Data(r->h), (r->h->size < newSize) ? r->h->size : newSize);
+    Chunk_Free(r->h);
+    r->h = c;
+    DB_Touch(dbP->db);
+    return c;
+}
+
+Err DmWrite(void *recordP, UInt32 offset, const void *srcP, UInt32 bytes)
+{
+    HostChunk *c;
+
+    COUNT(hostApiDmWrite);
+    c = Chunk_FromData(recordP);
+    if (!c->isRecord)
+        Host_Fatal("DmWrite to a dynamic-heap chunk");
+    if (offset + bytes > c->size)
+        Host_Fatal("DmWrite past end of record");
+    memmove(Chunk_Data(c) + offset, srcP, bytes);
+    sStats.dmWriteBytes += bytes;
+    return errNone;
+}
+
+/* Counted as a DmWrite: the same unprotect/protect of the storage heap */
+Err DmSet(void *recordP, UInt32 offset, UInt32 bytes, UInt8 value)
+{
+    HostChunk *c;
+
+    COUNT(hostApiDmWrite);
+    c = Chunk_FromData(recordP);
+    if (!c->isRecord)
+        Host_Fatal("DmSet on a dynamic-heap chunk");
+    if (offset + bytes > c->size)
+        Host_Fatal("DmSet past end of record");
+    memset(Chunk_Data(c) + offset, value, bytes);
+    sStats.dmWriteBytes += bytes;
+    return errNone;
+}
+
+MemHandle DmNewHandle(DmOpenRef dbP, UInt32 size)
+{
+    COUNT(hostApiDmNewHandle);
+    if (dbP == NULL)
+    {
+        SetErr(dmErrInvalidParam);
+        return NULL;
+    }
+    return Chunk_New(size, true);
+}
+
+/* --- String Manager --- */
+
+Int16 StrLen(const Char *src)
+{
+    return (Int16)strlen(src);
+}
+
+Char *StrCopy(Char *dst, const Char *src)
+{
+    return strcpy(dst, src);
+}
+
+Int16 StrCompare(const Char *s1, const Char *s2)
+{
+    int r;
+
+    r = strcmp(s1, s2);
+    return (Int16)((r > 0) - (r < 0));
+}
+
+Int16 StrPrintF(Char *s, const Char *formatStr, ...)
+{
+    va_list args;
+    int n;
+
+    va_start(args, formatStr);
+    n = vsprintf(s, formatStr, args);
+    va_end(args);
+    return (Int16)n;
+}
+
+/* --- Time Manager --- */
+
+UInt32 TimGetSeconds(void)
+{
+    COUNT(hostApiTimGetSeconds);
+    return sSeconds;
+}
+
+UInt32 TimGetTicks(void)
+{
+    struct timespec ts;
+
+    COUNT(hostApiTimGetTicks);
+    /* Ticks are 10 ms: the coarse clock is fine and far cheaper, which
+       matters now that LogDB times every call */
+#ifdef CLOCK_MONOTONIC_COARSE
+    clock_gettime(CLOCK_MONOTONIC_COARSE, &ts);
+#else
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+#endif
+    return (UInt32)((uint64_t)ts.tv_sec * 100u + (UInt32)(ts.tv_nsec / 10000000L));
+}
+
+UInt16 SysTicksPerSecond(void)
+{
+    return 100;
+}
+
+/* --- Event Manager --- */
+
+void EvtWakeup(void)
+{
+    /* No event loop to wake: counted only */
+    COUNT(hostApiEvtWakeup);
+}
+
+/* --- Feature Manager --- */
+
+Err FtrGet(UInt32 creator, UInt16 featureNum, UInt32 *valueP)
+{
+    /* The VFS Manager is "installed" while a volume root is set */
+    if (creator == sysFileCVFSMgr && featureNum == vfsFtrIDVersion && sVolRoot[0] != 0)
+    {
+        *valueP = 0x00020000UL;
+        return errNone;
+    }
+    return ftrErrNoSuchFeature;
+}
+
+/* --- VFS Manager --- */
+
+static Err Vfs_HostPath(UInt16 volRefNum, const Char *pathNameP, char *out, size_t outSize)
+{
+    if (volRefNum != HOST_VOL_REF || sVolRoot[0] == 0)
+        return vfsErrVolumeBadRef;
+    if (pathNameP == NULL || pathNameP[0] != '/')
+        return vfsErrBadName;
+    if ((size_t)snprintf(out, outSize, "%s%s", sVolRoot, pathNameP) >= outSize)
+        return vfsErrBadName;
+    return errNone;
+}
+
+static HostFile *Vfs_File(FileRef fileRef)
+{
+    if (fileRef == 0 || fileRef > HOST_MAX_FILES || sFiles[fileRef - 1].fp == NULL)
+        return NULL;
+    return &sFiles[fileRef - 1];
+}
+
+Err VFSVolumeEnumerate(UInt16 *volRefNumP, UInt32 *volIteratorP)
+{
+    if (sVolRoot[0] == 0 || *volIteratorP != (UInt32)vfsIteratorStart)
+    {
+        *volIteratorP = (UInt32)vfsIteratorStop;
+        return expErrCardNotPresent;
+    }
+    *volRefNumP = HOST_VOL_REF;
+    *volIteratorP = (UInt32)vfsIteratorStop;
+    return errNone;
+}
+
+Err VFSFileOpen(UInt16 volRefNum, const Char *pathNameP, UInt16 openMode, FileRef *fileRefP)
+{
+    char path[512];
+    struct stat sb;
+    Boolean exists;
+    UInt16 i;
+    UInt16 slot;
+    Err err;
+
+    COUNT(hostApiVFSFileOpen);
+    *fileRefP = 0;
+    err = Vfs_HostPath(volRefNum, pathNameP, path, sizeof(path));
+    if (err != errNone)
+        return err;
+
+    /* Exclusive opens shut out everyone else, as on a real card */
+    slot = HOST_MAX_FILES;
+    for (i = 0; i < HOST_MAX_FILES; i++)
+    {
+        if (sFiles[i].fp == NULL)
+        {
+            if (slot == HOST_MAX_FILES)
+                slot = i;
+            continue;
+        }
+        if (strcmp(sFiles[i].path, path) == 0 &&
+            ((sFiles[i].mode | openMode) & vfsModeExclusive) != 0)
+            return vfsErrFilePermissionDenied;
+    }
+    if (slot == HOST_MAX_FILES)
+        return vfsErrFileGeneric;
+
+    exists = (stat(path, &sb) == 0);
+    if (exists && S_ISDIR(sb.st_mode))
+        return vfsErrFilePermissionDenied;
+    if (!exists && (openMode & vfsModeCreate) == 0)
+        return vfsErrFileNotFound;
+
+    if ((openMode & vfsModeWrite & ~vfsModeExclusive) == 0)
+        sFiles[slot].fp = fopen(path, "rb");
+    else if (!exists || (openMode & vfsModeTruncate) != 0)
+        sFiles[slot].fp = fopen(path, "w+b");
+    else
+        sFiles[slot].fp = fopen(path, "r+b");
+    if (sFiles[slot].fp == NULL)
+        return vfsErrFileGeneric;
+
+    snprintf(sFiles[slot].path, sizeof(sFiles[slot].path), "%s", path);
+    sFiles[slot].mode = openMode;
+    *fileRefP = (FileRef)slot + 1;
+    return errNone;
+}
+
+Err VFSFileClose(FileRef fileRef)
+{
+    HostFile *f;
+
+    COUNT(hostApiVFSFileClose);
+    f = Vfs_File(fileRef);
+    if (f == NULL)
+        return vfsErrFileBadRef;
+    fclose(f->fp);
+    f->fp = NULL;
+    return errNone;
+}
+
+Err VFSFileRead(FileRef fileRef, UInt32 numBytes, void *bufP, UInt32 *numBytesReadP)
+{
+    HostFile *f;
+    size_t n;
+
+    COUNT(hostApiVFSFileRead);
+    if (numBytesReadP != NULL)
+        *numBytesReadP = 0;
+    f = Vfs_File(fileRef);
+    if (f == NULL)
+        return vfsErrFileBadRef;
+    if ((f->mode & vfsModeRead) == 0)
+        return vfsErrFilePermissionDenied;
+
+    n = fread(bufP, 1, numBytes, f->fp);
+    if (numBytesReadP != NULL)
+        *numBytesReadP = (UInt32)n;
+    return (n < numBytes) ? vfsErrFileEOF : errNone;
+}
+
+Err VFSFileWrite(FileRef fileRef, UInt32 numBytes, const void *dataP, UInt32 *numBytesWrittenP)
+{
+    HostFile *f;
+    size_t n;
+
+    COUNT(hostApiVFSFileWrite);
+    if (numBytesWrittenP != NULL)
+        *numBytesWrittenP = 0;
+    f = Vfs_File(fileRef);
+    if (f == NULL)
+        return vfsErrFileBadRef;
+    if ((f->mode & vfsModeWrite & ~vfsModeExclusive) == 0)
+        return vfsErrFilePermissionDenied;
+
+    n = fwrite(dataP, 1, numBytes, f->fp);
+    fflush(f->fp);
+    sStats.vfsWriteBytes += (UInt32)n;
+    if (numBytesWrittenP != NULL)
+        *numBytesWrittenP = (UInt32)n;
+    return (n < numBytes) ? vfsErrFileGeneric : errNone;
+}
+
+Err VFSFileSeek(FileRef fileRef, FileOrigin origin, Int32 offset)
+{
+    HostFile *f;
+    int whence;
+
+    COUNT(hostApiVFSFileSeek);
+    f = Vfs_File(fileRef);
+    if (f == NULL)
+        return vfsErrFileBadRef;
+    whence = (origin == vfsOriginEnd) ? SEEK_END : (origin == vfsOriginCurrent) ? SEEK_CUR : SEEK_SET;
+    return (fseek(f->fp, offset, whence) == 0) ? errNone : vfsErrFileGeneric;
+}
+
+Err VFSFileTell(FileRef fileRef, UInt32 *filePosP)
+{
+    HostFile *f;
+
+    f = Vfs_File(fileRef);
+    if (f == NULL)
+        return vfsErrFileBadRef;
+    *filePosP = (UInt32)ftell(f->fp);
+    return errNone;
+}
+
+Err VFSFileSize(FileRef fileRef, UInt32 *fileSizeP)
+{
+    HostFile *f;
+    long pos;
+
+    f = Vfs_File(fileRef);
+    if (f == NULL)
+        return vfsErrFileBadRef;
+    pos = ftell(f->fp);
+    fseek(f->fp, 0, SEEK_END);
+    *fileSizeP = (UInt32)ftell(f->fp);
+    fseek(f->fp, pos, SEEK_SET);
+    return errNone;
+}
+
+Err VFSFileDelete(UInt16 volRefNum, const Char *pathNameP)
+{
+    char path[512];
+    UInt16 i;
+    Err err;
+
+    err = Vfs_HostPath(volRefNum, pathNameP, path, sizeof(path));
+    if (err != errNone)
+        return err;
+    for (i = 0; i < HOST_MAX_FILES; i++)
+    {
+        if (sFiles[i].fp != NULL && strcmp(sFiles[i].path, path) == 0)
+            return vfsErrFileStillOpen;
+    }
+    return (remove(path) == 0) ? errNone : vfsErrFileNotFound;
+}
+
+Err VFSDirCreate(UInt16 volRefNum, const Char *dirNameP)
+{
+    char path[512];
+    Err err;
+
+    err = Vfs_HostPath(volRefNum, dirNameP, path, sizeof(path));
+    if (err != errNone)
+        return err;
+    if (mkdir(path, 0777) == 0)
+        return errNone;
+    return vfsErrFileAlreadyExists;
+}
+
+/* --- Shim control --- */
+
+void HostShim_Reset(void)
+{
+    UInt32 heap;
+    UInt16 i;
+
+    for (i = 0; i < HOST_MAX_DBS; i++)
+    {
+        if (sDBs[i] != NULL)
+        {
+            DB_Free(sDBs[i]);
+            sDBs[i] = NULL;
+        }
+    }
+    for (i = 0; i < HOST_MAX_FILES; i++)
+    {
+        if (sFiles[i].fp != NULL)
+        {
+            fclose(sFiles[i].fp);
+            sFiles[i].fp = NULL;
+        }
+    }
+    memset(sLocalIDs, 0, sizeof(sLocalIDs));
+    sNextID = 1;
+    sLastErr = errNone;
+    sSeconds = HOST_DEFAULT_SECONDS;
+    sStorageBytes = HOST_STORAGE_HEAP_BYTES;
+
+    /* Dynamic chunks outlive a reset */
+    heap = sStats.heapInUse;
+    memset(&sStats, 0, sizeof(sStats));
+    sStats.heapInUse = heap;
+}
+
+void HostShim_ResetStats(void)
+{
+    UInt32 inUse;
+    UInt32 heap;
+
+    inUse = sStats.storageInUse;
+    heap = sStats.heapInUse;
+    memset(&sStats, 0, sizeof(sStats));
+    sStats.storageInUse = inUse;
+    sStats.storagePeak = inUse;
+    sStats.heapInUse = heap;
+}
+
+const HostShim_Stats *HostShim_GetStats(void)
+{
+    return &sStats;
+}
+
+UInt32 HostShim_DmCalls(const HostShim_Stats *st)
+{
+    UInt32 n;
+    int i;
+
+    n = 0;
+    for (i = hostApiFirstDm; i <= hostApiLastDm; i++)
+        n += st->calls[i];
+    return n;
+}
+
+const char *HostShim_ApiName(HostApi api)
+{
+    return (api < hostApiCount) ? sApiNames[api] : "?";
+}
+
+void HostShim_SetSeconds(UInt32 secs)
+{
+    sSeconds = secs;
+}
+
+void HostShim_AdvanceSeconds(UInt32 delta)
+{
+    sSeconds += delta;
+}
+
+void HostShim_SetStorageBytes(UInt32 bytes)
+{
+    sStorageBytes = (bytes != 0) ? bytes : HOST_STORAGE_HEAP_BYTES;
+}
+
+void HostShim_SetVolumeRoot(const char *dir)
+{
+    snprintf(sVolRoot, sizeof(sVolRoot), "%s", (dir != NULL) ? dir : "");
+}
+
+static UInt32 Pdb_Get32(const UInt8 *p)
+{
+    return ((UInt32)p[0] << 24) | ((UInt32)p[1] << 16) | ((UInt32)p[2] << 8) | p[3];
+}
+
+Err HostShim_LoadPDB(const char *path, LocalID *dbIDP)
+{
+    UInt8 *file;
+    UInt8 *p;
+    Char name[dmDBNameLength];
+    DmOpenRef dbR;
+    MemHandle h;
+    LocalID dbID;
+    UInt32 crDate;
+    UInt32 modDate;
+    UInt32 bckDate;
+    UInt32 modNum;
+    UInt32 start;
+    UInt32 end;
+    UInt16 attrs;
+    UInt16 version;
+    UInt16 numRecs;
+    UInt16 index;
+    UInt16 i;
+    long size;
+    FILE *fp;
+    Err err;
+
+    fp = fopen(path, "rb");
+    if (fp == NULL)
+        return dmErrCantFind;
+    fseek(fp, 0, SEEK_END);
+    size = ftell(fp);
+    rewind(fp);
+    file = (size >= HOST_PDB_HEADER) ? (UInt8 *)malloc((size_t)size) : NULL;
+    if (file == NULL || fread(file, 1, (size_t)size, fp) != (size_t)size)
+    {
+        fclose(fp);
+        free(file);
+        return dmErrCorruptDatabase;
+    }
+    fclose(fp);
+
+    numRecs = (UInt16)((file[76] << 8) | file[77]);
+    if ((UInt32)size < HOST_PDB_HEADER + 8UL * numRecs)
+    {
+        free(file);
+        return dmErrCorruptDatabase;
+    }
+    memcpy(name, file, dmDBNameLength);
+    name[dmDBNameLength - 1] = 0;
+    err = DmCreateDatabase(0, name, Pdb_Get32(file + 64), Pdb_Get32(file + 60), false);
+    dbID = (err == errNone) ? DmFindDatabase(0, name) : 0;
+    dbR = (dbID != 0) ? DmOpenDatabase(0, dbID, dmModeReadWrite) : NULL;
+    if (dbR == NULL)
+    {
+        free(file);
+        return (err != errNone) ? err : dmErrCantOpen;
+    }
+
+    for (i = 0; i < numRecs && err == errNone; i++)
+    {
+        p = file + HOST_PDB_HEADER + 8UL * i;
+        start = Pdb_Get32(p);
+        end = (i + 1 < numRecs) ? Pdb_Get32(p + 8) : (UInt32)size;
+        if (start > end || end > (UInt32)size)
+        {
+            err = dmErrCorruptDatabase;
+            break;
+        }
+        index = dmMaxRecordIndex;
+        h = DmNewRecord(dbR, &index, end - start);
+        if (h == NULL)
+        {
+            err = dmErrMemError;
+            break;
+        }
+        if (end > start)
+            DmWrite(MemHandleLock(h), 0, file + start, end - start);
+        MemHandleUnlock(h);
+        DmReleaseRecord(dbR, index, false);
+    }
+    DmCloseDatabase(dbR);
+
+    /* The file's header, not the load, says when the DB was last changed */
+    attrs = (UInt16)((file[32] << 8) | file[33]);
+    version = (UInt16)((file[34] << 8) | file[35]);
+    crDate = Pdb_Get32(file + 36);
+    modDate = Pdb_Get32(file + 40);
+    bckDate = Pdb_Get32(file + 44);
+    modNum = Pdb_Get32(file + 48);
+    DmSetDatabaseInfo(0, dbID, NULL, &attrs, &version, &crDate, &modDate, &bckDate, &modNum,
+                      NULL, NULL, NULL, NULL);
+    free(file);
+
+    if (err != errNone)
+    {
+        DmDeleteDatabase(0, dbID);
+        return err;
+    }
+    if (dbIDP != NULL)
+        *dbIDP = dbID;
+    return errNone;
+}
+
+static void Pdb_Put16(UInt8 *p, UInt32 v)
+{
+    p[0] = (UInt8)(v >> 8);
+    p[1] = (UInt8)v;
+}
+
+static void Pdb_Put32(UInt8 *p, UInt32 v)
+{
+    Pdb_Put16(p, v >> 16);
+    Pdb_Put16(p + 2, v);
+}
+
+/* One DB as a .pdb file, records only (what HostShim_LoadPDB reads). */
+static int Pdb_Save(const HostDB *db, const char *path, UInt32 *bytesP)
+{
+    UInt8 hdr[HOST_PDB_HEADER];
+    UInt8 entry[8];
+    UInt8 pad[2];
+    UInt32 offset;
+    UInt32 i;
+    FILE *fp;
+    int ok;
+
+    fp = fopen(path, "wb");
+    if (fp == NULL)
+        return 0;
+    memset(hdr, 0, sizeof(hdr));
+    memcpy(hdr, db->name, dmDBNameLength);
+    Pdb_Put16(hdr + 32, db->attrs);
+    Pdb_Put16(hdr + 34, db->version);
+    Pdb_Put32(hdr + 36, db->crDate);
+    Pdb_Put32(hdr + 40, db->modDate);
+    Pdb_Put32(hdr + 44, sSeconds); /* the backup being made */
+    Pdb_Put32(hdr + 48, db->modNum);
+    Pdb_Put32(hdr + 60, db->type);
+    Pdb_Put32(hdr + 64, db->creator);
+    Pdb_Put16(hdr + 76, db->numRecs);
+    ok = fwrite(hdr, sizeof(hdr), 1, fp) == 1;
+
+    offset = HOST_PDB_HEADER + 8UL * db->numRecs + sizeof(pad);
+    for (i = 0; ok && i < db->numRecs; i++)
+    {
+        Pdb_Put32(entry, offset);
+        entry[4] = db->recs[i].attr;
+        Pdb_Put16(entry + 5, (i + 1) >> 8);
+        entry[7] = (UInt8)(i + 1);
+        ok = fwrite(entry, sizeof(entry), 1, fp) == 1;
+        offset += db->recs[i].h->size;
+    }
+    memset(pad, 0, sizeof(pad));
+    ok = ok && fwrite(pad, sizeof(pad), 1, fp) == 1;
+    for (i = 0; ok && i < db->numRecs; i++)
+    {
+        if (db->recs[i].h->size > 0)
+            ok = fwrite(Chunk_Data(db->recs[i].h), db->recs[i].h->size, 1, fp) == 1;
+    }
+    if (fclose(fp) != 0)
+        ok = 0;
+    *bytesP += offset;
+    return ok;
+}
+
+UInt16 HostShim_Backup(const char *dir, UInt32 *bytesP)
+{
+    char path[512];
+    HostDB *db;
+    UInt16 saved;
+    UInt32 bytes;
+    UInt32 i;
+
+    saved = 0;
+    bytes = 0;
+    for (i = 0; i < HOST_MAX_DBS; i++)
+    {
+        db = sDBs[i];
+        if (db == NULL || (db->attrs & dmHdrAttrBackup) == 0)
+            continue;
+
+        /* Backups are kept by name, so a renamed DB is new to the desktop */
+        if (db->bckDate != 0 && db->modNum == db->bckModNum &&
+            strcmp(db->name, db->bckName) == 0)
+            continue;
+
+        snprintf(path, sizeof(path), "%s/%s.pdb", dir, db->name);
+        if (!Pdb_Save(db, path, &bytes))
+            Host_Fatal("cannot write a backup");
+        db->bckDate = sSeconds;
+        db->bckModNum = db->modNum;
+        memcpy(db->bckName, db->name, dmDBNameLength);
+        saved++;
+    }
+    if (bytesP != NULL)
+        *bytesP = bytes;
+    return saved;
+}
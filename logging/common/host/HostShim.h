@@ -0,0 +1,116 @@
+#ifndef HOST_SHIM_H
+#define HOST_SHIM_H
+
+#include <PalmOS.h>
+#include <VFSMgr.h>
+
+/*
+    Control and accounting interface of the host Palm OS shim.
+
+    Every shimmed call bumps a per-API counter so benchmarks can report
+    Data Manager calls per operation alongside wall-clock throughput.
+*/
+
+typedef enum
+{
+    hostApiDmCreateDatabase,
+    hostApiDmFindDatabase,
+    hostApiDmDeleteDatabase,
+    hostApiDmGetNextDatabaseByTypeCreator,
+    hostApiDmDatabaseSize,
+    hostApiDmDatabaseInfo,
+    hostApiDmSetDatabaseInfo,
+    hostApiDmOpenDatabase,
+    hostApiDmOpenDatabaseByTypeCreator,
+    hostApiDmCloseDatabase,
+    hostApiDmOpenDatabaseInfo,
+    hostApiDmNumRecords,
+    hostApiDmNewRecord,
+    hostApiDmQueryRecord,
+    hostApiDmGetRecord,
+    hostApiDmReleaseRecord,
+    hostApiDmRemoveRecord,
+    hostApiDmResizeRecord,
+    hostApiDmWrite,
+    hostApiDmNewHandle,
+
+    hostApiMemPtrNew,
+    hostApiMemPtrFree,
+    hostApiMemHandleNew,
+    hostApiMemHandleFree,
+    hostApiMemHandleLock,
+    hostApiMemHandleUnlock,
+    hostApiMemHeapFreeBytes,
+
+    hostApiTimGetSeconds,
+    hostApiTimGetTicks,
+
+    hostApiEvtWakeup,
+
+    hostApiVFSFileOpen,
+    hostApiVFSFileClose,
+    hostApiVFSFileRead,
+    hostApiVFSFileWrite,
+    hostApiVFSFileSeek,
+
+    hostApiCount
+} HostApi;
+
+/* First and last Data Manager entries, for "Dm calls" totals. */
+#define hostApiFirstDm hostApiDmCreateDatabase
+#define hostApiLastDm hostApiDmNewHandle
+
+typedef struct HostShim_StatsTag
+{
+    UInt32 calls[hostApiCount];
+    UInt32 dmWriteBytes;   /* payload bytes passed to DmWrite */
+    UInt32 recordBytes;    /* bytes allocated by DmNewRecord */
+    UInt32 storageInUse;   /* live record bytes across all DBs */
+    UInt32 storagePeak;
+    UInt32 heapInUse;      /* live non-record chunk bytes */
+    UInt32 vfsWriteBytes;  /* bytes passed to VFSFileWrite */
+} HostShim_Stats;
+
+/* Drop every database and chunk, reset counters and the clock. */
+void HostShim_Reset(void);
+
+/* Zero the counters only (databases are kept). */
+void HostShim_ResetStats(void);
+
+const HostShim_Stats *HostShim_GetStats(void);
+
+/* Sum of all Data Manager calls in the current counters. */
+UInt32 HostShim_DmCalls(const HostShim_Stats *st);
+
+const char *HostShim_ApiName(HostApi api);
+
+/* Heap sizes MemHeapFreeBytes reports against (heap 0 dynamic, 1 storage
+   by default); the largest free chunk is reported as all of the free
+   space. */
+#define HOST_DYNAMIC_HEAP_BYTES (256UL * 1024UL)
+#define HOST_STORAGE_HEAP_BYTES (8UL * 1024UL * 1024UL)
+
+/* Size the storage heap (0: HOST_STORAGE_HEAP_BYTES). Records and DB
+   handles that would not fit are refused, as on a full device. */
+void HostShim_SetStorageBytes(UInt32 bytes);
+
+/* Simulated RTC used by TimGetSeconds (Palm epoch, 1904-01-01). */
+void HostShim_SetSeconds(UInt32 secs);
+void HostShim_AdvanceSeconds(UInt32 delta);
+
+/* Host directory mounted as VFS volume 1 (NULL: no card). Card paths are
+   taken relative to it; the directory must exist. */
+void HostShim_SetVolumeRoot(const char *dir);
+
+/* Install a .pdb file (as written by HotSync or tools/LogGen) through the
+   Data Manager calls, keeping its header dates and attributes. AppInfo
+   and SortInfo blocks are not loaded. */
+Err HostShim_LoadPDB(const char *path, LocalID *dbIDP);
+
+/* A HotSync backup into dir: every DB with the backup bit that changed
+   (or was renamed) since its last one is written as <name>.pdb, records
+   only, and stamped with the current time as its bckDate. Returns the
+   number of DBs written; bytesP (optional) receives their total size. */
+UInt16 HostShim_Backup(const char *dir, UInt32 *bytesP);
+
+#endif /* HOST_SHIM_H */
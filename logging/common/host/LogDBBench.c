@@ -0,0 +1,2115 @@
+/*
+    LogDB benchmark harness (host build).
+
+    Runs LogDB_Log throughput, a full iteration pass, an iteration over the
+    newest 10% of the time range, LogDB_ClearAll, structured records
+    (append with fields, match on a field), a sampled call site, the v1
+    to v2 record migration and segment compaction (with a read back of
+    the packed blocks, in order and by position), rolls past segment 9999
+    and a roll that cannot rename, the same packing and a
+    segment trim run from LogDB_Idle in small budgets, the memory sampler and
+    a word search over a drifting vocabulary (with how many record runs
+    its filters skip, and how many they let through for nothing),
+    one-line LogDB_Ctx sessions as a sub-launch would log them, logging
+    into a nearly full storage heap with and without the pressure tiers,
+    the per-app DBs (merged read, one app's read, one app's clear),
+    callback lines through a LogRing, LogDB_GetStats against the
+    shim's own counts and HotSync backups with and without
+    LogDB_ArchiveTrim at each requested record count, and reports
+    ops/sec next to the Data Manager calls and bytes each operation cost
+    according to the shim. The card phases
+    repeat logging and iteration with the VFS sink against a temporary
+    directory mounted as the card.
+
+    With -d, the read phases run instead over each DebugLog.pdb given
+    (tools/LogGen writes them; tools/golden lists the reference set).
+    With -b, only the backup phase runs, and each sync's backups are
+    kept under dir/sync-N for tools/LogMerge.
+
+    Usage: LogDBBench [records...]     (default: 1000 10000 60000)
+           LogDBBench -d file.pdb...
+           LogDBBench -b dir records
+*/
+
+#include <ctype.h>
+#include <dirent.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "HostShim.h"
+#include "LogDB.h"
+#include "LogRing.h"
+
+#define BENCH_APP_NAME "BenchApp"
+#define BENCH_OTHER_APP "OtherApp"
+#define BENCH_MSG_VARIANTS 8
+
+/* Big-endian, as LogDB lays records out */
+#define Bench_Put32(p, v)                                             \
+    ((p)[0] = (UInt8)((v) >> 24), (p)[1] = (UInt8)((v) >> 16),             \
+     (p)[2] = (UInt8)((v) >> 8), (p)[3] = (UInt8)(v))
+
+static const char *sMessages[BENCH_MSG_VARIANTS] = {
+    "Button Clicked",
+    "MainSubmitButton Clicked",
+    "frmOpenEvent",
+    "Sync started",
+    "Sync finished: 12 records",
+    "Low battery warning",
+    "penDownEvent at 80,92",
+    "Preferences saved",
+};
+
+static double Bench_Now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static void Bench_Report(UInt32 records, const char *phase, UInt32 ops, double secs)
+{
+    const HostShim_Stats *st;
+    double perOp;
+
+    st = HostShim_GetStats();
+    perOp = (ops > 0) ? 1.0 / (double)ops : 0.0;
+
+    printf("%8lu  %-8s %12.0f %8.2f %9.2f %9.3f %9.2f %10.2f\n",
+           (unsigned long)records, phase,
+           (secs > 0.0) ? (double)ops / secs : 0.0,
+           (double)HostShim_DmCalls(st) * perOp,
+           (double)st->calls[hostApiDmWrite] * perOp,
+           (double)st->calls[hostApiVFSFileWrite] * perOp,
+           (double)(st->dmWriteBytes + st->vfsWriteBytes) * perOp,
+           secs * 1000.0);
+}
+
+/* Structured records: append with two fields, then match form=1000. */
+static int Bench_Fields(UInt32 records)
+{
+    LogDB_Field fields[2];
+    LogDB_Field f;
+    LogDB_Entry entry;
+    LogDB_Iter it;
+    MemHandle h;
+    UInt32 i;
+    UInt32 matched;
+    double t0;
+    Err err;
+
+    HostShim_ResetStats();
+    t0 = Bench_Now();
+    for (i = 0; i < records; i++)
+    {
+        LogDB_FieldInt32(&fields[0], "form", 1000 + (i % 4));
+        LogDB_FieldStr(&fields[1], "ctl", "OK");
+        err = LogDB_LogFields("ctlSelectEvent", fields, 2);
+        if (err != errNone)
+        {
+            fprintf(stderr, "LogDB_LogFields failed at %lu: 0x%04x\n", (unsigned long)i, err);
+            return 1;
+        }
+    }
+    Bench_Report(records, "log-fld", records, Bench_Now() - t0);
+
+    HostShim_ResetStats();
+    matched = 0;
+    t0 = Bench_Now();
+    if (LogDB_IterBegin(&it) == errNone)
+    {
+        while ((h = LogDB_IterNextEntry(&it, &entry)) != NULL)
+        {
+            if (LogDB_FieldFind(&entry, "form", &f) && f.type == LOGDB_FIELD_INT32 &&
+                f.v.i32 == 1000)
+                matched++;
+            LogDB_IterUnlock(h);
+        }
+        LogDB_IterEnd(&it);
+    }
+    Bench_Report(records, "fld-find", records, Bench_Now() - t0);
+    if (matched != (records + 3) / 4)
+    {
+        fprintf(stderr, "form=1000 matched %lu of %lu records\n",
+                (unsigned long)matched, (unsigned long)records);
+        return 1;
+    }
+
+    LogDB_ClearAll();
+    return 0;
+}
+
+/* A hot call site sampled 1-in-16 and with p = 1/16: calls/sec including
+   the skipped ones, and the count scaled back up from the record rate. */
+static int Bench_Sampled(UInt32 records, LogDB_Site *site, const char *phase)
+{
+    LogDB_Field fields[1];
+    LogDB_Entry entry;
+    LogDB_Iter it;
+    MemHandle h;
+    UInt32 i;
+    UInt32 kept;
+    UInt32 estimate;
+    double t0;
+
+    HostShim_ResetStats();
+    t0 = Bench_Now();
+    for (i = 0; i < records; i++)
+    {
+        if (LogDB_Sample(site))
+        {
+            LogDB_FieldInt32(&fields[0], "x", (Int32)(i % 160));
+            LogDB_LogSampled(site->rate, "penMoveEvent", fields, 1);
+        }
+    }
+    Bench_Report(records, phase, records, Bench_Now() - t0);
+
+    kept = 0;
+    estimate = 0;
+    if (LogDB_IterBegin(&it) == errNone)
+    {
+        while ((h = LogDB_IterNextEntry(&it, &entry)) != NULL)
+        {
+            kept++;
+            estimate += entry.rate;
+            LogDB_IterUnlock(h);
+        }
+        LogDB_IterEnd(&it);
+    }
+    printf("%8s  %-8s kept %lu of %lu calls, scaled estimate %lu\n", "", "",
+           (unsigned long)kept, (unsigned long)records, (unsigned long)estimate);
+    LogDB_ClearAll();
+
+    /* Deterministic sampling must scale back exactly (up to the last run) */
+    if (site->mode == LOGDB_SAMPLE_EVERY && estimate + site->rate <= records)
+        return 1;
+    return (kept == 0 && records >= site->rate) ? 1 : 0;
+}
+
+/* v1 records written straight into the active DB, then LogDB_Migrate
+   (reported per migrated record) and a check that they read back. */
+static int Bench_Migrate(UInt32 records)
+{
+    LogDB_Entry entry;
+    LogDB_Iter it;
+    DmOpenRef dbR;
+    MemHandle h;
+    UInt8 rec[64];
+    UInt16 index;
+    UInt16 migrated;
+    UInt32 size;
+    UInt32 i;
+    UInt32 seen;
+    const char *msg;
+    double t0;
+    Err err;
+
+    LogDB_Close();
+    dbR = DmOpenDatabaseByTypeCreator(LOGDB_TYPE, LOGDB_CREATOR, dmModeReadWrite);
+    if (dbR == NULL)
+        return 1;
+    for (i = 0; i < records; i++)
+    {
+        msg = sMessages[i % BENCH_MSG_VARIANTS];
+        Bench_Put32(rec, TimGetSeconds());
+        memcpy(rec + 4, BENCH_APP_NAME, sizeof(BENCH_APP_NAME));
+        size = 4 + sizeof(BENCH_APP_NAME);
+        memcpy(rec + size, msg, strlen(msg) + 1);
+        size += strlen(msg) + 1;
+
+        index = dmMaxRecordIndex;
+        h = DmNewRecord(dbR, &index, size);
+        if (h == NULL)
+            return 1;
+        DmWrite(MemHandleLock(h), 0, rec, size);
+        MemHandleUnlock(h);
+        DmReleaseRecord(dbR, index, true);
+    }
+    DmCloseDatabase(dbR);
+    LogDB_Init(BENCH_APP_NAME);
+
+    HostShim_ResetStats();
+    t0 = Bench_Now();
+    err = LogDB_Migrate(&migrated);
+    Bench_Report(records, "migrate", records, Bench_Now() - t0);
+    if (err != errNone || migrated != records)
+    {
+        fprintf(stderr, "LogDB_Migrate: 0x%04x, %u of %lu records\n", err, migrated,
+                (unsigned long)records);
+        return 1;
+    }
+
+    seen = 0;
+    if (LogDB_IterBegin(&it) == errNone)
+    {
+        while ((h = LogDB_IterNextEntry(&it, &entry)) != NULL)
+        {
+            msg = sMessages[seen % BENCH_MSG_VARIANTS];
+            if (entry.version == 2 && entry.msgLen == strlen(msg) &&
+                strcmp(entry.msg, msg) == 0 && strcmp(entry.app, BENCH_APP_NAME) == 0)
+                seen++;
+            LogDB_IterUnlock(h);
+        }
+        LogDB_IterEnd(&it);
+    }
+    if (seen != records)
+    {
+        fprintf(stderr, "%lu of %lu migrated records read back\n", (unsigned long)seen,
+                (unsigned long)records);
+        return 1;
+    }
+
+    LogDB_ClearAll();
+    return 0;
+}
+
+/* Entries (of app, or all for NULL) and a checksum over what they hold. */
+static UInt32 Bench_Sum(const char *app, UInt32 *checksumP)
+{
+    LogDB_Entry entry;
+    LogDB_Iter it;
+    MemHandle h;
+    UInt32 seen;
+
+    seen = 0;
+    *checksumP = 0;
+    if (LogDB_IterBegin(&it) != errNone)
+        return 0;
+    LogDB_IterSetApp(&it, app);
+    while ((h = LogDB_IterNextEntry(&it, &entry)) != NULL)
+    {
+        *checksumP += entry.seconds + entry.ticks + entry.msgLen + (UInt32)entry.msg[0] +
+                      (UInt32)entry.app[entry.appLen - 1];
+        seen++;
+        LogDB_IterUnlock(h);
+    }
+    LogDB_IterEnd(&it);
+    return seen;
+}
+
+/* Remember where every entry lives, then read them all back by position,
+   newest first (as the viewer's snapshot does). */
+static int Bench_Seek(UInt32 records)
+{
+    LogDB_Entry entry;
+    LogDB_Iter it;
+    MemHandle h;
+    UInt32 *pos;
+    UInt32 *secs;
+    UInt32 n;
+    UInt32 i;
+    UInt32 bad;
+    double t0;
+
+    pos = (UInt32 *)malloc(records * sizeof(UInt32));
+    secs = (UInt32 *)malloc(records * sizeof(UInt32));
+    if (pos == NULL || secs == NULL || LogDB_IterBegin(&it) != errNone)
+        return 1;
+    n = 0;
+    while (n < records && (h = LogDB_IterNextEntry(&it, &entry)) != NULL)
+    {
+        pos[n] = LogDB_IterTell(&it);
+        secs[n++] = entry.seconds + entry.msgLen;
+        LogDB_IterUnlock(h);
+    }
+
+    HostShim_ResetStats();
+    bad = 0;
+    t0 = Bench_Now();
+    for (i = n; i > 0; i--)
+    {
+        h = LogDB_IterSeekEntry(&it, pos[i - 1], &entry);
+        if (h == NULL || entry.seconds + entry.msgLen != secs[i - 1])
+            bad++;
+        LogDB_IterUnlock(h);
+    }
+    Bench_Report(records, "seek", n, Bench_Now() - t0);
+    LogDB_IterEnd(&it);
+    free(pos);
+    free(secs);
+
+    if (n != records || bad != 0)
+    {
+        fprintf(stderr, "seek: %lu positions, %lu read back wrong\n", (unsigned long)n,
+                (unsigned long)bad);
+        return 1;
+    }
+    return 0;
+}
+
+/* A roll per record, past segment number 9999: the segments kept must
+   still read back oldest first. Then a roll that cannot rename (another
+   DB has the name): it may leave nothing behind in the storage heap, and
+   is tried again only every so many appends. Then rolls while a reader
+   holds the oldest segment open, so more than LOGDB_MAX_SEGMENTS pile
+   up: each must still take the next number, and once the reader is done
+   the next roll is back to the limit. Last, a roll of a big active DB
+   may not read its records. */
+#define BENCH_ROLLS 10040
+#define BENCH_ROLL_BLOCKED 600
+#define BENCH_ROLL_HELD 4
+#define BENCH_ROLL_BIG 4000
+
+/* Entries read back, whether oldest first, and whether the newest is
+   from now. */
+static UInt32 Bench_RollRead(int *orderedP, int *lastP)
+{
+    LogDB_Entry entry;
+    LogDB_Iter it;
+    MemHandle h;
+    UInt32 lastSecs;
+    UInt32 seen;
+
+    seen = 0;
+    *orderedP = 1;
+    lastSecs = 0;
+    if (LogDB_IterBegin(&it) == errNone)
+    {
+        while ((h = LogDB_IterNextEntry(&it, &entry)) != NULL)
+        {
+            *orderedP = *orderedP && entry.seconds > lastSecs;
+            lastSecs = entry.seconds;
+            seen++;
+            LogDB_IterUnlock(h);
+        }
+        LogDB_IterEnd(&it);
+    }
+    *lastP = (lastSecs == TimGetSeconds());
+    return seen;
+}
+
+static int Bench_Roll(void)
+{
+    LogDB_RollPolicy roll;
+    DmOpenRef heldR;
+    UInt32 storage;
+    UInt32 seen;
+    UInt32 tries;
+    UInt32 i;
+    int ordered;
+    int last;
+
+    MemSet(&roll, sizeof(roll), 0);
+    roll.maxRecords = 1;
+    LogDB_SetRollPolicy(&roll);
+    for (i = 0; i < BENCH_ROLLS; i++)
+    {
+        HostShim_AdvanceSeconds(1);
+        if (LogDB_Log(sMessages[i % BENCH_MSG_VARIANTS]) != errNone)
+            return 1;
+    }
+    seen = Bench_RollRead(&ordered, &last);
+    if (seen != LOGDB_MAX_SEGMENTS + 1 || !ordered || !last)
+    {
+        fprintf(stderr, "after %lu rolls: %lu records, %s, newest %s\n",
+                (unsigned long)BENCH_ROLLS, (unsigned long)seen,
+                ordered ? "in order" : "out of order", last ? "last" : "not last");
+        return 1;
+    }
+    LogDB_ClearAll();
+
+    storage = HostShim_GetStats()->storageInUse;
+    DmCreateDatabase(0, LOGDB_SEG_PREFIX "0001", 'Othr', 'DATA', false);
+    HostShim_ResetStats();
+    for (i = 0; i < BENCH_ROLL_BLOCKED; i++)
+    {
+        if (LogDB_Log(sMessages[i % BENCH_MSG_VARIANTS]) != errNone)
+            return 1;
+    }
+    tries = HostShim_GetStats()->calls[hostApiDmSetDatabaseInfo];
+    LogDB_ClearAll();
+    DmDeleteDatabase(0, DmFindDatabase(0, LOGDB_SEG_PREFIX "0001"));
+    /* A try at the first append, then one per 256; and the word filters' */
+    if (tries > BENCH_ROLL_BLOCKED / 256 + 2 ||
+        HostShim_GetStats()->storageInUse != storage)
+    {
+        fprintf(stderr, "blocked roll: %lu tries in %lu appends, %lu bytes left behind\n",
+                (unsigned long)tries, (unsigned long)BENCH_ROLL_BLOCKED,
+                (unsigned long)(HostShim_GetStats()->storageInUse - storage));
+        return 1;
+    }
+
+    for (i = 0; i < LOGDB_MAX_SEGMENTS + 1; i++)
+    {
+        HostShim_AdvanceSeconds(1);
+        LogDB_Log(sMessages[i % BENCH_MSG_VARIANTS]);
+    }
+    heldR = DmOpenDatabase(0, DmFindDatabase(0, LOGDB_SEG_PREFIX "0001"), dmModeReadOnly);
+    for (i = 0; i <= BENCH_ROLL_HELD; i++)
+    {
+        if (i == BENCH_ROLL_HELD && heldR != NULL)
+            DmCloseDatabase(heldR);
+        HostShim_AdvanceSeconds(1);
+        LogDB_Log(sMessages[i % BENCH_MSG_VARIANTS]);
+    }
+    seen = Bench_RollRead(&ordered, &last);
+    if (heldR == NULL || seen != LOGDB_MAX_SEGMENTS + 1 || !ordered || !last ||
+        DmFindDatabase(0, LOGDB_SEG_PREFIX "0037") == 0)
+    {
+        fprintf(stderr, "held segment: %lu records, %s, newest %s, %s\n", (unsigned long)seen,
+                ordered ? "in order" : "out of order", last ? "last" : "not last",
+                DmFindDatabase(0, LOGDB_SEG_PREFIX "0037") ? "numbered on" : "misnumbered");
+        return 1;
+    }
+    LogDB_ClearAll();
+
+    roll.maxRecords = BENCH_ROLL_BIG;
+    LogDB_SetRollPolicy(&roll);
+    for (i = 0; i <= BENCH_ROLL_BIG; i++)
+    {
+        if (i == BENCH_ROLL_BIG)
+            HostShim_ResetStats();
+        LogDB_Log(sMessages[i % BENCH_MSG_VARIANTS]);
+    }
+    tries = HostShim_GetStats()->calls[hostApiDmQueryRecord];
+    LogDB_ClearAll();
+    if (tries > 16)
+    {
+        fprintf(stderr, "roll of %lu records: %lu records read\n",
+                (unsigned long)BENCH_ROLL_BIG, (unsigned long)tries);
+        return 1;
+    }
+    LogDB_SetRollPolicy(NULL);
+    return 0;
+}
+
+/* Two apps across ~16 segments, packed one segment per LogDB_Compact;
+   the blocks must read back as the same entries, app filter included.
+   Switching the app name must not start a new session of the counters. */
+static int Bench_Compact(UInt32 records)
+{
+    LogDB_RollPolicy roll;
+    LogDB_Stats stats;
+    UInt32 packed;
+    UInt32 total;
+    UInt32 other;
+    UInt32 before;
+    UInt32 sumBefore;
+    UInt32 sumAfter;
+    UInt32 seen;
+    UInt32 i;
+    double t0;
+    Err err;
+
+    MemSet(&roll, sizeof(roll), 0);
+    roll.maxRecords = (UInt16)(records / 16 + 1);
+    LogDB_SetRollPolicy(&roll);
+    other = 0;
+    LogDB_Init(BENCH_APP_NAME);
+    for (i = 0; i < records; i++)
+    {
+        if ((i % 16) == 0)
+            HostShim_AdvanceSeconds(1);
+        LogDB_SetAppName((i % 4 == 3) ? BENCH_OTHER_APP : BENCH_APP_NAME);
+        other += (i % 4 == 3) ? 1 : 0;
+        if (LogDB_Log(sMessages[i % BENCH_MSG_VARIANTS]) != errNone)
+            return 1;
+    }
+    LogDB_SetAppName(BENCH_APP_NAME);
+    LogDB_GetStats(&stats);
+    if (stats.calls != records)
+    {
+        fprintf(stderr, "app switches: %lu of %lu calls counted\n", (unsigned long)stats.calls,
+                (unsigned long)records);
+        return 1;
+    }
+    Bench_Sum(NULL, &sumBefore);
+    before = HostShim_GetStats()->storageInUse;
+
+    HostShim_ResetStats();
+    total = 0;
+    t0 = Bench_Now();
+    do
+    {
+        err = LogDB_Compact(&packed);
+        total += packed;
+    } while (err == errNone && packed > 0);
+    Bench_Report(records, "compact", total, Bench_Now() - t0);
+    printf("%8s  %-8s storage in use: %lu -> %lu bytes\n", "", "", (unsigned long)before,
+           (unsigned long)HostShim_GetStats()->storageInUse);
+    if (err != errNone || total == 0)
+    {
+        fprintf(stderr, "LogDB_Compact: 0x%04x after %lu entries\n", err,
+                (unsigned long)total);
+        return 1;
+    }
+
+    HostShim_ResetStats();
+    t0 = Bench_Now();
+    seen = Bench_Sum(NULL, &sumAfter);
+    Bench_Report(records, "iter-pk", seen, Bench_Now() - t0);
+    if (seen != records || sumAfter != sumBefore)
+    {
+        fprintf(stderr, "packed read back: %lu of %lu entries, checksum %s\n",
+                (unsigned long)seen, (unsigned long)records,
+                (sumAfter == sumBefore) ? "ok" : "differs");
+        return 1;
+    }
+
+    if (Bench_Seek(records) != 0)
+        return 1;
+
+    HostShim_ResetStats();
+    t0 = Bench_Now();
+    seen = Bench_Sum(BENCH_OTHER_APP, &sumAfter);
+    Bench_Report(records, "app-pk", seen, Bench_Now() - t0);
+    if (seen != other)
+    {
+        fprintf(stderr, "app filter saw %lu of %lu entries\n", (unsigned long)seen,
+                (unsigned long)other);
+        return 1;
+    }
+
+    LogDB_SetRollPolicy(NULL);
+    LogDB_ClearAll();
+    return 0;
+}
+
+/* Segments packed and trimmed from LogDB_Idle in small budgets (reported
+   per step): the same entries must read back, every segment packed, the
+   slot freed ahead of the next roll, and the counters logged. */
+#define BENCH_IDLE_BUDGET 2
+
+static int Bench_Idle(UInt32 records)
+{
+    LogDB_RollPolicy roll;
+    LogDB_IdleStats st;
+    LogDB_Entry entry;
+    LogDB_Field f;
+    LogDB_Iter it;
+    MemHandle h;
+    UInt32 sumBefore;
+    UInt32 sumAfter;
+    UInt32 seen;
+    UInt32 steps;
+    UInt32 calls;
+    UInt32 over;
+    UInt32 maxTicks;
+    UInt32 t;
+    UInt32 packed;
+    UInt32 i;
+    UInt16 segs;
+    Boolean more;
+    Boolean logged;
+    double t0;
+
+    MemSet(&roll, sizeof(roll), 0);
+    roll.maxRecords = (UInt16)(records / 16 + 1);
+    LogDB_SetRollPolicy(&roll);
+    for (i = 0; i < records; i++)
+    {
+        if ((i % 16) == 0)
+            HostShim_AdvanceSeconds(1);
+        if (LogDB_Log(sMessages[i % BENCH_MSG_VARIANTS]) != errNone)
+            return 1;
+    }
+    Bench_Sum(NULL, &sumBefore);
+    LogDB_IdleReport(); /* counters from here on only */
+
+    HostShim_ResetStats();
+    calls = 0;
+    over = 0;
+    maxTicks = 0;
+    t0 = Bench_Now();
+    do
+    {
+        t = TimGetTicks();
+        calls++;
+        more = LogDB_Idle(BENCH_IDLE_BUDGET);
+        t = TimGetTicks() - t;
+        maxTicks = (t > maxTicks) ? t : maxTicks;
+        over += (t > BENCH_IDLE_BUDGET) ? 1 : 0;
+    } while (more);
+    LogDB_IdleGetStats(&st);
+    steps = st.done[0] + st.done[1] + st.done[2];
+    Bench_Report(records, "idle", steps, Bench_Now() - t0);
+    printf("%8s  %-8s %lu calls of %u ticks: %lu steps, %lu deferred, max %lu ticks, "
+           "%lu over\n",
+           "", "", (unsigned long)calls, BENCH_IDLE_BUDGET, (unsigned long)steps,
+           (unsigned long)(st.deferred[0] + st.deferred[1] + st.deferred[2]),
+           (unsigned long)maxTicks, (unsigned long)over);
+
+    seen = Bench_Sum(NULL, &sumAfter);
+    LogDB_Compact(&packed);
+    if (st.pending != 0 || packed != 0 || seen != records || sumAfter != sumBefore)
+    {
+        fprintf(stderr, "idle: pending 0x%x, %lu left to pack, %lu of %lu entries, "
+                "checksum %s\n", st.pending, (unsigned long)packed, (unsigned long)seen,
+                (unsigned long)records, (sumAfter == sumBefore) ? "ok" : "differs");
+        return 1;
+    }
+
+    /* Fill every segment slot: the trim frees one without a roll */
+    roll.maxRecords = 2;
+    LogDB_SetRollPolicy(&roll);
+    for (i = 0; i < 2 * (LOGDB_MAX_SEGMENTS + 1) + 1; i++)
+        LogDB_Log("fill");
+    while (LogDB_Idle(BENCH_IDLE_BUDGET))
+        ;
+    segs = 0;
+    if (LogDB_IterBegin(&it) == errNone)
+    {
+        segs = it.numDBs - 1; /* less the active DB */
+        LogDB_IterEnd(&it);
+    }
+    LogDB_IdleGetStats(&st);
+    if (segs != LOGDB_MAX_SEGMENTS - 1 || st.done[1] == 0)
+    {
+        fprintf(stderr, "idle trim: %u segments, %lu trims\n", segs,
+                (unsigned long)st.done[1]);
+        return 1;
+    }
+
+    /* The counters go out as a record */
+    LogDB_IdleReport();
+    logged = false;
+    if (LogDB_IterBegin(&it) == errNone)
+    {
+        while ((h = LogDB_IterNextEntry(&it, &entry)) != NULL)
+        {
+            if (StrCompare(entry.msg, LOGDB_IDLE_MSG) == 0 && LogDB_FieldFind(&entry, "pk", &f))
+                logged = (f.v.u32 == st.done[2]);
+            LogDB_IterUnlock(h);
+        }
+        LogDB_IterEnd(&it);
+    }
+    if (!logged)
+    {
+        fprintf(stderr, "idle: no \"%s\" record with pk=%lu\n", LOGDB_IDLE_MSG,
+                (unsigned long)st.done[2]);
+        return 1;
+    }
+
+    LogDB_SetRollPolicy(NULL);
+    LogDB_ClearAll();
+    return 0;
+}
+
+/* Word search. The log's vocabulary drifts the way an app's does: each
+   stretch of 1000 records touches a few forms and DBs, and a rare error
+   turns up now and then. Every query must return exactly the records a
+   plain scan matches; the phase reports how many runs the filters let it
+   skip, and how many of the runs it read had no match (false positives,
+   as a share of all runs without one). */
+#define BENCH_SEARCH_QUERIES 5
+#define BENCH_SEARCH_RUNS ((LOGDB_MAX_SEGMENTS + 1) * 256)
+
+static void Bench_SearchMsg(UInt32 i, char *buf)
+{
+    static const char *forms[12] = {"Main", "Prefs", "Details", "Edit", "List", "About",
+                                    "Find", "Note", "Alarm", "Backup", "Memo", "Todo"};
+    static const char *dbs[6] = {"AddressDB", "DatebookDB", "MemoDB", "ToDoDB", "MailDB",
+                                 "ExpenseDB"};
+    const char *form;
+    const char *db;
+    unsigned long stretch;
+
+    stretch = i / 1000;
+    form = forms[(stretch * 3 + i % 3) % 12];
+    db = dbs[(stretch + i % 2) % 6];
+    if (i % 977 == 500)
+    {
+        sprintf(buf, "Modem timeout after %lu ms", (unsigned long)(1000 + i % 9000));
+        return;
+    }
+    switch (i % 7)
+    {
+    case 0:
+        sprintf(buf, "frmOpenEvent %sForm", form);
+        break;
+    case 1:
+        sprintf(buf, "Opened %s, %lu records", db, (unsigned long)(i % 500));
+        break;
+    case 2:
+        sprintf(buf, "penDownEvent at %lu,%lu", (unsigned long)(i % 160),
+                (unsigned long)(i / 7 % 160));
+        break;
+    case 3:
+        sprintf(buf, "%sSaveButton Clicked", form);
+        break;
+    case 4:
+        sprintf(buf, "Wrote record %lu to %s", (unsigned long)(i % 997), db);
+        break;
+    case 5:
+        sprintf(buf, "keyDownEvent chr=%lu", (unsigned long)(32 + i % 90));
+        break;
+    default:
+        sprintf(buf, "Sync %s", (i % 2) ? "started" : "finished");
+        break;
+    }
+}
+
+/* Whether msg has word (lower case) as a whole word, in any case. */
+static int Bench_HasWord(const char *msg, const char *word)
+{
+    const char *p;
+    size_t n;
+    size_t i;
+
+    n = strlen(word);
+    for (p = msg; *p != 0;)
+    {
+        while (*p != 0 && !isalnum((unsigned char)*p))
+            p++;
+        for (i = 0; p[i] != 0 && isalnum((unsigned char)p[i]); i++)
+            ;
+        if (i == n && strncasecmp(p, word, n) == 0)
+            return 1;
+        p += i;
+    }
+    return 0;
+}
+
+static int Bench_Search(UInt32 records)
+{
+    static const char *queries[BENCH_SEARCH_QUERIES][3] = {
+        {"timeout", "timeout", NULL},
+        {"EditSaveButton clicked", "editsavebutton", "clicked"},
+        {"MemoDB", "memodb", NULL},
+        {"sync", "sync", NULL},
+        {"zebra", "zebra", NULL},
+    };
+    static unsigned char hit[BENCH_SEARCH_RUNS];
+    LogDB_Entry entry;
+    LogDB_Iter it;
+    MemHandle h;
+    char msg[64];
+    UInt32 want[BENCH_SEARCH_QUERIES];
+    UInt32 seen;
+    UInt32 runs;
+    UInt32 hitRuns;
+    UInt32 pos;
+    UInt32 run;
+    UInt32 i;
+    UInt16 q;
+    double t0;
+
+    for (i = 0; i < records; i++)
+    {
+        if ((i % 16) == 0)
+            HostShim_AdvanceSeconds(1);
+        Bench_SearchMsg(i, msg);
+        if (LogDB_Log(msg) != errNone)
+            return 1;
+    }
+
+    /* What each query should find, by a scan without filters */
+    MemSet(want, sizeof(want), 0);
+    if (LogDB_IterBegin(&it) == errNone)
+    {
+        while ((h = LogDB_IterNextEntry(&it, &entry)) != NULL)
+        {
+            for (q = 0; q < BENCH_SEARCH_QUERIES; q++)
+            {
+                if (Bench_HasWord(entry.msg, queries[q][1]) &&
+                    (queries[q][2] == NULL || Bench_HasWord(entry.msg, queries[q][2])))
+                    want[q]++;
+            }
+            LogDB_IterUnlock(h);
+        }
+        LogDB_IterEnd(&it);
+    }
+
+    for (q = 0; q < BENCH_SEARCH_QUERIES; q++)
+    {
+        MemSet(hit, sizeof(hit), 0);
+        seen = 0;
+        hitRuns = 0;
+        HostShim_ResetStats();
+        t0 = Bench_Now();
+        if (LogDB_IterBegin(&it) != errNone)
+            return 1;
+        LogDB_IterSetText(&it, queries[q][0]);
+        while ((h = LogDB_IterNextEntry(&it, &entry)) != NULL)
+        {
+            pos = LogDB_IterTell(&it);
+            run = (pos >> 24) * 256 + ((pos >> 8) & 0xFFFF) / LOGDB_BLOOM_RUN;
+            hitRuns += hit[run] ? 0 : 1;
+            hit[run] = 1;
+            seen++;
+            LogDB_IterUnlock(h);
+        }
+        LogDB_IterEnd(&it);
+        Bench_Report(records, "search", records, Bench_Now() - t0);
+
+        runs = it.runsRead + it.runsSkipped;
+        printf("%8s  %-8s \"%s\": %lu found, %lu of %lu runs skipped (%.0f%%), "
+               "%lu read for nothing (%.1f%% of %lu)\n",
+               "", "", queries[q][0], (unsigned long)seen, (unsigned long)it.runsSkipped,
+               (unsigned long)runs, (runs > 0) ? 100.0 * it.runsSkipped / runs : 0.0,
+               (unsigned long)(it.runsRead - hitRuns),
+               (runs > hitRuns) ? 100.0 * (it.runsRead - hitRuns) / (runs - hitRuns) : 0.0,
+               (unsigned long)(runs - hitRuns));
+        if (seen != want[q] || (want[q] == 0 && it.runsSkipped == 0))
+        {
+            fprintf(stderr, "search \"%s\": %lu found, %lu expected, %lu runs skipped\n",
+                    queries[q][0], (unsigned long)seen, (unsigned long)want[q],
+                    (unsigned long)it.runsSkipped);
+            return 1;
+        }
+    }
+
+    LogDB_ClearAll();
+    return 0;
+}
+
+/* Sub-launch logging: one-line LogDB_Ctx sessions (what an alarm or
+   notification handler does), timed between app writes, then more of
+   them interleaved with the app's own LogDB_Log calls. Every line must
+   be read back, and found by a word search, and the app's writer must
+   keep counting its DB right. With storage nearly full a line must be
+   refused and add nothing. */
+#define BENCH_CTX_APP "AlarmCtx"
+#define BENCH_CTX_EVERY 64
+
+static int Bench_Ctx(UInt32 records)
+{
+    LogDB_Entry entry;
+    LogDB_Iter it;
+    LogDB_Ctx ctx;
+    MemHandle h;
+    char msg[48];
+    UInt32 sessions;
+    UInt32 lines;
+    UInt32 seen;
+    UInt32 checksum;
+    UInt32 i;
+    double t0;
+    Err err;
+
+    sessions = (records / BENCH_CTX_EVERY > 0) ? records / BENCH_CTX_EVERY : 1;
+    for (i = 0; i < records / 2; i++)
+    {
+        if ((i % 16) == 0)
+            HostShim_AdvanceSeconds(1);
+        if (LogDB_Log(sMessages[i % BENCH_MSG_VARIANTS]) != errNone)
+            return 1;
+    }
+
+    HostShim_ResetStats();
+    t0 = Bench_Now();
+    for (i = 0; i < sessions; i++)
+    {
+        sprintf(msg, "Alarm fired for appointment %lu", (unsigned long)i);
+        err = LogDB_CtxInit(&ctx, BENCH_CTX_APP);
+        if (err == errNone)
+            err = LogDB_CtxLog(&ctx, msg);
+        LogDB_CtxClose(&ctx);
+        if (err != errNone)
+        {
+            fprintf(stderr, "LogDB_Ctx session %lu: 0x%04x\n", (unsigned long)i, err);
+            return 1;
+        }
+    }
+    Bench_Report(records, "ctx", sessions, Bench_Now() - t0);
+    lines = sessions;
+
+    for (i = records / 2; i < records; i++)
+    {
+        if ((i % 16) == 0)
+            HostShim_AdvanceSeconds(1);
+        if (LogDB_Log(sMessages[i % BENCH_MSG_VARIANTS]) != errNone)
+            return 1;
+        if ((i % BENCH_CTX_EVERY) == 0 && LogDB_CtxInit(&ctx, BENCH_CTX_APP) == errNone)
+        {
+            if (LogDB_CtxLog(&ctx, "Alarm fired for appointment") == errNone)
+                lines++;
+            LogDB_CtxClose(&ctx);
+        }
+    }
+
+    seen = 0;
+    if (LogDB_IterBegin(&it) == errNone)
+    {
+        LogDB_IterSetText(&it, "appointment");
+        while ((h = LogDB_IterNextEntry(&it, &entry)) != NULL)
+        {
+            seen++;
+            LogDB_IterUnlock(h);
+        }
+        LogDB_IterEnd(&it);
+    }
+    if (Bench_Sum(NULL, &checksum) != records + lines ||
+        Bench_Sum(BENCH_CTX_APP, &checksum) != lines || seen != lines)
+    {
+        fprintf(stderr, "ctx: %lu lines, %lu found by word, %lu of %lu records read\n",
+                (unsigned long)lines, (unsigned long)seen,
+                (unsigned long)Bench_Sum(NULL, &checksum), (unsigned long)(records + lines));
+        return 1;
+    }
+
+    HostShim_SetStorageBytes(HostShim_GetStats()->storageInUse + LOGDB_PRESSURE_DEFAULT_FULL / 2);
+    err = LogDB_CtxInit(&ctx, BENCH_CTX_APP);
+    if (err == errNone)
+        err = LogDB_CtxLog(&ctx, "Alarm fired for appointment");
+    LogDB_CtxClose(&ctx);
+    HostShim_SetStorageBytes(0);
+    if (err != dmErrMemError || Bench_Sum(BENCH_CTX_APP, &checksum) != lines)
+    {
+        fprintf(stderr, "ctx with storage full: 0x%04x, %lu of %lu lines\n", err,
+                (unsigned long)Bench_Sum(BENCH_CTX_APP, &checksum), (unsigned long)lines);
+        return 1;
+    }
+
+    LogDB_ClearAll();
+    return 0;
+}
+
+/* Storage pressure: a storage heap BENCH_PRESSURE_ROOM bytes bigger than
+   what is in use, filled with plain, structured and sampled records and
+   an idle call now and then, first with the tiers off (every bound at 1
+   byte), then with the default bounds. Without the tiers appends fail
+   once the heap is full; with them none may, and free storage must stay
+   well clear of zero. Trimming stops short of the newest segments, so the
+   marker of the tier the run ends in must still be there. */
+#define BENCH_PRESSURE_ROOM (160UL * 1024UL)
+#define BENCH_PRESSURE_ROLL 1024
+
+static int Bench_PressureRun(UInt32 records, const LogDB_PressurePolicy *policy,
+                             const char *phase, UInt32 *failedP, UInt32 *lowestP)
+{
+    LogDB_RollPolicy roll;
+    LogDB_Field f;
+    UInt32 room;
+    UInt32 i;
+    double t0;
+    Err err;
+
+    MemSet(&roll, sizeof(roll), 0);
+    roll.maxRecords = BENCH_PRESSURE_ROLL;
+    LogDB_SetRollPolicy(&roll);
+    LogDB_SetPressurePolicy(policy);
+    room = HostShim_GetStats()->storageInUse + BENCH_PRESSURE_ROOM;
+    HostShim_SetStorageBytes(room);
+
+    HostShim_ResetStats();
+    *failedP = 0;
+    t0 = Bench_Now();
+    for (i = 0; i < records; i++)
+    {
+        if ((i % 16) == 0)
+            HostShim_AdvanceSeconds(1);
+        if ((i % 64) == 0)
+            LogDB_Idle(BENCH_IDLE_BUDGET);
+        if ((i % 4) == 1)
+        {
+            err = LogDB_LogSampled(4, sMessages[i % BENCH_MSG_VARIANTS], NULL, 0);
+        }
+        else if ((i % 8) == 2)
+        {
+            LogDB_FieldUInt32(&f, "i", i);
+            err = LogDB_LogFields(sMessages[i % BENCH_MSG_VARIANTS], &f, 1);
+        }
+        else
+        {
+            err = LogDB_Log(sMessages[i % BENCH_MSG_VARIANTS]);
+        }
+        if (err != errNone)
+            (*failedP)++;
+    }
+    Bench_Report(records, phase, records, Bench_Now() - t0);
+    *lowestP = room - HostShim_GetStats()->storagePeak;
+
+    HostShim_SetStorageBytes(0);
+    LogDB_SetPressurePolicy(NULL);
+    LogDB_SetRollPolicy(NULL);
+    return 0;
+}
+
+static int Bench_Pressure(UInt32 records)
+{
+    LogDB_PressurePolicy off;
+    LogDB_Entry entry;
+    LogDB_Field f;
+    LogDB_Iter it;
+    MemHandle h;
+    UInt32 failedOff;
+    UInt32 lowestOff;
+    UInt32 failed;
+    UInt32 lowest;
+    UInt32 markers;
+    UInt32 dropped;
+    UInt32 tier;
+
+    MemSet(&off, sizeof(off), 0);
+    off.lowBytes = off.highBytes = off.fullBytes = 1;
+    Bench_PressureRun(records, &off, "press-0", &failedOff, &lowestOff);
+    LogDB_ClearAll();
+    Bench_PressureRun(records, NULL, "pressure", &failed, &lowest);
+
+    /* Markers that survived the trimming, and what they say was dropped */
+    markers = 0;
+    dropped = 0;
+    tier = LOGDB_PRESSURE_NONE;
+    if (LogDB_IterBegin(&it) == errNone)
+    {
+        while ((h = LogDB_IterNextEntry(&it, &entry)) != NULL)
+        {
+            if (StrCompare(entry.msg, LOGDB_PRESSURE_MSG) == 0 &&
+                LogDB_FieldFind(&entry, "t", &f))
+            {
+                markers++;
+                tier = f.v.u32;
+                if (LogDB_FieldFind(&entry, "drop", &f))
+                    dropped += f.v.u32;
+            }
+            LogDB_IterUnlock(h);
+        }
+        LogDB_IterEnd(&it);
+    }
+    printf("%8s  %-8s tiers off: %lu failed, %lu bytes left; on: %lu failed, %lu bytes "
+           "left, %lu markers kept, last tier %lu, %lu dropped\n",
+           "", "", (unsigned long)failedOff, (unsigned long)lowestOff, (unsigned long)failed,
+           (unsigned long)lowest, (unsigned long)markers, (unsigned long)tier,
+           (unsigned long)dropped);
+    if (failed != 0 || lowest < LOGDB_PRESSURE_DEFAULT_FULL / 2)
+    {
+        fprintf(stderr, "pressure: %lu appends failed, %lu bytes left\n",
+                (unsigned long)failed, (unsigned long)lowest);
+        return 1;
+    }
+    if (markers == 0 || tier == LOGDB_PRESSURE_NONE)
+    {
+        fprintf(stderr, "pressure: %lu markers kept, the last for tier %lu\n",
+                (unsigned long)markers, (unsigned long)tier);
+        return 1;
+    }
+
+    LogDB_ClearAll();
+    return 0;
+}
+
+/* The memory sampler: a poll that is not due yet, a forced sample, and
+   a check that the watermarks match the samples. */
+static int Bench_Mem(UInt32 records)
+{
+    LogDB_Entry entry;
+    LogDB_Field f;
+    LogDB_Iter it;
+    MemHandle h;
+    UInt32 samples;
+    UInt32 seen;
+    UInt32 lowSF;
+    UInt32 marksSF;
+    UInt32 marksN;
+    UInt32 i;
+    double t0;
+
+    LogDB_SetMemInterval(0x7FFFFFFFUL);
+    HostShim_ResetStats();
+    t0 = Bench_Now();
+    for (i = 0; i < records; i++)
+        LogDB_MemSample(false);
+    Bench_Report(records, "mem-poll", records, Bench_Now() - t0);
+
+    samples = (records >= 16) ? records / 16 : 1;
+    HostShim_ResetStats();
+    t0 = Bench_Now();
+    for (i = 0; i < samples; i++)
+    {
+        /* Something for the low water mark to catch */
+        LogDB_Log(sMessages[i % BENCH_MSG_VARIANTS]);
+        LogDB_MemSample(true);
+    }
+    Bench_Report(records, "mem-smp", samples, Bench_Now() - t0);
+    LogDB_MemReport();
+    LogDB_SetMemInterval(0);
+
+    seen = 0;
+    lowSF = 0xFFFFFFFFUL;
+    marksSF = 0;
+    marksN = 0;
+    if (LogDB_IterBegin(&it) == errNone)
+    {
+        while ((h = LogDB_IterNextEntry(&it, &entry)) != NULL)
+        {
+            if (StrCompare(entry.msg, LOGDB_MEM_MSG) == 0 && LogDB_FieldFind(&entry, "sf", &f))
+            {
+                seen++;
+                if (f.v.u32 < lowSF)
+                    lowSF = f.v.u32;
+            }
+            else if (StrCompare(entry.msg, LOGDB_MEM_MARKS_MSG) == 0)
+            {
+                if (LogDB_FieldFind(&entry, "sf", &f))
+                    marksSF = f.v.u32;
+                if (LogDB_FieldFind(&entry, "n", &f))
+                    marksN = f.v.u32;
+            }
+            LogDB_IterUnlock(h);
+        }
+        LogDB_IterEnd(&it);
+    }
+    printf("%8s  %-8s %lu samples, storage low water %lu bytes\n", "", "",
+           (unsigned long)seen, (unsigned long)marksSF);
+    LogDB_ClearAll();
+    if (seen != samples || marksN != samples || marksSF != lowSF)
+    {
+        fprintf(stderr, "memory samples: %lu of %lu, marks n=%lu sf=%lu (low %lu)\n",
+                (unsigned long)seen, (unsigned long)samples, (unsigned long)marksN,
+                (unsigned long)marksSF, (unsigned long)lowSF);
+        return 1;
+    }
+    return 0;
+}
+
+/* Number of DB opens an iteration made, and its entries in order. */
+static UInt32 Bench_AppIter(const char *app, UInt32 *opensP, int *orderedP)
+{
+    LogDB_Entry entry;
+    LogDB_Iter it;
+    MemHandle h;
+    UInt32 seen;
+    UInt32 last;
+
+    seen = 0;
+    last = 0;
+    *orderedP = 1;
+    HostShim_ResetStats();
+    if (LogDB_IterBeginSink(&it, LOGDB_SINK_APPDB, 0, 0xFFFFFFFFUL) != errNone)
+        return 0;
+    LogDB_IterSetApp(&it, app);
+    while ((h = LogDB_IterNextEntry(&it, &entry)) != NULL)
+    {
+        if (entry.seconds < last)
+            *orderedP = 0;
+        last = entry.seconds;
+        seen++;
+        LogDB_IterUnlock(h);
+    }
+    LogDB_IterEnd(&it);
+    *opensP = HostShim_GetStats()->calls[hostApiDmOpenDatabase];
+    return seen;
+}
+
+/* Four apps, each in its own DBs (rolled once), read back merged, then
+   one app alone, which must open only its own DBs. Logging inits for
+   every record, which must not check free storage more often. Then more
+   app DBs than there are segments, which must all be merged, and an app
+   rolled twice within a second, whose records must come back in the
+   order logged. Last, an app whose old generation a reader holds open
+   logs on: its roll may only be tried every so many appends. */
+#define BENCH_MANY_APPS (2 * (LOGDB_MAX_SEGMENTS + 1))
+
+static int Bench_AppDB(UInt32 records)
+{
+    static const char *kApps[] = {BENCH_APP_NAME, BENCH_OTHER_APP, "ThirdApp", "FourthApp"};
+    LogDB_RollPolicy roll;
+    LogDB_Entry entry;
+    LogDB_Iter it;
+    MemHandle h;
+    char name[16];
+    unsigned long last;
+    DmOpenRef heldR;
+    UInt32 checks;
+    UInt32 other;
+    UInt32 seen;
+    UInt32 opens;
+    UInt32 i;
+    int ordered;
+    double t0;
+
+    MemSet(&roll, sizeof(roll), 0);
+    roll.maxRecords = (UInt16)(records / 6 + 1);
+    LogDB_SetRollPolicy(&roll);
+    other = 0;
+    HostShim_ResetStats();
+    t0 = Bench_Now();
+    for (i = 0; i < records; i++)
+    {
+        if ((i % 16) == 0)
+            HostShim_AdvanceSeconds(1);
+        LogDB_InitSinks(kApps[i % 4], LOGDB_SINK_APPDB);
+        other += (i % 4 == 1) ? 1 : 0;
+        if (LogDB_Log(sMessages[i % BENCH_MSG_VARIANTS]) != errNone)
+            return 1;
+    }
+    Bench_Report(records, "app-log", records, Bench_Now() - t0);
+    /* An Init per record keeps the storage checks' countdown */
+    checks = HostShim_GetStats()->calls[hostApiMemHeapFreeBytes];
+    if (checks > records / LOGDB_PRESSURE_DEFAULT_CHECK + 2)
+    {
+        fprintf(stderr, "app-log: %lu storage checks in %lu records\n", (unsigned long)checks,
+                (unsigned long)records);
+        return 1;
+    }
+
+    t0 = Bench_Now();
+    seen = Bench_AppIter(NULL, &opens, &ordered);
+    Bench_Report(records, "app-all", seen, Bench_Now() - t0);
+    if (seen != records || !ordered)
+    {
+        fprintf(stderr, "merged read: %lu of %lu entries, %s\n", (unsigned long)seen,
+                (unsigned long)records, ordered ? "in order" : "out of order");
+        return 1;
+    }
+
+    t0 = Bench_Now();
+    seen = Bench_AppIter(BENCH_OTHER_APP, &opens, &ordered);
+    Bench_Report(records, "app-one", seen, Bench_Now() - t0);
+    printf("%8s  %-8s %lu DBs opened for one app of 4\n", "", "", (unsigned long)opens);
+    if (seen != other || opens > 2)
+    {
+        fprintf(stderr, "one app's read: %lu of %lu entries, %lu DBs opened\n",
+                (unsigned long)seen, (unsigned long)other, (unsigned long)opens);
+        return 1;
+    }
+
+    LogDB_ClearApp(BENCH_OTHER_APP);
+    if (Bench_AppIter(BENCH_OTHER_APP, &opens, &ordered) != 0 ||
+        Bench_AppIter(NULL, &opens, &ordered) != records - other)
+    {
+        fprintf(stderr, "LogDB_ClearApp left the wrong entries\n");
+        return 1;
+    }
+
+    LogDB_ClearAll();
+    for (i = 0; i < BENCH_MANY_APPS; i++)
+    {
+        sprintf(name, "App%03lu", (unsigned long)i);
+        LogDB_InitSinks(name, LOGDB_SINK_APPDB);
+        LogDB_Log(sMessages[i % BENCH_MSG_VARIANTS]);
+    }
+    seen = Bench_AppIter(NULL, &opens, &ordered);
+    if (seen != BENCH_MANY_APPS)
+    {
+        fprintf(stderr, "merged read of %u apps: %lu entries\n", (unsigned)BENCH_MANY_APPS,
+                (unsigned long)seen);
+        return 1;
+    }
+
+    /* The second roll's new DB takes the slot the first's old one left,
+       so it is found before the old generation */
+    LogDB_ClearAll();
+    roll.maxRecords = 8;
+    LogDB_SetRollPolicy(&roll);
+    LogDB_InitSinks(BENCH_APP_NAME, LOGDB_SINK_APPDB);
+    for (i = 0; i < 3 * roll.maxRecords; i++)
+    {
+        sprintf(name, "%lu", (unsigned long)i);
+        LogDB_Log(name);
+    }
+    seen = 0;
+    ordered = 1;
+    last = 0;
+    if (LogDB_IterBeginSink(&it, LOGDB_SINK_APPDB, 0, 0xFFFFFFFFUL) == errNone)
+    {
+        while ((h = LogDB_IterNextEntry(&it, &entry)) != NULL)
+        {
+            if (seen > 0 && strtoul(entry.msg, NULL, 10) <= last)
+                ordered = 0;
+            last = strtoul(entry.msg, NULL, 10);
+            seen++;
+            LogDB_IterUnlock(h);
+        }
+        LogDB_IterEnd(&it);
+    }
+    if (seen != 2 * roll.maxRecords || !ordered)
+    {
+        fprintf(stderr, "one second over two generations: %lu entries, %s\n",
+                (unsigned long)seen, ordered ? "in order" : "out of order");
+        return 1;
+    }
+
+    LogDB_ClearAll();
+    LogDB_InitSinks(BENCH_APP_NAME, LOGDB_SINK_APPDB);
+    for (i = 0; i < 2 * roll.maxRecords; i++)
+        LogDB_Log(sMessages[i % BENCH_MSG_VARIANTS]);
+    heldR = DmOpenDatabase(0, DmFindDatabase(0, LOGDB_APPDB_OLD_PREFIX BENCH_APP_NAME),
+                           dmModeReadOnly);
+    HostShim_ResetStats();
+    for (i = 0; i < BENCH_ROLL_BLOCKED; i++)
+        LogDB_Log(sMessages[i % BENCH_MSG_VARIANTS]);
+    checks = HostShim_GetStats()->calls[hostApiDmDeleteDatabase];
+    if (heldR != NULL)
+        DmCloseDatabase(heldR);
+    if (heldR == NULL || checks > BENCH_ROLL_BLOCKED / 256 + 1)
+    {
+        fprintf(stderr, "held app DB: %lu roll tries in %lu appends\n", (unsigned long)checks,
+                (unsigned long)BENCH_ROLL_BLOCKED);
+        return 1;
+    }
+
+    LogDB_ClearAll();
+    LogDB_SetRollPolicy(NULL);
+    LogDB_InitSinks(BENCH_APP_NAME, LOGDB_SINK_DB);
+    return 0;
+}
+
+/* Callback lines through a LogRing, in bursts of BENCH_RING_BURST with a
+   drain after each, so every burst overflows the ring. Putting may make
+   no Memory or Data Manager call, wakes the loop once per burst (the
+   ring was empty), and the drains must log every line kept plus one
+   overflow record per burst whose counts add up to the lines dropped. */
+#define BENCH_RING_BURST (LOGRING_SLOTS + LOGRING_SLOTS / 2)
+
+static int Bench_Ring(UInt32 records)
+{
+    static LogRing_Buffer ring;
+    const HostShim_Stats *st;
+    LogDB_Entry entry;
+    LogDB_Field f;
+    LogDB_Iter it;
+    MemHandle h;
+    UInt32 bursts;
+    UInt32 put;
+    UInt32 kept;
+    UInt32 dropped;
+    UInt32 lines;
+    UInt32 reported;
+    UInt32 i;
+    UInt32 j;
+    double putSecs;
+    double drainSecs;
+    double t0;
+
+    bursts = (records + BENCH_RING_BURST - 1) / BENCH_RING_BURST;
+    LogRing_Init(&ring);
+    put = 0;
+    kept = 0;
+    putSecs = 0;
+    drainSecs = 0;
+    HostShim_ResetStats();
+    for (i = 0; i < bursts; i++)
+    {
+        if ((i % 4) == 0)
+            HostShim_AdvanceSeconds(1);
+        t0 = Bench_Now();
+        for (j = 0; j < BENCH_RING_BURST; j++, put++)
+            kept += LogRing_Put(&ring, sMessages[put % BENCH_MSG_VARIANTS]) ? 1 : 0;
+        putSecs += Bench_Now() - t0;
+        st = HostShim_GetStats();
+        if (HostShim_DmCalls(st) != 0 || st->calls[hostApiMemPtrNew] != 0 ||
+            st->calls[hostApiMemHandleNew] != 0 || st->calls[hostApiEvtWakeup] != 1)
+        {
+            fprintf(stderr, "ring: putting made %lu Dm calls, %lu allocations, %lu wakeups\n",
+                    (unsigned long)HostShim_DmCalls(st),
+                    (unsigned long)(st->calls[hostApiMemPtrNew] + st->calls[hostApiMemHandleNew]),
+                    (unsigned long)st->calls[hostApiEvtWakeup]);
+            return 1;
+        }
+        t0 = Bench_Now();
+        LogRing_Drain(&ring);
+        drainSecs += Bench_Now() - t0;
+        HostShim_ResetStats();
+    }
+    printf("%8lu  %-8s %12.0f lines/sec put, %lu kept, %lu dropped\n", (unsigned long)records,
+           "ring-put", (putSecs > 0) ? (double)put / putSecs : 0.0, (unsigned long)kept,
+           (unsigned long)(put - kept));
+    printf("%8lu  %-8s %12.0f lines/sec drained\n", (unsigned long)records, "ring-drn",
+           (drainSecs > 0) ? (double)kept / drainSecs : 0.0);
+
+    lines = 0;
+    dropped = 0;
+    reported = 0;
+    if (LogDB_IterBegin(&it) == errNone)
+    {
+        while ((h = LogDB_IterNextEntry(&it, &entry)) != NULL)
+        {
+            if (entry.msgLen == StrLen(LOGRING_OVERFLOW_MSG) &&
+                MemCmp(entry.msg, LOGRING_OVERFLOW_MSG, entry.msgLen) == 0)
+            {
+                if (LogDB_FieldFind(&entry, "n", &f))
+                    dropped += f.v.u32;
+                reported++;
+            }
+            else if (LogDB_FieldFind(&entry, "q", &f))
+            {
+                lines++;
+            }
+            LogDB_IterUnlock(h);
+        }
+        LogDB_IterEnd(&it);
+    }
+    if (kept != bursts * LOGRING_SLOTS || lines != kept || dropped != put - kept ||
+        reported != bursts)
+    {
+        fprintf(stderr, "ring: %lu of %lu lines kept and %lu logged, %lu dropped in %lu reports\n",
+                (unsigned long)kept, (unsigned long)put, (unsigned long)lines,
+                (unsigned long)dropped, (unsigned long)reported);
+        return 1;
+    }
+
+    LogDB_ClearAll();
+    return 0;
+}
+
+/* LogDB_GetStats against the shim: over logging, a full read and a
+   clear, the Data Manager calls LogDB counted must be the ones the shim
+   saw, every call counted once and every record's bytes added. Reporting
+   them twice logs one record. */
+static int Bench_StatsCheck(const char *phase, const LogDB_Stats *before, UInt32 calls)
+{
+    LogDB_Stats after;
+    UInt32 dm;
+
+    LogDB_GetStats(&after);
+    dm = HostShim_DmCalls(HostShim_GetStats());
+    if (after.dmCalls - before->dmCalls != dm || after.calls - before->calls != calls ||
+        after.failures != before->failures)
+    {
+        fprintf(stderr, "stats %s: %lu Dm calls counted, %lu made, %lu of %lu calls, %lu failed\n",
+                phase, (unsigned long)(after.dmCalls - before->dmCalls), (unsigned long)dm,
+                (unsigned long)(after.calls - before->calls), (unsigned long)calls,
+                (unsigned long)(after.failures - before->failures));
+        return 1;
+    }
+    return 0;
+}
+
+static int Bench_Stats(UInt32 records)
+{
+    LogDB_Stats before;
+    LogDB_Stats after;
+    LogDB_Entry entry;
+    LogDB_Iter it;
+    MemHandle h;
+    UInt32 minBytes;
+    UInt32 seen;
+    UInt32 i;
+
+    LogDB_GetStats(&before);
+    HostShim_ResetStats();
+    minBytes = 0;
+    for (i = 0; i < records; i++)
+    {
+        if ((i % 16) == 0)
+            HostShim_AdvanceSeconds(1);
+        if (LogDB_Log(sMessages[i % BENCH_MSG_VARIANTS]) != errNone)
+            return 1;
+        minBytes += (UInt32)(strlen(sMessages[i % BENCH_MSG_VARIANTS]) + strlen(BENCH_APP_NAME));
+    }
+    if (Bench_StatsCheck("log", &before, records) != 0)
+        return 1;
+    LogDB_GetStats(&after);
+    if (after.bytes - before.bytes < minBytes)
+    {
+        fprintf(stderr, "stats: %lu bytes for %lu records of at least %lu\n",
+                (unsigned long)(after.bytes - before.bytes), (unsigned long)records,
+                (unsigned long)minBytes);
+        return 1;
+    }
+    printf("%8s  %-8s %lu calls, %.1f bytes and %.2f Dm calls each\n", "", "",
+           (unsigned long)(after.calls - before.calls),
+           (double)(after.bytes - before.bytes) / (double)records,
+           (double)(after.dmCalls - before.dmCalls) / (double)records);
+
+    before = after;
+    HostShim_ResetStats();
+    seen = 0;
+    if (LogDB_IterBegin(&it) == errNone)
+    {
+        while ((h = LogDB_IterNextEntry(&it, &entry)) != NULL)
+        {
+            seen++;
+            LogDB_IterUnlock(h);
+        }
+        LogDB_IterEnd(&it);
+    }
+    if (seen != records || Bench_StatsCheck("iterate", &before, 0) != 0)
+        return 1;
+
+    /* One report is one record; a second with nothing logged between adds
+       none */
+    LogDB_StatsReport();
+    LogDB_StatsReport();
+    seen = Bench_Sum(NULL, &minBytes);
+    if (seen != records + 1)
+    {
+        fprintf(stderr, "stats: %lu records after two reports on %lu\n",
+                (unsigned long)seen, (unsigned long)records);
+        return 1;
+    }
+
+    LogDB_GetStats(&before);
+    HostShim_ResetStats();
+    LogDB_ClearAll();
+    return Bench_StatsCheck("clear", &before, 0);
+}
+
+/* HotSyncs: each of BENCH_SYNCS backs up whatever changed into its own
+   dir/sync-N (HostShim_Backup), after a tenth of its share of records
+   has been logged since the one before; with trim, LogDB_ArchiveTrim then
+   runs as at the next launch. The log rolls a few times between syncs,
+   and the closed segments are packed before every other one. The second
+   sync is not followed by a trim (the app was not run before the next),
+   so the third backs some records up again. A trim must keep every record
+   from after the backup, and leave no other but those of a segment
+   rolled since (it keeps the DB's bckDate, so it goes at the next sync's
+   trim); nothing from before the sync before may be left. With one more
+   sync after the last the dirs together hold every record logged.
+   Reported: the bytes backed up per sync, and the records still on the
+   device at the end. */
+#define BENCH_SYNCS 4
+
+/* dir/sync-N and the backups in it removed again. */
+static void Bench_RemoveBackups(const char *dir)
+{
+    char path[512];
+    char file[1024];
+    struct dirent *de;
+    DIR *d;
+    int n;
+
+    for (n = 1; n <= BENCH_SYNCS + 1; n++)
+    {
+        snprintf(path, sizeof(path), "%s/sync-%d", dir, n);
+        d = opendir(path);
+        if (d == NULL)
+            continue;
+        while ((de = readdir(d)) != NULL)
+        {
+            if (de->d_name[0] == '.')
+                continue;
+            snprintf(file, sizeof(file), "%s/%s", path, de->d_name);
+            remove(file);
+        }
+        closedir(d);
+        rmdir(path);
+    }
+}
+
+static int Bench_Archive(UInt32 records, const char *dir, Boolean trim)
+{
+    LogDB_RollPolicy roll;
+    LogDB_Stats before;
+    LogDB_Entry entry;
+    LogDB_Iter it;
+    MemHandle h;
+    char path[512];
+    UInt32 packed;
+    UInt32 perSync;
+    UInt32 after;
+    UInt32 bckDate;
+    UInt32 prevDate;
+    UInt32 bytes;
+    UInt32 total;
+    UInt32 dropped;
+    UInt32 trimmed;
+    UInt32 kept;
+    UInt32 left;
+    UInt32 fresh;
+    UInt32 stale;
+    UInt32 i;
+    int n;
+    Err err;
+
+    HostShim_Reset();
+    err = LogDB_Init(BENCH_APP_NAME);
+    if (err != errNone)
+    {
+        fprintf(stderr, "LogDB_Init failed: 0x%04x\n", err);
+        return 1;
+    }
+    perSync = records / BENCH_SYNCS;
+    after = perSync / 10;
+    MemSet(&roll, sizeof(roll), 0);
+    roll.maxRecords = (UInt16)(perSync / 3 + 1);
+    LogDB_SetRollPolicy(&roll);
+    total = 0;
+    trimmed = 0;
+    kept = 0;
+    bckDate = 0;
+    for (n = 1; n <= BENCH_SYNCS; n++)
+    {
+        for (i = 0; i < perSync - after; i++)
+        {
+            if ((i % 16) == 0)
+                HostShim_AdvanceSeconds(1);
+            if (LogDB_Log(sMessages[i % BENCH_MSG_VARIANTS]) != errNone)
+                return 1;
+        }
+        while ((n % 2) != 0 && LogDB_Compact(&packed) == errNone && packed > 0)
+            ;
+        HostShim_AdvanceSeconds(1);
+        snprintf(path, sizeof(path), "%s/sync-%d", dir, n);
+        if (mkdir(path, 0700) != 0)
+        {
+            fprintf(stderr, "cannot make %s\n", path);
+            return 1;
+        }
+        HostShim_Backup(path, &bytes);
+        total += bytes;
+        prevDate = bckDate;
+        bckDate = TimGetSeconds();
+
+        /* Logged after the sync, before the app's next launch */
+        for (i = 0; i < after; i++)
+        {
+            if ((i % 16) == 0)
+                HostShim_AdvanceSeconds(1);
+            if (LogDB_Log(sMessages[i % BENCH_MSG_VARIANTS]) != errNone)
+                return 1;
+        }
+        if (!trim || n == 2)
+        {
+            kept += perSync;
+            continue;
+        }
+
+        LogDB_GetStats(&before);
+        HostShim_ResetStats();
+        err = LogDB_ArchiveTrim(&dropped);
+        if (err != errNone || Bench_StatsCheck("trim", &before, 0) != 0)
+        {
+            fprintf(stderr, "LogDB_ArchiveTrim failed: 0x%04x\n", err);
+            return 1;
+        }
+        trimmed += dropped;
+
+        left = 0;
+        fresh = 0;
+        stale = 0;
+        if (LogDB_IterBegin(&it) == errNone)
+        {
+            while ((h = LogDB_IterNextEntry(&it, &entry)) != NULL)
+            {
+                fresh += (entry.seconds >= bckDate) ? 1 : 0;
+                stale += (entry.seconds < prevDate) ? 1 : 0;
+                left++;
+                LogDB_IterUnlock(h);
+            }
+            LogDB_IterEnd(&it);
+        }
+        if (fresh != after || stale != 0 || left - fresh > roll.maxRecords ||
+            trimmed + left != kept + perSync)
+        {
+            fprintf(stderr, "archive: sync %d left %lu records (%lu new, %lu stale), %lu dropped\n",
+                    n, (unsigned long)left, (unsigned long)fresh, (unsigned long)stale,
+                    (unsigned long)trimmed);
+            return 1;
+        }
+        kept = left;
+        trimmed = 0;
+    }
+
+    /* One more sync for the last tail, so the backups hold every record */
+    HostShim_AdvanceSeconds(1);
+    snprintf(path, sizeof(path), "%s/sync-%d", dir, BENCH_SYNCS + 1);
+    if (mkdir(path, 0700) != 0)
+    {
+        fprintf(stderr, "cannot make %s\n", path);
+        return 1;
+    }
+    HostShim_Backup(path, NULL);
+
+    left = 0;
+    if (LogDB_IterBegin(&it) == errNone)
+    {
+        while ((h = LogDB_IterNextEntry(&it, &entry)) != NULL)
+        {
+            left++;
+            LogDB_IterUnlock(h);
+        }
+        LogDB_IterEnd(&it);
+    }
+    printf("%8lu  %-8s %12.0f bytes backed up per sync (%lu records each), %lu left\n",
+           (unsigned long)records, trim ? "bck-trim" : "bck-keep",
+           (double)total / BENCH_SYNCS, (unsigned long)perSync, (unsigned long)left);
+    LogDB_ClearAll();
+    LogDB_SetRollPolicy(NULL);
+    LogDB_Close();
+    return 0;
+}
+
+/* Both ways into a temporary directory. */
+static int Bench_Backups(UInt32 records)
+{
+    char dirTemplate[] = "/tmp/logdb-backup-XXXXXX";
+    const char *dir;
+    int rc;
+
+    dir = mkdtemp(dirTemplate);
+    if (dir == NULL)
+    {
+        fprintf(stderr, "no temporary backup directory; skipping backup phases\n");
+        return 0;
+    }
+    rc = Bench_Archive(records, dir, false);
+    Bench_RemoveBackups(dir);
+    if (rc == 0)
+        rc = Bench_Archive(records, dir, true);
+    Bench_RemoveBackups(dir);
+    rmdir(dir);
+    return rc;
+}
+
+static int Bench_Run(UInt32 records)
+{
+    LogDB_Iter it;
+    MemHandle h;
+    UInt32 secs;
+    Char *app;
+    Char *msg;
+    UInt32 i;
+    UInt32 seen;
+    UInt32 checksum;
+    UInt32 firstSecs;
+    UInt32 lastSecs;
+    double t0;
+    Err err;
+
+    HostShim_Reset();
+    err = LogDB_Init(BENCH_APP_NAME);
+    if (err != errNone)
+    {
+        fprintf(stderr, "LogDB_Init failed: 0x%04x\n", err);
+        return 1;
+    }
+
+    /* Append */
+    HostShim_ResetStats();
+    firstSecs = TimGetSeconds() + 1;
+    t0 = Bench_Now();
+    for (i = 0; i < records; i++)
+    {
+        if ((i % 16) == 0)
+            HostShim_AdvanceSeconds(1);
+        err = LogDB_Log(sMessages[i % BENCH_MSG_VARIANTS]);
+        if (err != errNone)
+        {
+            fprintf(stderr, "LogDB_Log failed at %lu: 0x%04x\n", (unsigned long)i, err);
+            return 1;
+        }
+    }
+    Bench_Report(records, "log", records, Bench_Now() - t0);
+    printf("%8s  %-8s storage in use: %lu bytes (%.1f per record)\n", "", "",
+           (unsigned long)HostShim_GetStats()->storageInUse,
+           (double)HostShim_GetStats()->storageInUse / (double)records);
+
+    /* Full iteration */
+    HostShim_ResetStats();
+    seen = 0;
+    checksum = 0;
+    t0 = Bench_Now();
+    if (LogDB_IterBegin(&it) == errNone)
+    {
+        while ((h = LogDB_IterNext(&it, &secs, &app, &msg)) != NULL)
+        {
+            checksum += secs + (UInt32)app[0] + (UInt32)msg[0];
+            seen++;
+            LogDB_IterUnlock(h);
+        }
+        LogDB_IterEnd(&it);
+    }
+    Bench_Report(records, "iterate", seen, Bench_Now() - t0);
+    if (seen != records)
+    {
+        fprintf(stderr, "iteration saw %lu of %lu records\n",
+                (unsigned long)seen, (unsigned long)records);
+        return 1;
+    }
+
+    /* Newest 10% of the time range (reported per record returned) */
+    lastSecs = TimGetSeconds();
+    HostShim_ResetStats();
+    seen = 0;
+    t0 = Bench_Now();
+    if (LogDB_IterBeginRange(&it, lastSecs - (lastSecs - firstSecs) / 10, lastSecs) == errNone)
+    {
+        while ((h = LogDB_IterNext(&it, &secs, &app, &msg)) != NULL)
+        {
+            checksum += secs;
+            seen++;
+            LogDB_IterUnlock(h);
+        }
+        LogDB_IterEnd(&it);
+    }
+    Bench_Report(records, "recent", seen, Bench_Now() - t0);
+
+    /* Clear (reported per removed record) */
+    HostShim_ResetStats();
+    t0 = Bench_Now();
+    LogDB_ClearAll();
+    Bench_Report(records, "clear", records, Bench_Now() - t0);
+
+    if (Bench_Fields(records) != 0)
+        return 1;
+
+    {
+        LogDB_Site every = LOGDB_SITE_EVERY(16);
+        LogDB_Site random = LOGDB_SITE_RANDOM(16);
+
+        if (Bench_Sampled(records, &every, "smp-1/16") != 0 ||
+            Bench_Sampled(records, &random, "smp-p16") != 0)
+        {
+            fprintf(stderr, "sampled counts do not scale back\n");
+            return 1;
+        }
+    }
+
+    if (records <= dmMaxRecordIndex && Bench_Migrate(records) != 0)
+        return 1;
+    if (Bench_Compact(records) != 0)
+        return 1;
+    if (Bench_Roll() != 0)
+        return 1;
+    if (Bench_Idle(records) != 0)
+        return 1;
+    if (Bench_Search(records) != 0)
+        return 1;
+    if (Bench_Ctx(records) != 0)
+        return 1;
+    if (Bench_Pressure(records) != 0)
+        return 1;
+    if (Bench_Mem(records) != 0)
+        return 1;
+    if (Bench_AppDB(records) != 0)
+        return 1;
+    if (Bench_Ring(records) != 0)
+        return 1;
+    if (Bench_Stats(records) != 0)
+        return 1;
+
+    LogDB_Close();
+    return (checksum == 0) ? 1 : 0;
+}
+
+/* Same appends and a full read back through the card stream sink. */
+static int Bench_RunCard(UInt32 records, const char *cardDir)
+{
+    LogDB_Iter it;
+    MemHandle h;
+    UInt32 secs;
+    Char *app;
+    Char *msg;
+    UInt32 i;
+    UInt32 seen;
+    double t0;
+    Err err;
+
+    HostShim_Reset();
+    HostShim_SetVolumeRoot(cardDir);
+    err = LogDB_InitSinks(BENCH_APP_NAME, LOGDB_SINK_VFS);
+    if (err != errNone)
+    {
+        fprintf(stderr, "LogDB_InitSinks failed: 0x%04x\n", err);
+        return 1;
+    }
+
+    HostShim_ResetStats();
+    t0 = Bench_Now();
+    for (i = 0; i < records; i++)
+    {
+        if ((i % 16) == 0)
+            HostShim_AdvanceSeconds(1);
+        err = LogDB_Log(sMessages[i % BENCH_MSG_VARIANTS]);
+        if (err != errNone)
+        {
+            fprintf(stderr, "LogDB_Log (card) failed at %lu: 0x%04x\n", (unsigned long)i, err);
+            return 1;
+        }
+    }
+    LogDB_Flush();
+    Bench_Report(records, "card-log", records, Bench_Now() - t0);
+
+    HostShim_ResetStats();
+    seen = 0;
+    t0 = Bench_Now();
+    if (LogDB_IterBeginSink(&it, LOGDB_SINK_VFS, 0, 0xFFFFFFFFUL) == errNone)
+    {
+        while ((h = LogDB_IterNext(&it, &secs, &app, &msg)) != NULL)
+        {
+            seen++;
+            LogDB_IterUnlock(h);
+        }
+        LogDB_IterEnd(&it);
+    }
+    Bench_Report(records, "card-it", seen, Bench_Now() - t0);
+    if (seen != records)
+    {
+        fprintf(stderr, "card iteration saw %lu of %lu records\n",
+                (unsigned long)seen, (unsigned long)records);
+        return 1;
+    }
+
+    LogDB_ClearAll();
+    LogDB_Close();
+    HostShim_SetVolumeRoot(NULL);
+    return 0;
+}
+
+/* Temporary card directory with the LogDB folder chain removed again. */
+static void Bench_RemoveCard(const char *cardDir)
+{
+    static const char *kDirs[] = {LOGDB_VFS_DIR, "/PALM/Programs", "/PALM", ""};
+    char path[512];
+    int i;
+
+    snprintf(path, sizeof(path), "%s%s", cardDir, LOGDB_VFS_PATH);
+    remove(path);
+    for (i = 0; i < (int)(sizeof(kDirs) / sizeof(kDirs[0])); i++)
+    {
+        snprintf(path, sizeof(path), "%s%s", cardDir, kDirs[i]);
+        rmdir(path);
+    }
+}
+
+/* Read phases over a DebugLog.pdb from tools/LogGen (or a device's
+   backup): the load itself, a full pass, the newest 10% of its time
+   range, the records of the app the first one came from and a word
+   search. Reported per record returned. */
+static int Bench_Dataset(const char *path)
+{
+    LogDB_Entry entry;
+    LogDB_Iter it;
+    MemHandle h;
+    LocalID dbID;
+    UInt16 numRecs;
+    UInt32 records;
+    UInt32 seen;
+    UInt32 checksum;
+    UInt32 firstSecs;
+    UInt32 lastSecs;
+    char app[32];
+    double t0;
+    Err err;
+
+    HostShim_Reset();
+    HostShim_ResetStats();
+    t0 = Bench_Now();
+    err = HostShim_LoadPDB(path, &dbID);
+    if (err != errNone)
+    {
+        fprintf(stderr, "%s: cannot load (0x%04x)\n", path, err);
+        return 1;
+    }
+    DmDatabaseSize(0, dbID, &records, NULL, NULL);
+    numRecs = (UInt16)records;
+    printf("%8s  %s\n", "", path);
+    Bench_Report(records, "load", records, Bench_Now() - t0);
+
+    err = LogDB_Init(BENCH_APP_NAME);
+    if (err != errNone)
+    {
+        fprintf(stderr, "LogDB_Init failed: 0x%04x\n", err);
+        return 1;
+    }
+
+    /* Full pass; the time range may run backwards where the clock jumped */
+    HostShim_ResetStats();
+    seen = 0;
+    checksum = 0;
+    firstSecs = 0xFFFFFFFFUL;
+    lastSecs = 0;
+    app[0] = 0;
+    t0 = Bench_Now();
+    if (LogDB_IterBegin(&it) == errNone)
+    {
+        while ((h = LogDB_IterNextEntry(&it, &entry)) != NULL)
+        {
+            if (seen == 0)
+                snprintf(app, sizeof(app), "%s", entry.app);
+            if (entry.seconds < firstSecs)
+                firstSecs = entry.seconds;
+            if (entry.seconds > lastSecs)
+                lastSecs = entry.seconds;
+            checksum += entry.seconds + entry.msgLen;
+            seen++;
+            LogDB_IterUnlock(h);
+        }
+        LogDB_IterEnd(&it);
+    }
+    Bench_Report(records, "iterate", seen, Bench_Now() - t0);
+    if (seen != numRecs || checksum == 0)
+    {
+        fprintf(stderr, "%s: iteration saw %lu of %u records\n", path, (unsigned long)seen,
+                numRecs);
+        return 1;
+    }
+
+    HostShim_ResetStats();
+    seen = 0;
+    t0 = Bench_Now();
+    if (LogDB_IterBeginRange(&it, lastSecs - (lastSecs - firstSecs) / 10, lastSecs) == errNone)
+    {
+        while ((h = LogDB_IterNextEntry(&it, &entry)) != NULL)
+        {
+            seen++;
+            LogDB_IterUnlock(h);
+        }
+        LogDB_IterEnd(&it);
+    }
+    Bench_Report(records, "recent", seen, Bench_Now() - t0);
+
+    HostShim_ResetStats();
+    t0 = Bench_Now();
+    seen = Bench_Sum(app, &checksum);
+    Bench_Report(records, "app", seen, Bench_Now() - t0);
+
+    HostShim_ResetStats();
+    seen = 0;
+    t0 = Bench_Now();
+    if (LogDB_IterBegin(&it) == errNone)
+    {
+        LogDB_IterSetText(&it, "timeout");
+        while ((h = LogDB_IterNextEntry(&it, &entry)) != NULL)
+        {
+            seen++;
+            LogDB_IterUnlock(h);
+        }
+        LogDB_IterEnd(&it);
+    }
+    Bench_Report(records, "search", seen, Bench_Now() - t0);
+
+    LogDB_Close();
+    return 0;
+}
+
+static int Bench_RunAll(UInt32 records, const char *cardDir)
+{
+    int rc;
+
+    rc = Bench_Run(records);
+    if (rc == 0)
+        rc = Bench_Backups(records);
+    if (rc == 0 && cardDir != NULL)
+        rc = Bench_RunCard(records, cardDir);
+    return rc;
+}
+
+int main(int argc, char **argv)
+{
+    static const UInt32 kDefaultSizes[] = {1000, 10000, 60000};
+    char cardTemplate[] = "/tmp/logdb-card-XXXXXX";
+    const char *cardDir;
+    int i;
+    int rc;
+
+    cardDir = mkdtemp(cardTemplate);
+    if (cardDir == NULL)
+        fprintf(stderr, "no temporary card directory; skipping card phases\n");
+
+    printf("%8s  %-8s %12s %8s %9s %9s %9s %10s\n",
+           "records", "phase", "ops/sec", "Dm/op", "DmWr/op", "VfsWr/op", "bytes/op", "total ms");
+
+    rc = 0;
+    if (argc > 2 && strcmp(argv[1], "-d") == 0)
+    {
+        for (i = 2; i < argc && rc == 0; i++)
+            rc = Bench_Dataset(argv[i]);
+    }
+    else if (argc == 4 && strcmp(argv[1], "-b") == 0)
+    {
+        rc = Bench_Archive((UInt32)strtoul(argv[3], NULL, 10), argv[2], true);
+    }
+    else if (argc > 1)
+    {
+        for (i = 1; i < argc && rc == 0; i++)
+            rc = Bench_RunAll((UInt32)strtoul(argv[i], NULL, 10), cardDir);
+    }
+    else
+    {
+        for (i = 0; i < (int)(sizeof(kDefaultSizes) / sizeof(kDefaultSizes[0])) && rc == 0; i++)
+            rc = Bench_RunAll(kDefaultSizes[i], cardDir);
+    }
+
+    if (cardDir != NULL)
+        Bench_RemoveCard(cardDir);
+    return rc;
+}
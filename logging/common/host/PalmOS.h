@@ -0,0 +1,184 @@
+#ifndef HOST_PALMOS_H
+#define HOST_PALMOS_H
+
+/*
+    Host stand-in for <PalmOS.h>.
+
+    Only the slice of the Palm OS 4 API that the common/ sources use is
+    declared here. Types, constants and error codes mirror the SDK so the
+    sources compile unchanged; behaviour lives in HostShim.c.
+*/
+
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* --- Core types --- */
+
+typedef int8_t Int8;
+typedef uint8_t UInt8;
+typedef int16_t Int16;
+typedef uint16_t UInt16;
+typedef int32_t Int32;
+typedef uint32_t UInt32;
+typedef char Char;
+typedef unsigned char Boolean;
+typedef UInt16 Err;
+typedef UInt32 LocalID;
+
+typedef void *MemPtr;
+typedef struct HostChunkTag *MemHandle;
+typedef struct HostOpenDBTag *DmOpenRef;
+
+#ifndef true
+#define true 1
+#endif
+#ifndef false
+#define false 0
+#endif
+
+#ifndef NULL
+#define NULL ((void *)0)
+#endif
+
+#define OffsetOf(type, member) ((UInt32)offsetof(type, member))
+
+/* --- Error codes --- */
+
+#define errNone 0x0000
+
+#define memErrorClass 0x0100
+#define dmErrorClass 0x0200
+#define ftrErrorClass 0x0C00
+#define expErrorClass 0x2900
+#define vfsErrorClass 0x2A00
+
+#define memErrChunkLocked (memErrorClass | 1)
+#define memErrNotEnoughSpace (memErrorClass | 2)
+#define memErrInvalidParam (memErrorClass | 3)
+
+#define dmErrMemError (dmErrorClass | 1)
+#define dmErrIndexOutOfRange (dmErrorClass | 2)
+#define dmErrInvalidParam (dmErrorClass | 3)
+#define dmErrReadOnly (dmErrorClass | 4)
+#define dmErrDatabaseOpen (dmErrorClass | 5)
+#define dmErrCantOpen (dmErrorClass | 6)
+#define dmErrCantFind (dmErrorClass | 7)
+#define dmErrNotValidRecord (dmErrorClass | 19)
+#define dmErrWriteOutOfBounds (dmErrorClass | 20)
+#define dmErrCorruptDatabase (dmErrorClass | 22)
+#define dmErrAlreadyExists (dmErrorClass | 25)
+
+#define ftrErrNoSuchFeature (ftrErrorClass | 2)
+
+#define expErrCardNotPresent (expErrorClass | 3)
+
+/* --- Data Manager constants --- */
+
+#define dmDBNameLength 32
+#define dmMaxRecordIndex ((UInt16)0xFFFF)
+
+#define dmModeReadOnly 0x0001
+#define dmModeWrite 0x0002
+#define dmModeReadWrite 0x0003
+#define dmModeLeaveOpen 0x0004
+#define dmModeExclusive 0x0008
+#define dmModeShowSecret 0x0010
+
+#define dmHdrAttrResDB 0x0001
+#define dmHdrAttrReadOnly 0x0002
+#define dmHdrAttrAppInfoDirty 0x0004
+#define dmHdrAttrBackup 0x0008
+#define dmHdrAttrOKToInstallNewer 0x0010
+#define dmHdrAttrResetAfterInstall 0x0020
+#define dmHdrAttrCopyPrevention 0x0040
+#define dmHdrAttrStream 0x0080
+#define dmHdrAttrHidden 0x0100
+#define dmHdrAttrOpen 0x8000
+
+typedef struct
+{
+    UInt32 info[8];
+} DmSearchStateType;
+typedef DmSearchStateType *DmSearchStatePtr;
+
+/* --- Memory Manager --- */
+
+MemPtr MemPtrNew(UInt32 size);
+Err MemPtrFree(MemPtr p);
+MemHandle MemHandleNew(UInt32 size);
+Err MemHandleFree(MemHandle h);
+MemPtr MemHandleLock(MemHandle h);
+Err MemHandleUnlock(MemHandle h);
+UInt32 MemHandleSize(MemHandle h);
+Err MemPtrUnlock(MemPtr p);
+LocalID MemHandleToLocalID(MemHandle h);
+MemPtr MemLocalIDToLockedPtr(LocalID local, UInt16 cardNo);
+MemPtr MemLocalIDToGlobal(LocalID local, UInt16 cardNo);
+Err MemMove(void *dstP, const void *sP, Int32 numBytes);
+Err MemSet(void *dstP, Int32 numBytes, UInt8 value);
+Int16 MemCmp(const void *s1, const void *s2, Int32 numBytes);
+UInt16 MemHeapID(UInt16 cardNo, UInt16 heapIndex);
+Err MemHeapFreeBytes(UInt16 heapID, UInt32 *freeP, UInt32 *maxP);
+
+/* --- Data Manager --- */
+
+Err DmCreateDatabase(UInt16 cardNo, const Char *nameP, UInt32 creator, UInt32 type,
+                     Boolean resDB);
+LocalID DmFindDatabase(UInt16 cardNo, const Char *nameP);
+Err DmDeleteDatabase(UInt16 cardNo, LocalID dbID);
+Err DmGetLastErr(void);
+Err DmGetNextDatabaseByTypeCreator(Boolean newSearch, DmSearchStatePtr stateInfoP,
+                                   UInt32 type, UInt32 creator, Boolean onlyLatestVers,
+                                   UInt16 *cardNoP, LocalID *dbIDP);
+Err DmDatabaseSize(UInt16 cardNo, LocalID dbID, UInt32 *numRecordsP, UInt32 *totalBytesP,
+                   UInt32 *dataBytesP);
+
+Err DmDatabaseInfo(UInt16 cardNo, LocalID dbID, Char *nameP, UInt16 *attributesP,
+                   UInt16 *versionP, UInt32 *crDateP, UInt32 *modDateP, UInt32 *bckUpDateP,
+                   UInt32 *modNumP, LocalID *appInfoIDP, LocalID *sortInfoIDP,
+                   UInt32 *typeP, UInt32 *creatorP);
+Err DmSetDatabaseInfo(UInt16 cardNo, LocalID dbID, const Char *nameP, UInt16 *attributesP,
+                      UInt16 *versionP, UInt32 *crDateP, UInt32 *modDateP, UInt32 *bckUpDateP,
+                      UInt32 *modNumP, LocalID *appInfoIDP, LocalID *sortInfoIDP,
+                      UInt32 *typeP, UInt32 *creatorP);
+
+DmOpenRef DmOpenDatabase(UInt16 cardNo, LocalID dbID, UInt16 mode);
+DmOpenRef DmOpenDatabaseByTypeCreator(UInt32 type, UInt32 creator, UInt16 mode);
+Err DmCloseDatabase(DmOpenRef dbP);
+Err DmOpenDatabaseInfo(DmOpenRef dbP, LocalID *dbIDP, UInt16 *openCountP, UInt16 *modeP,
+                       UInt16 *cardNoP, Boolean *resDBP);
+
+UInt16 DmNumRecords(DmOpenRef dbP);
+MemHandle DmNewRecord(DmOpenRef dbP, UInt16 *atP, UInt32 size);
+MemHandle DmQueryRecord(DmOpenRef dbP, UInt16 index);
+MemHandle DmGetRecord(DmOpenRef dbP, UInt16 index);
+Err DmReleaseRecord(DmOpenRef dbP, UInt16 index, Boolean dirty);
+Err DmRemoveRecord(DmOpenRef dbP, UInt16 index);
+MemHandle DmResizeRecord(DmOpenRef dbP, UInt16 index, UInt32 newSize);
+Err DmWrite(void *recordP, UInt32 offset, const void *srcP, UInt32 bytes);
+Err DmSet(void *recordP, UInt32 offset, UInt32 bytes, UInt8 value);
+MemHandle DmNewHandle(DmOpenRef dbP, UInt32 size);
+
+/* --- Feature Manager --- */
+
+Err FtrGet(UInt32 creator, UInt16 featureNum, UInt32 *valueP);
+
+/* --- String Manager --- */
+
+Int16 StrLen(const Char *src);
+Char *StrCopy(Char *dst, const Char *src);
+Int16 StrCompare(const Char *s1, const Char *s2);
+Int16 StrPrintF(Char *s, const Char *formatStr, ...);
+
+/* --- Time Manager --- */
+
+UInt32 TimGetSeconds(void);
+UInt32 TimGetTicks(void);
+UInt16 SysTicksPerSecond(void);
+
+/* --- Event Manager --- */
+
+void EvtWakeup(void);
+
+#endif /* HOST_PALMOS_H */
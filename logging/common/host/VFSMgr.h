@@ -0,0 +1,55 @@
+#ifndef HOST_VFSMGR_H
+#define HOST_VFSMGR_H
+
+/*
+    Host stand-in for <VFSMgr.h>.
+
+    Volume 1 is a directory on the host (HostShim_SetVolumeRoot); without
+    one there is no card and VFSVolumeEnumerate finds nothing.
+*/
+
+#include <PalmOS.h>
+
+typedef UInt32 FileRef;
+typedef UInt16 FileOrigin;
+
+#define sysFileCVFSMgr 'vfsm'
+#define vfsFtrIDVersion 0
+
+#define vfsIteratorStart 0L
+#define vfsIteratorStop 0xFFFFFFFFL
+
+#define vfsModeExclusive 0x0001
+#define vfsModeRead 0x0002
+#define vfsModeWrite (0x0004 | vfsModeExclusive)
+#define vfsModeReadWrite (vfsModeWrite | vfsModeRead)
+#define vfsModeCreate 0x0008
+#define vfsModeTruncate 0x0010
+
+#define vfsOriginBeginning 0
+#define vfsOriginCurrent 1
+#define vfsOriginEnd 2
+
+#define vfsErrFileGeneric (vfsErrorClass | 1)
+#define vfsErrFileBadRef (vfsErrorClass | 2)
+#define vfsErrFileStillOpen (vfsErrorClass | 3)
+#define vfsErrFilePermissionDenied (vfsErrorClass | 4)
+#define vfsErrFileAlreadyExists (vfsErrorClass | 5)
+#define vfsErrFileEOF (vfsErrorClass | 6)
+#define vfsErrFileNotFound (vfsErrorClass | 7)
+#define vfsErrVolumeBadRef (vfsErrorClass | 8)
+#define vfsErrBadName (vfsErrorClass | 14)
+
+Err VFSVolumeEnumerate(UInt16 *volRefNumP, UInt32 *volIteratorP);
+Err VFSFileOpen(UInt16 volRefNum, const Char *pathNameP, UInt16 openMode, FileRef *fileRefP);
+Err VFSFileClose(FileRef fileRef);
+Err VFSFileRead(FileRef fileRef, UInt32 numBytes, void *bufP, UInt32 *numBytesReadP);
+Err VFSFileWrite(FileRef fileRef, UInt32 numBytes, const void *dataP,
+                 UInt32 *numBytesWrittenP);
+Err VFSFileSeek(FileRef fileRef, FileOrigin origin, Int32 offset);
+Err VFSFileTell(FileRef fileRef, UInt32 *filePosP);
+Err VFSFileSize(FileRef fileRef, UInt32 *fileSizeP);
+Err VFSFileDelete(UInt16 volRefNum, const Char *pathNameP);
+Err VFSDirCreate(UInt16 volRefNum, const Char *dirNameP);
+
+#endif /* HOST_VFSMGR_H */
@@ -0,0 +1,187 @@
+/*
+    Archive-and-trim after a HotSync backup (see LogDB_ArchiveTrim in
+    LogDB.h).
+
+    HotSync stamps each DB it backs up with bckDate, so whatever in a DB
+    is older than its bckDate is in the desktop's copy. A closed segment
+    is all or nothing: once its newest record is older, it is deleted. A
+    segment rolled from an active DB keeps that DB's bckDate, so one that
+    still holds records from after that backup stays until its own backup.
+
+    The active DB is rolled into a segment, the records from after the
+    backup are copied back into the fresh active DB, and the segment is
+    deleted. The records to keep are the newest, so they are few right
+    after a sync, and nothing is removed from the front of a DB (each
+    removal there shifts the whole index). A reset part way through
+    leaves a segment still holding everything, and at worst a few copied
+    records twice.
+*/
+
+#include "LogDBPriv.h"
+
+/* bckDate of dbID, 0 if it was never backed up */
+static UInt32 LogArchive_BackupDate(LocalID dbID, UInt32 *dmP)
+{
+    UInt32 bckDate;
+
+    bckDate = 0;
+    LOGDB_DM(*dmP, DmDatabaseInfo(0, dbID, NULL, NULL, NULL, NULL, NULL, &bckDate, NULL, NULL,
+                                  NULL, NULL, NULL));
+    return bckDate;
+}
+
+/* Closed segments wholly older than their own backup. */
+static Err LogArchive_Segments(LogDB_Globals *g, UInt32 *droppedP)
+{
+    LocalID ids[LOGDB_MAX_SEGMENTS];
+    UInt16 seqs[LOGDB_MAX_SEGMENTS];
+    LogDB_SegInfo info;
+    UInt32 bckDate;
+    UInt16 n;
+    UInt16 i;
+    Err err;
+
+    n = LogSeg_List(ids, seqs, LOGDB_MAX_SEGMENTS, 0, 0xFFFFFFFFUL, NULL, NULL,
+                    &g->stats.dmCalls);
+    for (i = 0; i < n; i++)
+    {
+        bckDate = LogArchive_BackupDate(ids[i], &g->stats.dmCalls);
+        if (bckDate == 0 || !LogSeg_ReadInfo(ids[i], &info, &g->stats.dmCalls) ||
+            info.lastSecs >= bckDate)
+            continue;
+
+        /* Its unsealed copy, if packing was at it, is LogPack's to drop */
+        if (ids[i] == g->packSegID)
+            g->packSegID = 0;
+        err = LOGDB_DMG(g, DmDeleteDatabase(0, ids[i]));
+        if (err != errNone)
+            return err;
+        *droppedP += info.records;
+    }
+    return errNone;
+}
+
+/* Index of the first record of dbR that is bckDate or newer, looking
+   back from the end (the records to keep are the few newest). */
+static UInt16 LogArchive_Split(DmOpenRef dbR, UInt32 bckDate, UInt32 *dmP)
+{
+    MemHandle h;
+    UInt16 i;
+    UInt32 secs;
+
+    i = LOGDB_DM(*dmP, DmNumRecords(dbR));
+    while (i > 0)
+    {
+        h = LOGDB_DM(*dmP, DmQueryRecord(dbR, i - 1));
+        if (h == NULL)
+            break;
+        secs = LogDB_RecSeconds((const UInt8 *)MemHandleLock(h));
+        MemHandleUnlock(h);
+        if (secs < bckDate)
+            break;
+        i--;
+    }
+    return i;
+}
+
+/* Append record i of src to the active DB as it is, as LogSinkDB_Write
+   would account for it. */
+static Err LogArchive_CopyBack(LogDB_Globals *g, DmOpenRef src, UInt16 i)
+{
+    LogDB_Entry entry;
+    MemHandle srcH;
+    MemHandle h;
+    const UInt8 *p;
+    UInt32 size;
+    UInt16 index;
+
+    srcH = LOGDB_DMG(g, DmQueryRecord(src, i));
+    if (srcH == NULL)
+        return errNone;
+    p = (const UInt8 *)MemHandleLock(srcH);
+    size = MemHandleSize(srcH);
+
+    index = dmMaxRecordIndex;
+    h = LOGDB_DMG(g, DmNewRecord(g->dbR, &index, size));
+    if (h == NULL)
+    {
+        MemHandleUnlock(srcH);
+        return dmErrMemError;
+    }
+    LOGDB_DMG(g, DmWrite(MemHandleLock(h), 0, p, size));
+    MemHandleUnlock(h);
+    LOGDB_DMG(g, DmReleaseRecord(g->dbR, index, true));
+
+    LogSeg_Appended(g, LogDB_RecSeconds(p), size);
+    if (LogDB_RecDecode(p, size, &entry))
+        LogBloom_Add(g, index, entry.msg, entry.msgLen);
+    MemHandleUnlock(srcH);
+    return errNone;
+}
+
+/* The active DB's records from before its backup. */
+static Err LogArchive_Active(LogDB_Globals *g, UInt32 *droppedP)
+{
+    DmOpenRef segR;
+    LocalID segID;
+    UInt32 bckDate;
+    UInt16 split;
+    UInt16 n;
+    UInt16 i;
+    Err err;
+
+    if (g->dbR == NULL)
+    {
+        err = LogDB_OpenOrCreate(g);
+        if (err != errNone)
+            return err;
+    }
+    bckDate = LogArchive_BackupDate(g->dbID, &g->stats.dmCalls);
+    if (bckDate == 0 || g->activeCount == 0 || g->activeFirstSecs >= bckDate)
+        return errNone;
+    split = LogArchive_Split(g->dbR, bckDate, &g->stats.dmCalls);
+    if (split == 0)
+        return errNone;
+
+    /* The whole DB becomes the newest segment */
+    segID = g->dbID;
+    err = LogSeg_Roll(g);
+    if (err != errNone)
+        return err;
+    if (g->dbR == NULL)
+        return dmErrCantOpen;
+
+    segR = LOGDB_DMG(g, DmOpenDatabase(0, segID, dmModeReadOnly));
+    if (segR == NULL)
+        return dmErrCantOpen;
+    n = LOGDB_DMG(g, DmNumRecords(segR));
+    err = errNone;
+    for (i = split; i < n && err == errNone; i++)
+        err = LogArchive_CopyBack(g, segR, i);
+    LOGDB_DMG(g, DmCloseDatabase(segR));
+
+    /* Out of room: the segment keeps them all, and the copies double up
+       only the newest few */
+    if (err != errNone)
+        return err;
+    if (segID == g->packSegID)
+        g->packSegID = 0;
+    err = LOGDB_DMG(g, DmDeleteDatabase(0, segID));
+    if (err == errNone)
+        *droppedP += split;
+    return err;
+}
+
+Err LogDB_ArchiveTrimG(LogDB_Globals *g, UInt32 *droppedP)
+{
+    UInt32 dropped;
+    Err err;
+
+    dropped = 0;
+    err = LogArchive_Segments(g, &dropped);
+    if (err == errNone)
+        err = LogArchive_Active(g, &dropped);
+    if (droppedP != NULL)
+        *droppedP = dropped;
+    return err;
+}
@@ -0,0 +1,424 @@
+/*
+    Word filters for message search (see LogDB_IterSetText).
+
+    The active DB's SortInfo block holds one Bloom filter per run of
+    LOGDB_BLOOM_RUN records. It is made on the first append, sized for the
+    roll policy's record count, and goes along when the DB is rolled into
+    a segment, so every closed segment keeps the filters of its records.
+    Nothing else in the DB changes: record indices, counts and readers
+    that do not search are as before.
+
+    A word is a run of ASCII letters and digits, folded to lower case and
+    hashed with FNV-1a; its LOGDB_BLOOM_K bits come from that hash by
+    double hashing. Words of digits alone (counts, IDs) differ from record
+    to record and would fill a filter up, so they are matched but not
+    filtered on.
+
+    The writer keeps the current run's filter in g->bloomBits and writes
+    only the bytes a record changes; once a run's vocabulary has been
+    seen, most appends write nothing. The bytes written are ORed with
+    what is in the block first, so another writer's words are never lost:
+    a LogDB_Ctx (LogCtx.c) sets its records' bits straight in the block.
+*/
+
+#include "LogDBPriv.h"
+
+#define LOGBLOOM_BITS (LOGDB_BLOOM_BYTES * 8)
+
+static Char LogBloom_Lower(Char c)
+{
+    return (c >= 'A' && c <= 'Z') ? (Char)(c + ('a' - 'A')) : c;
+}
+
+static Boolean LogBloom_IsWordChar(Char c)
+{
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9');
+}
+
+/* Next word of s[0..len) from *posP on: its length (0 when there are no
+   more), its start in *startP and whether it has a letter in *letterP. */
+static UInt16 LogBloom_NextWord(const Char *s, UInt16 len, UInt16 *posP, UInt16 *startP,
+                                Boolean *letterP)
+{
+    UInt16 pos;
+
+    pos = *posP;
+    while (pos < len && !LogBloom_IsWordChar(s[pos]))
+        pos++;
+    *startP = pos;
+    *letterP = false;
+    while (pos < len && LogBloom_IsWordChar(s[pos]))
+    {
+        if (s[pos] > '9')
+            *letterP = true;
+        pos++;
+    }
+    *posP = pos;
+    return (UInt16)(pos - *startP);
+}
+
+static UInt32 LogBloom_Hash(const Char *w, UInt16 len)
+{
+    UInt32 h;
+    UInt16 i;
+
+    h = 2166136261UL;
+    for (i = 0; i < len; i++)
+    {
+        h ^= (UInt8)LogBloom_Lower(w[i]);
+        h *= 16777619UL;
+    }
+    return h;
+}
+
+/* The word's bits: the low bits of the hash, stepping by its high ones. */
+static void LogBloom_Bits(UInt32 h, UInt16 *bits)
+{
+    UInt32 step;
+    UInt16 i;
+
+    step = (h >> 16) | 1;
+    for (i = 0; i < LOGDB_BLOOM_K; i++)
+    {
+        bits[i] = (UInt16)(h & (LOGBLOOM_BITS - 1));
+        h += step;
+    }
+}
+
+static UInt32 LogBloom_Offset(UInt16 run)
+{
+    return sizeof(LogDB_BloomInfo) + (UInt32)run * LOGDB_BLOOM_BYTES;
+}
+
+/* --- Writing --- */
+
+void LogBloom_Load(LogDB_Globals *g)
+{
+    LocalID sortInfoID;
+    LogDB_BloomInfo *p;
+
+    g->bloomID = 0;
+    g->bloomOff = false;
+    g->bloomRun = LOGBLOOM_NO_RUN;
+    if (g->dbR == NULL || g->dbID == 0)
+        return;
+
+    sortInfoID = 0;
+    LOGDB_DMG(g, DmDatabaseInfo(0, g->dbID, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL,
+                                &sortInfoID, NULL, NULL));
+    if (sortInfoID == 0)
+        return;
+
+    /* Someone else's block is left alone, and no filters are kept */
+    p = (LogDB_BloomInfo *)MemLocalIDToLockedPtr(sortInfoID, 0);
+    if (p != NULL && p->version == LOGDB_BLOOM_VERSION)
+    {
+        g->bloomID = sortInfoID;
+        g->bloomRuns = p->runs;
+        g->bloomFrom = p->fromRun;
+    }
+    else
+    {
+        g->bloomOff = true;
+    }
+    if (p != NULL)
+        MemPtrUnlock(p);
+}
+
+/* The block for a DB whose next record is index, all filters empty. Runs
+   the DB already has records in get none: their words were never seen
+   (and not all of them were ours to count). */
+static Boolean LogBloom_Create(LogDB_Globals *g, UInt16 index)
+{
+    LogDB_BloomInfo info;
+    MemHandle h;
+    UInt8 *p;
+    UInt32 records;
+    UInt32 size;
+    LocalID sortInfoID;
+
+    records = (g->roll.maxRecords != 0) ? g->roll.maxRecords : LOGDB_ROLL_DEFAULT_RECORDS;
+    MemSet(&info, sizeof(info), 0);
+    info.version = LOGDB_BLOOM_VERSION;
+    info.runs = (UInt16)((records + LOGDB_BLOOM_RUN - 1) / LOGDB_BLOOM_RUN);
+    info.fromRun = (UInt16)(((UInt32)index + LOGDB_BLOOM_RUN - 1) / LOGDB_BLOOM_RUN);
+    size = LogBloom_Offset(info.runs);
+
+    h = LOGDB_DMG(g, DmNewHandle(g->dbR, size));
+    if (h == NULL)
+        return false;
+    p = (UInt8 *)MemHandleLock(h);
+    LOGDB_DMG(g, DmSet(p, 0, size, 0));
+    LOGDB_DMG(g, DmWrite(p, 0, &info, sizeof(info)));
+    MemHandleUnlock(h);
+
+    sortInfoID = MemHandleToLocalID(h);
+    if (LOGDB_DMG(g, DmSetDatabaseInfo(0, g->dbID, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL,
+                                       &sortInfoID, NULL, NULL)) != errNone)
+    {
+        MemHandleFree(h);
+        return false;
+    }
+    g->bloomID = sortInfoID;
+    g->bloomRuns = info.runs;
+    g->bloomFrom = info.fromRun;
+    return true;
+}
+
+/* Sets the bits of msg's words in filter; the first and last byte that
+   changed go in *loP and *hiP (*loP > *hiP when none did). */
+static void LogBloom_Set(UInt8 *filter, const Char *msg, UInt16 msgLen, UInt16 *loP,
+                         UInt16 *hiP)
+{
+    UInt16 bits[LOGDB_BLOOM_K];
+    UInt16 pos;
+    UInt16 start;
+    UInt16 len;
+    UInt16 byte;
+    UInt16 i;
+    UInt8 mask;
+    Boolean letter;
+
+    *loP = LOGDB_BLOOM_BYTES;
+    *hiP = 0;
+    pos = 0;
+    while ((len = LogBloom_NextWord(msg, msgLen, &pos, &start, &letter)) > 0)
+    {
+        if (!letter)
+            continue;
+        LogBloom_Bits(LogBloom_Hash(msg + start, len), bits);
+        for (i = 0; i < LOGDB_BLOOM_K; i++)
+        {
+            byte = (UInt16)(bits[i] >> 3);
+            mask = (UInt8)(1 << (bits[i] & 7));
+            if (filter[byte] & mask)
+                continue;
+            filter[byte] |= mask;
+            if (byte < *loP)
+                *loP = byte;
+            if (byte > *hiP)
+                *hiP = byte;
+        }
+    }
+}
+
+void LogBloom_Add(LogDB_Globals *g, UInt16 index, const Char *msg, UInt16 msgLen)
+{
+    UInt8 *p;
+    UInt32 off;
+    UInt16 run;
+    UInt16 lo;
+    UInt16 hi;
+    UInt16 i;
+
+    if (g->bloomOff)
+        return;
+    if (g->bloomID == 0 && !LogBloom_Create(g, index))
+    {
+        g->bloomOff = true; /* until the next DB; its readers scan it all */
+        return;
+    }
+    run = (UInt16)(index / LOGDB_BLOOM_RUN);
+    if (run < g->bloomFrom || run >= g->bloomRuns)
+        return;
+
+    if (run != g->bloomRun)
+    {
+        p = (UInt8 *)MemLocalIDToLockedPtr(g->bloomID, 0);
+        if (p == NULL)
+            return;
+        MemMove(g->bloomBits, p + LogBloom_Offset(run), LOGDB_BLOOM_BYTES);
+        MemPtrUnlock(p);
+        g->bloomRun = run;
+    }
+
+    LogBloom_Set(g->bloomBits, msg, msgLen, &lo, &hi);
+    if (lo > hi)
+        return;
+
+    p = (UInt8 *)MemLocalIDToLockedPtr(g->bloomID, 0);
+    if (p == NULL)
+        return;
+    off = LogBloom_Offset(run);
+    for (i = lo; i <= hi; i++)
+        g->bloomBits[i] |= p[off + i];
+    LOGDB_DMG(g, DmWrite(p, off + lo, g->bloomBits + lo, (UInt32)(hi - lo + 1)));
+    MemPtrUnlock(p);
+}
+
+/* Without a writer's cache the run's filter is read every time; a few
+   lines from a sub-launch do not need better. The block is not made
+   here: whoever makes it leaves this record's run unfiltered. */
+void LogBloom_AddTo(LocalID dbID, UInt16 index, const Char *msg, UInt16 msgLen, UInt32 *dmP)
+{
+    UInt8 filter[LOGDB_BLOOM_BYTES];
+    const LogDB_BloomInfo *info;
+    LocalID sortInfoID;
+    UInt8 *p;
+    UInt32 off;
+    UInt16 run;
+    UInt16 lo;
+    UInt16 hi;
+
+    sortInfoID = 0;
+    LOGDB_DM(*dmP, DmDatabaseInfo(0, dbID, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL,
+                                  &sortInfoID, NULL, NULL));
+    if (sortInfoID == 0)
+        return;
+    p = (UInt8 *)MemLocalIDToLockedPtr(sortInfoID, 0);
+    if (p == NULL)
+        return;
+
+    info = (const LogDB_BloomInfo *)p;
+    run = (UInt16)(index / LOGDB_BLOOM_RUN);
+    if (info->version == LOGDB_BLOOM_VERSION && run >= info->fromRun && run < info->runs)
+    {
+        off = LogBloom_Offset(run);
+        MemMove(filter, p + off, LOGDB_BLOOM_BYTES);
+        LogBloom_Set(filter, msg, msgLen, &lo, &hi);
+        if (lo <= hi)
+            LOGDB_DM(*dmP, DmWrite(p, off + lo, filter + lo, (UInt32)(hi - lo + 1)));
+    }
+    MemPtrUnlock(p);
+}
+
+/* --- Reading --- */
+
+void LogDB_IterSetText(LogDB_Iter *it, const Char *text)
+{
+    UInt16 textLen;
+    UInt16 pos;
+    UInt16 start;
+    UInt16 len;
+    UInt16 out;
+    UInt16 i;
+    Boolean letter;
+
+    if (it == NULL)
+        return;
+    it->textWords = 0;
+    it->textHashed = 0;
+    if (text == NULL)
+        return;
+
+    textLen = (UInt16)StrLen(text);
+    out = 0;
+    pos = 0;
+    while (it->textWords < LOGDB_TEXT_WORDS &&
+           (len = LogBloom_NextWord(text, textLen, &pos, &start, &letter)) > 0)
+    {
+        /* One that does not fit is dropped, not cut (that would be
+           another word) */
+        if (out + len + 1 > sizeof(it->text))
+            continue;
+        for (i = 0; i < len; i++)
+            it->text[out + i] = LogBloom_Lower(text[start + i]);
+        it->text[out + len] = 0;
+        out = (UInt16)(out + len + 1);
+        if (letter)
+            it->textHash[it->textHashed++] = LogBloom_Hash(text + start, len);
+        it->textWords++;
+    }
+}
+
+void LogBloom_IterOpen(LogDB_Iter *it, LocalID dbID)
+{
+    LocalID sortInfoID;
+    const LogDB_BloomInfo *p;
+
+    LogBloom_IterClose(it);
+    if (it->textHashed == 0)
+        return;
+    sortInfoID = 0;
+    LOGDB_DM(it->dmCalls, DmDatabaseInfo(0, dbID, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL,
+                                         &sortInfoID, NULL, NULL));
+    if (sortInfoID == 0)
+        return;
+    p = (const LogDB_BloomInfo *)MemLocalIDToLockedPtr(sortInfoID, 0);
+    if (p == NULL)
+        return;
+    if (p->version != LOGDB_BLOOM_VERSION)
+    {
+        MemPtrUnlock((MemPtr)p);
+        return;
+    }
+    it->bloomP = (const UInt8 *)p;
+    it->bloomRuns = p->runs;
+    it->bloomFrom = p->fromRun;
+}
+
+void LogBloom_IterClose(LogDB_Iter *it)
+{
+    if (it->bloomP != NULL)
+        MemPtrUnlock((MemPtr)it->bloomP);
+    it->bloomP = NULL;
+}
+
+Boolean LogBloom_IterRun(LogDB_Iter *it)
+{
+    const UInt8 *filter;
+    UInt16 bits[LOGDB_BLOOM_K];
+    UInt16 run;
+    UInt16 w;
+    UInt16 i;
+    UInt32 next;
+
+    run = (UInt16)(it->index / LOGDB_BLOOM_RUN);
+    if (it->bloomP != NULL && run >= it->bloomFrom && run < it->bloomRuns)
+    {
+        filter = it->bloomP + LogBloom_Offset(run);
+        for (w = 0; w < it->textHashed; w++)
+        {
+            LogBloom_Bits(it->textHash[w], bits);
+            for (i = 0; i < LOGDB_BLOOM_K; i++)
+            {
+                if ((filter[bits[i] >> 3] & (1 << (bits[i] & 7))) == 0)
+                    break;
+            }
+            if (i < LOGDB_BLOOM_K)
+            {
+                /* Not a record of the run has this word */
+                next = (UInt32)(run + 1) * LOGDB_BLOOM_RUN;
+                it->index = (next < it->count) ? (UInt16)next : it->count;
+                it->runsSkipped++;
+                return false;
+            }
+        }
+    }
+    it->runsRead++;
+    return true;
+}
+
+Boolean LogBloom_Matches(const LogDB_Iter *it, const LogDB_Entry *entry)
+{
+    const Char *w;
+    UInt16 wordLen;
+    UInt16 pos;
+    UInt16 start;
+    UInt16 len;
+    UInt16 n;
+    UInt16 i;
+    Boolean letter;
+    Boolean found;
+
+    w = it->text;
+    for (n = 0; n < it->textWords; n++)
+    {
+        wordLen = (UInt16)StrLen(w);
+        found = false;
+        pos = 0;
+        while (!found && (len = LogBloom_NextWord(entry->msg, entry->msgLen, &pos, &start,
+                                                  &letter)) > 0)
+        {
+            if (len != wordLen)
+                continue;
+            for (i = 0; i < len && LogBloom_Lower(entry->msg[start + i]) == w[i]; i++)
+                ;
+            found = (i == len);
+        }
+        if (!found)
+            return false;
+        w += wordLen + 1;
+    }
+    return true;
+}
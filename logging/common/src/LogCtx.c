@@ -0,0 +1,83 @@
+/*
+    Logging without globals (see LogDB_Ctx in LogDB.h).
+
+    Launch codes other than a normal launch may run with no access to the
+    app's globals, so nothing here touches LogDB_Globals or file-scope
+    state: the context is all there is. A session opens the active DB
+    (by type and creator, creating it if need be), appends a record per
+    line through the same code as the DB sink and closes it again.
+
+    An app's writer that is open at the same time (the shared library's,
+    kept open between launches) notices the records by their index and
+    recounts the DB, so its roll policy still sees them.
+
+    With no pressure tier to remember, each line reads the storage heap's
+    free bytes and is refused below the default LOGDB_PRESSURE_FULL bound;
+    a launch code logs a few lines, so the check costs little.
+*/
+
+#include "LogDBPriv.h"
+
+Err LogDB_CtxInit(LogDB_Ctx *ctx, const Char *appName)
+{
+    UInt16 n;
+
+    if (ctx == NULL || appName == NULL)
+        return dmErrInvalidParam;
+
+    n = (UInt16)StrLen(appName);
+    if (n >= sizeof(ctx->appName))
+        n = sizeof(ctx->appName) - 1;
+    MemMove(ctx->appName, appName, n);
+    ctx->appName[n] = 0;
+
+    ctx->dbR = NULL;
+    ctx->dbID = 0;
+    ctx->dmCalls = 0;
+    return LogDB_OpenActiveRef(dmModeReadWrite, &ctx->dbR, &ctx->dbID, &ctx->dmCalls);
+}
+
+Err LogDB_CtxLog(LogDB_Ctx *ctx, const Char *message)
+{
+    LogDB_Rec rec;
+    UInt32 freeBytes;
+    UInt32 maxBytes;
+    UInt16 index;
+    Err err;
+
+    if (ctx == NULL || ctx->dbR == NULL)
+        return dmErrInvalidParam;
+    if (message == NULL)
+        message = "";
+
+    /* Storage nearly full: leave what is left to the system */
+    freeBytes = 0;
+    maxBytes = 0;
+    MemHeapFreeBytes(MemHeapID(0, 1), &freeBytes, &maxBytes);
+    if (freeBytes < LOGDB_PRESSURE_DEFAULT_FULL)
+        return dmErrMemError;
+
+    rec.secs = TimGetSeconds();
+    rec.ticks = TimGetTicks();
+    rec.rate = 1;
+    rec.app = ctx->appName;
+    rec.appLen = (UInt16)StrLen(ctx->appName);
+    rec.msg = message;
+    rec.msgLen = (UInt16)StrLen(message);
+    rec.fields = NULL;
+    rec.fieldsLen = 0;
+
+    err = LogDB_AppendRec(ctx->dbR, &rec, LogDB_RecSize(&rec), &index, &ctx->dmCalls);
+    if (err == dmErrMemError)
+        return err; /* nothing was added */
+    LogBloom_AddTo(ctx->dbID, index, rec.msg, rec.msgLen, &ctx->dmCalls);
+    return err;
+}
+
+void LogDB_CtxClose(LogDB_Ctx *ctx)
+{
+    if (ctx == NULL || ctx->dbR == NULL)
+        return;
+    LOGDB_DM(ctx->dmCalls, DmCloseDatabase(ctx->dbR));
+    ctx->dbR = NULL;
+}
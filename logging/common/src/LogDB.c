@@ -1,26 +1,38 @@
-#include "LogDB.h"
+#include "LogDBPriv.h"
 
-static DmOpenRef sLogDB = NULL;
-static Char sAppName[32]; /* short name is fine; truncated if needed */
+/* Records up to this size are built on the stack and written with one
+   DmWrite; longer messages are written in place in three parts */
+#define LOGDB_REC_STACK_BYTES 256
 
-static Err LogDB_OpenOrCreate(void)
+Err LogDB_OpenActiveRef(UInt16 mode, DmOpenRef *dbRP, LocalID *dbIDP, UInt32 *dmP)
 {
     Err err = errNone;
-    UInt16 mode = dmModeReadWrite;
     LocalID dbID;
 
+    /* Re-open by cached ID when we have one (no name lookup) */
+    if (*dbIDP != 0)
+    {
+        *dbRP = LOGDB_DM(*dmP, DmOpenDatabase(0, *dbIDP, mode));
+        if (*dbRP != NULL)
+            return errNone;
+        *dbIDP = 0;
+    }
+
     /* Try open by Type/Creator first */
-    sLogDB = DmOpenDatabaseByTypeCreator(LOGDB_TYPE, LOGDB_CREATOR, mode);
-    if (sLogDB != NULL)
+    *dbRP = LOGDB_DM(*dmP, DmOpenDatabaseByTypeCreator(LOGDB_TYPE, LOGDB_CREATOR, mode));
+    if (*dbRP != NULL)
+    {
+        LOGDB_DM(*dmP, DmOpenDatabaseInfo(*dbRP, dbIDP, NULL, NULL, NULL, NULL));
         return errNone;
+    }
 
     /* Create if missing (ignore 'already exists') */
-    err = DmCreateDatabase(0, LOGDB_NAME, LOGDB_CREATOR, LOGDB_TYPE, false);
+    err = LOGDB_DM(*dmP, DmCreateDatabase(0, LOGDB_NAME, LOGDB_CREATOR, LOGDB_TYPE, false));
     if (err != errNone && err != dmErrAlreadyExists)
         return err;
 
     /* Look up the DB ID */
-    dbID = DmFindDatabase(0, LOGDB_NAME);
+    dbID = LOGDB_DM(*dmP, DmFindDatabase(0, LOGDB_NAME));
     if (dbID == 0)
     {
         /* Return the system’s last error if lookup failed */
@@ -35,168 +47,666 @@ static Err LogDB_OpenOrCreate(void)
         LocalID appInfoID = 0, sortInfoID = 0;
         Char name[dmDBNameLength];
 
-        DmDatabaseInfo(0, dbID, name, &attrs, &version, &crDate, &modDate, &bckDate,
-                       &modNum, &appInfoID, &sortInfoID, &type, &creator);
+        LOGDB_DM(*dmP, DmDatabaseInfo(0, dbID, name, &attrs, &version, &crDate, &modDate, &bckDate,
+                                      &modNum, &appInfoID, &sortInfoID, &type, &creator));
         /* Make sure DB is backed up and beamable (no copy prevention). */
         attrs |= dmHdrAttrBackup;
         attrs &= ~dmHdrAttrCopyPrevention;
-        DmSetDatabaseInfo(0, dbID, NULL, &attrs, NULL, NULL, NULL, NULL,
-                          NULL, NULL, NULL, NULL, NULL);
+        LOGDB_DM(*dmP, DmSetDatabaseInfo(0, dbID, NULL, &attrs, NULL, NULL, NULL, NULL,
+                                         NULL, NULL, NULL, NULL, NULL));
     }
 
     /* Open RW */
-    sLogDB = DmOpenDatabase(0, dbID, mode);
-    if (sLogDB == NULL)
+    *dbRP = LOGDB_DM(*dmP, DmOpenDatabase(0, dbID, mode));
+    if (*dbRP == NULL)
         return dmErrCantOpen;
+    *dbIDP = dbID;
 
     return errNone;
 }
 
-Err LogDB_Init(const Char *appName)
+Err LogDB_OpenOrCreate(LogDB_Globals *g)
 {
     Err err;
+
+    err = LogDB_OpenActiveRef(LOGDB_RW_MODE, &g->dbR, &g->dbID, &g->stats.dmCalls);
+    if (err == errNone)
+        LogSeg_LoadActive(g);
+    return err;
+}
+
+Err LogDB_InitG(LogDB_Globals *g, const Char *appName)
+{
+    return LogDB_InitSinksG(g, appName, LOGDB_SINK_DB);
+}
+
+Err LogDB_SetAppNameG(LogDB_Globals *g, const Char *appName)
+{
     UInt16 n;
 
     if (appName == NULL)
         return dmErrInvalidParam;
 
     n = StrLen(appName);
-    if (n >= sizeof(sAppName))
-        n = sizeof(sAppName) - 1;
-    MemMove(sAppName, appName, n);
-    sAppName[n] = 0;
+    if (n >= sizeof(g->appName))
+        n = sizeof(g->appName) - 1;
+    MemMove(g->appName, appName, n);
+    g->appName[n] = 0;
+    return errNone;
+}
+
+Err LogDB_InitSinksG(LogDB_Globals *g, const Char *appName, UInt16 sinks)
+{
+    Err err;
+
+    err = LogDB_SetAppNameG(g, appName);
+    if (err != errNone)
+        return err;
+
+    /* Each app asks for memory samples itself, and is charged only for
+       its own logging (the library's globals outlive it) */
+    g->memInterval = 0;
+    MemSet(&g->stats, sizeof(LogDB_Stats), 0);
+    g->statsCleared = 0;
+
+    /* The first record checks free storage (the library's policy is kept).
+       With a storage sink still open the countdown goes on, so an Init
+       per record does not make every record a check */
+    if (g->pressure.checkEvery == 0)
+        LogDB_SetPressurePolicyG(g, NULL);
+    if (g->dbR == NULL && g->appR == NULL)
+        g->pressureCheck = 0;
+
+    /* Closed segments left unpacked by earlier runs */
+    LogIdle_Queue(g, LOGDB_IDLE_COMPACT);
+
+    /* Sinks already open (e.g. kept open by the shared library) are kept */
+    return LogSink_Open(g, sinks);
+}
 
-    err = LogDB_OpenOrCreate();
+/* The session's counters as a LOGDB_STATS_MSG record, if it did anything */
+Err LogDB_StatsReportG(LogDB_Globals *g)
+{
+    LogDB_Field f[7];
+    LogDB_Stats s;
+    Err err;
+
+    /* Nothing logged since the last clear or report: leave the log be */
+    s = g->stats;
+    if (s.calls == g->statsCleared)
+        return errNone;
+    LogDB_FieldUInt32(&f[0], "n", s.calls);
+    LogDB_FieldUInt32(&f[1], "b", s.bytes);
+    LogDB_FieldUInt32(&f[2], "dm", s.dmCalls);
+    LogDB_FieldUInt32(&f[3], "f", s.failures);
+    LogDB_FieldUInt32(&f[4], "lt", s.logTicks);
+    LogDB_FieldUInt32(&f[5], "it", s.iterTicks);
+    LogDB_FieldUInt32(&f[6], "ct", s.clearTicks);
+    err = LogDB_LogFieldsG(g, LOGDB_STATS_MSG, f, 7);
+    g->statsCleared = g->stats.calls;
     return err;
 }
 
-void LogDB_Close(void)
+void LogDB_CloseG(LogDB_Globals *g)
 {
-    if (sLogDB != NULL)
-    {
-        DmCloseDatabase(sLogDB);
-        sLogDB = NULL;
-    }
+    LogDB_IdleReportG(g);
+    LogDB_MemReportG(g);
+    LogDB_StatsReportG(g);
+    LogSink_Close(g);
 }
 
-Err LogDB_Log(const Char *message)
+void LogDB_GetStatsG(LogDB_Globals *g, LogDB_Stats *stats)
+{
+    *stats = g->stats;
+}
+
+Err LogDB_FlushG(LogDB_Globals *g)
+{
+    return LogSink_Flush(g);
+}
+
+Err LogDB_LogG(LogDB_Globals *g, const Char *message)
 {
+    return LogDB_LogFieldsG(g, message, NULL, 0);
+}
+
+Err LogDB_LogFieldsG(LogDB_Globals *g, const Char *message, const LogDB_Field *fields,
+                     UInt16 numFields)
+{
+    return LogDB_LogSampledG(g, 1, message, fields, numFields);
+}
+
+Err LogDB_LogSampledG(LogDB_Globals *g, UInt16 rate, const Char *message,
+                      const LogDB_Field *fields, UInt16 numFields)
+{
+    LogDB_Rec rec;
+    UInt8 fieldBuf[LOGDB_FIELDS_MAX_BYTES];
+    Int16 fieldsLen;
     Err err;
-    UInt32 secs;
-    MemHandle h;
-    UInt16 index;
-    Char *dst;
-    UInt32 size;
-    UInt16 appLen, msgLen;
 
-    if (sLogDB == NULL)
+    if (message == NULL)
+        message = "";
+
+    g->stats.calls++;
+    fieldsLen = 0;
+    if (fields != NULL && numFields > 0)
     {
-        err = LogDB_OpenOrCreate();
-        if (err != errNone)
-            return err;
+        fieldsLen = LogField_Encode(fields, numFields, fieldBuf);
+        if (fieldsLen < 0)
+        {
+            g->stats.failures++;
+            return dmErrInvalidParam;
+        }
     }
 
-    if (message == NULL)
-        message = "";
+    rec.secs = TimGetSeconds();
+    rec.ticks = TimGetTicks();
+    rec.rate = (rate > 1) ? rate : 1;
+    rec.app = g->appName;
+    rec.appLen = (UInt16)StrLen(g->appName);
+    rec.msg = message;
+    rec.msgLen = (UInt16)StrLen(message);
+    rec.fields = fieldBuf;
+    rec.fieldsLen = (UInt16)fieldsLen;
+    err = LogSink_Write(g, &rec);
+
+    /* rec.ticks is when the call started, near enough */
+    g->stats.logTicks += TimGetTicks() - rec.ticks;
+    if (err != errNone)
+        g->stats.failures++;
+    return err;
+}
+
+/* --- DebugLog DB sink --- */
 
-    secs = TimGetSeconds();
+Err LogSinkDB_Open(LogDB_Globals *g)
+{
+    if (g->dbR != NULL)
+        return errNone;
+    return LogDB_OpenOrCreate(g);
+}
+
+void LogSinkDB_Close(LogDB_Globals *g)
+{
+    if (g->dbR != NULL)
+    {
+        LOGDB_DMG(g, DmCloseDatabase(g->dbR));
+        g->dbR = NULL;
+    }
+}
 
-    appLen = (UInt16)StrLen(sAppName);
-    msgLen = (UInt16)StrLen(message);
-    size = 4 + (UInt32)appLen + 1 + (UInt32)msgLen + 1;
+Err LogDB_AppendRec(DmOpenRef dbR, const LogDB_Rec *rec, UInt32 size, UInt16 *indexP,
+                    UInt32 *dmP)
+{
+    MemHandle h;
+    UInt16 index;
+    UInt8 *dst;
+    UInt16 head;
+    UInt8 buf[LOGDB_REC_STACK_BYTES];
 
-    h = DmNewRecord(sLogDB, &index, size);
+    /* Append at the end; never insert (that shifts the whole index) */
+    index = dmMaxRecordIndex;
+    h = LOGDB_DM(*dmP, DmNewRecord(dbR, &index, size));
     if (h == NULL)
         return dmErrMemError;
 
-    dst = (Char *)MemHandleLock(h);
+    dst = (UInt8 *)MemHandleLock(h);
     if (dst == NULL)
     {
-        DmRemoveRecord(sLogDB, index);
+        LOGDB_DM(*dmP, DmRemoveRecord(dbR, index));
         return dmErrMemError;
     }
 
-    /* [UInt32 seconds][appName\0][message\0] */
-    DmWrite(dst, 0, &secs, 4);
-    DmWrite(dst, 4, sAppName, appLen + 1);
-    DmWrite(dst, 4 + appLen + 1, message, msgLen + 1);
+    /* Each DmWrite is a trap plus a storage-heap unprotect/protect, so
+       the record goes in whole from the stack when it fits */
+    if (size <= sizeof(buf))
+    {
+        LogDB_RecEncode(rec, buf);
+        LOGDB_DM(*dmP, DmWrite(dst, 0, buf, size));
+    }
+    else
+    {
+        head = LogDB_RecEncodeHead(rec, buf);
+        LOGDB_DM(*dmP, DmWrite(dst, 0, buf, head));
+        LOGDB_DM(*dmP, DmWrite(dst, head, rec->msg, rec->msgLen));
+        buf[0] = 0;
+        MemMove(buf + 1, rec->fields, rec->fieldsLen);
+        LOGDB_DM(*dmP, DmWrite(dst, head + rec->msgLen, buf, 1 + rec->fieldsLen));
+    }
 
     MemHandleUnlock(h);
+    if (indexP != NULL)
+        *indexP = index;
+    return LOGDB_DM(*dmP, DmReleaseRecord(dbR, index, true));
+}
 
-    err = DmReleaseRecord(sLogDB, index, true);
+Err LogSinkDB_Write(LogDB_Globals *g, const LogDB_Rec *rec)
+{
+    Err err;
+    UInt32 size;
+    UInt16 index;
+
+    err = LogSinkDB_Open(g);
+    if (err != errNone)
+        return err;
+
+    size = LogDB_RecSize(rec);
+
+    /* Roll the active DB into a segment first if the policy says so;
+       on failure keep appending to the current one */
+    if (LogSeg_ShouldRoll(g, rec->secs, size))
+    {
+        if (LogSeg_Roll(g) != errNone && g->dbR == NULL)
+        {
+            err = LogDB_OpenOrCreate(g);
+            if (err != errNone)
+                return err;
+        }
+    }
+
+    err = LogDB_AppendRec(g->dbR, rec, size, &index, &g->stats.dmCalls);
+    if (err == dmErrMemError)
+        return err; /* nothing was added */
+
+    /* Not where we expected it: the DB changed under us (a LogDB_Ctx
+       logged from a sub-launch), so count it again, this record too */
+    if (index != g->activeCount)
+    {
+        LogSeg_LoadActive(g);
+    }
+    else
+    {
+        LogSeg_Appended(g, rec->secs, size);
+    }
+    LogBloom_Add(g, index, rec->msg, rec->msgLen);
     return err;
 }
 
-Err LogDB_ClearAll(void)
+static Err LogDB_ClearEverything(LogDB_Globals *g)
 {
     Err err;
-    UInt16 n, i;
+    UInt16 n;
 
-    if (sLogDB == NULL)
+    /* The card stream file, if there is one */
+    err = LogSinkVfs_Clear(g);
+    if (err != errNone)
+        return err;
+
+    g->packSegID = 0; /* an idle compaction's segment goes too */
+    err = LogSeg_DeleteAll(&g->stats.dmCalls);
+    if (err != errNone)
+        return err;
+
+    /* Every app's own DBs */
+    err = LogSinkApp_Clear(g, NULL);
+    if (err != errNone)
+        return err;
+
+    if (g->dbR == NULL)
     {
-        err = LogDB_OpenOrCreate();
+        err = LogDB_OpenOrCreate(g);
         if (err != errNone)
             return err;
     }
 
-    n = DmNumRecords(sLogDB);
-    for (i = 0; i < n; i++)
+    /* Dropping the active DB is one call; recreate it empty */
+    LogSinkDB_Close(g);
+    if (LOGDB_DMG(g, DmDeleteDatabase(0, g->dbID)) == errNone)
+    {
+        g->dbID = 0;
+        return LogDB_OpenOrCreate(g);
+    }
+
+    /* Still open elsewhere: remove from the end so nothing shifts */
+    err = LogDB_OpenOrCreate(g);
+    if (err != errNone)
+        return err;
+    n = LOGDB_DMG(g, DmNumRecords(g->dbR));
+    while (n > 0)
     {
-        if (DmRemoveRecord(sLogDB, 0) != errNone)
+        if (LOGDB_DMG(g, DmRemoveRecord(g->dbR, n - 1)) != errNone)
             break;
+        n--;
     }
+    LogSeg_LoadActive(g);
     return errNone;
 }
 
+Err LogDB_ClearAllG(LogDB_Globals *g)
+{
+    UInt32 start;
+    Err err;
+
+    start = TimGetTicks();
+    err = LogDB_ClearEverything(g);
+    g->stats.clearTicks += TimGetTicks() - start;
+    g->statsCleared = g->stats.calls;
+    return err;
+}
+
+Err LogDB_ClearAppG(LogDB_Globals *g, const Char *app)
+{
+    if (app == NULL || app[0] == 0)
+        return dmErrInvalidParam;
+    return LogSinkApp_Clear(g, app);
+}
+
+void LogDB_SetRollPolicyG(LogDB_Globals *g, const LogDB_RollPolicy *policy)
+{
+    if (policy == NULL)
+    {
+        MemSet(&g->roll, sizeof(LogDB_RollPolicy), 0);
+        return;
+    }
+    g->roll = *policy;
+    if (g->roll.maxRecords > LOGDB_ROLL_MAX_RECORDS)
+        g->roll.maxRecords = LOGDB_ROLL_MAX_RECORDS;
+}
+
+Err LogDB_PurgeBeforeG(LogDB_Globals *g, UInt32 secs, UInt16 *purgedP)
+{
+    LocalID ids[LOGDB_MAX_SEGMENTS];
+    UInt16 seqs[LOGDB_MAX_SEGMENTS];
+    UInt16 n;
+    UInt16 i;
+    UInt16 purged;
+    LogDB_SegInfo info;
+    Err err;
+
+    purged = 0;
+    err = errNone;
+    if (secs > 0)
+    {
+        /* Segments whose newest record is older than secs */
+        n = LogSeg_List(ids, seqs, LOGDB_MAX_SEGMENTS, 0, secs - 1, NULL, NULL,
+                        &g->stats.dmCalls);
+        for (i = 0; i < n; i++)
+        {
+            /* List matched on overlap; only delete if wholly before secs */
+            if (!LogSeg_ReadInfo(ids[i], &info, &g->stats.dmCalls) || info.lastSecs >= secs)
+                continue;
+
+            err = LOGDB_DMG(g, DmDeleteDatabase(0, ids[i]));
+            if (err != errNone)
+                break;
+            purged++;
+        }
+    }
+
+    if (purgedP != NULL)
+        *purgedP = purged;
+    return err;
+}
+
 /* --- Iteration helpers for viewer --- */
 
 Err LogDB_IterBegin(LogDB_Iter *it)
 {
+    return LogDB_IterBeginRange(it, 0, 0xFFFFFFFFUL);
+}
+
+Err LogDB_IterBeginRange(LogDB_Iter *it, UInt32 fromSecs, UInt32 toSecs)
+{
+    UInt16 seqs[LOGDB_MAX_SEGMENTS];
+    LocalID activeID;
+    UInt32 start;
+
     if (it == NULL)
         return dmErrInvalidParam;
+    start = TimGetTicks();
     MemSet(it, sizeof(LogDB_Iter), 0);
-    it->dbR = DmOpenDatabaseByTypeCreator(LOGDB_TYPE, LOGDB_CREATOR, dmModeReadOnly);
-    if (it->dbR == NULL)
+    it->fromSecs = fromSecs;
+    it->toSecs = toSecs;
+
+    /* Closed segments overlapping the window, oldest first... */
+    it->numDBs = LogSeg_List(it->dbIDs, seqs, LOGDB_MAX_SEGMENTS, fromSecs, toSecs, NULL, NULL,
+                             &it->dmCalls);
+
+    /* ...then the active DB, whose range is still open */
+    activeID = LOGDB_DM(it->dmCalls, DmFindDatabase(0, LOGDB_NAME));
+    if (activeID != 0)
+        it->dbIDs[it->numDBs++] = activeID;
+
+    it->ticks = TimGetTicks() - start;
+    if (it->numDBs == 0)
         return dmErrCantOpen;
-    it->count = DmNumRecords(it->dbR);
-    it->index = 0;
     return errNone;
 }
 
-MemHandle LogDB_IterNext(LogDB_Iter *it, UInt32 *seconds, Char **appPtr, Char **msgPtr)
+Err LogDB_IterBeginSinkG(LogDB_Globals *g, LogDB_Iter *it, UInt16 sink, UInt32 fromSecs,
+                         UInt32 toSecs)
+{
+    UInt32 start;
+    Err err;
+
+    if (sink != LOGDB_SINK_VFS && sink != LOGDB_SINK_APPDB)
+        return LogDB_IterBeginRange(it, fromSecs, toSecs);
+
+    if (it == NULL)
+        return dmErrInvalidParam;
+    start = TimGetTicks();
+    MemSet(it, sizeof(LogDB_Iter), 0);
+    it->fromSecs = fromSecs;
+    it->toSecs = toSecs;
+    it->sink = sink;
+    if (sink == LOGDB_SINK_APPDB)
+    {
+        err = LogSinkApp_IterBegin(it);
+    }
+    else
+    {
+        /* The writer opens the file exclusively: flush and release it
+           (the next LogDB_Log reopens it) */
+        LogSinkVfs_Close(g);
+        err = LogSinkVfs_IterBegin(it);
+    }
+    it->ticks += TimGetTicks() - start;
+    return err;
+}
+
+/* Advance to the next DB with records left; false when all are done. */
+static Boolean LogDB_IterNextDB(LogDB_Iter *it)
+{
+    while (it->dbR == NULL || it->index >= it->count)
+    {
+        if (it->dbR != NULL)
+        {
+            LogBloom_IterClose(it);
+            LOGDB_DM(it->dmCalls, DmCloseDatabase(it->dbR));
+            it->dbR = NULL;
+        }
+        if (it->db >= it->numDBs)
+            return false;
+
+        it->dbR = LOGDB_DM(it->dmCalls, DmOpenDatabase(0, it->dbIDs[it->db++], dmModeReadOnly));
+        it->index = 0;
+        it->count = (it->dbR != NULL) ? LOGDB_DM(it->dmCalls, DmNumRecords(it->dbR)) : 0;
+        if (it->dbR != NULL)
+            LogBloom_IterOpen(it, it->dbIDs[it->db - 1]);
+    }
+    return true;
+}
+
+static MemHandle LogDB_IterFind(LogDB_Iter *it, LogDB_Entry *entry)
+{
+    MemHandle h;
+    UInt8 *p;
+    UInt32 size;
+
+    for (;;)
+    {
+        /* Inside a packed block: its entries come first */
+        if (it->packH != NULL)
+        {
+            h = LogPack_IterNext(it, entry);
+            if (h != NULL && it->textWords > 0 && !LogBloom_Matches(it, entry))
+            {
+                MemHandleUnlock(h);
+                continue;
+            }
+            if (h != NULL)
+                return h;
+            continue;
+        }
+
+        if (it->sink == LOGDB_SINK_VFS)
+        {
+            h = LogSinkVfs_IterNext(it);
+            if (h == NULL)
+                return NULL;
+            size = it->frameLen;
+        }
+        else if (it->sink == LOGDB_SINK_APPDB)
+        {
+            h = LogSinkApp_IterNext(it);
+            if (h == NULL)
+                return NULL;
+            size = MemHandleSize(h);
+        }
+        else
+        {
+            if (!LogDB_IterNextDB(it))
+                return NULL;
+
+            /* A search passes over runs whose filter lacks a word */
+            if (it->textWords > 0 && it->index % LOGDB_BLOOM_RUN == 0 && !LogBloom_IterRun(it))
+                continue;
+
+            h = LOGDB_DM(it->dmCalls, DmQueryRecord(it->dbR, it->index));
+            it->index++;
+            if (h == NULL)
+                continue;
+            size = MemHandleSize(h);
+        }
+
+        p = (UInt8 *)MemHandleLock(h);
+        if (p == NULL)
+            continue;
+
+        if (LogDB_RecKind(p) == LOGDB_REC_BLOCK)
+        {
+            LogPack_IterEnter(it, h, p, size);
+            MemHandleUnlock(h);
+            continue;
+        }
+
+        /* v1 and v2 side by side; damaged records are skipped */
+        if (LogDB_RecDecode(p, size, entry) && entry->seconds >= it->fromSecs &&
+            entry->seconds <= it->toSecs &&
+            (it->app == NULL || StrCompare(entry->app, it->app) == 0) &&
+            (it->textWords == 0 || LogBloom_Matches(it, entry)))
+            return h;
+        MemHandleUnlock(h);
+    }
+}
+
+MemHandle LogDB_IterNextEntry(LogDB_Iter *it, LogDB_Entry *entry)
 {
     MemHandle h;
-    Char *p;
-    UInt16 len;
+    UInt32 start;
 
-    if (it == NULL || it->dbR == NULL)
+    if (it == NULL || entry == NULL)
         return NULL;
-    if (it->index >= it->count)
+    start = TimGetTicks();
+    h = LogDB_IterFind(it, entry);
+    it->ticks += TimGetTicks() - start;
+    return h;
+}
+
+UInt32 LogDB_IterTell(const LogDB_Iter *it)
+{
+    UInt16 entry;
+
+    if (it == NULL || it->sink == LOGDB_SINK_VFS || it->db == 0)
+        return LOGDB_POS_NONE;
+    if (it->sink == LOGDB_SINK_APPDB)
+        return LogSinkApp_IterTell(it);
+    if (it->index == 0)
+        return LOGDB_POS_NONE;
+
+    /* Both cursors have moved past what they returned */
+    entry = (it->packH != NULL) ? (UInt16)(it->packPos - 1) : 0;
+    return ((UInt32)(it->db - 1) << 24) | ((UInt32)(it->index - 1) << 8) | entry;
+}
+
+static MemHandle LogDB_IterSeek(LogDB_Iter *it, UInt32 pos, LogDB_Entry *entry)
+{
+    MemHandle h;
+    const UInt8 *p;
+    UInt16 db;
+    UInt16 index;
+    Boolean ok;
+
+    db = (UInt16)(pos >> 24);
+    index = (UInt16)(pos >> 8);
+    if (db >= it->numDBs)
         return NULL;
 
-    h = DmQueryRecord(it->dbR, it->index);
-    it->index++;
+    if (it->sink == LOGDB_SINK_APPDB)
+    {
+        h = LogSinkApp_IterSeek(it, db, index);
+    }
+    else
+    {
+        /* Keep the DB open while reads stay in it */
+        it->packH = NULL;
+        if (it->dbR == NULL || it->db != db + 1)
+        {
+            if (it->dbR != NULL)
+            {
+                LogBloom_IterClose(it);
+                LOGDB_DM(it->dmCalls, DmCloseDatabase(it->dbR));
+            }
+            it->dbR = LOGDB_DM(it->dmCalls, DmOpenDatabase(0, it->dbIDs[db], dmModeReadOnly));
+            it->count = (it->dbR != NULL) ? LOGDB_DM(it->dmCalls, DmNumRecords(it->dbR)) : 0;
+            it->db = db + 1;
+        }
+        it->index = index + 1;
+        if (index >= it->count)
+            return NULL;
+        h = LOGDB_DM(it->dmCalls, DmQueryRecord(it->dbR, index));
+    }
     if (h == NULL)
         return NULL;
+    p = (const UInt8 *)MemHandleLock(h);
+    if (LogDB_RecKind(p) == LOGDB_REC_BLOCK)
+        ok = LogPack_EntryAt(p, MemHandleSize(h), (UInt16)(pos & 0xFF), entry);
+    else
+        ok = LogDB_RecDecode(p, MemHandleSize(h), entry);
+    if (ok)
+        return h;
+    MemHandleUnlock(h);
+    return NULL;
+}
+
+MemHandle LogDB_IterSeekEntry(LogDB_Iter *it, UInt32 pos, LogDB_Entry *entry)
+{
+    MemHandle h;
+    UInt32 start;
+
+    if (it == NULL || entry == NULL || it->sink == LOGDB_SINK_VFS || pos == LOGDB_POS_NONE)
+        return NULL;
+    start = TimGetTicks();
+    h = LogDB_IterSeek(it, pos, entry);
+    it->ticks += TimGetTicks() - start;
+    return h;
+}
 
-    p = (Char *)MemHandleLock(h);
-    if (p == NULL)
+MemHandle LogDB_IterNext(LogDB_Iter *it, UInt32 *seconds, Char **appPtr, Char **msgPtr)
+{
+    LogDB_Entry entry;
+    MemHandle h;
+
+    h = LogDB_IterNextEntry(it, &entry);
+    if (h == NULL)
         return NULL;
 
     if (seconds != NULL)
-    {
-        *seconds = *(UInt32 *)(p);
-    }
-    p += 4;
-
+        *seconds = entry.seconds;
     if (appPtr != NULL)
-        *appPtr = p;
-    len = (UInt16)StrLen(p);
-    p += (UInt32)len + 1;
-
+        *appPtr = entry.app;
     if (msgPtr != NULL)
-        *msgPtr = p;
-
+        *msgPtr = entry.msg;
     return h;
 }
 
@@ -206,11 +716,177 @@ void LogDB_IterUnlock(MemHandle h)
         MemHandleUnlock(h);
 }
 
-void LogDB_IterEnd(LogDB_Iter *it)
+void LogDB_IterSetApp(LogDB_Iter *it, const Char *app)
+{
+    if (it == NULL)
+        return;
+    it->app = (app != NULL && app[0] != 0) ? app : NULL;
+    if (it->app != NULL && it->sink == LOGDB_SINK_APPDB)
+        LogSinkApp_IterSetApp(it, it->app);
+}
+
+void LogDB_IterEndG(LogDB_Globals *g, LogDB_Iter *it)
 {
-    if (it != NULL && it->dbR != NULL)
+    UInt32 start;
+
+    if (it == NULL)
+        return;
+    start = TimGetTicks();
+    if (it->sink == LOGDB_SINK_VFS)
+        LogSinkVfs_IterEnd(it);
+    if (it->sink == LOGDB_SINK_APPDB)
+        LogSinkApp_IterEnd(it);
+    if (it->dbR != NULL)
     {
-        DmCloseDatabase(it->dbR);
+        LogBloom_IterClose(it);
+        LOGDB_DM(it->dmCalls, DmCloseDatabase(it->dbR));
         it->dbR = NULL;
     }
+    it->packH = NULL;
+    it->db = it->numDBs;
+
+    /* The app pays for the iterator once, however often it is ended */
+    g->stats.dmCalls += it->dmCalls;
+    g->stats.iterTicks += it->ticks + (TimGetTicks() - start);
+    it->dmCalls = 0;
+    it->ticks = 0;
+}
+
+/* --- Static-link entry points (the shared library has its own) --- */
+
+#ifndef LOGDB_SYSLIB
+
+static LogDB_Globals sGlobals;
+
+Err LogDB_Init(const Char *appName)
+{
+    return LogDB_InitG(&sGlobals, appName);
+}
+
+Err LogDB_InitSinks(const Char *appName, UInt16 sinks)
+{
+    return LogDB_InitSinksG(&sGlobals, appName, sinks);
+}
+
+Err LogDB_SetAppName(const Char *appName)
+{
+    return LogDB_SetAppNameG(&sGlobals, appName);
+}
+
+Err LogDB_Flush(void)
+{
+    return LogDB_FlushG(&sGlobals);
+}
+
+void LogDB_Close(void)
+{
+    LogDB_CloseG(&sGlobals);
+}
+
+Err LogDB_Log(const Char *message)
+{
+    return LogDB_LogG(&sGlobals, message);
+}
+
+Err LogDB_LogFields(const Char *message, const LogDB_Field *fields, UInt16 numFields)
+{
+    return LogDB_LogFieldsG(&sGlobals, message, fields, numFields);
+}
+
+Err LogDB_LogSampled(UInt16 rate, const Char *message, const LogDB_Field *fields,
+                     UInt16 numFields)
+{
+    return LogDB_LogSampledG(&sGlobals, rate, message, fields, numFields);
+}
+
+Err LogDB_Migrate(UInt16 *migratedP)
+{
+    return LogDB_MigrateG(&sGlobals, migratedP);
+}
+
+Err LogDB_ClearAll(void)
+{
+    return LogDB_ClearAllG(&sGlobals);
+}
+
+Err LogDB_ClearApp(const Char *app)
+{
+    return LogDB_ClearAppG(&sGlobals, app);
+}
+
+void LogDB_SetRollPolicy(const LogDB_RollPolicy *policy)
+{
+    LogDB_SetRollPolicyG(&sGlobals, policy);
+}
+
+Err LogDB_PurgeBefore(UInt32 secs, UInt16 *purgedP)
+{
+    return LogDB_PurgeBeforeG(&sGlobals, secs, purgedP);
+}
+
+Err LogDB_ArchiveTrim(UInt32 *droppedP)
+{
+    return LogDB_ArchiveTrimG(&sGlobals, droppedP);
+}
+
+void LogDB_SetPressurePolicy(const LogDB_PressurePolicy *policy)
+{
+    LogDB_SetPressurePolicyG(&sGlobals, policy);
+}
+
+void LogDB_GetStats(LogDB_Stats *stats)
+{
+    LogDB_GetStatsG(&sGlobals, stats);
+}
+
+Err LogDB_StatsReport(void)
+{
+    return LogDB_StatsReportG(&sGlobals);
+}
+
+Err LogDB_IterBeginSink(LogDB_Iter *it, UInt16 sink, UInt32 fromSecs, UInt32 toSecs)
+{
+    return LogDB_IterBeginSinkG(&sGlobals, it, sink, fromSecs, toSecs);
+}
+
+void LogDB_IterEnd(LogDB_Iter *it)
+{
+    LogDB_IterEndG(&sGlobals, it);
+}
+
+Err LogDB_Compact(UInt32 *packedP)
+{
+    return LogDB_CompactG(&sGlobals, packedP);
+}
+
+void LogDB_SetMemInterval(UInt32 intervalTicks)
+{
+    LogDB_SetMemIntervalG(&sGlobals, intervalTicks);
+}
+
+Err LogDB_MemSample(Boolean force)
+{
+    return LogDB_MemSampleG(&sGlobals, force);
+}
+
+Err LogDB_MemReport(void)
+{
+    return LogDB_MemReportG(&sGlobals);
+}
+
+Boolean LogDB_Idle(UInt16 tickBudget)
+{
+    return LogDB_IdleG(&sGlobals, tickBudget);
+}
+
+void LogDB_IdleGetStats(LogDB_IdleStats *stats)
+{
+    LogDB_IdleGetStatsG(&sGlobals, stats);
 }
+
+Err LogDB_IdleReport(void)
+{
+    return LogDB_IdleReportG(&sGlobals);
+}
+
+#endif /* LOGDB_SYSLIB */
@@ -2,40 +2,566 @@
 #define LOGDB_H
 
 #include <PalmOS.h>
+#include <VFSMgr.h>
 
 /* Shared Debug Log database constants */
 #define LOGDB_NAME "DebugLog"
 #define LOGDB_TYPE 'DATA'
 #define LOGDB_CREATOR 'LgDB'
 
+/* Closed segments: "DebugLog-0001", "DebugLog-0002", ... (oldest first).
+   Different type, so type/creator lookups only ever find the active DB. */
+#define LOGDB_SEG_TYPE 'LSeg'
+#define LOGDB_SEG_PREFIX "DebugLog-"
+#define LOGDB_MAX_SEGMENTS 32 /* oldest is deleted when a roll would exceed this */
+
+/* Per-app DBs (LOGDB_SINK_APPDB): "DebugLog.<app>" for each name given to
+   LogDB_Init, truncated to fit a DB name. When one reaches the roll
+   policy's record count it becomes "DebugLog~<app>", replacing the one
+   before, so an app keeps at most two. Readers merge them by time, up to
+   256 DBs (128 apps); clearing an app deletes its DBs. */
+#define LOGDB_APPDB_TYPE 'LApp'
+#define LOGDB_APPDB_PREFIX "DebugLog."
+#define LOGDB_APPDB_OLD_PREFIX "DebugLog~"
+
+/* Segment summary, kept in each segment DB's AppInfo block. */
+#define LOGDB_SEGINFO_VERSION 1
+typedef struct LogDB_SegInfoTag
+{
+    UInt16 version;
+    UInt16 seq;       /* number in the DB name */
+    UInt32 firstSecs; /* oldest record timestamp */
+    UInt32 lastSecs;  /* newest record timestamp */
+    UInt32 records;
+    UInt32 bytes;     /* record payload bytes */
+} LogDB_SegInfo;
+
+/* When the active DB is rolled over into a segment. */
+#define LOGDB_ROLL_DEFAULT_RECORDS 8192
+#define LOGDB_ROLL_MAX_RECORDS 60000
+typedef struct LogDB_RollPolicyTag
+{
+    UInt16 maxRecords; /* 0 = LOGDB_ROLL_DEFAULT_RECORDS */
+    UInt32 maxBytes;   /* 0 = no size limit */
+    Boolean daily;     /* also roll when the calendar day changes */
+} LogDB_RollPolicy;
+
+/* Word filters, kept in the SortInfo block of "DebugLog" (and so of the
+   segments it becomes): a LogDB_BloomInfo, then LOGDB_BLOOM_BYTES of Bloom
+   filter for each run of LOGDB_BLOOM_RUN records, by record index. A
+   run's filter has LOGDB_BLOOM_K bits set for every word with a letter in
+   its messages (see LogDB_IterSetText). Runs before fromRun or past the
+   last have no filter, and packed segments none at all. */
+#define LOGDB_BLOOM_VERSION 1
+#define LOGDB_BLOOM_RUN 256
+#define LOGDB_BLOOM_BYTES 128
+#define LOGDB_BLOOM_K 3
+typedef struct LogDB_BloomInfoTag
+{
+    UInt16 version;
+    UInt16 runs;    /* filters that follow, sized for the roll policy */
+    UInt16 fromRun; /* first run with a filter (the DB predates them) */
+    UInt16 reserved;
+} LogDB_BloomInfo;
+
+/* Where records go (bit mask for LogDB_InitSinks). */
+#define LOGDB_SINK_DB 0x0001  /* DebugLog databases in the storage heap (default) */
+#define LOGDB_SINK_VFS 0x0002 /* append-only stream file on an expansion card */
+#define LOGDB_SINK_APPDB 0x0004 /* one DB per app, in the storage heap */
+
+/* Record layout. Records are written as v2:
+
+       [UInt8 version|flags][UInt8 appLen][UInt16 msgLen][UInt32 seconds]
+       [UInt32 ticks][UInt8 fieldsLen][UInt16 rate, if LOGDB_RECF_SAMPLED]
+       [appName\0][message\0][fields]
+
+   big-endian, with the strings still terminated so readers can hand them
+   out as C strings. v1 records, [UInt32 seconds][appName\0][message\0]
+   [fields], are read alongside (LogDB_Migrate rewrites them). A v1 record
+   starts with the top byte of its timestamp, 0xB0 or more for any clock
+   set after 1997, so the version nibble tells them apart from v2 records
+   and packed blocks. */
+#define LOGDB_REC_VERSION_MASK 0xF0
+#define LOGDB_REC_V1 0x10 /* never stored; what LogDB_RecKind calls v1 */
+#define LOGDB_REC_V2 0x20
+#define LOGDB_REC_BLOCK 0x30
+#define LOGDB_RECF_SAMPLED 0x01 /* rate follows the fixed header */
+#define LOGDB_REC_V2_HEADER 13
+#define LOGDB_REC_MIN 6 /* smallest v1 record: seconds, two empty strings */
+
+/* Packed block: many entries of a closed segment in one record, written
+   by LogDB_Compact. The small columns come first, so time and app filters
+   never touch the message bytes:
+
+       [UInt8 LOGDB_REC_BLOCK][UInt8 numApps][UInt16 count][UInt32 firstSecs]
+       [UInt32 lastSecs][UInt16 appsOffset][UInt16 dataOffset][UInt16 pad]
+       [UInt16 secsDelta] x count      from the previous entry (0 for the first)
+       [UInt8 appId] x count
+       [UInt16 entryOffset] x count    from dataOffset
+       [UInt16 nameOffset] x numApps   from the start of the block, at appsOffset
+       [UInt8 len][appName\0] x numApps
+       at dataOffset + entryOffset, per entry:
+       [UInt32 ticks][UInt16 rate][UInt16 msgLen][UInt8 fieldsLen][message\0][fields]
+
+   Entries in a block never go back in time, so firstSecs and lastSecs
+   bound the whole block. */
+#define LOGDB_BLOCK_HEADER 18
+#define LOGDB_BLOCK_ENTRY_HEADER 9
+#define LOGDB_BLOCK_ENTRIES 256
+#define LOGDB_BLOCK_MAX_APPS 32
+#define LOGDB_BLOCK_MAX_BYTES 8192
+
+/* Card stream file: LOGDB_VFS_MAGIC, then one frame per record,
+   [UInt16 length][record], big-endian, the record laid out as in the DB.
+   Frames are buffered and written a block at a time; a frame never spans
+   blocks, so messages longer than a block are truncated in the file. */
+#define LOGDB_VFS_DIR "/PALM/Programs/LogDB"
+#define LOGDB_VFS_PATH LOGDB_VFS_DIR "/DebugLog.lgs"
+#define LOGDB_VFS_MAGIC 'LgS1'
+#define LOGDB_VFS_BLOCK 512
+
 /* Initialize (open-or-create) the log DB and set the current app name. */
 Err LogDB_Init(const Char *appName);
 
+/* Like LogDB_Init, but write to the given LOGDB_SINK_* set. Sinks that
+   cannot be opened (no card) are dropped and their error returned; if none
+   is left, records go to the DebugLog DB. */
+Err LogDB_InitSinks(const Char *appName, UInt16 sinks);
+
+/* Log under appName from the next record on. Unlike LogDB_Init the
+   session goes on: counters, sample interval and sinks are kept. */
+Err LogDB_SetAppName(const Char *appName);
+
+/* Push buffered records out to their sinks. */
+Err LogDB_Flush(void);
+
 /* Close DB when app exits (safe if called repeatedly). */
 void LogDB_Close(void);
 
 /* Append one log message (timestamped internally). */
 Err LogDB_Log(const Char *message);
 
-/* Remove all log records. */
+/* Typed fields, appended to a record after the message:
+   [UInt8 type][UInt8 keyLen][key][value], values big-endian,
+   LOGDB_FIELD_STR values as [UInt8 len][bytes]. Nothing is terminated;
+   the record length bounds the list. */
+#define LOGDB_FIELD_INT32 1
+#define LOGDB_FIELD_UINT32 2
+#define LOGDB_FIELD_STR 3   /* up to 255 bytes */
+#define LOGDB_FIELD_TICKS 4 /* TimGetTicks value */
+#define LOGDB_FIELD_KEY_MAX 15
+#define LOGDB_FIELDS_MAX_BYTES 128 /* encoded size of one record's fields */
+
+/* One field. Keys and LOGDB_FIELD_STR values passed to LogDB_LogFields
+   are C strings; decoded fields point into the record instead, with
+   keyLen / strLen giving their length (no terminator). */
+typedef struct LogDB_FieldTag
+{
+    UInt8 type;
+    UInt8 keyLen;
+    UInt8 strLen;
+    const Char *key;
+    union
+    {
+        Int32 i32;
+        UInt32 u32; /* LOGDB_FIELD_UINT32 and LOGDB_FIELD_TICKS */
+        const Char *str;
+    } v;
+} LogDB_Field;
+
+#define LogDB_FieldInt32(f, k, val) \
+    ((f)->type = LOGDB_FIELD_INT32, (f)->key = (k), (f)->v.i32 = (Int32)(val))
+#define LogDB_FieldUInt32(f, k, val) \
+    ((f)->type = LOGDB_FIELD_UINT32, (f)->key = (k), (f)->v.u32 = (UInt32)(val))
+#define LogDB_FieldStr(f, k, s) \
+    ((f)->type = LOGDB_FIELD_STR, (f)->key = (k), (f)->v.str = (s))
+#define LogDB_FieldTicks(f, k, ticks) \
+    ((f)->type = LOGDB_FIELD_TICKS, (f)->key = (k), (f)->v.u32 = (UInt32)(ticks))
+
+/* Append one message with numFields typed fields. dmErrInvalidParam (and
+   nothing logged) if a key or string is too long or the fields encode
+   to more than LOGDB_FIELDS_MAX_BYTES. */
+Err LogDB_LogFields(const Char *message, const LogDB_Field *fields, UInt16 numFields);
+
+/* Sampling for hot call sites. The check is a macro on caller-owned state,
+   so a skipped call costs a decrement and a compare, with no LogDB call:
+
+       static LogDB_Site sPenSite = LOGDB_SITE_EVERY(16);
+       ...
+       if (LogDB_Sample(&sPenSite))
+           LogDB_LogSampled(sPenSite.rate, "penMove", fields, 2);
+
+   LOGDB_SITE_RANDOM(n) keeps each call with probability 1/n instead.
+   Sampled records carry the rate in their header (LogDB_Entry.rate) so
+   readers can scale counts back up; v1 records carried it in a
+   LOGDB_KEY_RATE field, which the iterator still reads. */
+#define LOGDB_SAMPLE_EVERY 0
+#define LOGDB_SAMPLE_RANDOM 1
+#define LOGDB_KEY_RATE "_rate"
+
+typedef struct LogDB_SiteTag
+{
+    UInt16 rate;      /* keep 1 in rate calls */
+    UInt16 mode;      /* LOGDB_SAMPLE_* */
+    UInt16 state;     /* countdown, or xorshift state */
+    UInt16 threshold; /* LOGDB_SAMPLE_RANDOM: keep when state < threshold */
+} LogDB_Site;
+
+#define LOGDB_SITE_RATE(n) ((UInt16)((n) > 1 ? (n) : 1))
+#define LOGDB_SITE_EVERY(n) {LOGDB_SITE_RATE(n), LOGDB_SAMPLE_EVERY, 1, 0}
+#define LOGDB_SITE_RANDOM(n) \
+    {LOGDB_SITE_RATE(n), LOGDB_SAMPLE_RANDOM, 0xACE1, (UInt16)(0xFFFFUL / LOGDB_SITE_RATE(n))}
+
+/* 16-bit xorshift step, then the threshold test */
+#define LogDB_SampleRandom(site)                          \
+    ((site)->state ^= (UInt16)((site)->state << 7),       \
+     (site)->state ^= (UInt16)((site)->state >> 9),       \
+     (site)->state ^= (UInt16)((site)->state << 8),       \
+     (site)->state < (site)->threshold || (site)->rate == 1)
+
+#define LogDB_Sample(site)                                              \
+    ((site)->mode == LOGDB_SAMPLE_RANDOM ? LogDB_SampleRandom(site)     \
+     : (--(site)->state == 0 ? ((site)->state = (site)->rate, true) : false))
+
+/* LogDB_LogFields for a sampled site; rate is the site's 1-in-rate. */
+Err LogDB_LogSampled(UInt16 rate, const Char *message, const LogDB_Field *fields,
+                     UInt16 numFields);
+
+/* Logging from launch codes that run without globals (notifications,
+   alarms, sysAppLaunchCmdSyncNotify). All state is in a LogDB_Ctx the
+   caller keeps on its stack, and nothing but the active DebugLog DB is
+   opened: no segments, sinks or idle work. A session is one DB open and
+   close, and each line one record (plus a word filter update):
+
+       LogDB_Ctx ctx;
+
+       if (LogDB_CtxInit(&ctx, "MyAlarm") == errNone)
+       {
+           LogDB_CtxLog(&ctx, "alarm fired");
+           LogDB_CtxClose(&ctx);
+       }
+
+   Records go to the DebugLog DB whatever sinks the app uses, and the
+   active DB is never rolled from here; the next LogDB_Log does that.
+   Below LOGDB_PRESSURE_DEFAULT_FULL free storage bytes (the app's own
+   pressure policy is not known here) LogDB_CtxLog adds nothing and
+   returns dmErrMemError. */
+typedef struct LogDB_CtxTag
+{
+    DmOpenRef dbR;    /* NULL once closed */
+    LocalID dbID;
+    UInt16 libRef;    /* LogDBClient builds: the library's */
+    UInt32 dmCalls;   /* Data Manager calls made through it */
+    Char appName[32];
+} LogDB_Ctx;
+
+Err LogDB_CtxInit(LogDB_Ctx *ctx, const Char *appName);
+Err LogDB_CtxLog(LogDB_Ctx *ctx, const Char *message);
+void LogDB_CtxClose(LogDB_Ctx *ctx);
+
+/* Rewrite any v1 records in the active DB and the segments as v2, in
+   place. Safe to run again; migratedP (optional) receives the count. */
+Err LogDB_Migrate(UInt16 *migratedP);
+
+/* Rewrite the oldest closed segment that still holds one record per entry
+   as packed blocks. One segment per call, so it can run a little at a
+   time from an idle loop; packedP (optional) receives the entries packed,
+   0 once every segment is done. */
+Err LogDB_Compact(UInt32 *packedP);
+
+/* Idle-time maintenance. Upkeep is queued as it comes due and run by
+   LogDB_Idle in small steps, each one a DB or file operation or one
+   packed block:
+     LOGDB_IDLE_FLUSH   write out the card stream's buffered block
+     LOGDB_IDLE_TRIM    delete the oldest segment while all
+                        LOGDB_MAX_SEGMENTS are in use, so a roll does
+                        not have to (one fewer segment is kept meanwhile)
+     LOGDB_IDLE_COMPACT pack closed segments, a block per step (what
+                        LogDB_Compact does a segment per call)
+   Every step's cost is estimated from the ones before it, and a step is
+   only started if it fits what is left of tickBudget; one that does not
+   counts as deferred and waits for the next call. Call it when
+   EvtGetEvent times out:
+
+       EvtGetEvent(&event, LogDB_Idle(0) ? IDLE_TIMEOUT : evtWaitForever);
+       ...
+       if (event.eType == nilEvent)
+           LogDB_Idle(IDLE_TICKS);
+
+   It returns true while work is queued. The counters go out as a
+   LOGDB_IDLE_MSG record with UInt32 fields n (calls), t (ticks spent)
+   and, per task, steps run and deferred: fl/flD, tr/trD, pk/pkD. */
+#define LOGDB_IDLE_FLUSH 0x0001
+#define LOGDB_IDLE_TRIM 0x0002
+#define LOGDB_IDLE_COMPACT 0x0004
+#define LOGDB_IDLE_TASKS 3
+#define LOGDB_IDLE_MSG "idle"
+
+typedef struct LogDB_IdleStatsTag
+{
+    UInt16 pending;                    /* LOGDB_IDLE_* queued */
+    UInt32 calls;                      /* LogDB_Idle calls with work queued */
+    UInt32 ticks;                      /* spent in steps */
+    UInt32 done[LOGDB_IDLE_TASKS];     /* steps run, by task bit */
+    UInt32 deferred[LOGDB_IDLE_TASKS]; /* steps that did not fit a budget */
+} LogDB_IdleStats;
+
+/* Run queued steps for up to tickBudget ticks (0 runs none: just asks
+   whether any are queued). */
+Boolean LogDB_Idle(UInt16 tickBudget);
+
+/* Counters since the last report, and what is queued. */
+void LogDB_IdleGetStats(LogDB_IdleStats *stats);
+
+/* Log the counters now (if LogDB_Idle ran since the last report) and
+   start them again. LogDB_Close calls it. */
+Err LogDB_IdleReport(void);
+
+/* Memory watermarks. With an interval set, LogDB_MemSample(false) logs a
+   LOGDB_MEM_MSG record once intervalTicks have passed since the last one
+   and returns at once otherwise, so it can be called from every trip
+   round the event loop (LogEvt_Dispatch does). Its UInt32 fields: df/dm
+   the dynamic heap's free bytes and largest free chunk, sf/sm the same
+   for the storage heap, db the active DebugLog DB's record bytes. A
+   sample that costs more than 1/LOGDB_MEM_SHARE of the interval doubles
+   the interval. LogDB_Close logs the session's low water marks (high for
+   db) as LOGDB_MEM_MARKS_MSG, with n the number of samples. */
+#define LOGDB_MEM_MSG "mem"
+#define LOGDB_MEM_MARKS_MSG "memMarks"
+#define LOGDB_MEM_SHARE 100
+
+/* 0 (the default) turns sampling off; LogDB_MemSample(true) still works. */
+void LogDB_SetMemInterval(UInt32 intervalTicks);
+
+/* Sample now (force) or when due. */
+Err LogDB_MemSample(Boolean force);
+
+/* Log the watermarks now and start a new session of them. LogDB_Close
+   calls it. */
+Err LogDB_MemReport(void);
+
+/* Storage pressure. Every checkEvery appends (a quarter as many once in
+   a tier) the storage heap's free bytes are read, and the tier they fall
+   in decides what goes into the DBs:
+     LOGDB_PRESSURE_NONE  everything
+     LOGDB_PRESSURE_LOW   all but sampled records; LogDB_Idle packs the
+                          closed segments
+     LOGDB_PRESSURE_HIGH  only records without fields; the oldest segment
+                          is deleted at each check until storage is clear
+                          of the tier or LOGDB_PRESSURE_KEEP_SEGMENTS are
+                          left, and packing (which needs room for a copy)
+                          waits
+     LOGDB_PRESSURE_FULL  nothing
+   The card stream still gets every record. A change of tier is logged as
+   a LOGDB_PRESSURE_MSG record with UInt32 fields t (the new tier), sf
+   (free storage bytes) and drop (records the tier left had dropped). A
+   tier is only left once free storage is a quarter above the bound that
+   brought it in, so it does not flap at the edge. */
+#define LOGDB_PRESSURE_NONE 0
+#define LOGDB_PRESSURE_LOW 1
+#define LOGDB_PRESSURE_HIGH 2
+#define LOGDB_PRESSURE_FULL 3
+#define LOGDB_PRESSURE_MSG "storage"
+#define LOGDB_PRESSURE_DEFAULT_LOW 131072UL
+#define LOGDB_PRESSURE_DEFAULT_HIGH 49152UL
+#define LOGDB_PRESSURE_DEFAULT_FULL 16384UL
+#define LOGDB_PRESSURE_DEFAULT_CHECK 32
+#define LOGDB_PRESSURE_KEEP_SEGMENTS 4 /* closed segments pressure never trims */
+
+/* Free storage bytes under which each tier starts; 0 takes the default.
+   A bound above the one before it is lowered to it. */
+typedef struct LogDB_PressurePolicyTag
+{
+    UInt32 lowBytes;
+    UInt32 highBytes;
+    UInt32 fullBytes;
+    UInt16 checkEvery; /* appends between checks */
+} LogDB_PressurePolicy;
+
+/* Set the storage pressure bounds (NULL restores the defaults). */
+void LogDB_SetPressurePolicy(const LogDB_PressurePolicy *policy);
+
+/* What LogDB has cost the app since LogDB_Init. Always counted: each
+   call adds to a few counters and reads the tick count once more (an
+   iterator call twice). dmCalls is every Data Manager call made for the
+   app, idle work included (DmGetLastErr aside, which only reads back an
+   error); an iterator keeps its own count and time, and LogDB_IterEnd
+   adds them in. LogDB's own records (idle, mem, storage markers) count
+   as calls. LogDB_Close logs the session's counters as a
+   LOGDB_STATS_MSG record with UInt32 fields n (calls), b (bytes), dm,
+   f (failures) and the ticks lt, it and ct (LogDB_StatsReport), unless
+   nothing was logged since the last LogDB_ClearAll or report. */
+#define LOGDB_STATS_MSG "stats"
+
+typedef struct LogDB_StatsTag
+{
+    UInt32 calls;      /* LogDB_Log, LogFields and LogSampled */
+    UInt32 bytes;      /* record bytes the sinks took, once per sink */
+    UInt32 dmCalls;    /* Data Manager calls */
+    UInt32 failures;   /* calls that returned an error */
+    UInt32 logTicks;   /* spent in those calls */
+    UInt32 iterTicks;  /* in iterator calls, IterBegin to IterEnd */
+    UInt32 clearTicks; /* in LogDB_ClearAll */
+} LogDB_Stats;
+
+/* The counters so far. */
+void LogDB_GetStats(LogDB_Stats *stats);
+
+/* Log the counters now as a LOGDB_STATS_MSG record. They keep counting;
+   LogDB_Close calls it. */
+Err LogDB_StatsReport(void);
+
+/* Remove all log records (deletes every segment, empties the active DB). */
 Err LogDB_ClearAll(void);
 
-/* Lightweight reader helpers for the viewer */
+/* Set the roll-over policy for the active DB (NULL restores defaults). */
+void LogDB_SetRollPolicy(const LogDB_RollPolicy *policy);
+
+/* Delete the per-app DBs of app (LOGDB_SINK_APPDB). */
+Err LogDB_ClearApp(const Char *app);
+
+/* Delete whole segments whose newest record is older than secs.
+   purgedP (optional) receives the number of segments deleted. */
+Err LogDB_PurgeBefore(UInt32 secs, UInt16 *purgedP);
+
+/* Archive-and-trim: drop the records HotSync has already backed up, so
+   the next sync sends only what is new. The DebugLog DBs keep the backup
+   bit, and HotSync stamps each DB it copies with its bckDate; records
+   older than their DB's bckDate go (closed segments whole, once their
+   newest record is older). Call it after a sync, at launch say; it is a
+   DmDatabaseInfo per DB when there is nothing to drop. droppedP
+   (optional) receives the number of records dropped. The card stream
+   and the per-app DBs are left alone.
+
+   HotSync replaces the desktop copy of "DebugLog" on every sync, so keep
+   each sync's backups: tools/LogMerge puts the history back together
+   from all of them. */
+Err LogDB_ArchiveTrim(UInt32 *droppedP);
+
+/* Lightweight reader helpers for the viewer.
+   Iteration runs oldest segment first and finishes with the active DB;
+   the card stream file is read front to back. The per-app DBs are all
+   open at once and merged: each call returns the oldest of their next
+   records. */
+#define LOGDB_TEXT_MAX 31  /* characters of a LogDB_IterSetText query kept */
+#define LOGDB_TEXT_WORDS 4 /* words of it used */
 typedef struct LogDB_IterTag
 {
-    DmOpenRef dbR;
-    UInt16 index;
-    UInt16 count;
+    DmOpenRef dbR; /* DB currently being read */
+    UInt16 index;  /* next record in dbR */
+    UInt16 count;  /* records in dbR */
+    UInt16 db;     /* next entry of dbIDs to open */
+    UInt16 numDBs;
+    LocalID dbIDs[LOGDB_MAX_SEGMENTS + 1]; /* not for LOGDB_SINK_APPDB */
+    UInt32 fromSecs;
+    UInt32 toSecs;
+
+    /* LOGDB_SINK_VFS source */
+    UInt16 sink;
+    FileRef fileRef;
+    MemHandle blockH; /* read-ahead block */
+    MemHandle frameH; /* current record, handed out by IterNext */
+    UInt16 frameLen;
+    UInt16 blockLen;
+    UInt16 blockPos;
+
+    /* Packed block being read (a record of dbR) */
+    MemHandle packH;
+    UInt16 packPos;   /* next entry */
+    UInt16 packCount;
+    UInt32 packSecs;  /* timestamp of the entry before packPos */
+    Int16 packApp;    /* app filter as an ID in packH, -1 for any */
+
+    /* LOGDB_SINK_APPDB source: a cursor per app DB (numDBs of them, in
+       a chunk of their own), opened on the first read (db is 1 from then
+       on) */
+    MemPtr merge;
+    UInt16 mergeCur; /* source of the entry last returned */
+
+    const Char *app;  /* LogDB_IterSetApp */
+
+    /* LogDB_IterSetText: its words, lower-cased, each NUL-terminated */
+    Char text[LOGDB_TEXT_MAX + 1];
+    UInt16 textWords;
+    UInt16 textHashed; /* words in textHash: those with a letter */
+    UInt32 textHash[LOGDB_TEXT_WORDS];
+    const UInt8 *bloomP; /* dbR's SortInfo block, locked, or NULL */
+    UInt16 bloomRuns;
+    UInt16 bloomFrom;
+    UInt32 runsRead;    /* runs of the DB sink read record by record */
+    UInt32 runsSkipped; /* and passed over on their filter */
+
+    /* For LogDB_GetStats, added in by LogDB_IterEnd */
+    UInt32 dmCalls;
+    UInt32 ticks;
 } LogDB_Iter;
 
 /* Begin iteration over all records (returns errNone or dmErrCantOpen). */
 Err LogDB_IterBegin(LogDB_Iter *it);
 
+/* Begin iteration over records stamped fromSecs..toSecs (inclusive).
+   Segments entirely outside the window are never opened. */
+Err LogDB_IterBeginRange(LogDB_Iter *it, UInt32 fromSecs, UInt32 toSecs);
+
+/* Same, reading the given backend (LOGDB_SINK_DB, _VFS or _APPDB). */
+Err LogDB_IterBeginSink(LogDB_Iter *it, UInt16 sink, UInt32 fromSecs, UInt32 toSecs);
+
+/* After IterBegin*: only return records logged by app (NULL for all).
+   Packed blocks are filtered on their app column, and the per-app DBs of
+   other apps are never opened; app must stay valid until IterEnd. */
+void LogDB_IterSetApp(LogDB_Iter *it, const Char *app);
+
+/* After IterBegin*: only return records whose message has every word of
+   text (NULL or no words for all). A word is a run of letters and digits,
+   compared without case; the first LOGDB_TEXT_WORDS that fit in
+   LOGDB_TEXT_MAX are used. Runs of the DB sink whose filter lacks one of
+   the words are passed over unread; runsRead and runsSkipped count them. */
+void LogDB_IterSetText(LogDB_Iter *it, const Char *text);
+
 /* Get next record; returns NULL when done.
    Out params (seconds, appPtr, msgPtr) point into locked memory.
-   You MUST call LogDB_IterUnlock after you’re done with the record. */
+   You MUST call LogDB_IterUnlock after you’re done with the record, and
+   before the next call (entries of a packed block share one handle). */
 MemHandle LogDB_IterNext(LogDB_Iter *it, UInt32 *seconds, Char **appPtr, Char **msgPtr);
 
+/* A record as returned by LogDB_IterNextEntry (points into locked memory). */
+typedef struct LogDB_EntryTag
+{
+    UInt32 seconds;
+    Char *app;
+    Char *msg;
+    const UInt8 *fields; /* encoded fields, NULL if there are none */
+    UInt16 fieldsLen;
+    UInt16 appLen;  /* StrLen(app), without calling it */
+    UInt16 msgLen;
+    UInt32 ticks;   /* TimGetTicks when logged; 0 for v1 records */
+    UInt16 rate;    /* calls this record stands for (1 unless sampled) */
+    UInt8 version;  /* 1 or 2; 3 for an entry of a packed block */
+} LogDB_Entry;
+
+/* Like LogDB_IterNext, also exposing the record's fields. */
+MemHandle LogDB_IterNextEntry(LogDB_Iter *it, LogDB_Entry *entry);
+
+/* Where the entry IterNextEntry last returned lives: the DB (an index
+   into it->dbIDs, or into the app DBs merged), the record and the entry
+   of a packed block, packed in a UInt32. LOGDB_POS_NONE for the card
+   stream, which has no positions. */
+#define LOGDB_POS_NONE 0xFFFFFFFFUL
+UInt32 LogDB_IterTell(const LogDB_Iter *it);
+
+/* Read back the entry at pos, as IterNextEntry would (unlock it the same
+   way); NULL if it is gone. pos must come from an iterator over the same
+   range, with the DBs unchanged since (compare their modNums). Time and
+   app filters do not apply; a later IterNextEntry carries on after pos. */
+MemHandle LogDB_IterSeekEntry(LogDB_Iter *it, UInt32 pos, LogDB_Entry *entry);
+
+/* Decode the field at *posP (start at 0) and advance past it. Returns
+   false at the end of the list or at a malformed field. */
+Boolean LogDB_FieldNext(const LogDB_Entry *entry, UInt16 *posP, LogDB_Field *field);
+
+/* First field named key (a C string); false if the record has none. */
+Boolean LogDB_FieldFind(const LogDB_Entry *entry, const Char *key, LogDB_Field *field);
+
 /* Unlock the currently locked MemHandle returned by IterNext. */
 void LogDB_IterUnlock(MemHandle h);
 
@@ -0,0 +1,382 @@
+/*
+    LogDB.h API forwarded to the LogDBLib shared library.
+
+    Linked into apps instead of LogDB.o when building with
+    LOGDB_LINK=syslib. The library is found (or loaded) on first use and
+    deliberately never removed, so the next launch finds it installed with
+    the DebugLog still open.
+*/
+
+#include "LogDB.h"
+#include "LogDBLib.h"
+
+static UInt16 sLibRef = sysInvalidRefNum;
+
+/* Find or load the library and open it, into *refP */
+static Err LogDBClient_Find(UInt16 *refP)
+{
+    Err err;
+
+    err = SysLibFind(LOGDBLIB_NAME, refP);
+    if (err != errNone)
+        err = SysLibLoad(LOGDBLIB_TYPE, LOGDBLIB_CREATOR, refP);
+    if (err == errNone)
+        err = LogDBLibOpen(*refP);
+    if (err != errNone)
+        *refP = sysInvalidRefNum;
+    return err;
+}
+
+static Err LogDBClient_Open(void)
+{
+    if (sLibRef != sysInvalidRefNum)
+        return errNone;
+    return LogDBClient_Find(&sLibRef);
+}
+
+Err LogDB_Init(const Char *appName)
+{
+    Err err;
+
+    err = LogDBClient_Open();
+    if (err != errNone)
+        return err;
+    return LogDBLibInit(sLibRef, appName);
+}
+
+Err LogDB_InitSinks(const Char *appName, UInt16 sinks)
+{
+    Err err;
+
+    err = LogDBClient_Open();
+    if (err != errNone)
+        return err;
+    return LogDBLibInitSinks(sLibRef, appName, sinks);
+}
+
+Err LogDB_SetAppName(const Char *appName)
+{
+    Err err;
+
+    err = LogDBClient_Open();
+    if (err != errNone)
+        return err;
+    return LogDBLibSetAppName(sLibRef, appName);
+}
+
+Err LogDB_Flush(void)
+{
+    if (sLibRef == sysInvalidRefNum)
+        return errNone;
+    return LogDBLibFlush(sLibRef);
+}
+
+void LogDB_Close(void)
+{
+    UInt16 useCount;
+
+    if (sLibRef == sysInvalidRefNum)
+        return;
+    /* This app's idle counters, watermarks, logging cost and buffered
+       card frames go out now; the library outlives us */
+    LogDBLibIdleReport(sLibRef);
+    LogDBLibMemReport(sLibRef);
+    LogDBLibStatsReport(sLibRef);
+    LogDBLibFlush(sLibRef);
+    /* Drop our open count only; the library stays loaded for the next app */
+    LogDBLibClose(sLibRef, &useCount);
+    sLibRef = sysInvalidRefNum;
+}
+
+Err LogDB_Log(const Char *message)
+{
+    Err err;
+
+    err = LogDBClient_Open();
+    if (err != errNone)
+        return err;
+    return LogDBLibLog(sLibRef, message);
+}
+
+Err LogDB_ClearAll(void)
+{
+    Err err;
+
+    err = LogDBClient_Open();
+    if (err != errNone)
+        return err;
+    return LogDBLibClearAll(sLibRef);
+}
+
+Err LogDB_ClearApp(const Char *app)
+{
+    Err err;
+
+    err = LogDBClient_Open();
+    if (err != errNone)
+        return err;
+    return LogDBLibClearApp(sLibRef, app);
+}
+
+Err LogDB_IterBegin(LogDB_Iter *it)
+{
+    Err err;
+
+    err = LogDBClient_Open();
+    if (err != errNone)
+        return err;
+    return LogDBLibIterBegin(sLibRef, it);
+}
+
+MemHandle LogDB_IterNext(LogDB_Iter *it, UInt32 *seconds, Char **appPtr, Char **msgPtr)
+{
+    if (sLibRef == sysInvalidRefNum)
+        return NULL;
+    return LogDBLibIterNext(sLibRef, it, seconds, appPtr, msgPtr);
+}
+
+void LogDB_IterUnlock(MemHandle h)
+{
+    if (sLibRef != sysInvalidRefNum)
+        LogDBLibIterUnlock(sLibRef, h);
+}
+
+void LogDB_IterEnd(LogDB_Iter *it)
+{
+    if (sLibRef != sysInvalidRefNum)
+        LogDBLibIterEnd(sLibRef, it);
+}
+
+void LogDB_SetRollPolicy(const LogDB_RollPolicy *policy)
+{
+    if (LogDBClient_Open() == errNone)
+        LogDBLibSetRollPolicy(sLibRef, policy);
+}
+
+void LogDB_SetPressurePolicy(const LogDB_PressurePolicy *policy)
+{
+    if (LogDBClient_Open() == errNone)
+        LogDBLibSetPressurePolicy(sLibRef, policy);
+}
+
+void LogDB_GetStats(LogDB_Stats *stats)
+{
+    if (sLibRef == sysInvalidRefNum)
+        MemSet(stats, sizeof(LogDB_Stats), 0);
+    else
+        LogDBLibGetStats(sLibRef, stats);
+}
+
+Err LogDB_PurgeBefore(UInt32 secs, UInt16 *purgedP)
+{
+    Err err;
+
+    err = LogDBClient_Open();
+    if (err != errNone)
+        return err;
+    return LogDBLibPurgeBefore(sLibRef, secs, purgedP);
+}
+
+Err LogDB_StatsReport(void)
+{
+    if (sLibRef == sysInvalidRefNum)
+        return errNone;
+    return LogDBLibStatsReport(sLibRef);
+}
+
+Err LogDB_ArchiveTrim(UInt32 *droppedP)
+{
+    Err err;
+
+    err = LogDBClient_Open();
+    if (err != errNone)
+        return err;
+    return LogDBLibArchiveTrim(sLibRef, droppedP);
+}
+
+Err LogDB_IterBeginRange(LogDB_Iter *it, UInt32 fromSecs, UInt32 toSecs)
+{
+    Err err;
+
+    err = LogDBClient_Open();
+    if (err != errNone)
+        return err;
+    return LogDBLibIterBeginRange(sLibRef, it, fromSecs, toSecs);
+}
+
+Err LogDB_IterBeginSink(LogDB_Iter *it, UInt16 sink, UInt32 fromSecs, UInt32 toSecs)
+{
+    Err err;
+
+    err = LogDBClient_Open();
+    if (err != errNone)
+        return err;
+    return LogDBLibIterBeginSink(sLibRef, it, sink, fromSecs, toSecs);
+}
+
+Err LogDB_LogFields(const Char *message, const LogDB_Field *fields, UInt16 numFields)
+{
+    Err err;
+
+    err = LogDBClient_Open();
+    if (err != errNone)
+        return err;
+    return LogDBLibLogFields(sLibRef, message, fields, numFields);
+}
+
+MemHandle LogDB_IterNextEntry(LogDB_Iter *it, LogDB_Entry *entry)
+{
+    if (sLibRef == sysInvalidRefNum)
+        return NULL;
+    return LogDBLibIterNextEntry(sLibRef, it, entry);
+}
+
+Boolean LogDB_FieldNext(const LogDB_Entry *entry, UInt16 *posP, LogDB_Field *field)
+{
+    if (sLibRef == sysInvalidRefNum)
+        return false;
+    return LogDBLibFieldNext(sLibRef, entry, posP, field);
+}
+
+Boolean LogDB_FieldFind(const LogDB_Entry *entry, const Char *key, LogDB_Field *field)
+{
+    if (sLibRef == sysInvalidRefNum)
+        return false;
+    return LogDBLibFieldFind(sLibRef, entry, key, field);
+}
+
+Err LogDB_LogSampled(UInt16 rate, const Char *message, const LogDB_Field *fields,
+                     UInt16 numFields)
+{
+    Err err;
+
+    err = LogDBClient_Open();
+    if (err != errNone)
+        return err;
+    return LogDBLibLogSampled(sLibRef, rate, message, fields, numFields);
+}
+
+Err LogDB_Migrate(UInt16 *migratedP)
+{
+    Err err;
+
+    err = LogDBClient_Open();
+    if (err != errNone)
+        return err;
+    return LogDBLibMigrate(sLibRef, migratedP);
+}
+
+Err LogDB_Compact(UInt32 *packedP)
+{
+    Err err;
+
+    err = LogDBClient_Open();
+    if (err != errNone)
+        return err;
+    return LogDBLibCompact(sLibRef, packedP);
+}
+
+void LogDB_IterSetApp(LogDB_Iter *it, const Char *app)
+{
+    if (sLibRef != sysInvalidRefNum)
+        LogDBLibIterSetApp(sLibRef, it, app);
+}
+
+void LogDB_IterSetText(LogDB_Iter *it, const Char *text)
+{
+    if (sLibRef != sysInvalidRefNum)
+        LogDBLibIterSetText(sLibRef, it, text);
+}
+
+UInt32 LogDB_IterTell(const LogDB_Iter *it)
+{
+    if (sLibRef == sysInvalidRefNum)
+        return LOGDB_POS_NONE;
+    return LogDBLibIterTell(sLibRef, it);
+}
+
+MemHandle LogDB_IterSeekEntry(LogDB_Iter *it, UInt32 pos, LogDB_Entry *entry)
+{
+    if (sLibRef == sysInvalidRefNum)
+        return NULL;
+    return LogDBLibIterSeekEntry(sLibRef, it, pos, entry);
+}
+
+void LogDB_SetMemInterval(UInt32 intervalTicks)
+{
+    if (LogDBClient_Open() == errNone)
+        LogDBLibSetMemInterval(sLibRef, intervalTicks);
+}
+
+/* Called on every event: without the library there is nothing to do */
+Err LogDB_MemSample(Boolean force)
+{
+    if (sLibRef == sysInvalidRefNum)
+        return errNone;
+    return LogDBLibMemSample(sLibRef, force);
+}
+
+Err LogDB_MemReport(void)
+{
+    if (sLibRef == sysInvalidRefNum)
+        return errNone;
+    return LogDBLibMemReport(sLibRef);
+}
+
+Boolean LogDB_Idle(UInt16 tickBudget)
+{
+    if (sLibRef == sysInvalidRefNum)
+        return false;
+    return LogDBLibIdle(sLibRef, tickBudget);
+}
+
+void LogDB_IdleGetStats(LogDB_IdleStats *stats)
+{
+    if (sLibRef == sysInvalidRefNum)
+        MemSet(stats, sizeof(LogDB_IdleStats), 0);
+    else
+        LogDBLibIdleGetStats(sLibRef, stats);
+}
+
+Err LogDB_IdleReport(void)
+{
+    if (sLibRef == sysInvalidRefNum)
+        return errNone;
+    return LogDBLibIdleReport(sLibRef);
+}
+
+/* No sLibRef here: the context keeps its own reference, so these work
+   from launch codes without globals */
+Err LogDB_CtxInit(LogDB_Ctx *ctx, const Char *appName)
+{
+    Err err;
+
+    if (ctx == NULL)
+        return dmErrInvalidParam;
+    ctx->dbR = NULL;
+    err = LogDBClient_Find(&ctx->libRef);
+    if (err != errNone)
+        return err;
+    err = LogDBLibCtxInit(ctx->libRef, ctx, appName);
+    if (err != errNone)
+        LogDB_CtxClose(ctx);
+    return err;
+}
+
+Err LogDB_CtxLog(LogDB_Ctx *ctx, const Char *message)
+{
+    if (ctx == NULL || ctx->libRef == sysInvalidRefNum)
+        return dmErrInvalidParam;
+    return LogDBLibCtxLog(ctx->libRef, ctx, message);
+}
+
+void LogDB_CtxClose(LogDB_Ctx *ctx)
+{
+    UInt16 useCount;
+
+    if (ctx == NULL || ctx->libRef == sysInvalidRefNum)
+        return;
+    LogDBLibCtxClose(ctx->libRef, ctx);
+    LogDBLibClose(ctx->libRef, &useCount);
+    ctx->libRef = sysInvalidRefNum;
+}
@@ -0,0 +1,135 @@
+#ifndef LOGDBLIB_H
+#define LOGDBLIB_H
+
+#include <PalmOS.h>
+#include "LogDB.h"
+
+/*
+    LogDBLib: LogDB packaged as a Palm OS shared library (SysLib).
+
+    The library is loaded once and left installed, and its globals keep
+    the DebugLog open (dmModeLeaveOpen) between app launches. Apps normally
+    do not call these traps directly: link LogDBClient.o instead of LogDB.o
+    (LOGDB_LINK=syslib) and keep using the LogDB.h API.
+*/
+
+#define LOGDBLIB_NAME "LogDBLib"
+#define LOGDBLIB_TYPE sysFileTLibrary
+#define LOGDBLIB_CREATOR 'LgDL'
+
+/* Custom trap numbers, in dispatch table order */
+#define logDBLibTrapInit (sysLibTrapCustom)
+#define logDBLibTrapLog (sysLibTrapCustom + 1)
+#define logDBLibTrapClearAll (sysLibTrapCustom + 2)
+#define logDBLibTrapIterBegin (sysLibTrapCustom + 3)
+#define logDBLibTrapIterNext (sysLibTrapCustom + 4)
+#define logDBLibTrapIterUnlock (sysLibTrapCustom + 5)
+#define logDBLibTrapIterEnd (sysLibTrapCustom + 6)
+#define logDBLibTrapSetRollPolicy (sysLibTrapCustom + 7)
+#define logDBLibTrapPurgeBefore (sysLibTrapCustom + 8)
+#define logDBLibTrapIterBeginRange (sysLibTrapCustom + 9)
+#define logDBLibTrapInitSinks (sysLibTrapCustom + 10)
+#define logDBLibTrapFlush (sysLibTrapCustom + 11)
+#define logDBLibTrapIterBeginSink (sysLibTrapCustom + 12)
+#define logDBLibTrapLogFields (sysLibTrapCustom + 13)
+#define logDBLibTrapIterNextEntry (sysLibTrapCustom + 14)
+#define logDBLibTrapFieldNext (sysLibTrapCustom + 15)
+#define logDBLibTrapFieldFind (sysLibTrapCustom + 16)
+#define logDBLibTrapLogSampled (sysLibTrapCustom + 17)
+#define logDBLibTrapMigrate (sysLibTrapCustom + 18)
+#define logDBLibTrapCompact (sysLibTrapCustom + 19)
+#define logDBLibTrapIterSetApp (sysLibTrapCustom + 20)
+#define logDBLibTrapIterTell (sysLibTrapCustom + 21)
+#define logDBLibTrapIterSeekEntry (sysLibTrapCustom + 22)
+#define logDBLibTrapSetMemInterval (sysLibTrapCustom + 23)
+#define logDBLibTrapMemSample (sysLibTrapCustom + 24)
+#define logDBLibTrapMemReport (sysLibTrapCustom + 25)
+#define logDBLibTrapClearApp (sysLibTrapCustom + 26)
+#define logDBLibTrapIdle (sysLibTrapCustom + 27)
+#define logDBLibTrapIdleGetStats (sysLibTrapCustom + 28)
+#define logDBLibTrapIdleReport (sysLibTrapCustom + 29)
+#define logDBLibTrapIterSetText (sysLibTrapCustom + 30)
+#define logDBLibTrapCtxInit (sysLibTrapCustom + 31)
+#define logDBLibTrapCtxLog (sysLibTrapCustom + 32)
+#define logDBLibTrapCtxClose (sysLibTrapCustom + 33)
+#define logDBLibTrapSetPressurePolicy (sysLibTrapCustom + 34)
+#define logDBLibTrapGetStats (sysLibTrapCustom + 35)
+#define logDBLibTrapArchiveTrim (sysLibTrapCustom + 36)
+#define logDBLibTrapStatsReport (sysLibTrapCustom + 37)
+#define logDBLibTrapSetAppName (sysLibTrapCustom + 38)
+
+/* The library itself is compiled without the trap attributes */
+#ifdef BUILDING_LOGDBLIB
+#define LOGDBLIB_TRAP(trapNum)
+#else
+#define LOGDBLIB_TRAP(trapNum) SYS_TRAP(trapNum)
+#endif
+
+/* Standard SysLib entry points */
+Err LogDBLibOpen(UInt16 refNum) LOGDBLIB_TRAP(sysLibTrapOpen);
+Err LogDBLibClose(UInt16 refNum, UInt16 *useCountP) LOGDBLIB_TRAP(sysLibTrapClose);
+Err LogDBLibSleep(UInt16 refNum) LOGDBLIB_TRAP(sysLibTrapSleep);
+Err LogDBLibWake(UInt16 refNum) LOGDBLIB_TRAP(sysLibTrapWake);
+
+/* LogDB.h API, one trap per call */
+Err LogDBLibInit(UInt16 refNum, const Char *appName) LOGDBLIB_TRAP(logDBLibTrapInit);
+Err LogDBLibLog(UInt16 refNum, const Char *message) LOGDBLIB_TRAP(logDBLibTrapLog);
+Err LogDBLibClearAll(UInt16 refNum) LOGDBLIB_TRAP(logDBLibTrapClearAll);
+Err LogDBLibIterBegin(UInt16 refNum, LogDB_Iter *it) LOGDBLIB_TRAP(logDBLibTrapIterBegin);
+MemHandle LogDBLibIterNext(UInt16 refNum, LogDB_Iter *it, UInt32 *seconds, Char **appPtr,
+                           Char **msgPtr) LOGDBLIB_TRAP(logDBLibTrapIterNext);
+void LogDBLibIterUnlock(UInt16 refNum, MemHandle h) LOGDBLIB_TRAP(logDBLibTrapIterUnlock);
+void LogDBLibIterEnd(UInt16 refNum, LogDB_Iter *it) LOGDBLIB_TRAP(logDBLibTrapIterEnd);
+void LogDBLibSetRollPolicy(UInt16 refNum, const LogDB_RollPolicy *policy)
+    LOGDBLIB_TRAP(logDBLibTrapSetRollPolicy);
+Err LogDBLibPurgeBefore(UInt16 refNum, UInt32 secs, UInt16 *purgedP)
+    LOGDBLIB_TRAP(logDBLibTrapPurgeBefore);
+Err LogDBLibIterBeginRange(UInt16 refNum, LogDB_Iter *it, UInt32 fromSecs, UInt32 toSecs)
+    LOGDBLIB_TRAP(logDBLibTrapIterBeginRange);
+Err LogDBLibInitSinks(UInt16 refNum, const Char *appName, UInt16 sinks)
+    LOGDBLIB_TRAP(logDBLibTrapInitSinks);
+Err LogDBLibFlush(UInt16 refNum) LOGDBLIB_TRAP(logDBLibTrapFlush);
+Err LogDBLibIterBeginSink(UInt16 refNum, LogDB_Iter *it, UInt16 sink, UInt32 fromSecs,
+                          UInt32 toSecs) LOGDBLIB_TRAP(logDBLibTrapIterBeginSink);
+Err LogDBLibLogFields(UInt16 refNum, const Char *message, const LogDB_Field *fields,
+                      UInt16 numFields) LOGDBLIB_TRAP(logDBLibTrapLogFields);
+MemHandle LogDBLibIterNextEntry(UInt16 refNum, LogDB_Iter *it, LogDB_Entry *entry)
+    LOGDBLIB_TRAP(logDBLibTrapIterNextEntry);
+Boolean LogDBLibFieldNext(UInt16 refNum, const LogDB_Entry *entry, UInt16 *posP,
+                          LogDB_Field *field) LOGDBLIB_TRAP(logDBLibTrapFieldNext);
+Boolean LogDBLibFieldFind(UInt16 refNum, const LogDB_Entry *entry, const Char *key,
+                          LogDB_Field *field) LOGDBLIB_TRAP(logDBLibTrapFieldFind);
+Err LogDBLibLogSampled(UInt16 refNum, UInt16 rate, const Char *message,
+                       const LogDB_Field *fields, UInt16 numFields)
+    LOGDBLIB_TRAP(logDBLibTrapLogSampled);
+Err LogDBLibMigrate(UInt16 refNum, UInt16 *migratedP) LOGDBLIB_TRAP(logDBLibTrapMigrate);
+Err LogDBLibCompact(UInt16 refNum, UInt32 *packedP) LOGDBLIB_TRAP(logDBLibTrapCompact);
+void LogDBLibIterSetApp(UInt16 refNum, LogDB_Iter *it, const Char *app)
+    LOGDBLIB_TRAP(logDBLibTrapIterSetApp);
+UInt32 LogDBLibIterTell(UInt16 refNum, const LogDB_Iter *it) LOGDBLIB_TRAP(logDBLibTrapIterTell);
+MemHandle LogDBLibIterSeekEntry(UInt16 refNum, LogDB_Iter *it, UInt32 pos, LogDB_Entry *entry)
+    LOGDBLIB_TRAP(logDBLibTrapIterSeekEntry);
+void LogDBLibSetMemInterval(UInt16 refNum, UInt32 intervalTicks)
+    LOGDBLIB_TRAP(logDBLibTrapSetMemInterval);
+Err LogDBLibMemSample(UInt16 refNum, Boolean force) LOGDBLIB_TRAP(logDBLibTrapMemSample);
+Err LogDBLibMemReport(UInt16 refNum) LOGDBLIB_TRAP(logDBLibTrapMemReport);
+Err LogDBLibClearApp(UInt16 refNum, const Char *app) LOGDBLIB_TRAP(logDBLibTrapClearApp);
+Boolean LogDBLibIdle(UInt16 refNum, UInt16 tickBudget) LOGDBLIB_TRAP(logDBLibTrapIdle);
+void LogDBLibIdleGetStats(UInt16 refNum, LogDB_IdleStats *stats)
+    LOGDBLIB_TRAP(logDBLibTrapIdleGetStats);
+Err LogDBLibIdleReport(UInt16 refNum) LOGDBLIB_TRAP(logDBLibTrapIdleReport);
+void LogDBLibIterSetText(UInt16 refNum, LogDB_Iter *it, const Char *text)
+    LOGDBLIB_TRAP(logDBLibTrapIterSetText);
+Err LogDBLibCtxInit(UInt16 refNum, LogDB_Ctx *ctx, const Char *appName)
+    LOGDBLIB_TRAP(logDBLibTrapCtxInit);
+Err LogDBLibCtxLog(UInt16 refNum, LogDB_Ctx *ctx, const Char *message)
+    LOGDBLIB_TRAP(logDBLibTrapCtxLog);
+void LogDBLibCtxClose(UInt16 refNum, LogDB_Ctx *ctx) LOGDBLIB_TRAP(logDBLibTrapCtxClose);
+void LogDBLibSetPressurePolicy(UInt16 refNum, const LogDB_PressurePolicy *policy)
+    LOGDBLIB_TRAP(logDBLibTrapSetPressurePolicy);
+void LogDBLibGetStats(UInt16 refNum, LogDB_Stats *stats) LOGDBLIB_TRAP(logDBLibTrapGetStats);
+Err LogDBLibArchiveTrim(UInt16 refNum, UInt32 *droppedP) LOGDBLIB_TRAP(logDBLibTrapArchiveTrim);
+Err LogDBLibStatsReport(UInt16 refNum) LOGDBLIB_TRAP(logDBLibTrapStatsReport);
+Err LogDBLibSetAppName(UInt16 refNum, const Char *appName) LOGDBLIB_TRAP(logDBLibTrapSetAppName);
+
+#endif /* LOGDBLIB_H */
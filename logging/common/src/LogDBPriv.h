@@ -0,0 +1,258 @@
+#ifndef LOGDB_PRIV_H
+#define LOGDB_PRIV_H
+
+#include "LogDB.h"
+
+/*
+    Internal state and entry points shared by the LogDB sources.
+
+    All mutable LogDB state lives in LogDB_Globals. The static build keeps
+    one instance in LogDB.c; the LogDBLib shared library keeps it in its
+    SysLib globals (LOGDB_SYSLIB builds have no file-scope state at all),
+    so it survives from one app launch to the next.
+*/
+
+typedef struct LogDB_GlobalsTag
+{
+    DmOpenRef dbR;     /* read/write ref, NULL until first use */
+    LocalID dbID;      /* cached so re-opens skip DmFindDatabase */
+    Char appName[32];  /* short name is fine; truncated if needed */
+
+    /* Active DB bookkeeping for roll-over (loaded on open) */
+    LogDB_RollPolicy roll;
+    UInt16 activeCount;
+    UInt32 activeBytes;
+    UInt32 activeFirstSecs; /* 0 while empty */
+    UInt32 activeLoSecs;    /* its records' time range, for the roll's summary */
+    UInt32 activeHiSecs;
+    UInt16 rollHold;        /* a roll failed: no retry below this count */
+
+    /* The active DB's word filters (LogBloom.c) */
+    LocalID bloomID;  /* its SortInfo block, 0 until the first append */
+    Boolean bloomOff; /* none are kept (no room, or a foreign block) */
+    UInt16 bloomRuns;
+    UInt16 bloomFrom;
+    UInt16 bloomRun;  /* run held in bloomBits, LOGBLOOM_NO_RUN for none */
+    UInt8 bloomBits[LOGDB_BLOOM_BYTES];
+
+    UInt16 sinks; /* LOGDB_SINK_* in use; 0 = DB only */
+
+    /* Per-app DB sink */
+    DmOpenRef appR;                 /* NULL while closed */
+    UInt16 appCount;                /* records in appR */
+    UInt16 appHold;                 /* a roll failed: no retry below this count */
+    Char appDbName[dmDBNameLength]; /* what appR was opened as */
+
+    /* Memory sampler (LogMem.c) */
+    UInt32 memInterval; /* ticks; 0 = off */
+    UInt32 memLast;     /* TimGetTicks of the last sample */
+    UInt16 memSamples;  /* since the last report */
+    UInt32 memLow[4];   /* df, dm, sf, sm */
+    UInt32 memHighDB;
+
+    /* Storage pressure (LogPressure.c) */
+    LogDB_PressurePolicy pressure; /* bounds in force, defaults filled in */
+    UInt16 pressureTier;           /* LOGDB_PRESSURE_* */
+    UInt16 pressureCheck;          /* appends until the next check; 0 = now */
+    UInt32 pressureDropped;        /* records kept out of the DBs in this tier */
+    Boolean pressureMarking;       /* a tier marker is on its way: let it in */
+
+    /* What logging has cost the app (LogDB_GetStats) */
+    LogDB_Stats stats;
+    UInt32 statsCleared; /* stats.calls at the last LogDB_ClearAll or report */
+
+    /* Idle-time maintenance (LogIdle.c) */
+    UInt16 idleCost[LOGDB_IDLE_TASKS]; /* ticks a step is expected to take */
+    LogDB_IdleStats idle;
+    LocalID packSegID; /* segment an idle compaction is copying, 0 = none */
+    UInt16 packNext;   /* its next record */
+    UInt32 packBytes;  /* block bytes written so far */
+
+    /* Card stream sink */
+    UInt16 vfsVolRef;
+    FileRef vfsFile;             /* 0 while closed */
+    UInt16 vfsUsed;              /* bytes waiting in vfsBuf */
+    UInt8 vfsBuf[LOGDB_VFS_BLOCK];
+} LogDB_Globals;
+
+/* One record on its way to the sinks */
+typedef struct LogDB_RecTag
+{
+    UInt32 secs;
+    UInt32 ticks;
+    UInt16 rate; /* 1 unless sampled */
+    const Char *app;
+    const Char *msg;
+    const UInt8 *fields; /* encoded, see LogField.c */
+    UInt16 appLen;
+    UInt16 msgLen;
+    UInt16 fieldsLen;
+} LogDB_Rec;
+
+/* Every Data Manager call is made through LOGDB_DM, which first adds
+   one to the UInt32 n: g->stats.dmCalls (LOGDB_DMG), an iterator's
+   dmCalls, or *dmP in helpers that have neither. */
+#define LOGDB_DM(n, call) ((n)++, (call))
+#define LOGDB_DMG(g, call) LOGDB_DM((g)->stats.dmCalls, call)
+
+/* The shared library leaves the DB open across app launches. */
+#ifdef LOGDB_SYSLIB
+#define LOGDB_RW_MODE (dmModeReadWrite | dmModeLeaveOpen)
+#else
+#define LOGDB_RW_MODE dmModeReadWrite
+#endif
+
+/* Record layout helpers (LogRec.c). Multi-byte fields are big-endian
+   whatever the host, so DB records and stream frames read the same
+   everywhere. RecEncodeHead writes the header and app name (the part
+   before the message) and returns its size; RecDecode takes v1 and v2
+   and returns false for a malformed record. */
+UInt16 LogDB_Get16(const UInt8 *p);
+UInt32 LogDB_Get32(const UInt8 *p);
+void LogDB_Put16(UInt8 *p, UInt16 v);
+void LogDB_Put32(UInt8 *p, UInt32 v);
+UInt8 LogDB_RecKind(const UInt8 *rec); /* LOGDB_REC_V1, _V2 or _BLOCK */
+UInt32 LogDB_RecSeconds(const UInt8 *rec);
+UInt32 LogDB_RecSize(const LogDB_Rec *rec);
+UInt16 LogDB_RecEncodeHead(const LogDB_Rec *rec, UInt8 *dst);
+void LogDB_RecEncode(const LogDB_Rec *rec, UInt8 *dst);
+Boolean LogDB_RecDecode(const UInt8 *p, UInt32 size, LogDB_Entry *entry);
+Err LogDB_MigrateG(LogDB_Globals *g, UInt16 *migratedP);
+
+/* Open (creating it if need be) the active DebugLog DB in mode, by
+   *dbIDP when that is set; *dbIDP is updated. */
+Err LogDB_OpenActiveRef(UInt16 mode, DmOpenRef *dbRP, LocalID *dbIDP, UInt32 *dmP);
+Err LogDB_OpenOrCreate(LogDB_Globals *g);
+Err LogDB_InitG(LogDB_Globals *g, const Char *appName);
+Err LogDB_InitSinksG(LogDB_Globals *g, const Char *appName, UInt16 sinks);
+Err LogDB_SetAppNameG(LogDB_Globals *g, const Char *appName);
+void LogDB_CloseG(LogDB_Globals *g);
+Err LogDB_FlushG(LogDB_Globals *g);
+Err LogDB_IterBeginSinkG(LogDB_Globals *g, LogDB_Iter *it, UInt16 sink, UInt32 fromSecs,
+                         UInt32 toSecs);
+void LogDB_IterEndG(LogDB_Globals *g, LogDB_Iter *it);
+void LogDB_GetStatsG(LogDB_Globals *g, LogDB_Stats *stats);
+Err LogDB_StatsReportG(LogDB_Globals *g);
+Err LogDB_LogG(LogDB_Globals *g, const Char *message);
+Err LogDB_LogFieldsG(LogDB_Globals *g, const Char *message, const LogDB_Field *fields,
+                     UInt16 numFields);
+Err LogDB_LogSampledG(LogDB_Globals *g, UInt16 rate, const Char *message,
+                      const LogDB_Field *fields, UInt16 numFields);
+Err LogDB_CompactG(LogDB_Globals *g, UInt32 *packedP);
+void LogDB_SetMemIntervalG(LogDB_Globals *g, UInt32 intervalTicks);
+Err LogDB_MemSampleG(LogDB_Globals *g, Boolean force);
+Err LogDB_MemReportG(LogDB_Globals *g);
+Err LogDB_ClearAllG(LogDB_Globals *g);
+Err LogDB_ClearAppG(LogDB_Globals *g, const Char *app);
+void LogDB_SetRollPolicyG(LogDB_Globals *g, const LogDB_RollPolicy *policy);
+void LogDB_SetPressurePolicyG(LogDB_Globals *g, const LogDB_PressurePolicy *policy);
+Err LogDB_PurgeBeforeG(LogDB_Globals *g, UInt32 secs, UInt16 *purgedP);
+Err LogDB_ArchiveTrimG(LogDB_Globals *g, UInt32 *droppedP); /* LogArchive.c */
+Boolean LogDB_IdleG(LogDB_Globals *g, UInt16 tickBudget);
+void LogDB_IdleGetStatsG(LogDB_Globals *g, LogDB_IdleStats *stats);
+Err LogDB_IdleReportG(LogDB_Globals *g);
+
+/* Word filters (LogBloom.c). Load picks up the active DB's after it is
+   (re)opened; Add sets the words of msg in record index's run, and AddTo
+   does the same in dbID's filters without the writer's state (a DB with
+   no filters yet is left alone). On the read side IterOpen locks the
+   open DB's and IterClose lets go; IterRun is called at the start of
+   each run and returns false, with it->index past the run, when its
+   filter rules the run out. Matches is the exact test for one entry. */
+#define LOGBLOOM_NO_RUN 0xFFFF
+void LogBloom_Load(LogDB_Globals *g);
+void LogBloom_Add(LogDB_Globals *g, UInt16 index, const Char *msg, UInt16 msgLen);
+void LogBloom_AddTo(LocalID dbID, UInt16 index, const Char *msg, UInt16 msgLen, UInt32 *dmP);
+void LogBloom_IterOpen(LogDB_Iter *it, LocalID dbID);
+void LogBloom_IterClose(LogDB_Iter *it);
+Boolean LogBloom_IterRun(LogDB_Iter *it);
+Boolean LogBloom_Matches(const LogDB_Iter *it, const LogDB_Entry *entry);
+
+/* Idle work (LogIdle.c): queue LOGDB_IDLE_* bits for LogDB_Idle. Trim
+   deletes the oldest segment while every slot is in use, or any time
+   storage is under pressure. */
+void LogIdle_Queue(LogDB_Globals *g, UInt16 work);
+void LogIdle_Trim(LogDB_Globals *g);
+
+/* Storage pressure (LogPressure.c). Admit says whether rec may go to the
+   storage heap sinks, checking the tier when one is due; Check reads
+   free storage and moves to the tier it falls in; TrimDue says whether
+   the oldest of closed segments should go to make room. */
+Boolean LogPressure_Admit(LogDB_Globals *g, const LogDB_Rec *rec);
+void LogPressure_Check(LogDB_Globals *g);
+Boolean LogPressure_TrimDue(LogDB_Globals *g, UInt16 closed);
+
+/* Segments (LogSeg.c). ReadInfo returns false (and an unbounded range, so
+   the segment is never skipped) when the summary is missing. List gives
+   the oldest max segments in the range, in order, having looked at every
+   one; totalP (optional) receives how many are in the range and maxSeqP
+   (optional) the highest number of them all.
+   Appended counts a record added to the end of the active DB. */
+Boolean LogSeg_ReadInfo(LocalID dbID, LogDB_SegInfo *info, UInt32 *dmP);
+LocalID LogSeg_NewInfo(DmOpenRef dbR, const LogDB_SegInfo *info, UInt32 *dmP);
+void LogSeg_LoadActive(LogDB_Globals *g);
+void LogSeg_Appended(LogDB_Globals *g, UInt32 secs, UInt32 size);
+Boolean LogSeg_ShouldRoll(const LogDB_Globals *g, UInt32 nowSecs, UInt32 recSize);
+Err LogSeg_Roll(LogDB_Globals *g);
+UInt16 LogSeg_List(LocalID *ids, UInt16 *seqs, UInt16 max, UInt32 fromSecs, UInt32 toSecs,
+                   UInt16 *totalP, UInt16 *maxSeqP, UInt32 *dmP);
+Err LogSeg_DeleteAll(UInt32 *dmP);
+
+/* Packed blocks (LogPack.c). IterEnter starts reading the block p (the
+   locked record h) and returns false if nothing in it can match; IterNext
+   returns its next matching entry, locked, or NULL once it is used up.
+   EntryAt decodes entry i of a block, false if there is none. */
+Boolean LogPack_IterEnter(LogDB_Iter *it, MemHandle h, const UInt8 *p, UInt32 size);
+MemHandle LogPack_IterNext(LogDB_Iter *it, LogDB_Entry *entry);
+Boolean LogPack_EntryAt(const UInt8 *p, UInt32 size, UInt16 i, LogDB_Entry *entry);
+
+/* One step of an idle compaction: start on the oldest unpacked segment,
+   pack one block of it, or swap the finished copy in. *moreP is false
+   once there is nothing left to pack, or after an error. */
+Err LogPack_Step(LogDB_Globals *g, Boolean *moreP);
+
+/* Field encoding (LogField.c): bytes written to dst (at most
+   LOGDB_FIELDS_MAX_BYTES), or -1 if the fields do not fit. */
+Int16 LogField_Encode(const LogDB_Field *fields, UInt16 numFields, UInt8 *dst);
+
+/* Sink dispatch (LogSink.c) */
+Err LogSink_Open(LogDB_Globals *g, UInt16 sinks);
+Err LogSink_Write(LogDB_Globals *g, const LogDB_Rec *rec);
+Err LogSink_Flush(LogDB_Globals *g);
+void LogSink_Close(LogDB_Globals *g);
+
+/* DebugLog DB sink (LogDB.c). AppendRec adds rec, LogDB_RecSize bytes,
+   at the end of dbR, and sets *indexP (optional) to where it went; the
+   per-app sink writes through it too. */
+Err LogDB_AppendRec(DmOpenRef dbR, const LogDB_Rec *rec, UInt32 size, UInt16 *indexP,
+                    UInt32 *dmP);
+Err LogSinkDB_Open(LogDB_Globals *g);
+Err LogSinkDB_Write(LogDB_Globals *g, const LogDB_Rec *rec);
+void LogSinkDB_Close(LogDB_Globals *g);
+
+/* Card stream sink (LogSinkVfs.c) */
+Err LogSinkVfs_Open(LogDB_Globals *g);
+Err LogSinkVfs_Write(LogDB_Globals *g, const LogDB_Rec *rec);
+Err LogSinkVfs_Flush(LogDB_Globals *g);
+void LogSinkVfs_Close(LogDB_Globals *g);
+Err LogSinkVfs_Clear(LogDB_Globals *g);
+Err LogSinkVfs_IterBegin(LogDB_Iter *it);
+MemHandle LogSinkVfs_IterNext(LogDB_Iter *it);
+void LogSinkVfs_IterEnd(LogDB_Iter *it);
+
+/* Per-app DB sink (LogSinkApp.c). Clear deletes app's DBs, or every
+   app's for NULL. IterNext returns the oldest next record of the merged
+   DBs, unlocked, NULL at the end; IterSeek moves source db to index and
+   returns that record. */
+Err LogSinkApp_Open(LogDB_Globals *g);
+Err LogSinkApp_Write(LogDB_Globals *g, const LogDB_Rec *rec);
+void LogSinkApp_Close(LogDB_Globals *g);
+Err LogSinkApp_Clear(LogDB_Globals *g, const Char *app);
+Err LogSinkApp_IterBegin(LogDB_Iter *it);
+void LogSinkApp_IterSetApp(LogDB_Iter *it, const Char *app);
+MemHandle LogSinkApp_IterNext(LogDB_Iter *it);
+MemHandle LogSinkApp_IterSeek(LogDB_Iter *it, UInt16 db, UInt16 index);
+UInt32 LogSinkApp_IterTell(const LogDB_Iter *it);
+void LogSinkApp_IterEnd(LogDB_Iter *it);
+
+#endif /* LOGDB_PRIV_H */
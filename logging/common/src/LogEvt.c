@@ -0,0 +1,165 @@
+/*
+    Instrumented event loop (see LogEvt.h).
+
+    Totals are kept per eType and per stage; the histogram bucket is the
+    bit length of the event's total ticks. Ticks are coarse (10 ms on
+    most devices), so most events land in bucket 0: the buckets above it
+    are the ones worth reading.
+*/
+
+#include <PalmOS.h>
+#include "LogDB.h"
+#include "LogEvt.h"
+
+void LogEvt_Init(LogEvt_Loop *loop, UInt16 budgetTicks)
+{
+    MemSet(loop, sizeof(LogEvt_Loop), 0);
+    if (budgetTicks == 0)
+        budgetTicks = (UInt16)(SysTicksPerSecond() * LOGEVT_DEFAULT_BUDGET_MS / 1000);
+    loop->budget = budgetTicks;
+}
+
+void LogEvt_SetRing(LogEvt_Loop *loop, LogRing_Buffer *ring)
+{
+    loop->ring = ring;
+}
+
+/* Something to tell events of one type apart in a "slowEvent" record. */
+static UInt16 LogEvt_Detail(const EventType *eventP)
+{
+    switch (eventP->eType)
+    {
+    case keyDownEvent:
+        return eventP->data.keyDown.chr;
+    case ctlSelectEvent:
+        return eventP->data.ctlSelect.controlID;
+    case popSelectEvent:
+        return eventP->data.popSelect.listID;
+    case menuEvent:
+        return eventP->data.menu.itemID;
+    case frmLoadEvent:
+        return eventP->data.frmLoad.formID;
+    case frmOpenEvent:
+        return eventP->data.frmOpen.formID;
+    default:
+        return 0;
+    }
+}
+
+static void LogEvt_Slow(LogEvt_Loop *loop, const EventType *eventP, UInt16 sys, UInt16 menu,
+                        UInt16 form)
+{
+    LogDB_Field f[6];
+
+    if (++loop->slow > LOGEVT_MAX_SLOW)
+        return;
+    LogDB_FieldUInt32(&f[0], "type", eventP->eType);
+    LogDB_FieldUInt32(&f[1], "sys", sys);
+    LogDB_FieldUInt32(&f[2], "menu", menu);
+    LogDB_FieldUInt32(&f[3], "form", form);
+    LogDB_FieldUInt32(&f[4], "detail", LogEvt_Detail(eventP));
+    LogDB_FieldUInt32(&f[5], "frmId", FrmGetActiveFormID());
+    LogDB_LogFields("slowEvent", f, 6);
+}
+
+void LogEvt_Dispatch(LogEvt_Loop *loop, EventType *eventP, LogEvt_AppHandler appHandler)
+{
+    LogEvt_Stats *st;
+    UInt32 t0;
+    UInt32 t1;
+    UInt32 t2;
+    UInt32 t3;
+    UInt16 err;
+    UInt16 total;
+    UInt16 bucket;
+    Boolean handled;
+
+    /* The chain as each app wrote it, with a tick read between stages */
+    t0 = TimGetTicks();
+    handled = SysHandleEvent(eventP);
+    t1 = TimGetTicks();
+    t2 = t1;
+    t3 = t1;
+    if (!handled)
+    {
+        handled = MenuHandleEvent(0, eventP, &err);
+        t2 = TimGetTicks();
+        t3 = t2;
+        if (!handled)
+        {
+            if (!appHandler(eventP))
+                FrmDispatchEvent(eventP);
+            t3 = TimGetTicks();
+        }
+    }
+
+    st = &loop->stats[(eventP->eType < LOGEVT_TYPES) ? eventP->eType : LOGEVT_OTHER];
+    st->count++;
+    st->sysTicks += t1 - t0;
+    st->menuTicks += t2 - t1;
+    st->formTicks += t3 - t2;
+    total = (t3 - t0 > 0xFFFF) ? 0xFFFF : (UInt16)(t3 - t0);
+    if (total > st->maxTicks)
+        st->maxTicks = total;
+    for (bucket = 0; bucket < LOGEVT_BUCKETS - 1 && (total >> bucket) != 0; bucket++)
+        ;
+    if (st->buckets[bucket] < 0xFFFF)
+        st->buckets[bucket]++;
+
+    if (total > loop->budget)
+        LogEvt_Slow(loop, eventP, (UInt16)(t1 - t0), (UInt16)(t2 - t1), (UInt16)(t3 - t2));
+
+    /* Memory watermarks, if the app asked for them (LogDB_SetMemInterval) */
+    LogDB_MemSample(false);
+
+    /* Lines from callbacks (their EvtWakeup brought us here) */
+    if (loop->ring != NULL)
+        LogRing_Drain(loop->ring);
+}
+
+void LogEvt_Run(LogEvt_Loop *loop, LogEvt_AppHandler appHandler)
+{
+    EventType event;
+
+    do
+    {
+        EvtGetEvent(&event, evtWaitForever);
+        LogEvt_Dispatch(loop, &event, appHandler);
+    } while (event.eType != appStopEvent);
+}
+
+void LogEvt_Report(const LogEvt_Loop *loop)
+{
+    const LogEvt_Stats *st;
+    LogDB_Field f[6 + LOGEVT_BUCKETS];
+    Char keys[LOGEVT_BUCKETS][3]; /* "h0".."h6" */
+    UInt16 type;
+    UInt16 i;
+
+    for (i = 0; i < LOGEVT_BUCKETS; i++)
+    {
+        keys[i][0] = 'h';
+        keys[i][1] = (Char)('0' + i);
+        keys[i][2] = 0;
+    }
+    for (type = 0; type <= LOGEVT_OTHER; type++)
+    {
+        st = &loop->stats[type];
+        if (st->count == 0)
+            continue;
+        LogDB_FieldUInt32(&f[0], "type", type);
+        LogDB_FieldUInt32(&f[1], "n", st->count);
+        LogDB_FieldUInt32(&f[2], "max", st->maxTicks);
+        LogDB_FieldUInt32(&f[3], "sys", st->sysTicks);
+        LogDB_FieldUInt32(&f[4], "menu", st->menuTicks);
+        LogDB_FieldUInt32(&f[5], "form", st->formTicks);
+        for (i = 0; i < LOGEVT_BUCKETS; i++)
+            LogDB_FieldUInt32(&f[6 + i], keys[i], st->buckets[i]);
+        LogDB_LogFields("evtStats", f, 6 + LOGEVT_BUCKETS);
+    }
+    if (loop->slow > LOGEVT_MAX_SLOW)
+    {
+        LogDB_FieldUInt32(&f[0], "slow", loop->slow);
+        LogDB_LogFields("slowEvent dropped", f, 1);
+    }
+}
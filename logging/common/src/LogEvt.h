@@ -0,0 +1,72 @@
+#ifndef LOGEVT_H
+#define LOGEVT_H
+
+#include <PalmOS.h>
+#include "LogRing.h"
+
+/* Instrumented event loop. Each event's trip through SysHandleEvent,
+   MenuHandleEvent and the app handler plus FrmDispatchEvent is timed in
+   ticks and added to per-type totals and a histogram; one that takes
+   longer than the budget is logged on the spot as a "slowEvent" record.
+   LogEvt_Report writes one "evtStats" record per event type seen. Each
+   event also gives LogDB_MemSample its chance to run. The state is
+   caller-owned (one static per app):
+
+       static LogEvt_Loop sLoop;
+       ...
+       LogEvt_Init(&sLoop, 0);
+       FrmGotoForm(MainFormID);
+       LogEvt_Run(&sLoop, AppHandleEvent);
+       LogEvt_Report(&sLoop);
+
+   A loop with its own timeouts or nil-event work calls LogEvt_Dispatch
+   in place of the usual handler chain instead of LogEvt_Run. With a
+   ring set (LogEvt_SetRing), each event drains the lines callbacks have
+   put in it.
+
+   The cost is four TimGetTicks calls and a few adds per event, so it is
+   meant to stay on in release builds. */
+
+#define LOGEVT_TYPES 40          /* eTypes below this get their own row */
+#define LOGEVT_OTHER LOGEVT_TYPES /* row for everything else */
+#define LOGEVT_BUCKETS 7         /* 0, 1, 2-3, 4-7, 8-15, 16-31, 32+ ticks */
+#define LOGEVT_MAX_SLOW 32       /* "slowEvent" records per run, at most */
+#define LOGEVT_DEFAULT_BUDGET_MS 250
+
+typedef Boolean (*LogEvt_AppHandler)(EventType *eventP);
+
+typedef struct LogEvt_StatsTag
+{
+    UInt32 count;
+    UInt32 sysTicks;
+    UInt32 menuTicks;
+    UInt32 formTicks; /* app handler and FrmDispatchEvent */
+    UInt16 maxTicks;
+    UInt16 buckets[LOGEVT_BUCKETS];
+} LogEvt_Stats;
+
+typedef struct LogEvt_LoopTag
+{
+    UInt16 budget;        /* ticks */
+    UInt16 slow;          /* events over budget */
+    LogRing_Buffer *ring; /* drained after each event; NULL: none */
+    LogEvt_Stats stats[LOGEVT_TYPES + 1];
+} LogEvt_Loop;
+
+/* Clear the totals. budgetTicks 0 = LOGEVT_DEFAULT_BUDGET_MS. */
+void LogEvt_Init(LogEvt_Loop *loop, UInt16 budgetTicks);
+
+/* Drain ring after each event from now on (NULL: stop). */
+void LogEvt_SetRing(LogEvt_Loop *loop, LogRing_Buffer *ring);
+
+/* SysHandleEvent, MenuHandleEvent, appHandler, FrmDispatchEvent, as the
+   apps' loops always did, timed. */
+void LogEvt_Dispatch(LogEvt_Loop *loop, EventType *eventP, LogEvt_AppHandler appHandler);
+
+/* EvtGetEvent(evtWaitForever) and LogEvt_Dispatch until appStopEvent. */
+void LogEvt_Run(LogEvt_Loop *loop, LogEvt_AppHandler appHandler);
+
+/* Log the totals through LogDB (call before LogDB_Close). */
+void LogEvt_Report(const LogEvt_Loop *loop);
+
+#endif /* LOGEVT_H */
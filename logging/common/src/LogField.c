@@ -0,0 +1,134 @@
+/*
+    Typed key/value fields carried after the message of a record.
+
+    Encoding per field: [UInt8 type][UInt8 keyLen][key][value], with
+    4-byte big-endian values for the numeric types and [UInt8 len][bytes]
+    for strings. Records without fields end at the message terminator, as
+    they always did, so older readers simply ignore the extra bytes.
+*/
+
+#include "LogDBPriv.h"
+
+Int16 LogField_Encode(const LogDB_Field *fields, UInt16 numFields, UInt8 *dst)
+{
+    const LogDB_Field *f;
+    UInt16 used;
+    UInt16 keyLen;
+    UInt16 strLen;
+    UInt16 need;
+    UInt16 i;
+
+    used = 0;
+    for (i = 0; i < numFields; i++)
+    {
+        f = &fields[i];
+        if (f->key == NULL)
+            return -1;
+        keyLen = (UInt16)StrLen(f->key);
+        if (keyLen == 0 || keyLen > LOGDB_FIELD_KEY_MAX)
+            return -1;
+
+        strLen = 0;
+        switch (f->type)
+        {
+        case LOGDB_FIELD_INT32:
+        case LOGDB_FIELD_UINT32:
+        case LOGDB_FIELD_TICKS:
+            need = 2 + keyLen + 4;
+            break;
+        case LOGDB_FIELD_STR:
+            strLen = (f->v.str != NULL) ? (UInt16)StrLen(f->v.str) : 0;
+            if (strLen > 255)
+                return -1;
+            need = 2 + keyLen + 1 + strLen;
+            break;
+        default:
+            return -1;
+        }
+        if (used + need > LOGDB_FIELDS_MAX_BYTES)
+            return -1;
+
+        dst[used++] = f->type;
+        dst[used++] = (UInt8)keyLen;
+        MemMove(dst + used, f->key, keyLen);
+        used += keyLen;
+        if (f->type == LOGDB_FIELD_STR)
+        {
+            dst[used++] = (UInt8)strLen;
+            if (strLen > 0)
+                MemMove(dst + used, f->v.str, strLen);
+            used += strLen;
+        }
+        else
+        {
+            /* i32 and u32 share the bits */
+            LogDB_Put32(dst + used, f->v.u32);
+            used += 4;
+        }
+    }
+    return (Int16)used;
+}
+
+Boolean LogDB_FieldNext(const LogDB_Entry *entry, UInt16 *posP, LogDB_Field *field)
+{
+    const UInt8 *p;
+    UInt16 left;
+    UInt16 keyLen;
+
+    if (entry == NULL || entry->fields == NULL || *posP >= entry->fieldsLen)
+        return false;
+
+    p = entry->fields + *posP;
+    left = entry->fieldsLen - *posP;
+    if (left < 2)
+        return false;
+    keyLen = p[1];
+    if (keyLen == 0 || left < 2 + keyLen)
+        return false;
+
+    field->type = p[0];
+    field->keyLen = (UInt8)keyLen;
+    field->key = (const Char *)p + 2;
+    field->strLen = 0;
+    p += 2 + keyLen;
+    left -= 2 + keyLen;
+
+    switch (field->type)
+    {
+    case LOGDB_FIELD_INT32:
+    case LOGDB_FIELD_UINT32:
+    case LOGDB_FIELD_TICKS:
+        if (left < 4)
+            return false;
+        field->v.u32 = LogDB_Get32(p);
+        *posP += 2 + keyLen + 4;
+        return true;
+
+    case LOGDB_FIELD_STR:
+        if (left < 1 || left < 1 + (UInt16)p[0])
+            return false;
+        field->strLen = p[0];
+        field->v.str = (const Char *)p + 1;
+        *posP += 2 + keyLen + 1 + field->strLen;
+        return true;
+
+    default:
+        /* Unknown type: the length of its value is unknown too */
+        return false;
+    }
+}
+
+Boolean LogDB_FieldFind(const LogDB_Entry *entry, const Char *key, LogDB_Field *field)
+{
+    UInt16 pos;
+    UInt16 keyLen;
+
+    keyLen = (UInt16)StrLen(key);
+    pos = 0;
+    while (LogDB_FieldNext(entry, &pos, field))
+    {
+        if (field->keyLen == keyLen && MemCmp(field->key, key, keyLen) == 0)
+            return true;
+    }
+    return false;
+}
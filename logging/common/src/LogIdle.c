@@ -0,0 +1,153 @@
+/*
+    Idle-time maintenance (see LogDB.h).
+
+    Each task is a bit in g->idle.pending, set where its work comes due (a
+    roll that fills the last segment slot queues a trim, every roll and
+    LogDB_Init queue packing, low storage both, bytes left in the card
+    buffer a flush) and cleared by the step that finds nothing left.
+    Tasks are tried in bit order, cheapest first, so a short budget still
+    gets the card written.
+
+    A task's cost estimate is the ticks its last step took, raised at once
+    by a slower step and halved towards a faster one. A step measured at k
+    ticks took less than k + 1, so it fits when the ticks used plus its
+    estimate are under the budget. One that does not fit is deferred and
+    its estimate drops a tick, so one slow step (a DB created on a nearly
+    full heap, say) does not keep its task out for good.
+*/
+
+#include "LogDBPriv.h"
+
+void LogIdle_Queue(LogDB_Globals *g, UInt16 work)
+{
+    g->idle.pending |= work;
+}
+
+/* The oldest segment, while every slot is in use or storage is HIGH (see
+   LogPressure_TrimDue). One step. */
+void LogIdle_Trim(LogDB_Globals *g)
+{
+    LocalID ids[LOGDB_MAX_SEGMENTS];
+    UInt16 seqs[LOGDB_MAX_SEGMENTS];
+    UInt16 n;
+
+    n = LogSeg_List(ids, seqs, LOGDB_MAX_SEGMENTS, 0, 0xFFFFFFFFUL, NULL, NULL,
+                    &g->stats.dmCalls);
+    if (n == 0 || (n < LOGDB_MAX_SEGMENTS && !LogPressure_TrimDue(g, n)))
+        return;
+
+    /* Packing goes oldest first, so it may be copying this one: its
+       unsealed copy is left for LogPack's recovery to drop */
+    if (ids[0] == g->packSegID)
+        g->packSegID = 0;
+    LOGDB_DMG(g, DmDeleteDatabase(0, ids[0]));
+}
+
+/* One step of task bit; true if it has more to do. */
+static Boolean LogIdle_Step(LogDB_Globals *g, UInt16 bit)
+{
+    Boolean more;
+
+    switch (bit)
+    {
+    case LOGDB_IDLE_FLUSH:
+        LogSink_Flush(g);
+        return false;
+    case LOGDB_IDLE_TRIM:
+        LogIdle_Trim(g);
+        return false;
+    default:
+        LogPack_Step(g, &more);
+        return more;
+    }
+}
+
+Boolean LogDB_IdleG(LogDB_Globals *g, UInt16 tickBudget)
+{
+    UInt32 start;
+    UInt32 t0;
+    UInt32 spent;
+    UInt16 *cost;
+    UInt16 task;
+    UInt16 bit;
+
+    if (g->vfsFile != 0 && g->vfsUsed > 0)
+        g->idle.pending |= LOGDB_IDLE_FLUSH;
+    if (tickBudget == 0 || g->idle.pending == 0)
+        return (g->idle.pending != 0);
+
+    g->idle.calls++;
+    start = TimGetTicks();
+    task = 0;
+    while (task < LOGDB_IDLE_TASKS)
+    {
+        bit = (UInt16)(1 << task);
+        cost = &g->idleCost[task];
+        if ((g->idle.pending & bit) == 0)
+        {
+            task++;
+            continue;
+        }
+
+        /* Packing makes a copy first: not while storage is this short */
+        if (bit == LOGDB_IDLE_COMPACT && g->pressureTier >= LOGDB_PRESSURE_HIGH)
+        {
+            task++;
+            continue;
+        }
+
+        /* Too big for what is left: a later, cheaper task may still fit */
+        t0 = TimGetTicks();
+        if (t0 - start + *cost >= tickBudget)
+        {
+            g->idle.deferred[task]++;
+            if (*cost > 0)
+                (*cost)--;
+            task++;
+            continue;
+        }
+
+        if (!LogIdle_Step(g, bit))
+            g->idle.pending &= ~bit;
+        spent = TimGetTicks() - t0;
+        g->idle.done[task]++;
+        g->idle.ticks += spent;
+        if (spent >= *cost)
+            *cost = (spent > 0xFFFF) ? 0xFFFF : (UInt16)spent;
+        else
+            *cost = (UInt16)((*cost + spent) / 2);
+    }
+    return (g->idle.pending != 0);
+}
+
+void LogDB_IdleGetStatsG(LogDB_Globals *g, LogDB_IdleStats *stats)
+{
+    if (g->vfsFile != 0 && g->vfsUsed > 0)
+        g->idle.pending |= LOGDB_IDLE_FLUSH;
+    *stats = g->idle;
+}
+
+Err LogDB_IdleReportG(LogDB_Globals *g)
+{
+    LogDB_Field f[8];
+    Err err;
+
+    if (g->idle.calls == 0)
+        return errNone;
+    LogDB_FieldUInt32(&f[0], "n", g->idle.calls);
+    LogDB_FieldUInt32(&f[1], "t", g->idle.ticks);
+    LogDB_FieldUInt32(&f[2], "fl", g->idle.done[0]);
+    LogDB_FieldUInt32(&f[3], "flD", g->idle.deferred[0]);
+    LogDB_FieldUInt32(&f[4], "tr", g->idle.done[1]);
+    LogDB_FieldUInt32(&f[5], "trD", g->idle.deferred[1]);
+    LogDB_FieldUInt32(&f[6], "pk", g->idle.done[2]);
+    LogDB_FieldUInt32(&f[7], "pkD", g->idle.deferred[2]);
+    err = LogDB_LogFieldsG(g, LOGDB_IDLE_MSG, f, 8);
+
+    /* The queue stays; the counters start again */
+    g->idle.calls = 0;
+    g->idle.ticks = 0;
+    MemSet(g->idle.done, sizeof(g->idle.done), 0);
+    MemSet(g->idle.deferred, sizeof(g->idle.deferred), 0);
+    return err;
+}
@@ -0,0 +1,83 @@
+/*
+    Memory watermark sampler.
+
+    A sample is two MemHeapFreeBytes calls, which walk the heaps' free
+    lists, plus the active DB's byte count that LogSeg already keeps; it
+    goes out as an ordinary record with five UInt32 fields, about 60
+    bytes, so every reader lists it among the other lines. Between
+    samples LogDB_MemSample costs one TimGetTicks.
+*/
+
+#include "LogDBPriv.h"
+
+#define LOGMEM_DF 0
+#define LOGMEM_DM 1
+#define LOGMEM_SF 2
+#define LOGMEM_SM 3
+
+void LogDB_SetMemIntervalG(LogDB_Globals *g, UInt32 intervalTicks)
+{
+    g->memInterval = intervalTicks;
+    g->memLast = TimGetTicks();
+}
+
+Err LogDB_MemSampleG(LogDB_Globals *g, Boolean force)
+{
+    LogDB_Field f[5];
+    UInt32 v[4];
+    UInt32 now;
+    UInt32 cost;
+    UInt16 i;
+    Err err;
+
+    now = TimGetTicks();
+    if (!force && (g->memInterval == 0 || now - g->memLast < g->memInterval))
+        return errNone;
+
+    /* Dynamic heap, then the storage heap, of card 0 */
+    v[LOGMEM_DF] = v[LOGMEM_DM] = 0;
+    v[LOGMEM_SF] = v[LOGMEM_SM] = 0;
+    MemHeapFreeBytes(MemHeapID(0, 0), &v[LOGMEM_DF], &v[LOGMEM_DM]);
+    MemHeapFreeBytes(MemHeapID(0, 1), &v[LOGMEM_SF], &v[LOGMEM_SM]);
+
+    for (i = 0; i < 4; i++)
+    {
+        if (g->memSamples == 0 || v[i] < g->memLow[i])
+            g->memLow[i] = v[i];
+    }
+    if (g->memSamples == 0 || g->activeBytes > g->memHighDB)
+        g->memHighDB = g->activeBytes;
+    if (g->memSamples < 0xFFFF)
+        g->memSamples++;
+
+    LogDB_FieldUInt32(&f[0], "df", v[LOGMEM_DF]);
+    LogDB_FieldUInt32(&f[1], "dm", v[LOGMEM_DM]);
+    LogDB_FieldUInt32(&f[2], "sf", v[LOGMEM_SF]);
+    LogDB_FieldUInt32(&f[3], "sm", v[LOGMEM_SM]);
+    LogDB_FieldUInt32(&f[4], "db", g->activeBytes);
+    err = LogDB_LogFieldsG(g, LOGDB_MEM_MSG, f, 5);
+
+    /* Keep the sampler's share of the time under 1/LOGDB_MEM_SHARE */
+    g->memLast = TimGetTicks();
+    cost = g->memLast - now;
+    while (g->memInterval != 0 && g->memInterval < 0x80000000UL &&
+           cost * LOGDB_MEM_SHARE > g->memInterval)
+        g->memInterval *= 2;
+    return err;
+}
+
+Err LogDB_MemReportG(LogDB_Globals *g)
+{
+    LogDB_Field f[6];
+
+    if (g->memSamples == 0)
+        return errNone;
+    LogDB_FieldUInt32(&f[0], "df", g->memLow[LOGMEM_DF]);
+    LogDB_FieldUInt32(&f[1], "dm", g->memLow[LOGMEM_DM]);
+    LogDB_FieldUInt32(&f[2], "sf", g->memLow[LOGMEM_SF]);
+    LogDB_FieldUInt32(&f[3], "sm", g->memLow[LOGMEM_SM]);
+    LogDB_FieldUInt32(&f[4], "db", g->memHighDB);
+    LogDB_FieldUInt32(&f[5], "n", g->memSamples);
+    g->memSamples = 0;
+    return LogDB_LogFieldsG(g, LOGDB_MEM_MARKS_MSG, f, 6);
+}
@@ -0,0 +1,639 @@
+/*
+    Packed blocks (layout in LogDB.h).
+
+    LogDB_Compact rewrites a closed segment into a fresh DB of blocks and
+    swaps it in under the segment's name. The copy is built as
+    LOGDB_PACK_NAME and gets its segment summary last, so a reset part way
+    through leaves either the old segment and a copy without a summary
+    (thrown away) or a finished copy the next run puts in place.
+
+    Packed segments are marked with LOGDB_PACK_DB_VERSION in the DB
+    header, so they are not packed again; records that cannot go in a
+    block (a message longer than a block) are copied across unchanged.
+*/
+
+#include "LogDBPriv.h"
+
+#define LOGDB_PACK_NAME "DebugLog-Pack"
+#define LOGDB_PACK_TYPE 'LPak'
+#define LOGDB_PACK_DB_VERSION 1
+
+/* Column positions within a block of count entries */
+#define LogPack_DeltaAt(count, i) (LOGDB_BLOCK_HEADER + 2 * (UInt16)(i))
+#define LogPack_AppIdAt(count, i) (LOGDB_BLOCK_HEADER + 2 * (UInt16)(count) + (UInt16)(i))
+#define LogPack_OffsetAt(count, i) (LOGDB_BLOCK_HEADER + 3 * (UInt16)(count) + 2 * (UInt16)(i))
+
+/* Scratch for one block, in the dynamic heap */
+typedef struct LogPack_WorkTag
+{
+    UInt16 numApps;
+    UInt8 appLen[LOGDB_BLOCK_MAX_APPS];
+    Char apps[LOGDB_BLOCK_MAX_APPS][32];
+    UInt8 block[LOGDB_BLOCK_MAX_BYTES];
+} LogPack_Work;
+
+/* --- Reading --- */
+
+Boolean LogPack_IterEnter(LogDB_Iter *it, MemHandle h, const UInt8 *p, UInt32 size)
+{
+    UInt16 count;
+    UInt16 numApps;
+    UInt16 appsOff;
+    UInt16 dataOff;
+    UInt16 off;
+    UInt16 appLen;
+    UInt16 i;
+
+    if (size < LOGDB_BLOCK_HEADER)
+        return false;
+    numApps = p[1];
+    count = LogDB_Get16(p + 2);
+    appsOff = LogDB_Get16(p + 12);
+    dataOff = LogDB_Get16(p + 14);
+    if (count == 0 || appsOff < LogPack_OffsetAt(count, count) ||
+        (UInt32)appsOff + 2 * numApps > dataOff || dataOff > size)
+        return false;
+
+    /* The whole block is outside the window: not one entry is looked at */
+    if (LogDB_Get32(p + 8) < it->fromSecs || LogDB_Get32(p + 4) > it->toSecs)
+        return false;
+
+    /* App filter: one name compare per app in the block, not per entry */
+    it->packApp = -1;
+    if (it->app != NULL)
+    {
+        appLen = (UInt16)StrLen(it->app);
+        for (i = 0; i < numApps; i++)
+        {
+            off = LogDB_Get16(p + appsOff + 2 * i);
+            if (off < dataOff && p[off] == appLen && off + 1 + appLen < dataOff &&
+                MemCmp(p + off + 1, it->app, appLen) == 0)
+            {
+                it->packApp = (Int16)i;
+                break;
+            }
+        }
+        if (it->packApp < 0)
+            return false;
+    }
+
+    it->packH = h;
+    it->packPos = 0;
+    it->packCount = count;
+    it->packSecs = LogDB_Get32(p + 4);
+    return true;
+}
+
+/* Entry i of the block p as a LogDB_Entry; false if it is damaged. */
+static Boolean LogPack_Decode(const UInt8 *p, UInt32 size, UInt16 count, UInt16 i,
+                              UInt32 secs, LogDB_Entry *entry)
+{
+    UInt16 appsOff;
+    UInt16 appId;
+    UInt16 nameOff;
+    UInt32 at;
+    UInt16 msgLen;
+    UInt16 fieldsLen;
+
+    appsOff = LogDB_Get16(p + 12);
+    appId = p[LogPack_AppIdAt(count, i)];
+    if (appId >= p[1])
+        return false;
+    nameOff = LogDB_Get16(p + appsOff + 2 * appId);
+    if ((UInt32)nameOff + 2 > size || (UInt32)nameOff + 1 + p[nameOff] >= size ||
+        p[nameOff + 1 + p[nameOff]] != 0)
+        return false;
+
+    at = (UInt32)LogDB_Get16(p + 14) + LogDB_Get16(p + LogPack_OffsetAt(count, i));
+    if (at + LOGDB_BLOCK_ENTRY_HEADER + 1 > size)
+        return false;
+    msgLen = LogDB_Get16(p + at + 6);
+    fieldsLen = p[at + 8];
+    if (at + LOGDB_BLOCK_ENTRY_HEADER + msgLen + 1 + fieldsLen > size ||
+        p[at + LOGDB_BLOCK_ENTRY_HEADER + msgLen] != 0)
+        return false;
+
+    entry->version = 3;
+    entry->seconds = secs;
+    entry->ticks = LogDB_Get32(p + at);
+    entry->rate = LogDB_Get16(p + at + 4);
+    if (entry->rate == 0)
+        entry->rate = 1;
+    entry->app = (Char *)p + nameOff + 1;
+    entry->appLen = p[nameOff];
+    entry->msg = (Char *)p + at + LOGDB_BLOCK_ENTRY_HEADER;
+    entry->msgLen = msgLen;
+    entry->fields = (fieldsLen > 0) ? (const UInt8 *)entry->msg + msgLen + 1 : NULL;
+    entry->fieldsLen = fieldsLen;
+    return true;
+}
+
+Boolean LogPack_EntryAt(const UInt8 *p, UInt32 size, UInt16 i, LogDB_Entry *entry)
+{
+    UInt16 count;
+    UInt32 secs;
+    UInt16 k;
+
+    if (size < LOGDB_BLOCK_HEADER)
+        return false;
+    count = LogDB_Get16(p + 2);
+    if (i >= count || LogPack_OffsetAt(count, count) > size)
+        return false;
+
+    /* Deltas add up from the first entry's time */
+    secs = LogDB_Get32(p + 4);
+    for (k = 1; k <= i; k++)
+        secs += LogDB_Get16(p + LogPack_DeltaAt(count, k));
+    return LogPack_Decode(p, size, count, i, secs, entry);
+}
+
+MemHandle LogPack_IterNext(LogDB_Iter *it, LogDB_Entry *entry)
+{
+    const UInt8 *p;
+    UInt32 size;
+    UInt32 secs;
+    UInt16 i;
+
+    p = (const UInt8 *)MemHandleLock(it->packH);
+    size = MemHandleSize(it->packH);
+    while (it->packPos < it->packCount)
+    {
+        i = it->packPos++;
+        secs = it->packSecs + LogDB_Get16(p + LogPack_DeltaAt(it->packCount, i));
+        it->packSecs = secs;
+
+        /* Only the two small columns are read for entries filtered out */
+        if (secs > it->toSecs)
+        {
+            it->packPos = it->packCount; /* nothing later in the block can match */
+            break;
+        }
+        if (secs < it->fromSecs)
+            continue;
+        if (it->packApp >= 0 && p[LogPack_AppIdAt(it->packCount, i)] != (UInt8)it->packApp)
+            continue;
+
+        /* The caller's LogDB_IterUnlock releases this lock */
+        if (LogPack_Decode(p, size, it->packCount, i, secs, entry))
+            return it->packH;
+    }
+    MemHandleUnlock(it->packH);
+    it->packH = NULL;
+    return NULL;
+}
+
+/* --- Packing --- */
+
+static Int16 LogPack_FindApp(const LogPack_Work *w, const LogDB_Entry *e)
+{
+    UInt16 a;
+
+    for (a = 0; a < w->numApps; a++)
+    {
+        if (w->appLen[a] == e->appLen && MemCmp(w->apps[a], e->app, e->appLen) == 0)
+            return (Int16)a;
+    }
+    return -1;
+}
+
+/* How many records from first on go in one block; fills in the app table.
+   0 if the first one cannot be packed at all. */
+static UInt16 LogPack_Plan(DmOpenRef src, UInt16 first, UInt16 n, LogPack_Work *w,
+                           UInt32 *dmP)
+{
+    LogDB_Entry e;
+    MemHandle h;
+    const UInt8 *p;
+    UInt16 count;
+    UInt32 prevSecs;
+    UInt32 names;
+    UInt32 data;
+    UInt32 need;
+    UInt16 entryBytes;
+    Boolean newApp;
+    Boolean ok;
+    UInt16 k;
+
+    w->numApps = 0;
+    count = 0;
+    prevSecs = 0;
+    names = 0;
+    data = 0;
+    for (k = first; k < n && count < LOGDB_BLOCK_ENTRIES; k++)
+    {
+        h = LOGDB_DM(*dmP, DmQueryRecord(src, k));
+        if (h == NULL)
+            break;
+        p = (const UInt8 *)MemHandleLock(h);
+        ok = (LogDB_RecKind(p) != LOGDB_REC_BLOCK && LogDB_RecDecode(p, MemHandleSize(h), &e) &&
+              e.appLen < sizeof(w->apps[0]));
+
+        /* Time only moves forward within a block, in steps that fit a UInt16 */
+        if (ok && count > 0)
+            ok = (e.seconds >= prevSecs && e.seconds - prevSecs <= 0xFFFFUL);
+
+        newApp = ok && LogPack_FindApp(w, &e) < 0;
+        if (newApp && w->numApps == LOGDB_BLOCK_MAX_APPS)
+            ok = false;
+
+        if (ok)
+        {
+            entryBytes = (UInt16)(LOGDB_BLOCK_ENTRY_HEADER + e.msgLen + 1 + e.fieldsLen);
+            need = LOGDB_BLOCK_HEADER + 5UL * (count + 1) +
+                   2UL * (w->numApps + (newApp ? 1 : 0)) +
+                   names + (newApp ? 1 + e.appLen + 1 : 0) + data + entryBytes;
+            ok = (need <= LOGDB_BLOCK_MAX_BYTES);
+        }
+        if (ok && newApp)
+        {
+            MemMove(w->apps[w->numApps], e.app, e.appLen);
+            w->appLen[w->numApps] = (UInt8)e.appLen;
+            w->numApps++;
+            names += 1 + e.appLen + 1;
+        }
+        MemHandleUnlock(h);
+        if (!ok)
+            break;
+
+        count++;
+        data += entryBytes;
+        prevSecs = e.seconds;
+    }
+    return count;
+}
+
+/* Lay out the count records planned from first; returns the block size. */
+static UInt16 LogPack_Build(DmOpenRef src, UInt16 first, UInt16 count, LogPack_Work *w,
+                            UInt32 *dmP)
+{
+    LogDB_Entry e;
+    MemHandle h;
+    const UInt8 *p;
+    UInt8 *b;
+    UInt16 appsOff;
+    UInt16 dataOff;
+    UInt16 pos;
+    UInt16 at;
+    UInt32 firstSecs;
+    UInt32 prevSecs;
+    UInt16 a;
+    UInt16 i;
+
+    b = w->block;
+    appsOff = LogPack_OffsetAt(count, count);
+    pos = (UInt16)(appsOff + 2 * w->numApps);
+    for (a = 0; a < w->numApps; a++)
+    {
+        LogDB_Put16(b + appsOff + 2 * a, pos);
+        b[pos] = w->appLen[a];
+        MemMove(b + pos + 1, w->apps[a], w->appLen[a]);
+        b[pos + 1 + w->appLen[a]] = 0;
+        pos += 1 + w->appLen[a] + 1;
+    }
+    dataOff = pos;
+
+    firstSecs = 0;
+    prevSecs = 0;
+    at = 0;
+    for (i = 0; i < count; i++)
+    {
+        h = LOGDB_DM(*dmP, DmQueryRecord(src, first + i));
+        p = (const UInt8 *)MemHandleLock(h);
+        LogDB_RecDecode(p, MemHandleSize(h), &e); /* checked by the plan */
+        if (i == 0)
+            firstSecs = prevSecs = e.seconds;
+
+        LogDB_Put16(b + LogPack_DeltaAt(count, i), (UInt16)(e.seconds - prevSecs));
+        b[LogPack_AppIdAt(count, i)] = (UInt8)LogPack_FindApp(w, &e);
+        LogDB_Put16(b + LogPack_OffsetAt(count, i), at);
+
+        pos = dataOff + at;
+        LogDB_Put32(b + pos, e.ticks);
+        LogDB_Put16(b + pos + 4, e.rate);
+        LogDB_Put16(b + pos + 6, e.msgLen);
+        b[pos + 8] = (UInt8)e.fieldsLen;
+        pos += LOGDB_BLOCK_ENTRY_HEADER;
+        MemMove(b + pos, e.msg, e.msgLen);
+        b[pos + e.msgLen] = 0;
+        pos += e.msgLen + 1;
+        if (e.fieldsLen > 0)
+            MemMove(b + pos, e.fields, e.fieldsLen);
+        at += LOGDB_BLOCK_ENTRY_HEADER + e.msgLen + 1 + e.fieldsLen;
+
+        prevSecs = e.seconds;
+        MemHandleUnlock(h);
+    }
+
+    b[0] = LOGDB_REC_BLOCK;
+    b[1] = (UInt8)w->numApps;
+    LogDB_Put16(b + 2, count);
+    LogDB_Put32(b + 4, firstSecs);
+    LogDB_Put32(b + 8, prevSecs);
+    LogDB_Put16(b + 12, appsOff);
+    LogDB_Put16(b + 14, dataOff);
+    LogDB_Put16(b + 16, 0);
+    return (UInt16)(dataOff + at);
+}
+
+/* Append size bytes from src to dst as one new record. */
+static Err LogPack_Append(DmOpenRef dst, const void *src, UInt32 size, UInt32 *dmP)
+{
+    MemHandle h;
+    UInt16 index;
+
+    index = dmMaxRecordIndex;
+    h = LOGDB_DM(*dmP, DmNewRecord(dst, &index, size));
+    if (h == NULL)
+        return dmErrMemError;
+    LOGDB_DM(*dmP, DmWrite(MemHandleLock(h), 0, src, size));
+    MemHandleUnlock(h);
+    return LOGDB_DM(*dmP, DmReleaseRecord(dst, index, true));
+}
+
+/* Copy the records of src from *iP on into dst: one block's worth, or
+   the one record at *iP if it cannot be packed. Advances *iP past them. */
+static Err LogPack_CopyStep(DmOpenRef src, DmOpenRef dst, LogPack_Work *w, UInt16 *iP,
+                            UInt32 *bytesP, UInt32 *packedP, UInt32 *dmP)
+{
+    MemHandle h;
+    UInt16 count;
+    UInt16 size;
+    Err err;
+
+    count = LogPack_Plan(src, *iP, LOGDB_DM(*dmP, DmNumRecords(src)), w, dmP);
+    if (count > 0)
+    {
+        size = LogPack_Build(src, *iP, count, w, dmP);
+        err = LogPack_Append(dst, w->block, size, dmP);
+        *bytesP += size;
+        *packedP += count;
+        *iP += count;
+        return err;
+    }
+
+    /* Too big for a block (or a block already): as it is */
+    err = errNone;
+    h = LOGDB_DM(*dmP, DmQueryRecord(src, *iP));
+    if (h != NULL)
+    {
+        err = LogPack_Append(dst, MemHandleLock(h), MemHandleSize(h), dmP);
+        *bytesP += MemHandleSize(h);
+        MemHandleUnlock(h);
+    }
+    (*iP)++;
+    return err;
+}
+
+/* Give the finished copy the segment's name and type. */
+static Err LogPack_Install(LocalID packID, UInt16 seq, UInt32 *dmP)
+{
+    Char name[dmDBNameLength];
+    UInt32 type;
+
+    StrPrintF(name, "%s%04u", LOGDB_SEG_PREFIX, seq);
+    type = LOGDB_SEG_TYPE;
+    return LOGDB_DM(*dmP, DmSetDatabaseInfo(0, packID, name, NULL, NULL, NULL, NULL, NULL, NULL,
+                                            NULL, NULL, &type, NULL));
+}
+
+/* A copy left by a reset: put it in place if its segment is gone,
+   otherwise it is unfinished or redundant. */
+static void LogPack_Recover(UInt32 *dmP)
+{
+    LocalID ids[LOGDB_MAX_SEGMENTS];
+    UInt16 seqs[LOGDB_MAX_SEGMENTS];
+    LogDB_SegInfo info;
+    LocalID packID;
+    UInt16 n;
+    UInt16 i;
+
+    packID = LOGDB_DM(*dmP, DmFindDatabase(0, LOGDB_PACK_NAME));
+    if (packID == 0)
+        return;
+
+    if (LogSeg_ReadInfo(packID, &info, dmP) && info.seq != 0)
+    {
+        n = LogSeg_List(ids, seqs, LOGDB_MAX_SEGMENTS, 0, 0xFFFFFFFFUL, NULL, NULL, dmP);
+        for (i = 0; i < n && seqs[i] != info.seq; i++)
+            ;
+        if (i == n && LogPack_Install(packID, info.seq, dmP) == errNone)
+            return;
+    }
+    LOGDB_DM(*dmP, DmDeleteDatabase(0, packID));
+}
+
+static Boolean LogPack_IsPacked(LocalID dbID, UInt32 *dmP)
+{
+    UInt16 version;
+
+    version = 0;
+    LOGDB_DM(*dmP, DmDatabaseInfo(0, dbID, NULL, NULL, &version, NULL, NULL, NULL, NULL, NULL, NULL,
+                                  NULL, NULL));
+    return (version == LOGDB_PACK_DB_VERSION);
+}
+
+/* Oldest closed segment not packed yet, 0 if none. */
+static LocalID LogPack_NextSegment(UInt32 *dmP)
+{
+    LocalID ids[LOGDB_MAX_SEGMENTS];
+    UInt16 seqs[LOGDB_MAX_SEGMENTS];
+    UInt16 n;
+    UInt16 i;
+
+    n = LogSeg_List(ids, seqs, LOGDB_MAX_SEGMENTS, 0, 0xFFFFFFFFUL, NULL, NULL, dmP);
+    for (i = 0; i < n; i++)
+    {
+        if (!LogPack_IsPacked(ids[i], dmP))
+            return ids[i];
+    }
+    return 0;
+}
+
+/* An empty copy to pack segID into; info receives the segment's summary. */
+static Err LogPack_Begin(LocalID segID, LogDB_SegInfo *info, LocalID *packIDP, UInt32 *dmP)
+{
+    Err err;
+
+    if (!LogSeg_ReadInfo(segID, info, dmP))
+        return dmErrCorruptDatabase;
+    err = LOGDB_DM(*dmP, DmCreateDatabase(0, LOGDB_PACK_NAME, LOGDB_CREATOR, LOGDB_PACK_TYPE,
+                                          false));
+    if (err != errNone)
+        return err;
+    *packIDP = LOGDB_DM(*dmP, DmFindDatabase(0, LOGDB_PACK_NAME));
+    return (*packIDP != 0) ? errNone : DmGetLastErr();
+}
+
+/* The summary goes on last: a copy with one is complete. */
+static Err LogPack_Seal(DmOpenRef dst, LocalID packID, const LogDB_SegInfo *segInfo,
+                        UInt32 bytes, UInt32 *dmP)
+{
+    LogDB_SegInfo info;
+    LocalID appInfoID;
+    UInt16 attrs;
+    UInt16 version;
+
+    info = *segInfo;
+    info.bytes = bytes;
+    appInfoID = LogSeg_NewInfo(dst, &info, dmP);
+    if (appInfoID == 0)
+        return dmErrMemError;
+    attrs = dmHdrAttrBackup;
+    version = LOGDB_PACK_DB_VERSION;
+    return LOGDB_DM(*dmP, DmSetDatabaseInfo(0, packID, NULL, &attrs, &version, NULL, NULL, NULL,
+                                            NULL, &appInfoID, NULL, NULL, NULL));
+}
+
+/* Put the sealed copy in the segment's place, or drop it after err. The
+   DBs are closed by now. */
+static Err LogPack_Swap(LocalID segID, LocalID packID, UInt16 seq, Err err, UInt32 *dmP)
+{
+    if (err == errNone)
+        err = LOGDB_DM(*dmP, DmDeleteDatabase(0, segID));
+    if (err != errNone)
+    {
+        LOGDB_DM(*dmP, DmDeleteDatabase(0, packID));
+        return err;
+    }
+    return LogPack_Install(packID, seq, dmP);
+}
+
+static Err LogPack_Segment(LocalID segID, UInt32 *packedP, UInt32 *dmP)
+{
+    LogDB_SegInfo info;
+    LogPack_Work *w;
+    DmOpenRef src;
+    DmOpenRef dst;
+    LocalID packID;
+    UInt32 bytes;
+    UInt16 i;
+    Err err;
+
+    err = LogPack_Begin(segID, &info, &packID, dmP);
+    if (err != errNone)
+        return err;
+
+    w = (LogPack_Work *)MemPtrNew(sizeof(LogPack_Work));
+    src = LOGDB_DM(*dmP, DmOpenDatabase(0, segID, dmModeReadOnly));
+    dst = LOGDB_DM(*dmP, DmOpenDatabase(0, packID, dmModeReadWrite));
+    if (w == NULL || src == NULL || dst == NULL)
+        err = (w == NULL) ? memErrNotEnoughSpace : dmErrCantOpen;
+
+    bytes = 0;
+    i = 0;
+    while (err == errNone && i < LOGDB_DM(*dmP, DmNumRecords(src)))
+        err = LogPack_CopyStep(src, dst, w, &i, &bytes, packedP, dmP);
+    if (err == errNone)
+        err = LogPack_Seal(dst, packID, &info, bytes, dmP);
+
+    if (w != NULL)
+        MemPtrFree(w);
+    if (src != NULL)
+        LOGDB_DM(*dmP, DmCloseDatabase(src));
+    if (dst != NULL)
+        LOGDB_DM(*dmP, DmCloseDatabase(dst));
+
+    err = LogPack_Swap(segID, packID, info.seq, err, dmP);
+    if (err != errNone)
+        *packedP = 0;
+    return err;
+}
+
+Err LogPack_Step(LogDB_Globals *g, Boolean *moreP)
+{
+    LogDB_SegInfo info;
+    LogPack_Work *w;
+    DmOpenRef src;
+    DmOpenRef dst;
+    LocalID packID;
+    LocalID segID;
+    UInt32 packed;
+    Boolean sealed;
+    Err err;
+
+    /* Pick the next segment; the copy is started as its own step */
+    *moreP = false;
+    if (g->packSegID == 0)
+    {
+        LogPack_Recover(&g->stats.dmCalls);
+        segID = LogPack_NextSegment(&g->stats.dmCalls);
+        if (segID == 0)
+            return errNone;
+        err = LogPack_Begin(segID, &info, &packID, &g->stats.dmCalls);
+        if (err != errNone)
+            return err;
+        g->packSegID = segID;
+        g->packNext = 0;
+        g->packBytes = 0;
+        *moreP = true;
+        return errNone;
+    }
+
+    /* Each step opens both DBs afresh, so nothing is held between them;
+       a segment or copy that went away (ClearAll, LogDB_Compact) fails
+       here and the copy is dropped */
+    segID = g->packSegID;
+    info.seq = 0;
+    packID = LOGDB_DMG(g, DmFindDatabase(0, LOGDB_PACK_NAME));
+    w = (LogPack_Work *)MemPtrNew(sizeof(LogPack_Work));
+    src = LOGDB_DMG(g, DmOpenDatabase(0, segID, dmModeReadOnly));
+    dst = (packID != 0) ? LOGDB_DMG(g, DmOpenDatabase(0, packID, dmModeReadWrite)) : NULL;
+    err = errNone;
+    if (w == NULL || src == NULL || dst == NULL ||
+        !LogSeg_ReadInfo(segID, &info, &g->stats.dmCalls))
+        err = (w == NULL) ? memErrNotEnoughSpace : dmErrCantOpen;
+
+    sealed = false;
+    if (err == errNone && g->packNext < LOGDB_DMG(g, DmNumRecords(src)))
+    {
+        packed = 0;
+        err = LogPack_CopyStep(src, dst, w, &g->packNext, &g->packBytes, &packed,
+                               &g->stats.dmCalls);
+    }
+    else if (err == errNone)
+    {
+        err = LogPack_Seal(dst, packID, &info, g->packBytes, &g->stats.dmCalls);
+        sealed = true;
+    }
+
+    if (w != NULL)
+        MemPtrFree(w);
+    if (src != NULL)
+        LOGDB_DMG(g, DmCloseDatabase(src));
+    if (dst != NULL)
+        LOGDB_DMG(g, DmCloseDatabase(dst));
+
+    if (err == errNone && !sealed)
+    {
+        *moreP = true;
+        return errNone;
+    }
+    g->packSegID = 0;
+    if (packID == 0)
+        return err;
+    err = LogPack_Swap(segID, packID, info.seq, err, &g->stats.dmCalls);
+    *moreP = (err == errNone);
+    return err;
+}
+
+Err LogDB_CompactG(LogDB_Globals *g, UInt32 *packedP)
+{
+    LocalID segID;
+    UInt32 packed;
+    Err err;
+
+    /* An idle compaction's copy is unsealed, so Recover drops it */
+    g->packSegID = 0;
+    LogPack_Recover(&g->stats.dmCalls);
+
+    /* Oldest unpacked segment first */
+    packed = 0;
+    err = errNone;
+    segID = LogPack_NextSegment(&g->stats.dmCalls);
+    if (segID != 0)
+        err = LogPack_Segment(segID, &packed, &g->stats.dmCalls);
+
+    if (packedP != NULL)
+        *packedP = packed;
+    return err;
+}
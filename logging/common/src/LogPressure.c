@@ -0,0 +1,159 @@
+/*
+    Storage pressure tiers (see LogDB.h).
+
+    A check is one MemHeapFreeBytes on the storage heap. It runs every
+    checkEvery records offered to the DBs, a quarter as often apart once
+    storage is short, and at once after an append fails for want of
+    memory, so between checks the log can only grow by a few records.
+
+    What a tier keeps goes by what a record is worth when space runs out:
+    a sampled record only stands for others, fields are mostly LogDB's own
+    diagnostics (idle, memory) or detail behind a message, and a plain
+    message is what someone wrote to be read. Room is made oldest first,
+    by deleting whole segments, once storage is HIGH and only until it is
+    clear of the tier again: space other apps hold cannot be won back
+    from the log, so LOGDB_PRESSURE_KEEP_SEGMENTS closed segments and the
+    active DB are always kept.
+*/
+
+#include "LogDBPriv.h"
+
+void LogDB_SetPressurePolicyG(LogDB_Globals *g, const LogDB_PressurePolicy *policy)
+{
+    LogDB_PressurePolicy *p;
+
+    p = &g->pressure;
+    if (policy != NULL)
+        *p = *policy;
+    else
+        MemSet(p, sizeof(*p), 0);
+
+    if (p->lowBytes == 0)
+        p->lowBytes = LOGDB_PRESSURE_DEFAULT_LOW;
+    if (p->highBytes == 0)
+        p->highBytes = LOGDB_PRESSURE_DEFAULT_HIGH;
+    if (p->fullBytes == 0)
+        p->fullBytes = LOGDB_PRESSURE_DEFAULT_FULL;
+    if (p->highBytes > p->lowBytes)
+        p->highBytes = p->lowBytes;
+    if (p->fullBytes > p->highBytes)
+        p->fullBytes = p->highBytes;
+    if (p->checkEvery == 0)
+        p->checkEvery = LOGDB_PRESSURE_DEFAULT_CHECK;
+    g->pressureCheck = 0;
+}
+
+/* Free bytes under which tier starts */
+static UInt32 LogPressure_Bound(const LogDB_Globals *g, UInt16 tier)
+{
+    switch (tier)
+    {
+    case LOGDB_PRESSURE_LOW:
+        return g->pressure.lowBytes;
+    case LOGDB_PRESSURE_HIGH:
+        return g->pressure.highBytes;
+    case LOGDB_PRESSURE_FULL:
+        return g->pressure.fullBytes;
+    default:
+        return 0xFFFFFFFFUL;
+    }
+}
+
+static UInt16 LogPressure_TierFor(const LogDB_Globals *g, UInt32 freeBytes)
+{
+    UInt16 tier;
+    UInt32 bound;
+
+    tier = LOGDB_PRESSURE_NONE;
+    while (tier < LOGDB_PRESSURE_FULL && freeBytes < LogPressure_Bound(g, tier + 1))
+        tier++;
+
+    /* Going back down takes a quarter more than coming in */
+    while (tier < g->pressureTier)
+    {
+        bound = LogPressure_Bound(g, tier + 1);
+        if (freeBytes >= bound + bound / 4)
+            break;
+        tier++;
+    }
+    return tier;
+}
+
+void LogPressure_Check(LogDB_Globals *g)
+{
+    LogDB_Field f[3];
+    UInt32 freeBytes;
+    UInt32 maxBytes;
+    UInt16 tier;
+
+    freeBytes = 0;
+    maxBytes = 0;
+    MemHeapFreeBytes(MemHeapID(0, 1), &freeBytes, &maxBytes);
+    tier = LogPressure_TierFor(g, freeBytes);
+
+    g->pressureCheck = g->pressure.checkEvery;
+    if (tier != LOGDB_PRESSURE_NONE && g->pressureCheck >= 4)
+        g->pressureCheck /= 4;
+    if (tier != g->pressureTier)
+    {
+        LogDB_FieldUInt32(&f[0], "t", tier);
+        LogDB_FieldUInt32(&f[1], "sf", freeBytes);
+        LogDB_FieldUInt32(&f[2], "drop", g->pressureDropped);
+        g->pressureTier = tier;
+        g->pressureDropped = 0;
+        g->pressureMarking = true;
+        LogDB_LogFieldsG(g, LOGDB_PRESSURE_MSG, f, 3);
+        g->pressureMarking = false;
+    }
+
+    /* The tier is current, so the check that enters HIGH trims too */
+    if (tier >= LOGDB_PRESSURE_HIGH)
+        LogIdle_Trim(g);
+    else if (tier == LOGDB_PRESSURE_LOW)
+        LogIdle_Queue(g, LOGDB_IDLE_COMPACT);
+}
+
+Boolean LogPressure_TrimDue(LogDB_Globals *g, UInt16 closed)
+{
+    UInt32 freeBytes;
+    UInt32 maxBytes;
+    UInt32 bound;
+
+    if (g->pressureTier < LOGDB_PRESSURE_HIGH || closed <= LOGDB_PRESSURE_KEEP_SEGMENTS)
+        return false;
+
+    /* Clear of HIGH again (as LogPressure_TierFor leaves it) */
+    freeBytes = 0;
+    maxBytes = 0;
+    MemHeapFreeBytes(MemHeapID(0, 1), &freeBytes, &maxBytes);
+    bound = g->pressure.highBytes;
+    return (freeBytes < bound + bound / 4);
+}
+
+Boolean LogPressure_Admit(LogDB_Globals *g, const LogDB_Rec *rec)
+{
+    Boolean keep;
+
+    if (g->pressureMarking)
+        return true;
+    if (g->pressureCheck == 0 || --g->pressureCheck == 0)
+        LogPressure_Check(g);
+
+    switch (g->pressureTier)
+    {
+    case LOGDB_PRESSURE_NONE:
+        return true;
+    case LOGDB_PRESSURE_LOW:
+        keep = (rec->rate <= 1);
+        break;
+    case LOGDB_PRESSURE_HIGH:
+        keep = (rec->rate <= 1 && rec->fieldsLen == 0);
+        break;
+    default:
+        keep = false;
+        break;
+    }
+    if (!keep)
+        g->pressureDropped++;
+    return keep;
+}
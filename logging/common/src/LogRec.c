@@ -0,0 +1,325 @@
+/*
+    Record layout (see LogDB.h): encoding v2 records, decoding v1 and v2,
+    and rewriting v1 records in place.
+
+    A v2 record spells out every length in its header, so readers find
+    the message and the fields without scanning the strings, and the
+    writer can build the whole record in one buffer.
+*/
+
+#include "LogDBPriv.h"
+
+UInt16 LogDB_Get16(const UInt8 *p)
+{
+    return (UInt16)(((UInt16)p[0] << 8) | p[1]);
+}
+
+UInt32 LogDB_Get32(const UInt8 *p)
+{
+    return ((UInt32)p[0] << 24) | ((UInt32)p[1] << 16) | ((UInt32)p[2] << 8) | p[3];
+}
+
+void LogDB_Put16(UInt8 *p, UInt16 v)
+{
+    p[0] = (UInt8)(v >> 8);
+    p[1] = (UInt8)v;
+}
+
+void LogDB_Put32(UInt8 *p, UInt32 v)
+{
+    p[0] = (UInt8)(v >> 24);
+    p[1] = (UInt8)(v >> 16);
+    p[2] = (UInt8)(v >> 8);
+    p[3] = (UInt8)v;
+}
+
+UInt8 LogDB_RecKind(const UInt8 *rec)
+{
+    UInt8 kind;
+
+    kind = (UInt8)(rec[0] & LOGDB_REC_VERSION_MASK);
+    return (kind == LOGDB_REC_V2 || kind == LOGDB_REC_BLOCK) ? kind : LOGDB_REC_V1;
+}
+
+#define LogRec_IsV2(p) (((p)[0] & LOGDB_REC_VERSION_MASK) == LOGDB_REC_V2)
+
+/* Fixed header plus the optional rate. */
+static UInt16 LogRec_HeaderSize(UInt8 verFlags)
+{
+    return (UInt16)(LOGDB_REC_V2_HEADER + ((verFlags & LOGDB_RECF_SAMPLED) ? 2 : 0));
+}
+
+/* v2 records and blocks (its first entry) keep the time at offset 4 */
+UInt32 LogDB_RecSeconds(const UInt8 *rec)
+{
+    return LogDB_Get32((LogDB_RecKind(rec) != LOGDB_REC_V1) ? rec + 4 : rec);
+}
+
+UInt32 LogDB_RecSize(const LogDB_Rec *rec)
+{
+    return (UInt32)LogRec_HeaderSize((UInt8)((rec->rate > 1) ? LOGDB_RECF_SAMPLED : 0)) +
+           rec->appLen + 1 + rec->msgLen + 1 + rec->fieldsLen;
+}
+
+UInt16 LogDB_RecEncodeHead(const LogDB_Rec *rec, UInt8 *dst)
+{
+    UInt8 verFlags;
+    UInt16 used;
+
+    verFlags = LOGDB_REC_V2;
+    if (rec->rate > 1)
+        verFlags |= LOGDB_RECF_SAMPLED;
+
+    dst[0] = verFlags;
+    dst[1] = (UInt8)rec->appLen;
+    LogDB_Put16(dst + 2, rec->msgLen);
+    LogDB_Put32(dst + 4, rec->secs);
+    LogDB_Put32(dst + 8, rec->ticks);
+    dst[12] = (UInt8)rec->fieldsLen;
+    used = LOGDB_REC_V2_HEADER;
+    if (verFlags & LOGDB_RECF_SAMPLED)
+    {
+        LogDB_Put16(dst + used, rec->rate);
+        used += 2;
+    }
+
+    MemMove(dst + used, rec->app, rec->appLen);
+    dst[used + rec->appLen] = 0;
+    return (UInt16)(used + rec->appLen + 1);
+}
+
+/* Encode into plain memory; the message need not be terminated at msgLen
+   (the card sink truncates it). */
+void LogDB_RecEncode(const LogDB_Rec *rec, UInt8 *dst)
+{
+    dst += LogDB_RecEncodeHead(rec, dst);
+    MemMove(dst, rec->msg, rec->msgLen);
+    dst[rec->msgLen] = 0;
+    dst += rec->msgLen + 1;
+    if (rec->fieldsLen > 0)
+        MemMove(dst, rec->fields, rec->fieldsLen);
+}
+
+/* Length of the string at p, or -1 if it is not terminated before end. */
+static Int32 LogRec_StrLen(const UInt8 *p, const UInt8 *end)
+{
+    const UInt8 *s;
+
+    for (s = p; s < end; s++)
+    {
+        if (*s == 0)
+            return (Int32)(s - p);
+    }
+    return -1;
+}
+
+static Boolean LogRec_DecodeV1(const UInt8 *p, UInt32 size, LogDB_Entry *entry)
+{
+    const UInt8 *end;
+    Int32 appLen;
+    Int32 msgLen;
+    UInt32 used;
+    LogDB_Field rate;
+
+    if (size < LOGDB_REC_MIN)
+        return false;
+    end = p + size;
+    appLen = LogRec_StrLen(p + 4, end);
+    if (appLen < 0)
+        return false;
+    msgLen = LogRec_StrLen(p + 4 + appLen + 1, end);
+    if (msgLen < 0)
+        return false;
+
+    entry->version = 1;
+    entry->seconds = LogDB_Get32(p);
+    entry->ticks = 0;
+    entry->app = (Char *)p + 4;
+    entry->appLen = (UInt16)appLen;
+    entry->msg = entry->app + appLen + 1;
+    entry->msgLen = (UInt16)msgLen;
+
+    /* Whatever follows the message is the field list */
+    used = 4 + (UInt32)appLen + 1 + (UInt32)msgLen + 1;
+    entry->fields = (used < size) ? p + used : NULL;
+    entry->fieldsLen = (used < size) ? (UInt16)(size - used) : 0;
+
+    /* Sampled v1 records said so in a field */
+    entry->rate = 1;
+    if (entry->fields != NULL && LogDB_FieldFind(entry, LOGDB_KEY_RATE, &rate) &&
+        rate.type == LOGDB_FIELD_UINT32 && rate.v.u32 > 1 && rate.v.u32 <= 0xFFFF)
+        entry->rate = (UInt16)rate.v.u32;
+    return true;
+}
+
+Boolean LogDB_RecDecode(const UInt8 *p, UInt32 size, LogDB_Entry *entry)
+{
+    UInt16 hdr;
+    UInt16 appLen;
+    UInt16 msgLen;
+    UInt16 fieldsLen;
+
+    if (p == NULL || size < 1)
+        return false;
+    if (LogDB_RecKind(p) == LOGDB_REC_V1)
+        return LogRec_DecodeV1(p, size, entry);
+    if (!LogRec_IsV2(p))
+        return false; /* a packed block is not one entry */
+
+    hdr = LogRec_HeaderSize(p[0]);
+    if (size < (UInt32)hdr + 2)
+        return false;
+    appLen = p[1];
+    msgLen = LogDB_Get16(p + 2);
+    fieldsLen = p[12];
+
+    /* Anything past the fields is left for later versions */
+    if (size < (UInt32)hdr + appLen + 1 + msgLen + 1 + fieldsLen)
+        return false;
+    if (p[hdr + appLen] != 0 || p[hdr + appLen + 1 + msgLen] != 0)
+        return false;
+
+    entry->version = 2;
+    entry->seconds = LogDB_Get32(p + 4);
+    entry->ticks = LogDB_Get32(p + 8);
+    entry->rate = (p[0] & LOGDB_RECF_SAMPLED) ? LogDB_Get16(p + LOGDB_REC_V2_HEADER) : 1;
+    if (entry->rate == 0)
+        entry->rate = 1;
+    entry->app = (Char *)p + hdr;
+    entry->appLen = appLen;
+    entry->msg = entry->app + appLen + 1;
+    entry->msgLen = msgLen;
+    entry->fields = (fieldsLen > 0) ? (const UInt8 *)entry->msg + msgLen + 1 : NULL;
+    entry->fieldsLen = fieldsLen;
+    return true;
+}
+
+/* --- Migration --- */
+
+/* Rewrite each v1 record of dbR as v2. The new record is built in *bufP
+   (grown as needed) before the old one is resized, since the resize may
+   move it. */
+static Err LogRec_MigrateDB(DmOpenRef dbR, MemPtr *bufP, UInt32 *capP, UInt16 *migratedP,
+                            UInt32 *dmP)
+{
+    LogDB_Entry entry;
+    LogDB_Rec rec;
+    MemHandle h;
+    UInt8 *p;
+    UInt32 size;
+    UInt16 n;
+    UInt16 i;
+    Boolean ok;
+
+    n = LOGDB_DM(*dmP, DmNumRecords(dbR));
+    for (i = 0; i < n; i++)
+    {
+        h = LOGDB_DM(*dmP, DmQueryRecord(dbR, i));
+        if (h == NULL)
+            continue;
+        p = (UInt8 *)MemHandleLock(h);
+        ok = (p != NULL && LogDB_RecKind(p) == LOGDB_REC_V1 &&
+              LogRec_DecodeV1(p, MemHandleSize(h), &entry));
+        if (!ok)
+        {
+            if (p != NULL)
+                MemHandleUnlock(h);
+            continue;
+        }
+
+        rec.secs = entry.seconds;
+        rec.ticks = 0;
+        rec.rate = entry.rate;
+        rec.app = entry.app;
+        rec.appLen = entry.appLen;
+        rec.msg = entry.msg;
+        rec.msgLen = entry.msgLen;
+        rec.fields = entry.fields;
+        rec.fieldsLen = entry.fieldsLen;
+        if (rec.appLen > 255 || rec.fieldsLen > 255)
+        {
+            /* Never written by LogDB; leave it as v1 */
+            MemHandleUnlock(h);
+            continue;
+        }
+
+        size = LogDB_RecSize(&rec);
+        if (size > *capP)
+        {
+            if (*bufP != NULL)
+                MemPtrFree(*bufP);
+            *capP = 0;
+            *bufP = MemPtrNew(size);
+            if (*bufP == NULL)
+            {
+                MemHandleUnlock(h);
+                return memErrNotEnoughSpace;
+            }
+            *capP = size;
+        }
+        LogDB_RecEncode(&rec, (UInt8 *)*bufP);
+        MemHandleUnlock(h);
+
+        /* Resize and rewrite; attributes and unique ID are kept */
+        if (LOGDB_DM(*dmP, DmGetRecord(dbR, i)) == NULL)
+            return DmGetLastErr();
+        h = LOGDB_DM(*dmP, DmResizeRecord(dbR, i, size));
+        if (h == NULL)
+        {
+            LOGDB_DM(*dmP, DmReleaseRecord(dbR, i, false));
+            return dmErrMemError;
+        }
+        p = (UInt8 *)MemHandleLock(h);
+        LOGDB_DM(*dmP, DmWrite(p, 0, *bufP, size));
+        MemHandleUnlock(h);
+        LOGDB_DM(*dmP, DmReleaseRecord(dbR, i, true));
+        (*migratedP)++;
+    }
+    return errNone;
+}
+
+Err LogDB_MigrateG(LogDB_Globals *g, UInt16 *migratedP)
+{
+    LocalID ids[LOGDB_MAX_SEGMENTS];
+    UInt16 seqs[LOGDB_MAX_SEGMENTS];
+    DmOpenRef dbR;
+    MemPtr buf;
+    UInt32 cap;
+    UInt16 migrated;
+    UInt16 n;
+    UInt16 i;
+    Err err;
+
+    buf = NULL;
+    cap = 0;
+    migrated = 0;
+
+    /* Closed segments; a full storage heap stops the run, and what is left
+       stays readable as v1 */
+    err = errNone;
+    n = LogSeg_List(ids, seqs, LOGDB_MAX_SEGMENTS, 0, 0xFFFFFFFFUL, NULL, NULL,
+                    &g->stats.dmCalls);
+    for (i = 0; i < n && err == errNone; i++)
+    {
+        dbR = LOGDB_DMG(g, DmOpenDatabase(0, ids[i], dmModeReadWrite));
+        if (dbR == NULL)
+            continue;
+        err = LogRec_MigrateDB(dbR, &buf, &cap, &migrated, &g->stats.dmCalls);
+        LOGDB_DMG(g, DmCloseDatabase(dbR));
+    }
+
+    /* The active DB through the writer's own reference */
+    if (err == errNone)
+        err = LogSinkDB_Open(g);
+    if (err == errNone)
+    {
+        err = LogRec_MigrateDB(g->dbR, &buf, &cap, &migrated, &g->stats.dmCalls);
+        LogSeg_LoadActive(g);
+    }
+
+    if (buf != NULL)
+        MemPtrFree(buf);
+    if (migratedP != NULL)
+        *migratedP = migrated;
+    return err;
+}
@@ -0,0 +1,94 @@
+/*
+    Callback-safe ring of log lines (see LogRing.h).
+
+    head and tail run free and are masked into the slots, so head - tail
+    is the fill even across the 16-bit wrap. The 68000 does not reorder
+    stores and a 16-bit store cannot be interrupted halfway, so all the
+    producer needs is for the compiler to finish the slot before it
+    moves head (and the consumer to finish reading before it moves tail).
+*/
+
+#include <PalmOS.h>
+#include "LogDB.h"
+#include "LogRing.h"
+
+#define LOGRING_MASK (LOGRING_SLOTS - 1)
+
+/* No store is moved across it by the compiler */
+#define LogRing_Barrier() __asm__ __volatile__("" : : : "memory")
+
+void LogRing_Init(LogRing_Buffer *ring)
+{
+    MemSet(ring, sizeof(LogRing_Buffer), 0);
+}
+
+Boolean LogRing_Put(LogRing_Buffer *ring, const Char *message)
+{
+    LogRing_Slot *slot;
+    UInt16 head;
+    UInt16 i;
+
+    head = ring->head;
+    if ((UInt16)(head - ring->tail) >= LOGRING_SLOTS)
+    {
+        ring->overflows++;
+        return false;
+    }
+
+    /* Copied by hand: no trap that might not be safe here */
+    slot = &ring->slots[head & LOGRING_MASK];
+    slot->ticks = TimGetTicks();
+    i = 0;
+    if (message != NULL)
+    {
+        for (; i < LOGRING_MSG_BYTES - 1 && message[i] != 0; i++)
+            slot->msg[i] = message[i];
+    }
+    slot->msg[i] = 0;
+
+    LogRing_Barrier();
+    ring->head = head + 1;
+
+    /* An empty ring may have a loop asleep in EvtGetEvent to wake */
+    if (head == ring->tail)
+        EvtWakeup();
+    return true;
+}
+
+UInt16 LogRing_Drain(LogRing_Buffer *ring)
+{
+    LogRing_Slot *slot;
+    LogDB_Field f;
+    UInt32 overflows;
+    UInt16 head;
+    UInt16 tail;
+    UInt16 n;
+
+    /* Only what was there on entry: a busy producer cannot hold us */
+    head = ring->head;
+    LogRing_Barrier();
+    n = 0;
+    for (tail = ring->tail; tail != head; tail++)
+    {
+        slot = &ring->slots[tail & LOGRING_MASK];
+        LogDB_FieldUInt32(&f, "q", TimGetTicks() - slot->ticks);
+        LogDB_LogFields(slot->msg, &f, 1);
+        n++;
+
+        LogRing_Barrier();
+        ring->tail = tail + 1;
+    }
+
+    overflows = ring->overflows;
+    if (overflows != ring->reported)
+    {
+        LogDB_FieldUInt32(&f, "n", overflows - ring->reported);
+        LogDB_LogFields(LOGRING_OVERFLOW_MSG, &f, 1);
+        ring->reported = overflows;
+    }
+
+    /* Lines put since the first read woke nobody: come back for them */
+    if (ring->head != head)
+        EvtWakeup();
+    return n;
+}
@@ -0,0 +1,60 @@
+#ifndef LOGRING_H
+#define LOGRING_H
+
+#include <PalmOS.h>
+
+/* Logging from code that runs outside the event loop: sound stream and
+   serial receive callbacks, notification handlers. LogDB_Log allocates
+   and writes to the storage heap, which such code must not do, so it
+   copies its line into a fixed ring instead and the main loop logs it
+   later. The ring is caller-owned and allocated up front (a global, or
+   a locked chunk the callback is handed as its user data):
+
+       static LogRing_Buffer sRing;
+       ...
+       LogRing_Init(&sRing);
+       LogEvt_SetRing(&sLoop, &sRing);      (or LogRing_Drain in the loop)
+       ...
+       in the callback:
+       LogRing_Put(&sRing, "underrun");
+
+   One producer and one consumer, no locks: LogRing_Put only moves head
+   and LogRing_Drain only tail, each after its slot is done with. Put
+   makes no allocation and no Data Manager call, and touches no globals.
+   A line that finds every slot full is dropped and counted; the next
+   drain logs the count as a LOGRING_OVERFLOW_MSG record with a UInt32
+   field "n". Drained lines are logged as they were put, with a UInt32
+   field "q": the ticks they waited in the ring. */
+
+#define LOGRING_SLOTS 16     /* a power of two */
+#define LOGRING_MSG_BYTES 40 /* longer lines are cut */
+#define LOGRING_OVERFLOW_MSG "ringOverflow"
+
+typedef struct LogRing_SlotTag
+{
+    UInt32 ticks; /* when it was put */
+    Char msg[LOGRING_MSG_BYTES];
+} LogRing_Slot;
+
+typedef struct LogRing_BufferTag
+{
+    volatile UInt16 head;      /* lines put; LogRing_Put only */
+    volatile UInt16 tail;      /* lines drained; LogRing_Drain only */
+    volatile UInt32 overflows; /* lines dropped; LogRing_Put only */
+    UInt32 reported;           /* overflows logged; LogRing_Drain only */
+    LogRing_Slot slots[LOGRING_SLOTS];
+} LogRing_Buffer;
+
+/* Empty the ring. Not while a callback may be putting lines. */
+void LogRing_Init(LogRing_Buffer *ring);
+
+/* Copy a line in; false if the ring was full and it was dropped. Wakes
+   the event loop (EvtWakeup) when the ring was empty. */
+Boolean LogRing_Put(LogRing_Buffer *ring, const Char *message);
+
+/* Log the lines waiting (at most LOGRING_SLOTS, so a busy producer
+   cannot keep the loop here) and any new overflow count; returns how
+   many lines were logged. Main loop only. */
+UInt16 LogRing_Drain(LogRing_Buffer *ring);
+
+#endif /* LOGRING_H */
@@ -0,0 +1,387 @@
+/*
+    Time-segmented log databases.
+
+    Appends always go to the active "DebugLog" DB. When the roll policy
+    trips, the active DB is stamped with a LogDB_SegInfo AppInfo block,
+    renamed to the next "DebugLog-NNNN" and retyped to LOGDB_SEG_TYPE, and a
+    fresh active DB is created. Readers pick segments by their stored time
+    range; purging is one DmDeleteDatabase per segment. Segments are in
+    time order by number, so when the numbers reach 9999 the ones kept are
+    renumbered from 1.
+*/
+
+#include "LogDBPriv.h"
+
+#define SECS_PER_DAY (24UL * 60UL * 60UL)
+#define LOGSEG_MAX_SEQ 9999    /* four digits in the name */
+#define LOGSEG_RETRY_RECORDS 256 /* appends between tries after a failed roll */
+
+/* Parse the sequence number out of "DebugLog-NNNN" (0 if malformed). */
+static UInt16 LogSeg_SeqFromName(const Char *name)
+{
+    const Char *p;
+    UInt16 prefixLen;
+    UInt16 seq;
+
+    prefixLen = (UInt16)StrLen(LOGDB_SEG_PREFIX);
+    if (StrLen(name) <= prefixLen)
+        return 0;
+
+    seq = 0;
+    for (p = name + prefixLen; *p != 0; p++)
+    {
+        if (*p < '0' || *p > '9')
+            return 0;
+        seq = (UInt16)(seq * 10 + (*p - '0'));
+    }
+    return seq;
+}
+
+Boolean LogSeg_ReadInfo(LocalID dbID, LogDB_SegInfo *info, UInt32 *dmP)
+{
+    Char name[dmDBNameLength];
+    LocalID appInfoID;
+    LogDB_SegInfo *p;
+    Boolean found;
+
+    MemSet(info, sizeof(LogDB_SegInfo), 0);
+    info->lastSecs = 0xFFFFFFFFUL;
+
+    appInfoID = 0;
+    name[0] = 0;
+    if (LOGDB_DM(*dmP, DmDatabaseInfo(0, dbID, name, NULL, NULL, NULL, NULL, NULL, NULL,
+                                      &appInfoID, NULL, NULL, NULL)) != errNone)
+        return false;
+    info->seq = LogSeg_SeqFromName(name);
+
+    if (appInfoID == 0)
+        return false;
+    p = (LogDB_SegInfo *)MemLocalIDToLockedPtr(appInfoID, 0);
+    if (p == NULL)
+        return false;
+    found = (p->version == LOGDB_SEGINFO_VERSION);
+    if (found)
+        MemMove(info, p, sizeof(LogDB_SegInfo));
+    MemPtrUnlock(p);
+    return found;
+}
+
+UInt16 LogSeg_List(LocalID *ids, UInt16 *seqs, UInt16 max, UInt32 fromSecs, UInt32 toSecs,
+                   UInt16 *totalP, UInt16 *maxSeqP, UInt32 *dmP)
+{
+    DmSearchStateType state;
+    Boolean newSearch;
+    LocalID dbID;
+    UInt16 cardNo;
+    UInt16 n;
+    UInt16 i;
+    LogDB_SegInfo info;
+
+    n = 0;
+    if (totalP != NULL)
+        *totalP = 0;
+    if (maxSeqP != NULL)
+        *maxSeqP = 0;
+    newSearch = true;
+    while (LOGDB_DM(*dmP, DmGetNextDatabaseByTypeCreator(newSearch, &state, LOGDB_SEG_TYPE,
+                                                         LOGDB_CREATOR, false, &cardNo,
+                                                         &dbID)) == errNone)
+    {
+        newSearch = false;
+
+        LogSeg_ReadInfo(dbID, &info, dmP);
+        if (maxSeqP != NULL && info.seq > *maxSeqP)
+            *maxSeqP = info.seq;
+        if (info.lastSecs < fromSecs || info.firstSecs > toSecs)
+            continue;
+        if (totalP != NULL)
+            (*totalP)++;
+
+        /* More than fit (a delete failed): the newest one listed makes way,
+           so the list is always the oldest */
+        if (n == max)
+        {
+            if (max == 0 || seqs[max - 1] < info.seq)
+                continue;
+            n--;
+        }
+
+        /* Insertion sort by sequence number (there are only a few) */
+        i = n;
+        while (i > 0 && seqs[i - 1] > info.seq)
+        {
+            ids[i] = ids[i - 1];
+            seqs[i] = seqs[i - 1];
+            i--;
+        }
+        ids[i] = dbID;
+        seqs[i] = info.seq;
+        n++;
+    }
+    return n;
+}
+
+/* One pass over the record headers for the active DB's time range, when
+   it is opened or was appended to behind our back. */
+static void LogSeg_ScanRange(DmOpenRef dbR, UInt32 *firstP, UInt32 *lastP, UInt32 *dmP)
+{
+    UInt16 n;
+    UInt16 i;
+    UInt32 secs;
+    UInt32 lo;
+    UInt32 hi;
+    MemHandle h;
+
+    lo = 0xFFFFFFFFUL;
+    hi = 0;
+    n = LOGDB_DM(*dmP, DmNumRecords(dbR));
+    for (i = 0; i < n; i++)
+    {
+        h = LOGDB_DM(*dmP, DmQueryRecord(dbR, i));
+        if (h == NULL)
+            continue;
+        secs = LogDB_RecSeconds((const UInt8 *)MemHandleLock(h));
+        MemHandleUnlock(h);
+        if (secs < lo)
+            lo = secs;
+        if (secs > hi)
+            hi = secs;
+    }
+    if (lo > hi)
+        lo = hi = 0;
+    *firstP = lo;
+    *lastP = hi;
+}
+
+void LogSeg_LoadActive(LogDB_Globals *g)
+{
+    UInt32 numRecs;
+    UInt32 dataBytes;
+    MemHandle h;
+
+    g->activeCount = 0;
+    g->activeBytes = 0;
+    g->activeFirstSecs = 0;
+    g->activeLoSecs = 0;
+    g->activeHiSecs = 0;
+    g->rollHold = 0;
+    LogBloom_Load(g);
+    if (g->dbR == NULL || g->dbID == 0)
+        return;
+
+    numRecs = 0;
+    dataBytes = 0;
+    LOGDB_DMG(g, DmDatabaseSize(0, g->dbID, &numRecs, NULL, &dataBytes));
+    g->activeCount = (UInt16)numRecs;
+    g->activeBytes = dataBytes;
+
+    if (numRecs > 0)
+    {
+        h = LOGDB_DMG(g, DmQueryRecord(g->dbR, 0));
+        if (h != NULL)
+        {
+            g->activeFirstSecs = LogDB_RecSeconds((const UInt8 *)MemHandleLock(h));
+            MemHandleUnlock(h);
+        }
+        LogSeg_ScanRange(g->dbR, &g->activeLoSecs, &g->activeHiSecs, &g->stats.dmCalls);
+    }
+}
+
+void LogSeg_Appended(LogDB_Globals *g, UInt32 secs, UInt32 size)
+{
+    if (g->activeCount == 0)
+    {
+        g->activeFirstSecs = secs;
+        g->activeLoSecs = secs;
+        g->activeHiSecs = secs;
+    }
+    else if (secs < g->activeLoSecs)
+    {
+        g->activeLoSecs = secs;
+    }
+    else if (secs > g->activeHiSecs)
+    {
+        g->activeHiSecs = secs;
+    }
+    g->activeCount++;
+    g->activeBytes += size;
+}
+
+Boolean LogSeg_ShouldRoll(const LogDB_Globals *g, UInt32 nowSecs, UInt32 recSize)
+{
+    UInt16 maxRecords;
+
+    if (g->activeCount == 0 || g->activeCount < g->rollHold)
+        return false;
+
+    maxRecords = g->roll.maxRecords;
+    if (maxRecords == 0)
+        maxRecords = LOGDB_ROLL_DEFAULT_RECORDS;
+    if (g->activeCount >= maxRecords)
+        return true;
+
+    if (g->roll.maxBytes != 0 && g->activeBytes + recSize > g->roll.maxBytes)
+        return true;
+
+    if (g->roll.daily && (nowSecs / SECS_PER_DAY) != (g->activeFirstSecs / SECS_PER_DAY))
+        return true;
+
+    return false;
+}
+
+/* The summary goes in an AppInfo block, allocated in the DB's own heap;
+   the caller hands the returned ID to DmSetDatabaseInfo. */
+LocalID LogSeg_NewInfo(DmOpenRef dbR, const LogDB_SegInfo *info, UInt32 *dmP)
+{
+    MemHandle infoH;
+
+    infoH = LOGDB_DM(*dmP, DmNewHandle(dbR, sizeof(LogDB_SegInfo)));
+    if (infoH == NULL)
+        return 0;
+    LOGDB_DM(*dmP, DmWrite(MemHandleLock(infoH), 0, info, sizeof(LogDB_SegInfo)));
+    MemHandleUnlock(infoH);
+    return MemHandleToLocalID(infoH);
+}
+
+/* The numbers have run out: the segments kept, oldest first, become
+   1..n. Going up in order, a new name is never one still in use. The
+   summary's seq is rewritten too, as readers and LogPack go by it. */
+static Err LogSeg_Renumber(LogDB_Globals *g, const LocalID *ids, UInt16 n)
+{
+    Char name[dmDBNameLength];
+    LocalID appInfoID;
+    LogDB_SegInfo *p;
+    UInt16 seq;
+    UInt16 i;
+    Err err;
+
+    for (i = 0; i < n; i++)
+    {
+        seq = i + 1;
+        StrPrintF(name, "%s%04u", LOGDB_SEG_PREFIX, seq);
+        err = LOGDB_DMG(g, DmSetDatabaseInfo(0, ids[i], name, NULL, NULL, NULL, NULL, NULL, NULL,
+                                             NULL, NULL, NULL, NULL));
+        if (err != errNone)
+            return err;
+
+        appInfoID = 0;
+        LOGDB_DMG(g, DmDatabaseInfo(0, ids[i], NULL, NULL, NULL, NULL, NULL, NULL, NULL,
+                                    &appInfoID, NULL, NULL, NULL));
+        p = (appInfoID != 0) ? (LogDB_SegInfo *)MemLocalIDToLockedPtr(appInfoID, 0) : NULL;
+        if (p == NULL)
+            continue;
+        if (p->version == LOGDB_SEGINFO_VERSION)
+            LOGDB_DMG(g, DmWrite(p, OffsetOf(LogDB_SegInfo, seq), &seq, sizeof(seq)));
+        MemPtrUnlock(p);
+    }
+    return errNone;
+}
+
+/* Keep appending to the active DB and try again a while later, not on
+   every append: each try lists every segment. */
+static Err LogSeg_RollFailed(LogDB_Globals *g, Err err)
+{
+    g->rollHold = g->activeCount + LOGSEG_RETRY_RECORDS;
+    return err;
+}
+
+Err LogSeg_Roll(LogDB_Globals *g)
+{
+    LocalID ids[LOGDB_MAX_SEGMENTS];
+    UInt16 seqs[LOGDB_MAX_SEGMENTS];
+    UInt16 n;
+    UInt16 first;
+    UInt16 total;
+    UInt16 maxSeq;
+    LogDB_SegInfo info;
+    LocalID appInfoID;
+    LocalID segID;
+    UInt32 segType;
+    Char name[dmDBNameLength];
+    Err err;
+
+    if (g->dbR == NULL || g->dbID == 0 || LOGDB_DMG(g, DmNumRecords(g->dbR)) == 0)
+        return errNone;
+
+    /* Retention: make room by dropping the oldest segments, as many as
+       earlier failed deletes (one held open by a reader) left over */
+    n = LogSeg_List(ids, seqs, LOGDB_MAX_SEGMENTS, 0, 0xFFFFFFFFUL, &total, &maxSeq,
+                    &g->stats.dmCalls);
+    first = 0;
+    while (first < n && total - first >= LOGDB_MAX_SEGMENTS &&
+           LOGDB_DMG(g, DmDeleteDatabase(0, ids[first])) == errNone)
+        first++;
+
+    /* The new segment must sort after every one kept. Renumbering covers
+       only the segments listed; with more left over the roll waits for
+       retention to bring them within the list. */
+    if (maxSeq >= LOGSEG_MAX_SEQ)
+    {
+        if (total > n)
+            return LogSeg_RollFailed(g, dmErrAlreadyExists);
+        err = LogSeg_Renumber(g, ids + first, n - first);
+        if (err != errNone)
+            return LogSeg_RollFailed(g, err);
+        maxSeq = n - first;
+    }
+
+    MemSet(&info, sizeof(info), 0);
+    info.version = LOGDB_SEGINFO_VERSION;
+    info.seq = maxSeq + 1;
+    info.records = LOGDB_DMG(g, DmNumRecords(g->dbR));
+    info.bytes = g->activeBytes;
+    info.firstSecs = g->activeLoSecs;
+    info.lastSecs = g->activeHiSecs;
+
+    appInfoID = LogSeg_NewInfo(g->dbR, &info, &g->stats.dmCalls);
+    if (appInfoID == 0)
+        return LogSeg_RollFailed(g, dmErrMemError);
+
+    StrPrintF(name, "%s%04u", LOGDB_SEG_PREFIX, info.seq);
+    segType = LOGDB_SEG_TYPE;
+    segID = g->dbID;
+
+    LogSinkDB_Close(g);
+    g->dbID = 0;
+
+    err = LOGDB_DMG(g, DmSetDatabaseInfo(0, segID, name, NULL, NULL, NULL, NULL, NULL, NULL,
+                                         &appInfoID, NULL, &segType, NULL));
+    if (err != errNone)
+    {
+        /* Still the active DB, without the summary */
+        MemHandleFree((MemHandle)MemLocalIDToGlobal(appInfoID, 0));
+        LogDB_OpenOrCreate(g);
+        return LogSeg_RollFailed(g, err);
+    }
+
+    /* The new segment wants packing, and once every slot is in use the
+       next roll's delete can be done ahead of it */
+    LogIdle_Queue(g, (total - first + 1 >= LOGDB_MAX_SEGMENTS)
+                         ? LOGDB_IDLE_COMPACT | LOGDB_IDLE_TRIM
+                         : LOGDB_IDLE_COMPACT);
+
+    /* Fresh active DB (also reloads the bookkeeping) */
+    return LogDB_OpenOrCreate(g);
+}
+
+Err LogSeg_DeleteAll(UInt32 *dmP)
+{
+    LocalID ids[LOGDB_MAX_SEGMENTS];
+    UInt16 seqs[LOGDB_MAX_SEGMENTS];
+    UInt16 n;
+    UInt16 i;
+    Err err;
+
+    err = errNone;
+    do
+    {
+        n = LogSeg_List(ids, seqs, LOGDB_MAX_SEGMENTS, 0, 0xFFFFFFFFUL, NULL, NULL, dmP);
+        for (i = 0; i < n; i++)
+        {
+            err = LOGDB_DM(*dmP, DmDeleteDatabase(0, ids[i]));
+            if (err != errNone)
+                return err;
+        }
+    } while (n == LOGDB_MAX_SEGMENTS);
+    return err;
+}
@@ -0,0 +1,180 @@
+/*
+    Sink dispatch for the LogDB write path.
+
+    Every record goes through LogSink_Write to the sinks selected at init
+    (LOGDB_SINK_* bits in g->sinks). Each sink provides Open, Write, Flush
+    and Close; they are dispatched with a switch rather than a table of
+    function pointers, which would need relocated data the shared library
+    does not have.
+
+    Records bound for the storage heap pass the pressure tiers first
+    (LogPressure.c); the card takes whatever it is given.
+*/
+
+#include "LogDBPriv.h"
+
+#define LOGDB_SINK_ALL (LOGDB_SINK_DB | LOGDB_SINK_VFS | LOGDB_SINK_APPDB)
+#define LOGSINK_STORAGE (LOGDB_SINK_DB | LOGDB_SINK_APPDB) /* in the storage heap */
+
+/* Sinks records go to; nothing selected (or nothing left) means the DB. */
+static UInt16 LogSink_Active(const LogDB_Globals *g)
+{
+    return (g->sinks != 0) ? g->sinks : LOGDB_SINK_DB;
+}
+
+static Err LogSink_OpenOne(LogDB_Globals *g, UInt16 sink)
+{
+    switch (sink)
+    {
+    case LOGDB_SINK_DB:
+        return LogSinkDB_Open(g);
+    case LOGDB_SINK_VFS:
+        return LogSinkVfs_Open(g);
+    case LOGDB_SINK_APPDB:
+        return LogSinkApp_Open(g);
+    default:
+        return dmErrInvalidParam;
+    }
+}
+
+static Err LogSink_WriteOne(LogDB_Globals *g, UInt16 sink, const LogDB_Rec *rec)
+{
+    switch (sink)
+    {
+    case LOGDB_SINK_DB:
+        return LogSinkDB_Write(g, rec);
+    case LOGDB_SINK_VFS:
+        return LogSinkVfs_Write(g, rec);
+    case LOGDB_SINK_APPDB:
+        return LogSinkApp_Write(g, rec);
+    default:
+        return errNone;
+    }
+}
+
+static Err LogSink_FlushOne(LogDB_Globals *g, UInt16 sink)
+{
+    switch (sink)
+    {
+    case LOGDB_SINK_VFS:
+        return LogSinkVfs_Flush(g);
+    default:
+        return errNone; /* the DB sinks write through */
+    }
+}
+
+static void LogSink_CloseOne(LogDB_Globals *g, UInt16 sink)
+{
+    switch (sink)
+    {
+    case LOGDB_SINK_DB:
+        LogSinkDB_Close(g);
+        break;
+    case LOGDB_SINK_VFS:
+        LogSinkVfs_Close(g);
+        break;
+    case LOGDB_SINK_APPDB:
+        LogSinkApp_Close(g);
+        break;
+    default:
+        break;
+    }
+}
+
+Err LogSink_Open(LogDB_Globals *g, UInt16 sinks)
+{
+    UInt16 sink;
+    Err err;
+    Err firstErr;
+
+    sinks &= LOGDB_SINK_ALL;
+    if (sinks == 0)
+        sinks = LOGDB_SINK_DB;
+
+    /* Release sinks the new selection drops */
+    for (sink = 1; sink <= LOGDB_SINK_ALL; sink <<= 1)
+    {
+        if ((g->sinks & sink) != 0 && (sinks & sink) == 0)
+            LogSink_CloseOne(g, sink);
+    }
+
+    firstErr = errNone;
+    g->sinks = sinks;
+    for (sink = 1; sink <= LOGDB_SINK_ALL; sink <<= 1)
+    {
+        if ((sinks & sink) == 0)
+            continue;
+        err = LogSink_OpenOne(g, sink);
+        if (err != errNone)
+        {
+            /* The DBs retry on the next write; the card is dropped */
+            if (sink == LOGDB_SINK_VFS)
+                g->sinks &= ~sink;
+            if (firstErr == errNone)
+                firstErr = err;
+        }
+    }
+    return firstErr;
+}
+
+Err LogSink_Write(LogDB_Globals *g, const LogDB_Rec *rec)
+{
+    UInt16 sinks;
+    UInt16 sink;
+    UInt32 size;
+    Err err;
+    Err firstErr;
+
+    sinks = LogSink_Active(g);
+    if ((sinks & LOGSINK_STORAGE) != 0 && !LogPressure_Admit(g, rec))
+        sinks &= ~LOGSINK_STORAGE;
+
+    firstErr = errNone;
+    size = 0;
+    for (sink = 1; sink <= LOGDB_SINK_ALL; sink <<= 1)
+    {
+        if ((sinks & sink) == 0)
+            continue;
+        err = LogSink_WriteOne(g, sink, rec);
+        if (err == errNone)
+        {
+            if (size == 0)
+                size = LogDB_RecSize(rec);
+            g->stats.bytes += size;
+        }
+        else if (firstErr == errNone)
+        {
+            firstErr = err;
+        }
+    }
+
+    /* Out of room sooner than the last check said: look again now */
+    if (firstErr == dmErrMemError && !g->pressureMarking)
+        LogPressure_Check(g);
+    return firstErr;
+}
+
+Err LogSink_Flush(LogDB_Globals *g)
+{
+    UInt16 sink;
+    Err err;
+    Err firstErr;
+
+    firstErr = errNone;
+    for (sink = 1; sink <= LOGDB_SINK_ALL; sink <<= 1)
+    {
+        err = LogSink_FlushOne(g, sink);
+        if (err != errNone && firstErr == errNone)
+            firstErr = err;
+    }
+    return firstErr;
+}
+
+void LogSink_Close(LogDB_Globals *g)
+{
+    UInt16 sink;
+
+    /* Every sink, selected or not: closing a closed sink is a no-op */
+    for (sink = 1; sink <= LOGDB_SINK_ALL; sink <<= 1)
+        LogSink_CloseOne(g, sink);
+}
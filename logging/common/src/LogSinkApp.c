@@ -0,0 +1,441 @@
+/*
+    Per-app DB sink: each app appends to its own "DebugLog.<app>", so a
+    reader after one app opens that app's DBs and nothing else, and a
+    noisy app's volume only slows down the queries that ask for it.
+
+    A DB that reaches the roll policy's record count is renamed to the
+    app's "DebugLog~<app>" (deleting the one before) and a fresh one is
+    started, which bounds each app to two DBs without ever removing
+    records from the front of one.
+
+    Readers open every app DB that passes the app filter and merge them:
+    each source keeps the timestamp of its next record, and the oldest of
+    those is returned next. There are only ever a few sources, so the
+    pick is a linear scan. The cursors live in a chunk sized to the DBs
+    found, up to LOGAPP_MAX_DBS (what a LogDB_IterTell position can
+    address): two for each of 128 apps.
+*/
+
+#include "LogDBPriv.h"
+
+#define LOGAPP_MAX_DBS 256      /* sources an iterator merges */
+#define LOGAPP_CLEAR_BATCH 32   /* DBs Clear lists at a time */
+#define LOGAPP_RETRY_RECORDS 256 /* appends between tries after a failed roll */
+
+/* A merge source: one app DB and the cursor into it */
+typedef struct
+{
+    LocalID dbID;
+    DmOpenRef dbR;
+    UInt16 index; /* next record */
+    UInt16 count;
+    UInt32 secs;  /* timestamp at index */
+} LogApp_Source;
+
+#define LogApp_Src(it) ((LogApp_Source *)(it)->merge)
+
+/* prefix and app, cut to fit a DB name. Both prefixes are as long. */
+static void LogApp_Name(const Char *prefix, const Char *app, Char *name)
+{
+    UInt16 prefixLen;
+    UInt16 len;
+
+    prefixLen = (UInt16)StrLen(prefix);
+    len = (UInt16)StrLen(app);
+    if (prefixLen + len >= dmDBNameLength)
+        len = dmDBNameLength - 1 - prefixLen;
+    MemMove(name, prefix, prefixLen);
+    MemMove(name + prefixLen, app, len);
+    name[prefixLen + len] = 0;
+}
+
+/* Whether name is one of app's DBs (either generation). */
+static Boolean LogApp_NameIsFor(const Char *name, const Char *app)
+{
+    Char want[dmDBNameLength];
+    UInt16 prefixLen;
+
+    LogApp_Name(LOGDB_APPDB_PREFIX, app, want);
+    prefixLen = (UInt16)StrLen(LOGDB_APPDB_PREFIX);
+    return StrCompare(name + prefixLen, want + prefixLen) == 0;
+}
+
+/* The same, for dbID */
+static Boolean LogApp_IsFor(LocalID dbID, const Char *app, UInt32 *dmP)
+{
+    Char name[dmDBNameLength];
+
+    name[0] = 0;
+    if (LOGDB_DM(*dmP, DmDatabaseInfo(0, dbID, name, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL,
+                                      NULL, NULL)) != errNone)
+        return false;
+    return LogApp_NameIsFor(name, app);
+}
+
+/* Where old generation name goes among the n listed: before its new
+   generation if that is listed already, else at the end. */
+static UInt16 LogApp_Place(const LocalID *ids, UInt16 n, const Char *name, UInt32 *dmP)
+{
+    Char newName[dmDBNameLength];
+    LocalID newID;
+    UInt16 prefixLen;
+    UInt16 i;
+
+    prefixLen = (UInt16)StrLen(LOGDB_APPDB_PREFIX);
+    if (MemCmp(name, LOGDB_APPDB_OLD_PREFIX, prefixLen) != 0)
+        return n;
+    LogApp_Name(LOGDB_APPDB_PREFIX, name + prefixLen, newName);
+    newID = LOGDB_DM(*dmP, DmFindDatabase(0, newName));
+    for (i = 0; i < n && ids[i] != newID; i++)
+        ;
+    return i;
+}
+
+/* App DBs, of app only unless it is NULL; at most max of them. With ids
+   NULL, only counts them. Each app's old generation comes before its new
+   one, so the merge returns the older of two records of a second first. */
+static UInt16 LogApp_List(LocalID *ids, UInt16 max, const Char *app, UInt32 *dmP)
+{
+    DmSearchStateType state;
+    Char name[dmDBNameLength];
+    Boolean newSearch;
+    LocalID dbID;
+    UInt16 cardNo;
+    UInt16 at;
+    UInt16 n;
+
+    n = 0;
+    newSearch = true;
+    while (n < max &&
+           LOGDB_DM(*dmP, DmGetNextDatabaseByTypeCreator(newSearch, &state, LOGDB_APPDB_TYPE,
+                                                         LOGDB_CREATOR, false, &cardNo,
+                                                         &dbID)) == errNone)
+    {
+        newSearch = false;
+        name[0] = 0;
+        if (app != NULL || ids != NULL)
+            LOGDB_DM(*dmP, DmDatabaseInfo(0, dbID, name, NULL, NULL, NULL, NULL, NULL, NULL, NULL,
+                                          NULL, NULL, NULL));
+        if (app != NULL && !LogApp_NameIsFor(name, app))
+            continue;
+        if (ids != NULL)
+        {
+            at = LogApp_Place(ids, n, name, dmP);
+            MemMove(ids + at + 1, ids + at, (UInt32)(n - at) * sizeof(LocalID));
+            ids[at] = dbID;
+        }
+        n++;
+    }
+    return n;
+}
+
+/* HotSync backs the app DBs up like the shared one. */
+static void LogApp_SetBackup(LocalID dbID, UInt32 *dmP)
+{
+    UInt16 attrs;
+
+    attrs = 0;
+    LOGDB_DM(*dmP, DmDatabaseInfo(0, dbID, NULL, &attrs, NULL, NULL, NULL, NULL, NULL, NULL, NULL,
+                                  NULL, NULL));
+    attrs |= dmHdrAttrBackup;
+    attrs &= ~dmHdrAttrCopyPrevention;
+    LOGDB_DM(*dmP, DmSetDatabaseInfo(0, dbID, NULL, &attrs, NULL, NULL, NULL, NULL, NULL, NULL,
+                                     NULL, NULL, NULL));
+}
+
+Err LogSinkApp_Open(LogDB_Globals *g)
+{
+    Char name[dmDBNameLength];
+    LocalID dbID;
+    Err err;
+
+    LogApp_Name(LOGDB_APPDB_PREFIX, g->appName, name);
+    if (g->appR != NULL)
+    {
+        if (StrCompare(name, g->appDbName) == 0)
+            return errNone;
+        LogSinkApp_Close(g); /* LogDB_Init switched apps */
+    }
+
+    dbID = LOGDB_DMG(g, DmFindDatabase(0, name));
+    if (dbID == 0)
+    {
+        err = LOGDB_DMG(g, DmCreateDatabase(0, name, LOGDB_CREATOR, LOGDB_APPDB_TYPE, false));
+        if (err != errNone && err != dmErrAlreadyExists)
+            return err;
+        dbID = LOGDB_DMG(g, DmFindDatabase(0, name));
+        if (dbID == 0)
+            return DmGetLastErr();
+        LogApp_SetBackup(dbID, &g->stats.dmCalls);
+    }
+
+    g->appR = LOGDB_DMG(g, DmOpenDatabase(0, dbID, LOGDB_RW_MODE));
+    if (g->appR == NULL)
+        return dmErrCantOpen;
+    g->appCount = LOGDB_DMG(g, DmNumRecords(g->appR));
+    g->appHold = 0;
+    StrCopy(g->appDbName, name);
+    return errNone;
+}
+
+void LogSinkApp_Close(LogDB_Globals *g)
+{
+    if (g->appR != NULL)
+    {
+        LOGDB_DMG(g, DmCloseDatabase(g->appR));
+        g->appR = NULL;
+    }
+    g->appDbName[0] = 0;
+}
+
+/* The full DB becomes the old generation; a new one is opened. The old
+   generation goes first (a reader may have it open), so a failure leaves
+   the full DB open to append to. */
+static Err LogApp_Roll(LogDB_Globals *g)
+{
+    Char oldName[dmDBNameLength];
+    LocalID dbID;
+    LocalID oldID;
+    Err err;
+
+    LogApp_Name(LOGDB_APPDB_OLD_PREFIX, g->appName, oldName);
+    oldID = LOGDB_DMG(g, DmFindDatabase(0, oldName));
+    if (oldID != 0)
+    {
+        err = LOGDB_DMG(g, DmDeleteDatabase(0, oldID));
+        if (err != errNone)
+            return err;
+    }
+
+    LOGDB_DMG(g, DmOpenDatabaseInfo(g->appR, &dbID, NULL, NULL, NULL, NULL));
+    LogSinkApp_Close(g);
+    err = LOGDB_DMG(g, DmSetDatabaseInfo(0, dbID, oldName, NULL, NULL, NULL, NULL, NULL, NULL, NULL,
+                                         NULL, NULL, NULL));
+    if (err != errNone)
+        return err;
+    return LogSinkApp_Open(g);
+}
+
+Err LogSinkApp_Write(LogDB_Globals *g, const LogDB_Rec *rec)
+{
+    UInt16 maxRecords;
+    Err err;
+
+    err = LogSinkApp_Open(g);
+    if (err != errNone)
+        return err;
+
+    /* On a failed roll, keep appending to what is open, and try again
+       only a while later */
+    maxRecords = (g->roll.maxRecords != 0) ? g->roll.maxRecords : LOGDB_ROLL_DEFAULT_RECORDS;
+    if (g->appCount >= maxRecords && g->appCount >= g->appHold && LogApp_Roll(g) != errNone)
+    {
+        if (g->appR == NULL)
+        {
+            err = LogSinkApp_Open(g);
+            if (err != errNone)
+                return err;
+        }
+        g->appHold = g->appCount + LOGAPP_RETRY_RECORDS;
+    }
+
+    err = LogDB_AppendRec(g->appR, rec, LogDB_RecSize(rec), NULL, &g->stats.dmCalls);
+    if (err != dmErrMemError)
+        g->appCount++;
+    return err;
+}
+
+Err LogSinkApp_Clear(LogDB_Globals *g, const Char *app)
+{
+    LocalID ids[LOGAPP_CLEAR_BATCH];
+    UInt16 n;
+    UInt16 i;
+    Err err;
+
+    /* Ours may be among them; the next write starts a new one */
+    LogSinkApp_Close(g);
+
+    /* Listed before deleting, so the search never walks a changed list */
+    do
+    {
+        n = LogApp_List(ids, LOGAPP_CLEAR_BATCH, app, &g->stats.dmCalls);
+        for (i = 0; i < n; i++)
+        {
+            err = LOGDB_DMG(g, DmDeleteDatabase(0, ids[i]));
+            if (err != errNone)
+                return err;
+        }
+    } while (n == LOGAPP_CLEAR_BATCH);
+    return errNone;
+}
+
+/* --- Merged reading --- */
+
+Err LogSinkApp_IterBegin(LogDB_Iter *it)
+{
+    LogApp_Source *src;
+    LocalID *ids;
+    UInt16 n;
+    UInt16 s;
+
+    /* Counted first, so the list runs into a chunk of its size */
+    n = LogApp_List(NULL, LOGAPP_MAX_DBS, NULL, &it->dmCalls);
+    if (n == 0)
+        return dmErrCantOpen;
+    ids = (LocalID *)MemPtrNew((UInt32)n * sizeof(LocalID));
+    src = (LogApp_Source *)MemPtrNew((UInt32)n * sizeof(LogApp_Source));
+    if (ids == NULL || src == NULL)
+    {
+        if (ids != NULL)
+            MemPtrFree(ids);
+        if (src != NULL)
+            MemPtrFree(src);
+        return memErrNotEnoughSpace;
+    }
+
+    /* One may have come or gone since the count */
+    n = LogApp_List(ids, n, NULL, &it->dmCalls);
+    MemSet(src, (UInt32)n * sizeof(LogApp_Source), 0);
+    for (s = 0; s < n; s++)
+        src[s].dbID = ids[s];
+    MemPtrFree(ids);
+    it->merge = src;
+    it->numDBs = n;
+    return (n > 0) ? errNone : dmErrCantOpen;
+}
+
+void LogSinkApp_IterSetApp(LogDB_Iter *it, const Char *app)
+{
+    LogApp_Source *src;
+    UInt16 i;
+    UInt16 n;
+
+    /* Once the DBs are open, the record filter alone applies */
+    if (it->db != 0 || it->merge == NULL)
+        return;
+    src = LogApp_Src(it);
+    n = 0;
+    for (i = 0; i < it->numDBs; i++)
+    {
+        if (LogApp_IsFor(src[i].dbID, app, &it->dmCalls))
+            src[n++] = src[i];
+    }
+    it->numDBs = n;
+}
+
+/* Timestamp of source s's next record, past any that cannot be read. */
+static void LogApp_Head(LogDB_Iter *it, UInt16 s)
+{
+    LogApp_Source *src;
+    MemHandle h;
+    const UInt8 *p;
+
+    src = LogApp_Src(it) + s;
+    while (src->index < src->count)
+    {
+        h = LOGDB_DM(it->dmCalls, DmQueryRecord(src->dbR, src->index));
+        if (h != NULL && MemHandleSize(h) >= LOGDB_REC_MIN)
+        {
+            p = (const UInt8 *)MemHandleLock(h);
+            src->secs = LogDB_RecSeconds(p);
+            MemHandleUnlock(h);
+            return;
+        }
+        src->index++;
+    }
+}
+
+static void LogApp_IterOpen(LogDB_Iter *it)
+{
+    LogApp_Source *src;
+    UInt16 s;
+
+    src = LogApp_Src(it);
+    for (s = 0; s < it->numDBs; s++)
+    {
+        src[s].dbR = LOGDB_DM(it->dmCalls, DmOpenDatabase(0, src[s].dbID, dmModeReadOnly));
+        src[s].index = 0;
+        src[s].count =
+            (src[s].dbR != NULL) ? LOGDB_DM(it->dmCalls, DmNumRecords(src[s].dbR)) : 0;
+        LogApp_Head(it, s);
+    }
+    it->db = 1;
+}
+
+MemHandle LogSinkApp_IterNext(LogDB_Iter *it)
+{
+    LogApp_Source *src;
+    MemHandle h;
+    UInt16 best;
+    UInt16 s;
+
+    if (it->merge == NULL)
+        return NULL;
+    if (it->db == 0)
+        LogApp_IterOpen(it);
+
+    /* Oldest head wins; on a tie the earlier source (an old generation
+       is listed before its new one) */
+    src = LogApp_Src(it);
+    best = it->numDBs;
+    for (s = 0; s < it->numDBs; s++)
+    {
+        if (src[s].index < src[s].count && (best == it->numDBs || src[s].secs < src[best].secs))
+            best = s;
+    }
+    if (best == it->numDBs)
+        return NULL;
+
+    h = LOGDB_DM(it->dmCalls, DmQueryRecord(src[best].dbR, src[best].index));
+    src[best].index++;
+    it->mergeCur = best;
+    LogApp_Head(it, best);
+    return h;
+}
+
+MemHandle LogSinkApp_IterSeek(LogDB_Iter *it, UInt16 db, UInt16 index)
+{
+    LogApp_Source *src;
+
+    if (it->merge == NULL)
+        return NULL;
+    if (it->db == 0)
+        LogApp_IterOpen(it);
+    src = LogApp_Src(it);
+    if (db >= it->numDBs || index >= src[db].count)
+        return NULL;
+
+    src[db].index = index + 1;
+    it->mergeCur = db;
+    LogApp_Head(it, db);
+    return LOGDB_DM(it->dmCalls, DmQueryRecord(src[db].dbR, index));
+}
+
+UInt32 LogSinkApp_IterTell(const LogDB_Iter *it)
+{
+    const LogApp_Source *src;
+
+    if (it->merge == NULL)
+        return LOGDB_POS_NONE;
+    src = LogApp_Src(it) + it->mergeCur;
+    if (src->index == 0)
+        return LOGDB_POS_NONE;
+    return ((UInt32)it->mergeCur << 24) | ((UInt32)(src->index - 1) << 8);
+}
+
+void LogSinkApp_IterEnd(LogDB_Iter *it)
+{
+    LogApp_Source *src;
+    UInt16 s;
+
+    if (it->merge == NULL)
+        return;
+    src = LogApp_Src(it);
+    for (s = 0; s < it->numDBs; s++)
+    {
+        if (src[s].dbR != NULL)
+            LOGDB_DM(it->dmCalls, DmCloseDatabase(src[s].dbR));
+    }
+    MemPtrFree(it->merge);
+    it->merge = NULL;
+}
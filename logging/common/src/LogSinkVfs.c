@@ -0,0 +1,281 @@
+/*
+    Card stream sink: records appended to LOGDB_VFS_PATH on the first
+    expansion card volume through the VFS Manager.
+
+    Frames ([UInt16 length][record]) are collected in g->vfsBuf and written
+    with one VFSFileWrite per block instead of one per record. A block
+    only ever holds whole frames, so a reset loses at most the unflushed
+    tail and never leaves a torn frame for the next append to follow.
+    logging/tools/LogTail reads the same file on the desktop.
+*/
+
+#include "LogDBPriv.h"
+
+/* First mounted volume; false without the VFS Manager or a card. */
+static Boolean LogVfs_FindVolume(UInt16 *volRefP)
+{
+    UInt32 vfsVersion;
+    UInt32 volIter;
+
+    if (FtrGet(sysFileCVFSMgr, vfsFtrIDVersion, &vfsVersion) != errNone)
+        return false;
+
+    volIter = vfsIteratorStart;
+    return (VFSVolumeEnumerate(volRefP, &volIter) == errNone);
+}
+
+Err LogSinkVfs_Open(LogDB_Globals *g)
+{
+    UInt8 magic[4];
+    UInt32 size;
+    UInt32 written;
+    Err err;
+
+    if (g->vfsFile != 0)
+        return errNone;
+    if (!LogVfs_FindVolume(&g->vfsVolRef))
+        return expErrCardNotPresent;
+
+    /* Parents first; "already exists" is the usual answer */
+    VFSDirCreate(g->vfsVolRef, "/PALM");
+    VFSDirCreate(g->vfsVolRef, "/PALM/Programs");
+    VFSDirCreate(g->vfsVolRef, LOGDB_VFS_DIR);
+
+    err = VFSFileOpen(g->vfsVolRef, LOGDB_VFS_PATH, vfsModeReadWrite | vfsModeCreate,
+                      &g->vfsFile);
+    if (err != errNone)
+    {
+        g->vfsFile = 0;
+        return err;
+    }
+
+    size = 0;
+    VFSFileSize(g->vfsFile, &size);
+    if (size == 0)
+    {
+        LogDB_Put32(magic, LOGDB_VFS_MAGIC);
+        err = VFSFileWrite(g->vfsFile, sizeof(magic), magic, &written);
+    }
+    else
+    {
+        err = VFSFileSeek(g->vfsFile, vfsOriginEnd, 0);
+    }
+    if (err != errNone)
+    {
+        VFSFileClose(g->vfsFile);
+        g->vfsFile = 0;
+        return err;
+    }
+
+    g->vfsUsed = 0;
+    return errNone;
+}
+
+Err LogSinkVfs_Write(LogDB_Globals *g, const LogDB_Rec *rec)
+{
+    LogDB_Rec r;
+    UInt32 size;
+    Err err;
+
+    /* Released for a reader (or never opened): reopen, or stop trying */
+    if (g->vfsFile == 0)
+    {
+        err = LogSinkVfs_Open(g);
+        if (err != errNone)
+        {
+            g->sinks &= ~LOGDB_SINK_VFS;
+            return err;
+        }
+    }
+
+    r = *rec;
+    size = LogDB_RecSize(&r);
+    if (2 + size > LOGDB_VFS_BLOCK)
+    {
+        r.msgLen -= (UInt16)(2 + size - LOGDB_VFS_BLOCK);
+        size = LOGDB_VFS_BLOCK - 2;
+    }
+
+    if (g->vfsUsed + 2 + size > LOGDB_VFS_BLOCK)
+    {
+        err = LogSinkVfs_Flush(g);
+        if (err != errNone)
+            return err;
+    }
+
+    LogDB_Put16(g->vfsBuf + g->vfsUsed, (UInt16)size);
+    LogDB_RecEncode(&r, g->vfsBuf + g->vfsUsed + 2);
+    g->vfsUsed += (UInt16)(2 + size);
+    return errNone;
+}
+
+Err LogSinkVfs_Flush(LogDB_Globals *g)
+{
+    UInt32 written;
+    Err err;
+
+    if (g->vfsFile == 0 || g->vfsUsed == 0)
+        return errNone;
+
+    written = 0;
+    err = VFSFileWrite(g->vfsFile, g->vfsUsed, g->vfsBuf, &written);
+    g->vfsUsed = 0;
+    if (err != errNone)
+    {
+        /* Card pulled or full: drop the file, the next write retries */
+        VFSFileClose(g->vfsFile);
+        g->vfsFile = 0;
+    }
+    return err;
+}
+
+void LogSinkVfs_Close(LogDB_Globals *g)
+{
+    if (g->vfsFile == 0)
+        return;
+    LogSinkVfs_Flush(g);
+    if (g->vfsFile != 0)
+    {
+        VFSFileClose(g->vfsFile);
+        g->vfsFile = 0;
+    }
+}
+
+Err LogSinkVfs_Clear(LogDB_Globals *g)
+{
+    Boolean wasOpen;
+    UInt16 volRef;
+    Err err;
+
+    wasOpen = (g->vfsFile != 0);
+    if (wasOpen)
+    {
+        g->vfsUsed = 0;
+        VFSFileClose(g->vfsFile);
+        g->vfsFile = 0;
+        volRef = g->vfsVolRef;
+    }
+    else if (!LogVfs_FindVolume(&volRef))
+    {
+        return errNone;
+    }
+
+    err = VFSFileDelete(volRef, LOGDB_VFS_PATH);
+    if (err == vfsErrFileNotFound)
+        err = errNone;
+
+    if (wasOpen && err == errNone)
+        err = LogSinkVfs_Open(g);
+    return err;
+}
+
+/* --- Reading the stream file --- */
+
+/* Copy n bytes from the file through the read-ahead block. */
+static Boolean LogVfs_Read(LogDB_Iter *it, UInt8 *dst, UInt16 n)
+{
+    UInt8 *block;
+    UInt32 got;
+    UInt16 chunk;
+
+    block = (UInt8 *)MemHandleLock(it->blockH);
+    while (n > 0)
+    {
+        if (it->blockPos >= it->blockLen)
+        {
+            /* A short read at the end of the file reports vfsErrFileEOF */
+            got = 0;
+            VFSFileRead(it->fileRef, LOGDB_VFS_BLOCK, block, &got);
+            it->blockLen = (UInt16)got;
+            it->blockPos = 0;
+            if (got == 0)
+                break;
+        }
+        chunk = it->blockLen - it->blockPos;
+        if (chunk > n)
+            chunk = n;
+        MemMove(dst, block + it->blockPos, chunk);
+        it->blockPos += chunk;
+        dst += chunk;
+        n -= chunk;
+    }
+    MemHandleUnlock(it->blockH);
+    return (n == 0);
+}
+
+Err LogSinkVfs_IterBegin(LogDB_Iter *it)
+{
+    UInt16 volRef;
+    UInt8 magic[4];
+    Err err;
+
+    if (!LogVfs_FindVolume(&volRef))
+        return expErrCardNotPresent;
+
+    err = VFSFileOpen(volRef, LOGDB_VFS_PATH, vfsModeRead, &it->fileRef);
+    if (err != errNone)
+    {
+        it->fileRef = 0;
+        return err;
+    }
+
+    /* Frames are capped at a block, so one frame buffer serves them all */
+    it->blockH = MemHandleNew(LOGDB_VFS_BLOCK);
+    it->frameH = MemHandleNew(LOGDB_VFS_BLOCK);
+    if (it->blockH == NULL || it->frameH == NULL)
+    {
+        LogSinkVfs_IterEnd(it);
+        return memErrNotEnoughSpace;
+    }
+
+    if (!LogVfs_Read(it, magic, sizeof(magic)) || LogDB_Get32(magic) != LOGDB_VFS_MAGIC)
+    {
+        LogSinkVfs_IterEnd(it);
+        return dmErrCantOpen;
+    }
+    return errNone;
+}
+
+/* Next frame as an unlocked handle; NULL at the end or at a damaged
+   length. The record itself is checked when it is decoded. */
+MemHandle LogSinkVfs_IterNext(LogDB_Iter *it)
+{
+    UInt8 lenBuf[2];
+    UInt16 len;
+    UInt8 *p;
+    Boolean ok;
+
+    if (it->fileRef == 0)
+        return NULL;
+    if (!LogVfs_Read(it, lenBuf, sizeof(lenBuf)))
+        return NULL;
+
+    len = LogDB_Get16(lenBuf);
+    if (len < LOGDB_REC_MIN || len > LOGDB_VFS_BLOCK - 2)
+        return NULL;
+
+    p = (UInt8 *)MemHandleLock(it->frameH);
+    ok = LogVfs_Read(it, p, len);
+    MemHandleUnlock(it->frameH);
+    it->frameLen = len;
+    return ok ? it->frameH : NULL;
+}
+
+void LogSinkVfs_IterEnd(LogDB_Iter *it)
+{
+    if (it->fileRef != 0)
+    {
+        VFSFileClose(it->fileRef);
+        it->fileRef = 0;
+    }
+    if (it->blockH != NULL)
+    {
+        MemHandleFree(it->blockH);
+        it->blockH = NULL;
+    }
+    if (it->frameH != NULL)
+    {
+        MemHandleFree(it->frameH);
+        it->frameH = NULL;
+    }
+}
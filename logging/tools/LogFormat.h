@@ -0,0 +1,311 @@
+#ifndef LOGFORMAT_H
+#define LOGFORMAT_H
+
+/*
+    LogDB on-disk formats as seen from the desktop.
+
+    Mirrors ../common/src/LogDB.h without the Palm headers. Everything is
+    big-endian, so these read the same on any host.
+
+    Record v2:    [UInt8 version|flags][UInt8 appLen][UInt16 msgLen]
+                  [UInt32 seconds][UInt32 ticks][UInt8 fieldsLen]
+                  [UInt16 rate, if sampled][appName\0][message\0][fields]
+    Record v1:    [UInt32 seconds][appName\0][message\0][fields]
+                  (top nibble of the first byte is never 2)
+    Packed block: [UInt8 0x30][UInt8 numApps][UInt16 count][UInt32 firstSecs]
+                  [UInt32 lastSecs][UInt16 appsOffset][UInt16 dataOffset][pad]
+                  [UInt16 secsDelta] x count, [UInt8 appId] x count,
+                  [UInt16 entryOffset] x count, at appsOffset
+                  [UInt16 nameOffset] x numApps, [UInt8 len][appName\0] each;
+                  at dataOffset + entryOffset, per entry: [UInt32 ticks]
+                  [UInt16 rate][UInt16 msgLen][UInt8 fieldsLen][message\0][fields]
+    Field:        [UInt8 type][UInt8 keyLen][key][value]
+                  int32/uint32/ticks: 4 bytes; str: [UInt8 len][bytes]
+    Stream file:  'LgS1', then [UInt16 length][record] per record
+    PDB file:     78-byte header, an 8-byte [offset][attr][uniqueID]
+                  entry per record, 2 bytes of pad, then the records
+*/
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#define LOG_VFS_MAGIC 0x4C675331UL /* 'LgS1' */
+#define LOG_VFS_BLOCK 512
+#define LOG_MIN_RECORD 6
+
+#define LOG_REC_VERSION_MASK 0xF0
+#define LOG_REC_V2 0x20
+#define LOG_RECF_SAMPLED 0x01
+#define LOG_REC_V2_HEADER 13
+#define LOG_REC_BLOCK 0x30
+#define LOG_BLOCK_HEADER 18
+#define LOG_BLOCK_ENTRY_HEADER 9
+
+#define LOG_FIELD_INT32 1
+#define LOG_FIELD_UINT32 2
+#define LOG_FIELD_STR 3
+#define LOG_FIELD_TICKS 4
+
+/* "DebugLog" as HotSync backs it up */
+#define LOG_PDB_NAME "DebugLog"
+#define LOG_PDB_TYPE 0x44415441UL    /* 'DATA' */
+#define LOG_SEG_TYPE 0x4C536567UL    /* 'LSeg': "DebugLog-NNNN", rolled over */
+#define LOG_PDB_CREATOR 0x4C674442UL /* 'LgDB' */
+#define LOG_PDB_HEADER 78
+#define LOG_PDB_ENTRY 8
+#define LOG_PDB_ATTR_BACKUP 0x0008
+#define LOG_PDB_MAX_RECORDS 65535
+
+/* uint32 field carried by sampled v1 records: calls each one stands for */
+#define LOG_KEY_RATE "_rate"
+
+typedef struct
+{
+    int version;       /* 3 for an entry of a packed block */
+    uint32_t secs;
+    uint32_t ticks;    /* 0 for v1 */
+    unsigned rate;     /* from the v2 header; 1 otherwise */
+    const char *app;
+    const char *msg;
+    const unsigned char *fields; /* bytes after the message */
+    size_t fieldsLen;
+} LogRecord;
+
+/* Helpers each tool may or may not use */
+#ifdef __GNUC__
+#define LOG_HELPER static __attribute__((unused))
+#else
+#define LOG_HELPER static
+#endif
+
+/* Seconds between the Palm epoch (1904-01-01) and the Unix epoch */
+#define LOG_PALM_TO_UNIX 2082844800UL
+
+LOG_HELPER uint16_t Log_Get16(const unsigned char *p)
+{
+    return (uint16_t)((p[0] << 8) | p[1]);
+}
+
+LOG_HELPER uint32_t Log_Get32(const unsigned char *p)
+{
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+}
+
+/* Split a record into its parts; 0 if it is malformed. */
+LOG_HELPER int Log_DecodeRecord(const unsigned char *rec, size_t len, LogRecord *out)
+{
+    const unsigned char *end;
+    const unsigned char *z;
+    size_t hdr;
+    size_t appLen;
+    size_t msgLen;
+    size_t fieldsLen;
+
+    if (len < LOG_MIN_RECORD)
+        return 0;
+
+    if ((rec[0] & LOG_REC_VERSION_MASK) == LOG_REC_V2)
+    {
+        hdr = LOG_REC_V2_HEADER + ((rec[0] & LOG_RECF_SAMPLED) ? 2 : 0);
+        if (len < hdr + 2)
+            return 0;
+        appLen = rec[1];
+        msgLen = Log_Get16(rec + 2);
+        fieldsLen = rec[12];
+        if (len < hdr + appLen + 1 + msgLen + 1 + fieldsLen ||
+            rec[hdr + appLen] != 0 || rec[hdr + appLen + 1 + msgLen] != 0)
+            return 0;
+        out->version = 2;
+        out->secs = Log_Get32(rec + 4);
+        out->ticks = Log_Get32(rec + 8);
+        out->rate = (rec[0] & LOG_RECF_SAMPLED) ? Log_Get16(rec + LOG_REC_V2_HEADER) : 1;
+        out->app = (const char *)rec + hdr;
+        out->msg = out->app + appLen + 1;
+        out->fields = (const unsigned char *)out->msg + msgLen + 1;
+        out->fieldsLen = fieldsLen;
+        return 1;
+    }
+
+    end = rec + len;
+    out->version = 1;
+    out->ticks = 0;
+    out->rate = 1;
+    out->secs = Log_Get32(rec);
+    out->app = (const char *)rec + 4;
+    z = memchr(rec + 4, 0, (size_t)(end - (rec + 4)));
+    if (z == NULL || z + 1 >= end)
+        return 0;
+    out->msg = (const char *)z + 1;
+    z = memchr(z + 1, 0, (size_t)(end - (z + 1)));
+    if (z == NULL)
+        return 0;
+    out->fields = z + 1;
+    out->fieldsLen = (size_t)(end - (z + 1));
+    return 1;
+}
+
+/* Entries in a packed block; 0 if it is not one or is damaged. */
+LOG_HELPER unsigned Log_BlockCount(const unsigned char *blk, size_t len)
+{
+    unsigned count;
+
+    if (len < LOG_BLOCK_HEADER || (blk[0] & LOG_REC_VERSION_MASK) != LOG_REC_BLOCK)
+        return 0;
+    count = Log_Get16(blk + 2);
+    if (Log_Get16(blk + 12) < LOG_BLOCK_HEADER + 5 * (size_t)count || Log_Get16(blk + 14) > len)
+        return 0;
+    return count;
+}
+
+/* Entry i of a packed block (i below Log_BlockCount) as a record; 0 if it
+   is damaged. */
+LOG_HELPER int Log_DecodeBlockEntry(const unsigned char *blk, size_t len, unsigned i,
+                                    LogRecord *out)
+{
+    unsigned count;
+    unsigned appId;
+    unsigned k;
+    size_t nameOff;
+    size_t at;
+    size_t msgLen;
+    size_t fieldsLen;
+
+    count = Log_Get16(blk + 2);
+    appId = blk[LOG_BLOCK_HEADER + 2 * count + i];
+    if (appId >= blk[1] || (size_t)Log_Get16(blk + 12) + 2 * (appId + 1) > len)
+        return 0;
+    nameOff = Log_Get16(blk + Log_Get16(blk + 12) + 2 * appId);
+    if (nameOff + 2 > len || nameOff + 1 + blk[nameOff] >= len ||
+        blk[nameOff + 1 + blk[nameOff]] != 0)
+        return 0;
+
+    at = (size_t)Log_Get16(blk + 14) + Log_Get16(blk + LOG_BLOCK_HEADER + 3 * count + 2 * i);
+    if (at + LOG_BLOCK_ENTRY_HEADER + 1 > len)
+        return 0;
+    msgLen = Log_Get16(blk + at + 6);
+    fieldsLen = blk[at + 8];
+    if (at + LOG_BLOCK_ENTRY_HEADER + msgLen + 1 + fieldsLen > len ||
+        blk[at + LOG_BLOCK_ENTRY_HEADER + msgLen] != 0)
+        return 0;
+
+    /* Deltas add up from the first entry's time */
+    out->version = 3;
+    out->secs = Log_Get32(blk + 4);
+    for (k = 1; k <= i; k++)
+        out->secs += Log_Get16(blk + LOG_BLOCK_HEADER + 2 * k);
+    out->ticks = Log_Get32(blk + at);
+    out->rate = Log_Get16(blk + at + 4) > 1 ? Log_Get16(blk + at + 4) : 1;
+    out->app = (const char *)blk + nameOff + 1;
+    out->msg = (const char *)blk + at + LOG_BLOCK_ENTRY_HEADER;
+    out->fields = (const unsigned char *)out->msg + msgLen + 1;
+    out->fieldsLen = fieldsLen;
+    return 1;
+}
+
+/* Print the field list as " {key=value ...}"; 0 if it is malformed. */
+LOG_HELPER int Log_PrintFields(FILE *out, const unsigned char *p, size_t len)
+{
+    const unsigned char *end;
+    unsigned keyLen;
+    unsigned strLen;
+    int type;
+
+    if (len == 0)
+        return 1;
+    end = p + len;
+    fputs(" {", out);
+    while (p < end)
+    {
+        if (end - p < 2)
+            return 0;
+        type = p[0];
+        keyLen = p[1];
+        if (keyLen == 0 || (size_t)(end - p) < 2 + (size_t)keyLen)
+            return 0;
+        if (p != end - len)
+            fputc(' ', out);
+        fprintf(out, "%.*s=", (int)keyLen, (const char *)p + 2);
+        p += 2 + keyLen;
+
+        switch (type)
+        {
+        case LOG_FIELD_INT32:
+        case LOG_FIELD_UINT32:
+        case LOG_FIELD_TICKS:
+            if (end - p < 4)
+                return 0;
+            if (type == LOG_FIELD_INT32)
+                fprintf(out, "%ld", (long)(int32_t)Log_Get32(p));
+            else if (type == LOG_FIELD_UINT32)
+                fprintf(out, "%lu", (unsigned long)Log_Get32(p));
+            else
+                fprintf(out, "@%lu", (unsigned long)Log_Get32(p));
+            p += 4;
+            break;
+        case LOG_FIELD_STR:
+            if (end - p < 1 || (size_t)(end - p) < 1 + (size_t)p[0])
+                return 0;
+            strLen = p[0];
+            fprintf(out, "\"%.*s\"", (int)strLen, (const char *)p + 1);
+            p += 1 + strLen;
+            break;
+        default:
+            return 0;
+        }
+    }
+    fputc('}', out);
+    return 1;
+}
+
+/* Calls a record stands for: the header rate, or a v1 record's "_rate"
+   field; 1 when unsampled. */
+LOG_HELPER unsigned long Log_RecordWeight(const LogRecord *r)
+{
+    const unsigned char *p;
+    const unsigned char *end;
+    size_t keyLen;
+    size_t valLen;
+
+    if (r->rate > 1)
+        return r->rate;
+    p = r->fields;
+    end = p + r->fieldsLen;
+    while (end - p >= 2)
+    {
+        keyLen = p[1];
+        if ((size_t)(end - p) < 2 + keyLen)
+            break;
+        if (p[0] == LOG_FIELD_STR)
+            valLen = ((size_t)(end - p) > 2 + keyLen) ? 1 + (size_t)p[2 + keyLen] : 1;
+        else
+            valLen = 4;
+        if ((size_t)(end - p) < 2 + keyLen + valLen)
+            break;
+        if (p[0] == LOG_FIELD_UINT32 && keyLen == sizeof(LOG_KEY_RATE) - 1 &&
+            memcmp(p + 2, LOG_KEY_RATE, keyLen) == 0)
+            return Log_Get32(p + 2 + keyLen) > 1 ? Log_Get32(p + 2 + keyLen) : 1;
+        p += 2 + keyLen + valLen;
+    }
+    return 1;
+}
+
+/* "YYYY-MM-DD hh:mm:ss - App - Message {fields}". Palm clocks run on
+   local time, so the wall-clock fields are printed as stored. */
+LOG_HELPER void Log_PrintRecord(FILE *out, const LogRecord *r)
+{
+    time_t t;
+    struct tm tmv;
+    char when[32];
+
+    t = (time_t)((int64_t)r->secs - (int64_t)LOG_PALM_TO_UNIX);
+    gmtime_r(&t, &tmv);
+    strftime(when, sizeof(when), "%Y-%m-%d %H:%M:%S", &tmv);
+    fprintf(out, "%s - %s - %s", when, r->app, r->msg);
+    if (!Log_PrintFields(out, r->fields, r->fieldsLen))
+        fputs(" <bad fields>", out);
+    fputc('\n', out);
+}
+
+#endif /* LOGFORMAT_H */
@@ -0,0 +1,487 @@
+/*
+    LogGen: write a synthetic DebugLog.pdb for benchmarks.
+
+    The records are v2, laid out byte for byte as LogDB_Log writes them,
+    so the PDB installs on a device (or loads into the host shim) as a log
+    that grew there. Every choice comes from a seeded generator of its
+    own, so the same options give the same file on any host; golden/
+    lists the reference datasets by their options and CRC-32.
+
+        LogGen [options] out.pdb
+
+        -n records         1..65535 (default 1000)
+        -s seed            (default 1)
+        -a apps[:skew]     apps logging (default 4:1); the k-th logs in
+                           proportion to 1/k^skew, skew 0..3
+        -m min:max[:shape] message length (default 8:48:s); shape u is
+                           uniform, s favours short messages, l long ones
+        -t start           first timestamp, Palm seconds (default 2004-01-01)
+        -i mean            mean seconds between records (default 2)
+        -b percent         records logged in the same second as the one
+                           before, a burst (default 20)
+        -j jumps[:secs]    clock changes per 10000 records, each back or
+                           forward by up to secs (default 0:86400)
+        -l out.lgs         also write the records as a card stream file
+        -c crc             exit 1 unless the PDB's CRC-32 is crc (hex)
+
+    A line with the record count, size and CRC-32 goes to stdout.
+*/
+
+#include <stdlib.h>
+
+#include "LogFormat.h"
+
+#define GEN_MAX_APPS 64
+#define GEN_MAX_MSG 1000
+#define GEN_DEFAULT_START 3155760000UL /* 2004-01-01 00:00:00 */
+
+typedef struct
+{
+    unsigned long records;
+    uint32_t seed;
+    unsigned apps;
+    unsigned skew;
+    unsigned minLen;
+    unsigned maxLen;
+    char shape;
+    uint32_t start;
+    unsigned long mean;
+    unsigned burst;
+    unsigned jumps;
+    unsigned long jumpSecs;
+    const char *pdbPath;
+    const char *lgsPath;
+    const char *crc;
+} GenOptions;
+
+static const char *sAppNames[] = {
+    "LogTestApp", "LogViewer", "Memo", "Address", "Datebook", "ToDo", "Mail", "Expense",
+    "HotSync", "Prefs", "Calc", "Clock", "Notes", "Launcher", "SyncAgent", "Beamer",
+};
+
+static const char *sWords[] = {
+    "frmOpenEvent", "penDownEvent", "keyDownEvent", "ctlSelectEvent", "Sync", "started",
+    "finished", "records", "Button", "Clicked", "Saved", "Opened", "Closed", "form",
+    "Main", "Prefs", "Details", "Low", "battery", "warning", "Alarm", "timeout", "retry",
+    "error", "DmWrite", "MemoDB", "AddressDB", "ok", "at", "to", "from", "in",
+};
+
+/* --- Seeded generator (xorshift32) --- */
+
+static uint32_t sState;
+
+static uint32_t Gen_Rand(void)
+{
+    sState ^= sState << 13;
+    sState ^= sState >> 17;
+    sState ^= sState << 5;
+    return sState;
+}
+
+/* 0..n-1 */
+static uint32_t Gen_Below(uint32_t n)
+{
+    return (n > 0) ? Gen_Rand() % n : 0;
+}
+
+/* --- Records --- */
+
+/* Cumulative weights: app k (from 1) weighs apps^skew / k^skew */
+static void Gen_AppWeights(const GenOptions *o, unsigned long *cum)
+{
+    unsigned long w;
+    unsigned long total;
+    unsigned k;
+    unsigned e;
+
+    total = 0;
+    for (k = 1; k <= o->apps; k++)
+    {
+        w = 1;
+        for (e = 0; e < o->skew; e++)
+            w *= o->apps;
+        for (e = 0; e < o->skew; e++)
+            w /= k;
+        total += (w > 0) ? w : 1;
+        cum[k - 1] = total;
+    }
+}
+
+static const char *Gen_App(const GenOptions *o, const unsigned long *cum, char *buf)
+{
+    unsigned long r;
+    unsigned k;
+
+    r = Gen_Below((uint32_t)cum[o->apps - 1]);
+    for (k = 0; k + 1 < o->apps && r >= cum[k]; k++)
+        ;
+    if (k < sizeof(sAppNames) / sizeof(sAppNames[0]))
+        return sAppNames[k];
+    sprintf(buf, "App%02u", k);
+    return buf;
+}
+
+static unsigned Gen_Length(const GenOptions *o)
+{
+    uint32_t span;
+    uint32_t a;
+    uint32_t b;
+    uint32_t c;
+    uint32_t pick;
+
+    span = o->maxLen - o->minLen + 1;
+    a = Gen_Below(span);
+    if (o->shape == 'u')
+        return o->minLen + a;
+
+    /* The least (or greatest) of three draws */
+    b = Gen_Below(span);
+    c = Gen_Below(span);
+    if (o->shape == 's')
+        pick = (a < b) ? ((a < c) ? a : c) : ((b < c) ? b : c);
+    else
+        pick = (a > b) ? ((a > c) ? a : c) : ((b > c) ? b : c);
+    return o->minLen + pick;
+}
+
+/* Words and numbers up to len characters, cut at exactly len */
+static void Gen_Message(unsigned len, char *msg)
+{
+    unsigned pos;
+    int n;
+
+    pos = 0;
+    while (pos < len)
+    {
+        if (pos > 0)
+            msg[pos++] = ' ';
+        if (Gen_Below(5) == 0)
+            n = sprintf(msg + pos, "%lu", (unsigned long)Gen_Below(10000));
+        else
+            n = sprintf(msg + pos, "%s", sWords[Gen_Below(sizeof(sWords) / sizeof(sWords[0]))]);
+        pos += (unsigned)n;
+    }
+    msg[len] = 0;
+}
+
+static void Gen_Put16(unsigned char *p, uint16_t v)
+{
+    p[0] = (unsigned char)(v >> 8);
+    p[1] = (unsigned char)v;
+}
+
+static void Gen_Put32(unsigned char *p, uint32_t v)
+{
+    p[0] = (unsigned char)(v >> 24);
+    p[1] = (unsigned char)(v >> 16);
+    p[2] = (unsigned char)(v >> 8);
+    p[3] = (unsigned char)v;
+}
+
+/* An unsampled v2 record without fields, as LogDB_Log writes it */
+static size_t Gen_Encode(unsigned char *dst, uint32_t secs, uint32_t ticks, const char *app,
+                         const char *msg, size_t msgLen)
+{
+    size_t appLen;
+
+    appLen = strlen(app);
+    dst[0] = LOG_REC_V2;
+    dst[1] = (unsigned char)appLen;
+    Gen_Put16(dst + 2, (uint16_t)msgLen);
+    Gen_Put32(dst + 4, secs);
+    Gen_Put32(dst + 8, ticks);
+    dst[12] = 0;
+    memcpy(dst + LOG_REC_V2_HEADER, app, appLen + 1);
+    memcpy(dst + LOG_REC_V2_HEADER + appLen + 1, msg, msgLen);
+    dst[LOG_REC_V2_HEADER + appLen + 1 + msgLen] = 0;
+    return LOG_REC_V2_HEADER + appLen + 1 + msgLen + 1;
+}
+
+/* --- Output --- */
+
+static uint32_t Gen_Crc(uint32_t crc, const unsigned char *p, size_t len)
+{
+    int k;
+
+    crc = ~crc;
+    while (len-- > 0)
+    {
+        crc ^= *p++;
+        for (k = 0; k < 8; k++)
+            crc = (crc >> 1) ^ (0xEDB88320UL & (0 - (crc & 1)));
+    }
+    return ~crc;
+}
+
+static int Gen_Write(FILE *fp, const void *p, size_t len, uint32_t *crcP)
+{
+    *crcP = Gen_Crc(*crcP, (const unsigned char *)p, len);
+    return fwrite(p, 1, len, fp) == len;
+}
+
+static int Gen_WritePdb(const GenOptions *o, const unsigned char *data, const size_t *offsets,
+                        uint32_t lastSecs, uint32_t *crcP)
+{
+    unsigned char hdr[LOG_PDB_HEADER];
+    unsigned char entry[LOG_PDB_ENTRY];
+    unsigned char pad[2];
+    size_t base;
+    unsigned long i;
+    FILE *fp;
+    int ok;
+
+    fp = fopen(o->pdbPath, "wb");
+    if (fp == NULL)
+    {
+        perror(o->pdbPath);
+        return 0;
+    }
+
+    memset(hdr, 0, sizeof(hdr));
+    strcpy((char *)hdr, LOG_PDB_NAME);
+    Gen_Put16(hdr + 32, LOG_PDB_ATTR_BACKUP);
+    Gen_Put32(hdr + 36, o->start);           /* created */
+    Gen_Put32(hdr + 40, lastSecs);           /* modified */
+    Gen_Put32(hdr + 48, (uint32_t)o->records); /* modification number */
+    Gen_Put32(hdr + 60, LOG_PDB_TYPE);
+    Gen_Put32(hdr + 64, LOG_PDB_CREATOR);
+    Gen_Put32(hdr + 68, (uint32_t)o->records); /* unique ID seed */
+    Gen_Put16(hdr + 76, (uint16_t)o->records);
+
+    *crcP = 0;
+    ok = Gen_Write(fp, hdr, sizeof(hdr), crcP);
+    base = LOG_PDB_HEADER + LOG_PDB_ENTRY * o->records + sizeof(pad);
+    for (i = 0; ok && i < o->records; i++)
+    {
+        Gen_Put32(entry, (uint32_t)(base + offsets[i]));
+        entry[4] = 0;
+        entry[5] = (unsigned char)((i + 1) >> 16);
+        entry[6] = (unsigned char)((i + 1) >> 8);
+        entry[7] = (unsigned char)(i + 1);
+        ok = Gen_Write(fp, entry, sizeof(entry), crcP);
+    }
+    memset(pad, 0, sizeof(pad));
+    if (ok)
+        ok = Gen_Write(fp, pad, sizeof(pad), crcP);
+    if (ok)
+        ok = Gen_Write(fp, data, offsets[o->records], crcP);
+    if (fclose(fp) != 0)
+        ok = 0;
+    if (!ok)
+        perror(o->pdbPath);
+    return ok;
+}
+
+/* --- Options --- */
+
+static int Gen_Usage(const char *argv0)
+{
+    fprintf(stderr,
+            "usage: %s [-n records] [-s seed] [-a apps[:skew]] [-m min:max[:u|s|l]]\n"
+            "          [-t start] [-i mean] [-b percent] [-j jumps[:secs]] [-l out.lgs]\n"
+            "          [-c crc] out.pdb\n",
+            argv0);
+    return 2;
+}
+
+static int Gen_Parse(int argc, char **argv, GenOptions *o)
+{
+    const char *v;
+    char *end;
+    int i;
+
+    memset(o, 0, sizeof(*o));
+    o->records = 1000;
+    o->seed = 1;
+    o->apps = 4;
+    o->skew = 1;
+    o->minLen = 8;
+    o->maxLen = 48;
+    o->shape = 's';
+    o->start = GEN_DEFAULT_START;
+    o->mean = 2;
+    o->burst = 20;
+    o->jumpSecs = 86400;
+
+    for (i = 1; i < argc; i++)
+    {
+        if (argv[i][0] != '-' || argv[i][1] == 0 || argv[i][2] != 0)
+        {
+            if (o->pdbPath != NULL || i != argc - 1)
+                return 0;
+            o->pdbPath = argv[i];
+            continue;
+        }
+        if (i + 1 >= argc)
+            return 0;
+        v = argv[++i];
+        switch (argv[i - 1][1])
+        {
+        case 'n':
+            o->records = strtoul(v, &end, 10);
+            break;
+        case 's':
+            o->seed = (uint32_t)strtoul(v, &end, 10);
+            break;
+        case 'a':
+            o->apps = (unsigned)strtoul(v, &end, 10);
+            if (*end == ':')
+                o->skew = (unsigned)strtoul(end + 1, &end, 10);
+            break;
+        case 'm':
+            o->minLen = (unsigned)strtoul(v, &end, 10);
+            if (*end != ':')
+                return 0;
+            o->maxLen = (unsigned)strtoul(end + 1, &end, 10);
+            if (*end == ':' && end[1] != 0 && end[2] == 0)
+            {
+                o->shape = end[1];
+                end += 2;
+            }
+            break;
+        case 't':
+            o->start = (uint32_t)strtoul(v, &end, 10);
+            break;
+        case 'i':
+            o->mean = strtoul(v, &end, 10);
+            break;
+        case 'b':
+            o->burst = (unsigned)strtoul(v, &end, 10);
+            break;
+        case 'j':
+            o->jumps = (unsigned)strtoul(v, &end, 10);
+            if (*end == ':')
+                o->jumpSecs = strtoul(end + 1, &end, 10);
+            break;
+        case 'l':
+            o->lgsPath = v;
+            end = (char *)"";
+            break;
+        case 'c':
+            o->crc = v;
+            end = (char *)"";
+            break;
+        default:
+            return 0;
+        }
+        if (*end != 0)
+            return 0;
+    }
+
+    return o->pdbPath != NULL && o->records >= 1 && o->records <= LOG_PDB_MAX_RECORDS &&
+           o->apps >= 1 && o->apps <= GEN_MAX_APPS && o->skew <= 3 && o->minLen >= 1 &&
+           o->minLen <= o->maxLen && o->maxLen <= GEN_MAX_MSG &&
+           (o->shape == 'u' || o->shape == 's' || o->shape == 'l') && o->burst <= 100 &&
+           o->jumps <= 10000 && o->jumpSecs >= 1;
+}
+
+int main(int argc, char **argv)
+{
+    GenOptions o;
+    unsigned long cum[GEN_MAX_APPS];
+    unsigned char frame[2 + LOG_VFS_BLOCK];
+    char msg[GEN_MAX_MSG + 1];
+    char appBuf[16];
+    const char *app;
+    unsigned char *data;
+    size_t *offsets;
+    size_t len;
+    size_t cut;
+    uint32_t secs;
+    uint32_t ticks;
+    uint32_t gap;
+    uint32_t delta;
+    uint32_t crc;
+    unsigned long jumped;
+    unsigned long i;
+    FILE *lgs;
+
+    if (!Gen_Parse(argc, argv, &o))
+        return Gen_Usage(argv[0]);
+
+    data = (unsigned char *)malloc(o.records * (LOG_REC_V2_HEADER + 32 + GEN_MAX_MSG + 1));
+    offsets = (size_t *)malloc((o.records + 1) * sizeof(size_t));
+    if (data == NULL || offsets == NULL)
+    {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+
+    lgs = NULL;
+    if (o.lgsPath != NULL)
+    {
+        lgs = fopen(o.lgsPath, "wb");
+        Gen_Put32(frame, LOG_VFS_MAGIC);
+        if (lgs == NULL || fwrite(frame, 1, 4, lgs) != 4)
+        {
+            perror(o.lgsPath);
+            return 1;
+        }
+    }
+
+    sState = (o.seed != 0) ? o.seed : 1;
+    Gen_AppWeights(&o, cum);
+    secs = o.start;
+    ticks = Gen_Below(100000);
+    jumped = 0;
+    offsets[0] = 0;
+    for (i = 0; i < o.records; i++)
+    {
+        /* Uptime ticks keep counting through clock changes */
+        if (i > 0 && Gen_Below(100) < o.burst)
+        {
+            gap = 0;
+            ticks += 1 + Gen_Below(5);
+        }
+        else
+        {
+            gap = (i > 0) ? Gen_Below((uint32_t)(2 * o.mean + 1)) : 0;
+            ticks += gap * 100 + Gen_Below(100);
+        }
+        if (o.jumps > 0 && Gen_Below(10000) < o.jumps)
+        {
+            delta = 1 + Gen_Below((uint32_t)o.jumpSecs);
+            secs = Gen_Below(2) ? secs + delta : secs - delta;
+            jumped++;
+        }
+        secs += gap;
+
+        app = Gen_App(&o, cum, appBuf);
+        Gen_Message(Gen_Length(&o), msg);
+        len = Gen_Encode(data + offsets[i], secs, ticks, app, msg, strlen(msg));
+        offsets[i + 1] = offsets[i] + len;
+
+        /* On the card a frame fits in a block: the message is cut to fit */
+        if (lgs != NULL)
+        {
+            cut = (2 + len > LOG_VFS_BLOCK) ? 2 + len - LOG_VFS_BLOCK : 0;
+            len = Gen_Encode(frame + 2, secs, ticks, app, msg, strlen(msg) - cut);
+            Gen_Put16(frame, (uint16_t)len);
+            if (fwrite(frame, 1, 2 + len, lgs) != 2 + len)
+            {
+                perror(o.lgsPath);
+                return 1;
+            }
+        }
+    }
+    if (lgs != NULL && fclose(lgs) != 0)
+    {
+        perror(o.lgsPath);
+        return 1;
+    }
+
+    if (!Gen_WritePdb(&o, data, offsets, secs, &crc))
+        return 1;
+    printf("%s: %lu records, %lu bytes, %lu clock changes, crc %08lx\n", o.pdbPath, o.records,
+           (unsigned long)(LOG_PDB_HEADER + LOG_PDB_ENTRY * o.records + 2 + offsets[o.records]),
+           jumped, (unsigned long)crc);
+    free(data);
+    free(offsets);
+
+    if (o.crc != NULL && strtoul(o.crc, NULL, 16) != crc)
+    {
+        fprintf(stderr, "%s: crc %08lx, expected %s\n", o.pdbPath, (unsigned long)crc, o.crc);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,405 @@
+/*
+    LogMerge: one history from the DebugLog backups of many HotSyncs.
+
+    LogDB_ArchiveTrim drops from the device whatever a HotSync has backed
+    up, so from then on the history is in the backups. HotSync keeps only
+    the last backup of each DB, so copy the Backup folder away after each
+    sync, each to a directory of its own, and give LogMerge every .pdb
+    file of every copy:
+
+        LogMerge [-o merged.lgs] [-c count] backup.pdb...
+
+    Every LogDB PDB among the files is read ("DebugLog" and its segments,
+    packed or not; anything else is skipped) and the records are printed
+    oldest first, by seconds and then ticks, as LogTail prints them. With
+    -o they are written as a card stream file instead, which LogTail reads;
+    records too long for a card frame are left out of it. -c exits 1
+    unless count records come out.
+
+    The same record is often in more than one backup (a segment backed up
+    before the sync that let it be trimmed, the records a trim copied
+    back), but one sync's DBs never share one. Records are compared as the
+    v2 bytes LogDB_Log would write for them, whatever form they were read
+    in, and each is kept as many times as the one sync (directory) with
+    the most copies of it holds, so repeats logged in the same tick
+    survive.
+*/
+
+#include <stdlib.h>
+
+#include "LogFormat.h"
+
+#define MERGE_MAX_FILES 4096
+
+typedef struct
+{
+    unsigned char *bytes; /* v2 record */
+    size_t len;
+    uint32_t secs;
+    uint32_t ticks;
+    int sync; /* files from the same directory are one sync's backup */
+} MergeRecord;
+
+static MergeRecord *sRecs;
+static size_t sNumRecs;
+static size_t sCapRecs;
+
+static void Merge_Put16(unsigned char *p, uint16_t v)
+{
+    p[0] = (unsigned char)(v >> 8);
+    p[1] = (unsigned char)v;
+}
+
+static void Merge_Put32(unsigned char *p, uint32_t v)
+{
+    Merge_Put16(p, (uint16_t)(v >> 16));
+    Merge_Put16(p + 2, (uint16_t)v);
+}
+
+/* r as a v2 record, added to sRecs; 0 if it does not fit one. */
+static int Merge_Add(const LogRecord *r, int sync)
+{
+    MergeRecord *m;
+    unsigned char *p;
+    size_t hdr;
+    size_t appLen;
+    size_t msgLen;
+
+    appLen = strlen(r->app);
+    msgLen = strlen(r->msg);
+    if (appLen > 255 || msgLen > 65535 || r->fieldsLen > 255)
+        return 0;
+    if (sNumRecs == sCapRecs)
+    {
+        sCapRecs = (sCapRecs > 0) ? 2 * sCapRecs : 4096;
+        sRecs = (MergeRecord *)realloc(sRecs, sCapRecs * sizeof(MergeRecord));
+        if (sRecs == NULL)
+        {
+            fprintf(stderr, "out of memory\n");
+            exit(1);
+        }
+    }
+
+    hdr = LOG_REC_V2_HEADER + (r->rate > 1 ? 2 : 0);
+    m = &sRecs[sNumRecs];
+    m->len = hdr + appLen + 1 + msgLen + 1 + r->fieldsLen;
+    m->bytes = (unsigned char *)malloc(m->len);
+    if (m->bytes == NULL)
+    {
+        fprintf(stderr, "out of memory\n");
+        exit(1);
+    }
+    p = m->bytes;
+    p[0] = LOG_REC_V2 | (r->rate > 1 ? LOG_RECF_SAMPLED : 0);
+    p[1] = (unsigned char)appLen;
+    Merge_Put16(p + 2, (uint16_t)msgLen);
+    Merge_Put32(p + 4, r->secs);
+    Merge_Put32(p + 8, r->ticks);
+    p[12] = (unsigned char)r->fieldsLen;
+    if (r->rate > 1)
+        Merge_Put16(p + LOG_REC_V2_HEADER, (uint16_t)r->rate);
+    memcpy(p + hdr, r->app, appLen + 1);
+    memcpy(p + hdr + appLen + 1, r->msg, msgLen + 1);
+    memcpy(p + hdr + appLen + 1 + msgLen + 1, r->fields, r->fieldsLen);
+    m->secs = r->secs;
+    m->ticks = r->ticks;
+    m->sync = sync;
+    sNumRecs++;
+    return 1;
+}
+
+static int Merge_CompareOffsets(const void *a, const void *b)
+{
+    uint32_t x = *(const uint32_t *)a;
+    uint32_t y = *(const uint32_t *)b;
+
+    return (x < y) ? -1 : (x > y);
+}
+
+/* Where the record at off ends: the next offset in the sorted bounds. */
+static uint32_t Merge_End(const uint32_t *bounds, size_t n, uint32_t off)
+{
+    size_t lo;
+    size_t hi;
+    size_t mid;
+
+    lo = 0;
+    hi = n;
+    while (lo < hi)
+    {
+        mid = lo + (hi - lo) / 2;
+        if (bounds[mid] <= off)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return bounds[lo]; /* the file size is always last */
+}
+
+/* The records of one backed-up PDB. Returns 0 if the file cannot be read;
+   a PDB of any other DB is skipped with a note. */
+static int Merge_ReadPdb(const char *path, int sync)
+{
+    unsigned char *data;
+    uint32_t *bounds;
+    LogRecord rec;
+    uint32_t type;
+    uint32_t off;
+    uint32_t end;
+    size_t numRecs;
+    size_t numBounds;
+    size_t bad;
+    long size;
+    size_t i;
+    unsigned count;
+    unsigned k;
+    FILE *fp;
+
+    fp = fopen(path, "rb");
+    if (fp == NULL || fseek(fp, 0, SEEK_END) != 0 || (size = ftell(fp)) < 0)
+    {
+        perror(path);
+        return 0;
+    }
+    rewind(fp);
+    data = (unsigned char *)malloc((size_t)size + 1);
+    if (data == NULL || fread(data, 1, (size_t)size, fp) != (size_t)size)
+    {
+        perror(path);
+        return 0;
+    }
+    fclose(fp);
+
+    if (size < LOG_PDB_HEADER + 2)
+    {
+        fprintf(stderr, "%s: not a PDB\n", path);
+        free(data);
+        return 0;
+    }
+    type = Log_Get32(data + 60);
+    if (Log_Get32(data + 64) != LOG_PDB_CREATOR || (type != LOG_PDB_TYPE && type != LOG_SEG_TYPE))
+    {
+        fprintf(stderr, "%s: not a LogDB log, skipped\n", path);
+        free(data);
+        return 1;
+    }
+    numRecs = Log_Get16(data + 76);
+    if ((size_t)size < LOG_PDB_HEADER + LOG_PDB_ENTRY * numRecs)
+    {
+        fprintf(stderr, "%s: record list cut short\n", path);
+        free(data);
+        return 0;
+    }
+
+    /* A record runs up to whatever comes next: another record, the
+       AppInfo or SortInfo block, or the end of the file */
+    bounds = (uint32_t *)malloc((numRecs + 3) * sizeof(uint32_t));
+    if (bounds == NULL)
+    {
+        fprintf(stderr, "out of memory\n");
+        exit(1);
+    }
+    numBounds = 0;
+    for (i = 0; i < numRecs; i++)
+        bounds[numBounds++] = Log_Get32(data + LOG_PDB_HEADER + LOG_PDB_ENTRY * i);
+    if (Log_Get32(data + 52) != 0)
+        bounds[numBounds++] = Log_Get32(data + 52);
+    if (Log_Get32(data + 56) != 0)
+        bounds[numBounds++] = Log_Get32(data + 56);
+    qsort(bounds, numBounds, sizeof(uint32_t), Merge_CompareOffsets);
+    bounds[numBounds] = (uint32_t)size;
+
+    bad = 0;
+    for (i = 0; i < numRecs; i++)
+    {
+        off = Log_Get32(data + LOG_PDB_HEADER + LOG_PDB_ENTRY * i);
+        end = Merge_End(bounds, numBounds + 1, off);
+        if (off >= (uint32_t)size || end > (uint32_t)size)
+        {
+            bad++;
+            continue;
+        }
+        count = Log_BlockCount(data + off, end - off);
+        if (count > 0)
+        {
+            for (k = 0; k < count; k++)
+            {
+                if (!Log_DecodeBlockEntry(data + off, end - off, k, &rec) || !Merge_Add(&rec, sync))
+                    bad++;
+            }
+        }
+        else if (!Log_DecodeRecord(data + off, end - off, &rec) || !Merge_Add(&rec, sync))
+        {
+            bad++;
+        }
+    }
+    if (bad > 0)
+        fprintf(stderr, "%s: %lu damaged records left out\n", path, (unsigned long)bad);
+    free(bounds);
+    free(data);
+    return 1;
+}
+
+/* Oldest first; equal records together, grouped by sync */
+static int Merge_Compare(const void *a, const void *b)
+{
+    const MergeRecord *x = (const MergeRecord *)a;
+    const MergeRecord *y = (const MergeRecord *)b;
+    int c;
+
+    if (x->secs != y->secs)
+        return (x->secs < y->secs) ? -1 : 1;
+    if (x->ticks != y->ticks)
+        return (x->ticks < y->ticks) ? -1 : 1;
+    if (x->len != y->len)
+        return (x->len < y->len) ? -1 : 1;
+    c = memcmp(x->bytes, y->bytes, x->len);
+    if (c != 0)
+        return c;
+    return x->sync - y->sync;
+}
+
+static int Merge_Same(const MergeRecord *x, const MergeRecord *y)
+{
+    return x->len == y->len && memcmp(x->bytes, y->bytes, x->len) == 0;
+}
+
+/* Length of the directory part of path ("" for a bare name) */
+static size_t Merge_DirLen(const char *path)
+{
+    const char *slash;
+
+    slash = strrchr(path, '/');
+    return (slash != NULL) ? (size_t)(slash - path) : 0;
+}
+
+/* Which sync paths[i] belongs to: the first of paths[0..i] in the same
+   directory. */
+static int Merge_Sync(char **paths, int i)
+{
+    size_t len;
+    int k;
+
+    len = Merge_DirLen(paths[i]);
+    for (k = 0; k < i; k++)
+    {
+        if (Merge_DirLen(paths[k]) == len && strncmp(paths[k], paths[i], len) == 0)
+            break;
+    }
+    return k;
+}
+
+static int Merge_Usage(const char *argv0)
+{
+    fprintf(stderr, "usage: %s [-o merged.lgs] [-c count] backup.pdb...\n", argv0);
+    return 2;
+}
+
+int main(int argc, char **argv)
+{
+    unsigned char frame[4];
+    const char *outPath;
+    const char *expect;
+    LogRecord rec;
+    unsigned long out;
+    unsigned long skipped;
+    size_t copies;
+    size_t most;
+    size_t i;
+    size_t j;
+    size_t k;
+    int files;
+    int n;
+    FILE *lgs;
+
+    outPath = NULL;
+    expect = NULL;
+    for (n = 1; n + 1 < argc && argv[n][0] == '-'; n += 2)
+    {
+        if (strcmp(argv[n], "-o") == 0)
+            outPath = argv[n + 1];
+        else if (strcmp(argv[n], "-c") == 0)
+            expect = argv[n + 1];
+        else
+            return Merge_Usage(argv[0]);
+    }
+    if (n >= argc || argc - n > MERGE_MAX_FILES)
+        return Merge_Usage(argv[0]);
+
+    for (files = 0; n + files < argc; files++)
+    {
+        if (!Merge_ReadPdb(argv[n + files], Merge_Sync(argv + n, files)))
+            return 1;
+    }
+    qsort(sRecs, sNumRecs, sizeof(MergeRecord), Merge_Compare);
+
+    lgs = NULL;
+    if (outPath != NULL)
+    {
+        lgs = fopen(outPath, "wb");
+        Merge_Put32(frame, LOG_VFS_MAGIC);
+        if (lgs == NULL || fwrite(frame, 1, 4, lgs) != 4)
+        {
+            perror(outPath);
+            return 1;
+        }
+    }
+    out = 0;
+    skipped = 0;
+    for (i = 0; i < sNumRecs; i = j)
+    {
+        /* The largest number of copies any one sync has */
+        most = 0;
+        for (j = i; j < sNumRecs && Merge_Same(&sRecs[i], &sRecs[j]); j = k)
+        {
+            for (k = j; k < sNumRecs && sRecs[k].sync == sRecs[j].sync &&
+                        Merge_Same(&sRecs[i], &sRecs[k]);
+                 k++)
+                ;
+            copies = k - j;
+            if (copies > most)
+                most = copies;
+        }
+
+        for (copies = 0; copies < most; copies++)
+        {
+            if (lgs == NULL)
+            {
+                Log_DecodeRecord(sRecs[i].bytes, sRecs[i].len, &rec);
+                Log_PrintRecord(stdout, &rec);
+            }
+            else if (2 + sRecs[i].len > LOG_VFS_BLOCK)
+            {
+                skipped++;
+                continue;
+            }
+            else
+            {
+                Merge_Put16(frame, (uint16_t)sRecs[i].len);
+                fwrite(frame, 1, 2, lgs);
+                fwrite(sRecs[i].bytes, 1, sRecs[i].len, lgs);
+            }
+            out++;
+        }
+    }
+    for (i = 0; i < sNumRecs; i++)
+        free(sRecs[i].bytes);
+    free(sRecs);
+
+    if (lgs != NULL && (ferror(lgs) || fclose(lgs) != 0))
+    {
+        perror(outPath);
+        return 1;
+    }
+    fprintf(stderr, "%lu records from %d files", out, files);
+    if (skipped > 0)
+        fprintf(stderr, ", %lu too long for a card frame", skipped);
+    fputc('\n', stderr);
+
+    if (expect != NULL && strtoul(expect, NULL, 10) != out)
+    {
+        fprintf(stderr, "expected %s records\n", expect);
+        return 1;
+    }
+    return 0;
+}
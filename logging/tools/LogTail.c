@@ -0,0 +1,209 @@
+/*
+    LogTail: print the records of a LogDB card stream file.
+
+    Copy DebugLog.lgs off the card (or point at the card reader's mount)
+    and run:
+
+        LogTail [-f] /media/card/PALM/Programs/LogDB/DebugLog.lgs
+
+    -f keeps the file open and prints frames as the device appends them,
+    like tail -f. A frame is only printed once all of it has arrived, and a
+    file that shrinks (LogDB_ClearAll on the device) is read again from the
+    start.
+*/
+
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "LogFormat.h"
+
+#define TAIL_POLL_USECS 250000
+#define TAIL_MAX_APPS 64
+
+typedef struct
+{
+    char app[32];
+    unsigned long records;
+    unsigned long calls;
+} TailCount;
+
+static TailCount sCounts[TAIL_MAX_APPS];
+static int sNumCounts;
+
+static void Tail_Count(const LogRecord *rec)
+{
+    int i;
+
+    for (i = 0; i < sNumCounts; i++)
+    {
+        if (strcmp(sCounts[i].app, rec->app) == 0)
+            break;
+    }
+    if (i == sNumCounts)
+    {
+        if (sNumCounts == TAIL_MAX_APPS)
+            i = TAIL_MAX_APPS - 1; /* lump the overflow into the last row */
+        else
+            snprintf(sCounts[sNumCounts++].app, sizeof(sCounts[0].app), "%.31s", rec->app);
+    }
+    sCounts[i].records++;
+    sCounts[i].calls += Log_RecordWeight(rec);
+}
+
+static void Tail_PrintCounts(void)
+{
+    int i;
+
+    printf("%-31s %10s %10s\n", "app", "records", "calls");
+    for (i = 0; i < sNumCounts; i++)
+        printf("%-31s %10lu %10lu\n", sCounts[i].app, sCounts[i].records, sCounts[i].calls);
+}
+
+/* Read one frame at the current position. 1 = got it, 0 = not all there
+   yet (position restored), -1 = damaged. */
+static int Tail_ReadFrame(FILE *fp, unsigned char *buf, size_t *lenP)
+{
+    unsigned char lenBuf[2];
+    long start;
+    size_t len;
+
+    start = ftell(fp);
+    if (fread(lenBuf, 1, 2, fp) != 2)
+    {
+        clearerr(fp);
+        fseek(fp, start, SEEK_SET);
+        return 0;
+    }
+    len = Log_Get16(lenBuf);
+    if (len < LOG_MIN_RECORD || len > LOG_VFS_BLOCK - 2)
+        return -1;
+    if (fread(buf, 1, len, fp) != len)
+    {
+        clearerr(fp);
+        fseek(fp, start, SEEK_SET);
+        return 0;
+    }
+    *lenP = len;
+    return 1;
+}
+
+static int Tail_CheckMagic(FILE *fp, const char *path)
+{
+    unsigned char magic[4];
+
+    if (fread(magic, 1, 4, fp) != 4 || Log_Get32(magic) != LOG_VFS_MAGIC)
+    {
+        fprintf(stderr, "%s: not a LogDB stream file\n", path);
+        return 0;
+    }
+    return 1;
+}
+
+/* Current size of the file at path (-1 while it does not exist). */
+static long Tail_PathSize(const char *path)
+{
+    struct stat sb;
+
+    if (stat(path, &sb) != 0)
+        return -1;
+    return (long)sb.st_size;
+}
+
+int main(int argc, char **argv)
+{
+    unsigned char buf[LOG_VFS_BLOCK];
+    const char *path;
+    LogRecord rec;
+    size_t len;
+    int follow;
+    int count;
+    int rc;
+    FILE *fp;
+
+    follow = 0;
+    count = 0;
+    path = NULL;
+    if (argc == 3 && strcmp(argv[1], "-f") == 0)
+    {
+        follow = 1;
+        path = argv[2];
+    }
+    else if (argc == 3 && strcmp(argv[1], "-c") == 0)
+    {
+        count = 1;
+        path = argv[2];
+    }
+    else if (argc == 2)
+    {
+        path = argv[1];
+    }
+    if (path == NULL)
+    {
+        fprintf(stderr, "usage: %s [-f | -c] DebugLog.lgs\n", argv[0]);
+        return 2;
+    }
+
+    fp = fopen(path, "rb");
+    if (fp == NULL)
+    {
+        perror(path);
+        return 1;
+    }
+    if (!Tail_CheckMagic(fp, path))
+    {
+        fclose(fp);
+        return 1;
+    }
+
+    for (;;)
+    {
+        rc = Tail_ReadFrame(fp, buf, &len);
+        if (rc > 0)
+        {
+            if (!Log_DecodeRecord(buf, len, &rec))
+                continue;
+            if (count)
+                Tail_Count(&rec);
+            else
+                Log_PrintRecord(stdout, &rec);
+            continue;
+        }
+        if (rc < 0)
+        {
+            fprintf(stderr, "%s: damaged frame at offset %ld\n", path, ftell(fp) - 2);
+            fclose(fp);
+            return 1;
+        }
+        if (!follow)
+            break;
+
+        fflush(stdout);
+        usleep(TAIL_POLL_USECS);
+
+        /* Cleared on the device (deleted and recreated): reopen the path
+           and start over once the new header is there */
+        if (Tail_PathSize(path) < ftell(fp))
+        {
+            fclose(fp);
+            while (Tail_PathSize(path) < 4)
+                usleep(TAIL_POLL_USECS);
+            fp = fopen(path, "rb");
+            if (fp == NULL)
+            {
+                perror(path);
+                return 1;
+            }
+            if (!Tail_CheckMagic(fp, path))
+            {
+                fclose(fp);
+                return 1;
+            }
+        }
+    }
+
+    fclose(fp);
+    if (count)
+        Tail_PrintCounts();
+    return 0;
+}